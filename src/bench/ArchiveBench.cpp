@@ -0,0 +1,213 @@
+// Scan cost of the hot tables before and after archiving, and what a
+// background archive pass costs the writers running alongside it.
+//
+// A catalogue of `titles` titles and `history` closed loans spread over
+// three years is seeded; `retired`% of the titles are then retired and
+// loans closed more than a year ago archived, with an issue + return loop
+// timed while the pass runs.
+//
+// usage: ArchiveBench [titles] [history] [retired%] [batch-rows]
+#include "../persistence/ArchiveManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../services/ReportService.h"
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+template <typename F>
+static double medianMs(int runs, F&& f) {
+    std::vector<double> ms;
+    for (int r = 0; r < runs; ++r) {
+        auto t0 = SteadyClock::now();
+        f();
+        ms.push_back(std::chrono::duration<double, std::milli>(SteadyClock::now() - t0).count());
+    }
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+static void exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << sql << ": " << (err ? err : "?") << "\n";
+        sqlite3_free(err);
+        std::exit(1);
+    }
+}
+
+struct Scans {
+    double walk, all, search, history, historyScan;
+};
+
+static Scans measure(AssetRepository& assets, ReportService& reports, DatabaseManager& db) {
+    Scans s{};
+    s.walk = medianMs(5, [&] {
+        for (auto b = assets.page("", 1000); !b.empty(); b = assets.page(b.back().id(), 1000))
+            if (b.size() < 1000) break;
+    });
+    s.all = medianMs(5, [&] { assets.getAll(); });
+    s.search = medianMs(21, [&] { assets.searchRanked("river", 20); });
+    s.history = medianMs(21, [&] { reports.history("U17", 20); });
+    s.historyScan = medianMs(5, [&] {
+        sqlite3_stmt* st = nullptr;
+        sqlite3_prepare_v2(db.get(), "SELECT count(*), sum(return_date - issue_date) FROM loan_history;", -1, &st,
+                           nullptr);
+        sqlite3_step(st);
+        sqlite3_finalize(st);
+    });
+    return s;
+}
+
+int main(int argc, char** argv) {
+    int titles     = argc > 1 ? std::stoi(argv[1]) : 200000;
+    int history    = argc > 2 ? std::stoi(argv[2]) : 1000000;
+    int retiredPct = argc > 3 ? std::stoi(argv[3]) : 40;
+    int batchRows  = argc > 4 ? std::stoi(argv[4]) : 500;
+    const int readers = 2000;
+    const time_t day = 24 * 60 * 60;
+
+    auto dir = fs::temp_directory_path();
+    auto path = (dir / "lm_archive_bench.db").string(), archivePath = (dir / "lm_archive_bench_cold.db").string();
+    for (auto& p : {path, archivePath})
+        for (auto suffix : {"", "-wal", "-shm", "-journal"}) fs::remove(p + suffix);
+
+    auto clock = std::make_shared<ManualClock>(1'700'000'000);
+    auto db = std::make_shared<DatabaseManager>(path, DurabilityProfile::Balanced);
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users = std::make_shared<UserRepository>(db);
+    ReportService reports(db, clock);
+
+    std::cout << "seeding " << titles << " titles, " << history << " closed loans..." << std::flush;
+    static const char* words[] = {"river", "stone", "night", "garden", "empire", "winter", "glass", "harbor",
+                                  "silent", "crown", "orchard", "lantern", "ember", "meadow", "cipher", "tide"};
+    std::mt19937 rng(42);
+    db->write([&] {
+        for (int u = 0; u < readers; ++u) users->add({"U" + std::to_string(u), "Reader", Role::User, "x"});
+        sqlite3_stmt* st = nullptr;
+        sqlite3_prepare_v2(db->get(),
+                           "INSERT INTO assets (ext_id, type, title, author_or_owner, copies, available) "
+                           "VALUES (?, 1, ?, ?, 1, 1);",
+                           -1, &st, nullptr);
+        for (int t = 0; t < titles; ++t) {
+            char id[16];
+            std::snprintf(id, sizeof id, "B%07d", t);
+            std::string title = std::string(words[rng() % 16]) + " " + words[rng() % 16] + " " + std::to_string(t);
+            std::string author = std::string("Author ") + words[rng() % 16];
+            sqlite3_bind_text(st, 1, id, -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(st, 2, title.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(st, 3, author.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(st);
+            sqlite3_reset(st);
+        }
+        sqlite3_finalize(st);
+        exec(db->get(), "INSERT INTO type_stats (type, copies) SELECT type, count(*) FROM assets GROUP BY type;");
+        sqlite3_prepare_v2(db->get(),
+                           "INSERT INTO loan_history (asset_id, user_id, issue_date, return_date) "
+                           "VALUES (?, (SELECT id FROM users WHERE ext_id = ?), ?, ?);",
+                           -1, &st, nullptr);
+        // Returns spread evenly over the last three years, oldest first.
+        time_t span = 3 * 365 * day;
+        for (int h = 0; h < history; ++h) {
+            time_t ret = clock->now() - span + span * h / history;
+            std::string user = "U" + std::to_string(rng() % readers);
+            sqlite3_bind_int64(st, 1, 1 + static_cast<sqlite3_int64>(rng() % titles));
+            sqlite3_bind_text(st, 2, user.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(st, 3, ret - static_cast<time_t>(1 + rng() % 21) * day);
+            sqlite3_bind_int64(st, 4, ret);
+            sqlite3_step(st);
+            sqlite3_reset(st);
+        }
+        sqlite3_finalize(st);
+    });
+    exec(db->get(), "ANALYZE;");
+    std::cout << " done\n";
+
+    auto before = measure(*assets, reports, *db);
+
+    ArchiveOptions options;
+    options.path = archivePath;
+    options.batchRows = batchRows;
+    ArchiveManager archive(db, options, clock);
+    int toRetire = static_cast<int>(static_cast<long>(titles) * retiredPct / 100);
+    auto t0 = SteadyClock::now();
+    for (int t = 0; t < toRetire; ++t) {
+        char id[16];
+        std::snprintf(id, sizeof id, "B%07d", static_cast<int>(static_cast<long>(t) * titles / toRetire));
+        archive.retire(id);
+    }
+    double retireUs = std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count() / toRetire;
+
+    // A title kept in circulation for the writer loop.
+    assets->add({"HOT", AssetType::Book, "Hot", "Writer"});
+    LoanService loans(assets, users, clock);
+    auto* out = std::cout.rdbuf(nullptr);   // services narrate every call
+    std::vector<double> idleUs;
+    for (int i = 0; i < 200; ++i) {
+        auto s = SteadyClock::now();
+        loans.issueAsset("HOT", "U1");
+        loans.returnAsset("HOT", "U1");
+        idleUs.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - s).count());
+    }
+
+    std::atomic<bool> done{false};
+    std::vector<double> busyUs;
+    std::thread writer([&] {
+        while (!done) {
+            auto s = SteadyClock::now();
+            loans.issueAsset("HOT", "U1");
+            loans.returnAsset("HOT", "U1");
+            busyUs.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - s).count());
+        }
+    });
+    auto summary = archive.archiveNow().get();
+    done = true;
+    writer.join();
+    std::cout.rdbuf(out);
+    exec(db->get(), "ANALYZE;");
+    exec(db->get(), "PRAGMA main.wal_checkpoint(TRUNCATE);");
+    auto after = measure(*assets, reports, *db);
+    // Deleted rows leave free space on the pages they were on; VACUUM
+    // packs what is left.
+    exec(db->get(), "VACUUM main;");
+    auto packed = measure(*assets, reports, *db);
+
+    auto pct = [](std::vector<double> v, double p) {
+        std::sort(v.begin(), v.end());
+        return v.empty() ? 0.0 : v[std::min(v.size() - 1, static_cast<std::size_t>(p * v.size()))];
+    };
+    std::cout << std::fixed << std::setprecision(2)
+              << "retire: " << retireUs << " us per title\n"
+              << "archive pass: " << summary.assets << " titles, " << summary.loanRecords << " loan records in "
+              << summary.batches << " batches, " << summary.elapsedMs / 1000.0 << " s\n"
+              << "issue+return while idle:    p50 " << pct(idleUs, 0.5) << " us, p99 " << pct(idleUs, 0.99)
+              << " us\n"
+              << "issue+return during pass:   p50 " << pct(busyUs, 0.5) << " us, p99 " << pct(busyUs, 0.99)
+              << " us, max " << pct(busyUs, 1.0) << " us (" << busyUs.size() << " loops)\n\n"
+              << "                          before     after  after VACUUM\n";
+    auto row = [&](const char* name, double Scans::*m) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::setw(8) << before.*m << " ms"
+                  << std::setw(8) << after.*m << " ms" << std::setw(8) << packed.*m << " ms\n";
+    };
+    row("page() walk, all titles", &Scans::walk);
+    row("getAll()", &Scans::all);
+    row("search 'river' top 20", &Scans::search);
+    row("history(user) top 20", &Scans::history);
+    row("loan_history full scan", &Scans::historyScan);
+}
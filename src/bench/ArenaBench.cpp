@@ -0,0 +1,147 @@
+// Allocator calls and latency of typical commands with and without a
+// CommandArena: the staff listing (pages of 1000 with the borrower of each
+// loaned title), getAll(), a ranked search and a single lookup. Global
+// operator new is replaced to count calls; SQLite's own allocations go
+// through malloc and are the same either way, so they are not counted.
+//
+// usage: ArenaBench [assets] [reps]
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../util/Arena.h"
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static std::atomic<long> newCalls{0};
+
+void* operator new(std::size_t n) {
+    newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, std::align_val_t a) {
+    newCalls.fetch_add(1, std::memory_order_relaxed);
+    auto align = static_cast<std::size_t>(a);
+    if (void* p = std::aligned_alloc(align, (n + align - 1) / align * align)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+static void exec(sqlite3* db, const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << sql << ": " << (err ? err : "?") << "\n";
+        std::exit(1);
+    }
+}
+
+struct Result {
+    double allocs;   // operator new calls per command
+    double us;       // median latency
+};
+
+template <typename F>
+static Result measure(int reps, bool arena, F&& command) {
+    std::vector<double> us;
+    long calls = 0;
+    for (int i = 0; i < reps; ++i) {
+        long before = newCalls.load();
+        auto t0 = SteadyClock::now();
+        if (arena) {
+            CommandArena scope;
+            command();
+        } else {
+            command();
+        }
+        us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count());
+        calls += newCalls.load() - before;
+    }
+    std::sort(us.begin(), us.end());
+    return {static_cast<double>(calls) / reps, us[us.size() / 2]};
+}
+
+int main(int argc, char** argv) {
+    int assets = argc > 1 ? std::stoi(argv[1]) : 20'000;
+    int reps   = argc > 2 ? std::stoi(argv[2]) : 21;
+
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assetRepo = std::make_shared<AssetRepository>(db);
+    auto userRepo  = std::make_shared<UserRepository>(db);
+    LoanService loans(assetRepo, userRepo);
+    db->write([&] {
+        exec(db->get(), "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " +
+                            std::to_string(assets) + ") "
+                            "INSERT INTO assets (ext_id, type, title, author_or_owner, copies, available) "
+                            "SELECT printf('B%07d', i), 1, 'A river through the glass, volume ' || i, "
+                            "'Author number ' || (i % 997), 2, 2 FROM n;");
+        exec(db->get(), "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 2000) "
+                        "INSERT INTO users (ext_id, name, password_hash) "
+                        "SELECT printf('U%06d', i), 'Reader with a longer name ' || i, 'x' FROM n;");
+        // Every tenth title has one copy out.
+        exec(db->get(), "INSERT INTO loans (asset_id, user_id, issue_date) "
+                        "SELECT id, 1 + id % 2000, 1700000000 FROM assets WHERE id % 10 = 0;");
+        exec(db->get(), "UPDATE assets SET available = 1 WHERE id % 10 = 0;");
+    });
+
+    // What the staff listing does, minus the rendering.
+    auto listing = [&] {
+        std::size_t bytes = 0;
+        for (auto batch = assetRepo->page("", 1000); !batch.empty();
+             batch = assetRepo->page(batch.back().id(), 1000)) {
+            for (auto& a : batch) {
+                bytes += a.title().size();
+                if (a.onLoan() == 0) continue;
+                if (auto lo = loans.loanInfo(a.id()))
+                    if (auto u = userRepo->find(lo->userId)) bytes += u->name().size();
+            }
+            if (batch.size() < 1000) break;
+        }
+        return bytes;
+    };
+
+    struct Case {
+        const char*           name;
+        std::function<void()> run;
+    };
+    std::vector<Case> cases = {
+        {"listing", [&] { listing(); }},
+        {"getAll", [&] { assetRepo->getAll(); }},
+        {"search", [&] { assetRepo->searchRanked("river glass", 20); }},
+        {"find+loan", [&] {
+             for (int i = 10; i <= 1000; i += 10) {
+                 char id[16];
+                 std::snprintf(id, sizeof id, "B%07d", i);
+                 if (auto a = assetRepo->find(id)) loans.loanInfo(a->id());
+             }
+         }},
+    };
+
+    std::cout << assets << " assets, median of " << reps << " runs\n\n"
+              << "command       new() heap   new() arena      ms heap    ms arena\n";
+    for (auto& c : cases) {
+        measure(3, false, c.run);   // warm the statement cache
+        auto heap = measure(reps, false, c.run);
+        auto arena = measure(reps, true, c.run);
+        std::cout << std::left << std::setw(10) << c.name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(14) << heap.allocs << std::setw(14) << arena.allocs << std::setprecision(2)
+                  << std::setw(13) << heap.us / 1000 << std::setw(12) << arena.us / 1000 << "\n";
+    }
+}
@@ -0,0 +1,92 @@
+// Issue/return latency with and without an online backup running.
+//
+// usage: BackupBench [assets] [ops] [pages-per-step]
+#include "../persistence/AssetRepository.h"
+#include "../persistence/BackupManager.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+struct Latency { double p50, p99, max; };
+
+static Latency issueReturn(LoanService& loans, long assets, int ops) {
+    std::vector<double> us;
+    auto* out = std::cout.rdbuf(nullptr);   // LoanService narrates every call
+    for (int i = 0; i < ops; ++i) {
+        auto id = "A" + std::to_string((i * 7919L) % assets);
+        auto t0 = SteadyClock::now();
+        loans.issueAsset(id, "U0");
+        loans.returnAsset(id);
+        us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count());
+    }
+    std::cout.rdbuf(out);
+    std::cout.clear();
+    std::sort(us.begin(), us.end());
+    return {us[us.size() / 2], us[us.size() * 99 / 100], us.back()};
+}
+
+int main(int argc, char** argv) {
+    long assets = argc > 1 ? std::stol(argv[1]) : 200000;
+    int  ops    = argc > 2 ? std::stoi(argv[2]) : 2000;
+    int  pages  = argc > 3 ? std::stoi(argv[3]) : 64;
+
+    auto path = fs::temp_directory_path() / "lm_backup_bench.db";
+    auto dir  = fs::temp_directory_path() / "lm_backup_bench";
+    for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+    fs::remove_all(dir);
+    {
+        auto db = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Balanced);
+        db->initializeSchema();
+        auto assetRepo = std::make_shared<AssetRepository>(db);
+        auto userRepo  = std::make_shared<UserRepository>(db);
+        LoanService loans(assetRepo, userRepo);
+        userRepo->add({"U0", "Reader", Role::User, "x"});
+        db->write([&] {
+            for (long i = 0; i < assets; ++i)
+                assetRepo->add({"A" + std::to_string(i), AssetType::Book,
+                                "Title " + std::to_string(i) + " of a long running series", "Author"});
+        });
+        std::cout << "database " << fs::file_size(path) / (1024 * 1024) << " MiB, " << ops
+                  << " issue+return pairs, " << pages << " pages per step\n\n";
+
+        auto idle = issueReturn(loans, assets, ops);
+
+        BackupOptions options;
+        options.directory = dir.string();
+        options.pagesPerStep = pages;
+        options.keep = 1;
+        auto& backups = db->enableBackups(options);
+        std::atomic<bool> stop{false};
+        std::thread snapshots([&] { while (!stop) backups.backupNow().get(); });
+        auto busy = issueReturn(loans, assets, ops);
+        stop = true;
+        snapshots.join();
+        auto p = backups.progress();
+
+        std::cout << "                | p50 us | p99 us | max us\n"
+                  << "--------------------------------------------\n" << std::fixed << std::setprecision(0)
+                  << "no backup       | " << std::setw(6) << idle.p50 << " | " << std::setw(6) << idle.p99
+                  << " | " << std::setw(6) << idle.max << "\n"
+                  << "during backups  | " << std::setw(6) << busy.p50 << " | " << std::setw(6) << busy.p99
+                  << " | " << std::setw(6) << busy.max << "\n\n"
+                  << p.completed << " snapshots, last took " << p.lastDurationMs << " ms, "
+                  << p.steps << " steps, " << p.yields << " yields to writers\n";
+    }
+    for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+    fs::remove_all(dir);
+    return 0;
+}
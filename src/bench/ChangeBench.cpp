@@ -0,0 +1,101 @@
+// Cost of cross-process change detection: an idle externalChanges() poll,
+// a poll that picks up a burst of another connection's commits, and what
+// the change_log triggers add to an issue + return. File database in the
+// temp directory, balanced profile (WAL).
+//
+// usage: ChangeBench [assets] [pairs]
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+
+#include <sqlite3.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using SteadyClock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+static void exec(sqlite3* db, const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << sql << ": " << (err ? err : "?") << "\n";
+        std::exit(1);
+    }
+}
+
+static double since(SteadyClock::time_point t0) {
+    return std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int assets = argc > 1 ? std::stoi(argv[1]) : 100'000;
+    int pairs  = argc > 2 ? std::stoi(argv[2]) : 5'000;
+    auto path = fs::temp_directory_path() / "change_bench.db";
+    auto cleanup = [&] {
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+    };
+    cleanup();
+
+    auto writer = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Balanced);
+    writer->initializeSchema();
+    writer->write([&] {
+        exec(writer->get(), "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " +
+                                std::to_string(assets) + ") INSERT INTO assets (ext_id, type, title, author_or_owner) "
+                                "SELECT 'B' || i, 1, 'Title ' || i, 'Author' FROM n;");
+        exec(writer->get(), "INSERT INTO users (ext_id, name, password_hash) VALUES ('U1', 'Reader', 'x');");
+    });
+    auto assetRepo = std::make_shared<AssetRepository>(writer);
+    auto userRepo = std::make_shared<UserRepository>(writer);
+    LoanService loans(assetRepo, userRepo);
+
+    auto reader = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Balanced);
+    reader->externalChanges();
+
+    // Idle: nobody commits.
+    const int polls = 100'000;
+    auto t0 = SteadyClock::now();
+    for (int i = 0; i < polls; ++i) reader->externalChanges();
+    double idleUs = since(t0) / polls;
+
+    // Issue + return pairs, with the change log and without it.
+    auto* out = std::cout.rdbuf(nullptr);
+    auto run = [&](int pairs) {
+        auto t = SteadyClock::now();
+        for (int i = 0; i < pairs; ++i) {
+            auto id = "B" + std::to_string(1 + i % assets);
+            loans.issueAsset(id, "U1");
+            loans.returnAsset(id, "U1");
+        }
+        return since(t) / pairs;
+    };
+    run(pairs / 10);   // warm up
+    reader->externalChanges();
+    double loggedUs = run(pairs);
+    std::cout.rdbuf(out);
+
+    t0 = SteadyClock::now();
+    auto burst = reader->externalChanges();
+    double burstUs = since(t0);
+
+    writer->write([&] {
+        exec(writer->get(), "DROP TRIGGER loans_log_ai; DROP TRIGGER loans_log_ad; DROP TRIGGER holds_log_au;");
+    });
+    out = std::cout.rdbuf(nullptr);
+    run(pairs / 10);
+    double plainUs = run(pairs);
+    std::cout.rdbuf(out);
+
+    std::cout << assets << " assets, " << pairs << " issue + return pairs\n\n" << std::fixed << std::setprecision(2)
+              << "idle poll                  " << std::setw(10) << idleUs << " us\n"
+              << "poll after the pairs       " << std::setw(10) << burstUs / 1000 << " ms ("
+              << burst.assetIds.size() << " assets, " << burst.userIds.size() << " users)\n"
+              << "issue + return, logged     " << std::setw(10) << loggedUs << " us\n"
+              << "issue + return, no log     " << std::setw(10) << plainUs << " us\n";
+
+    cleanup();
+}
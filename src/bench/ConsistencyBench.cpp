@@ -0,0 +1,84 @@
+// Time for ConsistencyChecker::check() over a file database at several
+// worker counts, and for repair() after scattering damage through it.
+// The database is built once in the temp directory and removed at the end.
+//
+// usage: ConsistencyBench [assets] [damaged]
+#include "../persistence/ConsistencyChecker.h"
+#include "../persistence/DatabaseManager.h"
+
+#include <sqlite3.h>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static void exec(sqlite3* db, const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << sql << ": " << (err ? err : "?") << "\n";
+        std::exit(1);
+    }
+}
+
+int main(int argc, char** argv) {
+    long assets  = argc > 1 ? std::stol(argv[1]) : 2'000'000;
+    long damaged = argc > 2 ? std::stol(argv[2]) : 10'000;
+    auto path = std::filesystem::temp_directory_path() / "consistency_bench.db";
+    std::filesystem::remove(path);
+
+    auto db = std::make_shared<DatabaseManager>(path.string());
+    db->initializeSchema();
+    auto n = std::to_string(assets);
+    auto t0 = SteadyClock::now();
+    db->write([&] {
+        exec(db->get(), "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 200000) "
+                        "INSERT INTO users (ext_id, name, password_hash) SELECT 'U' || i, 'Reader ' || i, 'x' FROM n;");
+        exec(db->get(), "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " + n + ") "
+                        "INSERT INTO assets (ext_id, type, title, author_or_owner, copies, available) "
+                        "SELECT 'B' || i, 1 + i % 3, 'Title ' || i, 'Author', 3, 3 - (i % 4 = 0) - (i % 12 = 0) FROM n;");
+        // A quarter of the titles have a copy out, a twelfth a hold ready.
+        exec(db->get(), "INSERT INTO loans (asset_id, user_id, issue_date) "
+                        "SELECT id, 1 + id % 200000, 1700000000 FROM assets WHERE id % 4 = 0;");
+        exec(db->get(), "INSERT INTO holds (asset_id, user_id, placed_at, ready_at) "
+                        "SELECT id, 1 + (id * 7) % 200000, 1700000000, 1700000000 FROM assets WHERE id % 12 = 0;");
+        exec(db->get(), "DELETE FROM type_stats;");
+        exec(db->get(), "INSERT INTO type_stats (type, copies, on_loan) "
+                        "SELECT type, sum(copies), sum(id % 4 = 0) FROM assets GROUP BY type;");
+    });
+    std::cout << assets << " assets, " << assets / 4 << " loans, " << assets / 12 << " holds, 200000 users ("
+              << std::chrono::duration<double>(SteadyClock::now() - t0).count() << " s to build)\n\n";
+
+    std::cout << "threads   check ms   issues\n";
+    for (std::size_t threads : {1, 2, 4}) {
+        ConsistencyChecker checker(db, {.threads = threads});
+        checker.check();   // warm the page cache
+        auto report = checker.check();
+        std::cout << std::setw(7) << threads << std::fixed << std::setprecision(0) << std::setw(11)
+                  << report.elapsedMs << std::setw(9) << report.issues.size() << "\n";
+    }
+
+    // Damage spread over the whole id range: orphaned loans, users gone,
+    // shelf counters off by one.
+    auto step = std::to_string(assets / damaged * 4 + 1);
+    db->write([&] {
+        exec(db->get(), "UPDATE loans SET asset_id = asset_id + 100000000 WHERE id % " + step + " = 0;");
+        exec(db->get(), "DELETE FROM users WHERE id % " + step + " = 1;");
+        exec(db->get(), "UPDATE assets SET available = available - 1 WHERE id % " + step + " = 2;");
+    });
+    ConsistencyChecker checker(db);
+    auto report = checker.check();
+    auto r0 = SteadyClock::now();
+    auto changed = checker.repair(report);
+    double repairMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - r0).count();
+    auto after = checker.check();
+    std::cout << "\ndamaged: " << report.issues.size() << " issues found in " << std::setprecision(0)
+              << report.elapsedMs << " ms\nrepair:  " << changed << " rows changed in " << repairMs
+              << " ms\nafter:   " << after.issues.size() << " issues\n";
+
+    db.reset();
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,87 @@
+// Write throughput and SQLite memory use for each durability profile,
+// with and without group commit.
+//
+// usage: DurabilityBench [writes] [threads]
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../models/Asset.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+static void removeDb(const fs::path& p) {
+    fs::remove(p);
+    fs::remove(p.string() + "-wal");
+    fs::remove(p.string() + "-shm");
+    fs::remove(p.string() + "-journal");
+}
+
+struct Result {
+    double        opsPerSec;
+    std::uint64_t commits;
+    sqlite3_int64 memHighwater;
+};
+
+static Result runOnce(DurabilityProfile profile, int writes, int threads, bool group) {
+    auto path = fs::temp_directory_path() / "lm_durability_bench.db";
+    removeDb(path);
+    Result r{};
+    {
+        auto db = std::make_shared<DatabaseManager>(path.string(), profile);
+        db->initializeSchema();
+        AssetRepository repo(db);
+        if (group) db->enableGroupCommit(std::chrono::milliseconds(2));
+        sqlite3_memory_highwater(1);
+
+        auto start = SteadyClock::now();
+        std::vector<std::thread> workers;
+        int perThread = writes / threads;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < perThread; ++i) {
+                    auto id = std::to_string(t) + "-" + std::to_string(i);
+                    repo.add({id, AssetType::Book, "Benchmark title " + id, "Bench Author"});
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        double secs = std::chrono::duration<double>(SteadyClock::now() - start).count();
+
+        db->disableGroupCommit();
+        r.opsPerSec = perThread * threads / secs;
+        r.commits = db->commitCount();
+        r.memHighwater = sqlite3_memory_highwater(0);
+    }
+    removeDb(path);
+    return r;
+}
+
+int main(int argc, char** argv) {
+    int writes  = argc > 1 ? std::stoi(argv[1]) : 2000;
+    int threads = argc > 2 ? std::stoi(argv[2]) : 8;
+
+    std::cout << "writes=" << writes << " threads=" << threads << "\n\n"
+              << "profile   | mode          | writes/s   | commits | sqlite mem peak\n"
+              << "----------------------------------------------------------------\n";
+    for (auto p : {DurabilityProfile::Default, DurabilityProfile::Durable,
+                   DurabilityProfile::Balanced, DurabilityProfile::Fast}) {
+        for (bool group : {false, true}) {
+            auto r = runOnce(p, writes, threads, group);
+            std::cout << std::left << std::setw(9) << durabilityProfileToString(p) << " | "
+                      << std::setw(13) << (group ? "group-commit" : "per-write") << " | "
+                      << std::right << std::setw(10) << std::fixed << std::setprecision(0) << r.opsPerSec << " | "
+                      << std::setw(7) << r.commits << " | "
+                      << std::setw(8) << r.memHighwater / 1024 << " KiB\n";
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Cost of EventBus::publish by subscriber and producer count, against a
+// mutex + condition variable queue doing the same fan-out. Subscribers
+// count events and do nothing else, so this is the bus's own overhead.
+//
+// usage: EventBench [events-per-producer]
+#include "../util/EventBus.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+// The obvious alternative: one locked deque per subscriber.
+class LockedBus {
+public:
+    explicit LockedBus(int subscribers) : _queues(subscribers) {
+        for (auto& q : _queues) q.thread = std::thread([&q] { drain(q); });
+    }
+    ~LockedBus() {
+        for (auto& q : _queues) {
+            { std::lock_guard<std::mutex> lock(q.mutex); q.stopping = true; }
+            q.cv.notify_one();
+            q.thread.join();
+        }
+    }
+    void publish(const DomainEvent& e) {
+        for (auto& q : _queues) {
+            { std::lock_guard<std::mutex> lock(q.mutex); q.events.push_back(e); }
+            q.cv.notify_one();
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex              mutex;
+        std::condition_variable cv;
+        std::deque<DomainEvent> events;
+        bool                    stopping = false;
+        std::thread             thread;
+    };
+    std::vector<Queue> _queues;
+
+    static void drain(Queue& q) {
+        std::deque<DomainEvent> batch;
+        while (true) {
+            std::unique_lock<std::mutex> lock(q.mutex);
+            q.cv.wait(lock, [&] { return q.stopping || !q.events.empty(); });
+            if (q.events.empty()) return;
+            batch.swap(q.events);
+            lock.unlock();
+            batch.clear();
+        }
+    }
+};
+
+template <typename Publish>
+static double nsPerPublish(int producers, long each, Publish&& publish) {
+    auto t0 = SteadyClock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&] {
+            for (long i = 0; i < each; ++i) publish(AssetIssued{"ASSET-1042", "USR-100417", i});
+        });
+    for (auto& t : threads) t.join();
+    return std::chrono::duration<double, std::nano>(SteadyClock::now() - t0).count() / (producers * each);
+}
+
+int main(int argc, char** argv) {
+    long each = argc > 1 ? std::stol(argv[1]) : 1000000;
+
+    std::cout << std::left << std::setw(14) << "subscribers" << std::setw(12) << "producers" << std::right
+              << std::setw(14) << "bus ns/op" << std::setw(16) << "locked ns/op" << std::setw(10) << "batch"
+              << "\n";
+    for (int subscribers : {1, 4}) {
+        for (int producers : {1, 4}) {
+            double busNs, lockedNs, avgBatch;
+            {
+                EventBus bus(1 << 16);
+                std::vector<EventBus::Subscription> subs;
+                for (int s = 0; s < subscribers; ++s)
+                    subs.push_back(bus.subscribe("s" + std::to_string(s), [](std::span<const DomainEvent>) {}));
+                busNs = nsPerPublish(producers, each, [&](const DomainEvent& e) { bus.publish(e); });
+                bus.flush();
+                auto stats = bus.stats();
+                avgBatch = static_cast<double>(stats[0].delivered) / std::max<std::uint64_t>(stats[0].batches, 1);
+            }
+            {
+                LockedBus locked(subscribers);
+                lockedNs = nsPerPublish(producers, each, [&](const DomainEvent& e) { locked.publish(e); });
+            }
+            std::cout << std::left << std::setw(14) << subscribers << std::setw(12) << producers << std::right
+                      << std::fixed << std::setprecision(1) << std::setw(14) << busNs << std::setw(16)
+                      << lockedNs << std::setw(10) << std::setprecision(0) << avgBatch << "\n";
+        }
+    }
+}
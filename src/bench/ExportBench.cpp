@@ -0,0 +1,101 @@
+// Export throughput and memory: `history` closed loans over `titles`
+// titles and `readers` users are exported as the loans table (one join per
+// side per row) in each format, with and without gzip, and peak RSS is
+// read before and after.
+//
+// usage: ExportBench [history] [titles] [readers]
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/Exporter.h"
+
+#include <sqlite3.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static void exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << sql << ": " << (err ? err : "?") << "\n";
+        sqlite3_free(err);
+        std::exit(1);
+    }
+}
+
+// Peak resident set so far, in MiB.
+static double peakRssMiB() {
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);)
+        if (line.rfind("VmHWM:", 0) == 0) return std::stod(line.substr(6)) / 1024;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    long history = argc > 1 ? std::stol(argv[1]) : 10'000'000;
+    int  titles  = argc > 2 ? std::stoi(argv[2]) : 100'000;
+    int  readers = argc > 3 ? std::stoi(argv[3]) : 20'000;
+
+    auto dir = fs::temp_directory_path();
+    auto path = (dir / "lm_export_bench.db").string();
+    auto out = (dir / "lm_export_bench").string();
+    for (auto suffix : {"", "-wal", "-shm", "-journal"}) fs::remove(path + suffix);
+    fs::remove_all(out);
+
+    auto db = std::make_shared<DatabaseManager>(path, DurabilityProfile::Fast);
+    db->initializeSchema();
+    std::cout << "seeding " << history << " loans..." << std::flush;
+    db->write([&] {
+        exec(db->get(), ("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " +
+                         std::to_string(titles) + ") "
+                         "INSERT INTO assets (ext_id, type, title, author_or_owner) "
+                         "SELECT printf('B%07d', i), 1, 'Title number ' || i, 'Author ' || (i % 997) FROM n;")
+                            .c_str());
+        exec(db->get(), ("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " +
+                         std::to_string(readers) + ") "
+                         "INSERT INTO users (ext_id, name, password_hash) "
+                         "SELECT printf('U%06d', i), 'Reader ' || i, 'x' FROM n;")
+                            .c_str());
+        sqlite3_stmt* st = nullptr;
+        sqlite3_prepare_v2(db->get(),
+                           "INSERT INTO loan_history (asset_id, user_id, issue_date, return_date) VALUES (?, ?, ?, ?);",
+                           -1, &st, nullptr);
+        std::mt19937 rng(42);
+        for (long h = 0; h < history; ++h) {
+            sqlite3_int64 issued = 1'600'000'000 + h * 7;
+            sqlite3_bind_int64(st, 1, 1 + rng() % titles);
+            sqlite3_bind_int64(st, 2, 1 + rng() % readers);
+            sqlite3_bind_int64(st, 3, issued);
+            sqlite3_bind_int64(st, 4, issued + 86400 * (1 + rng() % 21));
+            sqlite3_step(st);
+            sqlite3_reset(st);
+        }
+        sqlite3_finalize(st);
+    });
+    exec(db->get(), "PRAGMA wal_checkpoint(TRUNCATE);");
+    std::cout << " done\npeak RSS after seeding: " << std::fixed << std::setprecision(1) << peakRssMiB()
+              << " MiB\n\n";
+
+    struct Case {
+        const char*  name;
+        ExportFormat format;
+        bool         gzip;
+    };
+    std::cout << "format          rows       MiB      s    Mrows/s   peak RSS\n";
+    for (auto c : {Case{"csv", ExportFormat::Csv, false}, Case{"jsonl", ExportFormat::Jsonl, false},
+                   Case{"columnar", ExportFormat::Columnar, false}, Case{"csv.gz", ExportFormat::Csv, true}}) {
+        if (c.gzip && !Exporter::gzipAvailable()) continue;
+        ExportOptions options;
+        options.format = c.format;
+        options.gzip = c.gzip;
+        auto s = Exporter(db, options).run({ExportTable::Loans}, out)[0];
+        std::cout << std::left << std::setw(10) << c.name << std::right << std::setw(10) << s.rows
+                  << std::setw(10) << s.bytes / 1048576.0 << std::setw(7) << s.elapsedMs / 1000
+                  << std::setw(11) << s.rows / s.elapsedMs / 1000 << std::setw(8) << peakRssMiB() << " MiB\n";
+        fs::remove_all(out);
+    }
+}
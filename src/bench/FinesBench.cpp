@@ -0,0 +1,91 @@
+// Nightly fines run over a large open-loan table: snapshot, parallel
+// accrual and chunked ledger writes, at a few worker counts. Each count
+// gets a fresh copy of the same database, and a second night is run to
+// show the incremental case.
+//
+// usage: FinesBench [loans] [max-threads]
+#include "../persistence/DatabaseManager.h"
+#include "../services/FinesJob.h"
+
+#include <sqlite3.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static const time_t day = 24 * 60 * 60;
+static const time_t today = 1'700'000'000 / day * day;
+
+static void exec(sqlite3* db, const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "SQL failed: " << (err ? err : "?") << "\n";
+        std::exit(1);
+    }
+}
+
+// Loans up to 60 days old spread over 100k titles and 50k readers; about
+// two thirds are past the loan period.
+static void build(const fs::path& path, long loans) {
+    const long titles = 100000, readers = 50000;
+    {
+        DatabaseManager db(path.string(), DurabilityProfile::Fast);
+        db.initializeSchema();
+    }
+    sqlite3* db = nullptr;
+    sqlite3_open(path.string().c_str(), &db);
+    exec(db, "BEGIN;");
+    exec(db, "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " +
+                 std::to_string(readers) + ") INSERT INTO users (id, ext_id, name, role, password_hash) "
+                 "SELECT i, 'U' || i, 'Reader', 0, 'x' FROM n;");
+    const long copies = loans / titles + 1;
+    exec(db, "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < " +
+                 std::to_string(titles) + ") INSERT INTO assets (id, ext_id, type, title, author_or_owner, "
+                 "copies, available) SELECT i, 'A' || i, CASE WHEN i % 10 THEN 1 ELSE 2 END, 'Title', "
+                 "'Author', " + std::to_string(copies) + ", 0 FROM n;");
+    sqlite3_stmt* s = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO loans (asset_id, user_id, issue_date) VALUES (?, ?, ?);", -1, &s, nullptr);
+    std::mt19937 rng(3);
+    for (long i = 0; i < loans; ++i) {
+        sqlite3_bind_int64(s, 1, i % titles + 1);
+        sqlite3_bind_int64(s, 2, rng() % readers + 1);
+        sqlite3_bind_int64(s, 3, today - static_cast<time_t>(rng() % (60 * day)));
+        sqlite3_step(s);
+        sqlite3_reset(s);
+    }
+    sqlite3_finalize(s);
+    exec(db, "COMMIT;");
+    sqlite3_close(db);
+}
+
+int main(int argc, char** argv) {
+    long loans     = argc > 1 ? std::stol(argv[1]) : 1000000;
+    int maxThreads = argc > 2 ? std::stoi(argv[2]) : 4;
+
+    auto seed = fs::temp_directory_path() / "lm_fines_seed.db";
+    auto path = fs::temp_directory_path() / "lm_fines_bench.db";
+    for (auto& p : {seed, path})
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(p.string() + suffix);
+    std::cout << "Building " << loans << " open loans...\n";
+    build(seed, loans);
+
+    std::cout << std::left << std::setw(9) << "threads" << std::right << std::setw(12) << "charged"
+              << std::setw(14) << "night 1 ms" << std::setw(14) << "night 2 ms" << std::setw(12) << "loans/s"
+              << "\n";
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+        fs::copy_file(seed, path);
+        auto db = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Balanced);
+        FinesJob job(db, FinePolicy{}, threads);
+        auto first  = job.run(today);
+        auto second = job.run(today + day);
+        std::cout << std::left << std::setw(9) << threads << std::right << std::setw(12) << first.accruals
+                  << std::fixed << std::setprecision(0) << std::setw(14) << first.elapsedMs << std::setw(14)
+                  << second.elapsedMs << std::setw(12) << first.loans / (first.elapsedMs / 1000) << "\n";
+    }
+    for (auto& p : {seed, path})
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(p.string() + suffix);
+}
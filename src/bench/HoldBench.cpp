@@ -0,0 +1,107 @@
+// Hold placement, cancellation and return-time hand-off on a title with a
+// long waiting list, at several queue lengths. Costs should stay flat as the
+// queue grows.
+//
+// usage: HoldBench [max-queue] [ops]
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/HoldService.h"
+#include "../services/LoanService.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+struct Latency { double p50, p99; };
+
+static Latency summarize(std::vector<double> us) {
+    std::sort(us.begin(), us.end());
+    return {us[us.size() / 2], us[us.size() * 99 / 100]};
+}
+
+template <typename F>
+static double timeUs(F&& f) {
+    auto t0 = SteadyClock::now();
+    f();
+    return std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int maxQueue = argc > 1 ? std::stoi(argv[1]) : 10000;
+    int ops      = argc > 2 ? std::stoi(argv[2]) : 500;
+
+    std::cout << std::left << std::setw(8) << "queue" << std::right
+              << std::setw(12) << "place p50" << std::setw(12) << "place p99"
+              << std::setw(12) << "cancel p50" << std::setw(12) << "cancel p99"
+              << std::setw(12) << "hand p50" << std::setw(12) << "hand p99" << "   (us)\n";
+
+    for (int queue = 100; queue <= maxQueue; queue *= 10) {
+        auto path = fs::temp_directory_path() / "lm_hold_bench.db";
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+        {
+            auto db = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Balanced);
+            db->initializeSchema();
+            auto assets = std::make_shared<AssetRepository>(db);
+            auto users  = std::make_shared<UserRepository>(db);
+            auto holds  = std::make_shared<HoldService>(assets, users);
+            LoanService loans(assets, users, systemClock(), holds);
+
+            int people = queue + ops + 1;
+            db->write([&] {
+                for (int i = 0; i < people; ++i)
+                    users->add({"U" + std::to_string(i), "Reader", Role::User, "x"});
+                assets->add({"HOT", AssetType::Book, "Bestseller", "Author", 3, 3});
+            });
+            auto* out = std::cout.rdbuf(nullptr);   // services narrate every call
+            for (int i = 0; i < 3; ++i) loans.issueAsset("HOT", "U" + std::to_string(people - 1 - i));
+
+            // Fill the queue; a few readers get priority.
+            std::mt19937 rng(queue);
+            std::vector<double> place;
+            for (int i = 0; i < queue; ++i) {
+                auto uid = "U" + std::to_string(i);
+                int prio = rng() % 20 == 0 ? 1 : 0;
+                double us = timeUs([&] { holds->placeHold("HOT", uid, prio); });
+                if (i >= queue - ops) place.push_back(us);
+            }
+
+            // Cancel random waiting holds, then put them back.
+            std::vector<double> cancel;
+            for (int i = 0; i < ops; ++i) {
+                auto uid = "U" + std::to_string(rng() % queue);
+                cancel.push_back(timeUs([&] { holds->cancelHold("HOT", uid); }));
+                holds->placeHold("HOT", uid);
+            }
+
+            // A copy comes back, goes to the head of the queue, is picked up;
+            // the returning reader rejoins at the back.
+            std::vector<double> hand;
+            for (int i = 0; i < ops; ++i) {
+                std::string reader(loans.loanInfo("HOT")->userId);
+                hand.push_back(timeUs([&] { loans.returnAsset("HOT", reader); }));
+                auto ready = holds->holdsFor("HOT").front();
+                loans.issueAsset("HOT", ready.userId);
+                holds->placeHold("HOT", reader);
+            }
+            std::cout.rdbuf(out);
+            std::cout.clear();
+
+            auto p = summarize(place), c = summarize(cancel), h = summarize(hand);
+            std::cout << std::left << std::setw(8) << holds->queueLength("HOT") << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(12) << p.p50 << std::setw(12) << p.p99
+                      << std::setw(12) << c.p50 << std::setw(12) << c.p99
+                      << std::setw(12) << h.p50 << std::setw(12) << h.p99 << "\n";
+        }
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+    }
+}
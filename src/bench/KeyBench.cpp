@@ -0,0 +1,200 @@
+// Table/index size and join speed of the original TEXT-keyed schema versus
+// integer row keys with interned external IDs. The integer database is made
+// by migrating a copy of the TEXT one, so both hold identical data.
+//
+// usage: KeyBench [assets] [users] [loans] [runs]
+#include "../persistence/DatabaseManager.h"
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+static void exec(sqlite3* db, const std::string& sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        std::cerr << "SQL failed: " << (err ? err : "?") << "\n";
+        std::exit(1);
+    }
+}
+
+static void buildLegacy(const fs::path& path, long assets, long users, long loans) {
+    sqlite3* db = nullptr;
+    sqlite3_open(path.string().c_str(), &db);
+    exec(db, R"(
+        CREATE TABLE users (id TEXT PRIMARY KEY, name TEXT NOT NULL,
+                            role TEXT NOT NULL DEFAULT 'user', password_hash TEXT NOT NULL);
+        CREATE TABLE assets (id TEXT PRIMARY KEY, type TEXT NOT NULL, title TEXT NOT NULL,
+                             author_or_owner TEXT NOT NULL, is_issued INTEGER NOT NULL DEFAULT 0);
+        CREATE TABLE loans (asset_id TEXT PRIMARY KEY, user_id TEXT NOT NULL, issue_date INTEGER,
+                            FOREIGN KEY(asset_id) REFERENCES assets(id),
+                            FOREIGN KEY(user_id)  REFERENCES users(id));
+        BEGIN;
+    )");
+    std::mt19937 rng(7);
+    sqlite3_stmt* s = nullptr;
+    sqlite3_prepare_v2(db, "INSERT INTO users VALUES (?, ?, ?, 'hash');", -1, &s, nullptr);
+    for (long i = 0; i < users; ++i) {
+        auto id = "USR-" + std::to_string(100000 + i);
+        sqlite3_bind_text(s, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(s, 2, ("Reader " + std::to_string(i)).c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(s, 3, i % 50 ? "user" : "staff", -1, SQLITE_STATIC);
+        sqlite3_step(s);
+        sqlite3_reset(s);
+    }
+    sqlite3_finalize(s);
+    sqlite3_prepare_v2(db, "INSERT INTO assets VALUES (?, ?, ?, 'Author', ?);", -1, &s, nullptr);
+    for (long i = 0; i < assets; ++i) {
+        auto id = "ASSET-" + std::to_string(1000000 + i);
+        sqlite3_bind_text(s, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(s, 2, i % 10 ? "book" : "laptop", -1, SQLITE_STATIC);
+        sqlite3_bind_text(s, 3, ("Title " + std::to_string(i)).c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(s, 4, i < loans);
+        sqlite3_step(s);
+        sqlite3_reset(s);
+    }
+    sqlite3_finalize(s);
+    sqlite3_prepare_v2(db, "INSERT INTO loans VALUES (?, ?, ?);", -1, &s, nullptr);
+    for (long i = 0; i < loans; ++i) {
+        auto aid = "ASSET-" + std::to_string(1000000 + i);
+        auto uid = "USR-" + std::to_string(100000 + rng() % users);
+        sqlite3_bind_text(s, 1, aid.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(s, 2, uid.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(s, 3, 1700000000 - static_cast<long>(rng() % (30 * 86400)));
+        sqlite3_step(s);
+        sqlite3_reset(s);
+    }
+    sqlite3_finalize(s);
+    exec(db, "COMMIT; VACUUM;");
+    sqlite3_close(db);
+}
+
+// Bytes per b-tree (table or index) from the dbstat virtual table.
+static std::map<std::string, long> sizes(sqlite3* db) {
+    std::map<std::string, long> out;
+    sqlite3_stmt* s = nullptr;
+    sqlite3_prepare_v2(db, "SELECT name, SUM(pgsize) FROM dbstat GROUP BY name;", -1, &s, nullptr);
+    while (sqlite3_step(s) == SQLITE_ROW)
+        out[reinterpret_cast<const char*>(sqlite3_column_text(s, 0))] = sqlite3_column_int64(s, 1);
+    sqlite3_finalize(s);
+    return out;
+}
+
+// Median wall time of running `sql` to completion with one text parameter.
+static double medianMs(sqlite3* db, const char* sql, const std::vector<std::string>& args, int runs) {
+    sqlite3_stmt* s = nullptr;
+    sqlite3_prepare_v2(db, sql, -1, &s, nullptr);
+    std::vector<double> ms;
+    for (int r = 0; r < runs; ++r) {
+        auto t0 = SteadyClock::now();
+        for (auto& a : args) {
+            if (sqlite3_bind_parameter_count(s) > 0) sqlite3_bind_text(s, 1, a.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(s) == SQLITE_ROW) {}
+            sqlite3_reset(s);
+        }
+        ms.push_back(std::chrono::duration<double, std::milli>(SteadyClock::now() - t0).count());
+    }
+    sqlite3_finalize(s);
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    long assets = argc > 1 ? std::stol(argv[1]) : 500000;
+    long users  = argc > 2 ? std::stol(argv[2]) : 50000;
+    long loans  = argc > 3 ? std::stol(argv[3]) : 100000;
+    int  runs   = argc > 4 ? std::stoi(argv[4]) : 5;
+
+    auto textPath = fs::temp_directory_path() / "lm_keys_text.db";
+    auto intPath  = fs::temp_directory_path() / "lm_keys_int.db";
+    for (auto& p : {textPath, intPath})
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(p.string() + suffix);
+
+    std::cout << "Building " << assets << " assets, " << users << " users, " << loans << " loans...\n";
+    buildLegacy(textPath, assets, users, loans);
+    fs::copy_file(textPath, intPath);
+
+    auto t0 = SteadyClock::now();
+    {
+        DatabaseManager db(intPath.string(), DurabilityProfile::Balanced);
+        db.initializeSchema();
+    }
+    std::cout << "Migration: " << std::fixed << std::setprecision(0)
+              << std::chrono::duration<double, std::milli>(SteadyClock::now() - t0).count() << " ms\n";
+
+    sqlite3 *text = nullptr, *ints = nullptr;
+    sqlite3_open(textPath.string().c_str(), &text);
+    sqlite3_open(intPath.string().c_str(), &ints);
+    exec(ints, "DROP TABLE assets_fts; VACUUM;");   // the TEXT copy has no search index
+
+    auto before = sizes(text), after = sizes(ints);
+    auto kb = [](long b) { return std::to_string(b / 1024) + " KB"; };
+    std::cout << "\n" << std::left << std::setw(36) << "b-tree" << std::right << std::setw(12) << "TEXT keys"
+              << std::setw(12) << "INT keys" << "\n";
+    long totalBefore = 0, totalAfter = 0;
+    for (auto& [name, bytes] : before) totalBefore += bytes;
+    for (auto& [name, bytes] : after) totalAfter += bytes;
+    std::map<std::string, std::pair<long, long>> rows;
+    for (auto& [name, bytes] : before) rows[name].first = bytes;
+    for (auto& [name, bytes] : after) rows[name].second = bytes;
+    for (auto& [name, pair] : rows) {
+        if (name.rfind("sqlite_schema", 0) == 0 || name == "sqlite_master") continue;
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(12)
+                  << (pair.first ? kb(pair.first) : "-") << std::setw(12)
+                  << (pair.second ? kb(pair.second) : "-") << "\n";
+    }
+    std::cout << std::left << std::setw(36) << "total" << std::right << std::setw(12) << kb(totalBefore)
+              << std::setw(12) << kb(totalAfter) << "\n\n";
+
+    // Overdue report: every loan joined to its asset (and, on the integer
+    // schema, to its borrower's external ID).
+    std::vector<std::string> none{""};
+    double overdueText = medianMs(text, R"(
+        SELECT l.asset_id, a.title, l.user_id, l.issue_date
+        FROM loans l JOIN assets a ON a.id = l.asset_id
+        WHERE l.issue_date < 1699000000 ORDER BY l.issue_date, l.asset_id;)", none, runs);
+    double overdueInt = medianMs(ints, R"(
+        SELECT a.ext_id, a.title, u.ext_id, l.issue_date
+        FROM loans l JOIN assets a ON a.id = l.asset_id JOIN users u ON u.id = l.user_id
+        WHERE l.issue_date < 1699000000 ORDER BY l.issue_date, a.ext_id;)", none, runs);
+
+    // Per-user loan counts: a loans->users join over the whole table.
+    double perUserText = medianMs(text, R"(
+        SELECT u.name, count(*) FROM loans l JOIN users u ON u.id = l.user_id GROUP BY u.id;)", none, runs);
+    double perUserInt = medianMs(ints, R"(
+        SELECT u.name, count(*) FROM loans l JOIN users u ON u.id = l.user_id GROUP BY u.id;)", none, runs);
+
+    // Point lookups by external ID, as the repositories issue them.
+    std::vector<std::string> ids;
+    std::mt19937 rng(11);
+    for (int i = 0; i < 20000; ++i) ids.push_back("ASSET-" + std::to_string(1000000 + rng() % loans));
+    double lookupText = medianMs(text, "SELECT user_id, issue_date FROM loans WHERE asset_id = ?;", ids, runs);
+    double lookupInt = medianMs(ints, R"(
+        SELECT u.ext_id, l.issue_date
+        FROM assets a JOIN loans l ON l.asset_id = a.id JOIN users u ON u.id = l.user_id
+        WHERE a.ext_id = ?;)", ids, runs);
+
+    std::cout << std::left << std::setw(36) << "query (median ms)" << std::right << std::setw(12) << "TEXT keys"
+              << std::setw(12) << "INT keys" << "\n" << std::setprecision(1);
+    auto row = [](const char* name, double a, double b) {
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(12) << a
+                  << std::setw(12) << b << "\n";
+    };
+    row("overdue report", overdueText, overdueInt);
+    row("loans per user", perUserText, perUserInt);
+    row("20k loan lookups by ext ID", lookupText, lookupInt);
+
+    sqlite3_close(text);
+    sqlite3_close(ints);
+    for (auto& p : {textPath, intPath})
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(p.string() + suffix);
+}
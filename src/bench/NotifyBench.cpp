@@ -0,0 +1,99 @@
+// Builds overdue digests the way checkAndNotifyOverdue() used to (a
+// stringstream per line, copied into a vector, then into a summary stream)
+// and with compiled NotificationTemplates rendered into reused buffers.
+// No database: the loans are generated up front so only message building
+// is timed. Global operator new is replaced to count calls.
+//
+// usage: NotifyBench [digests] [lines per digest]
+#include "../services/NotificationTemplate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static std::atomic<long> newCalls{0};
+
+void* operator new(std::size_t n) {
+    newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+struct Loan {
+    std::string asset, type, title, user, name;
+    long        days;
+};
+
+int main(int argc, char** argv) {
+    long digests = argc > 1 ? std::stol(argv[1]) : 100'000;
+    int  lines   = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    std::vector<Loan> loans;
+    for (int i = 0; i < 1000; ++i)
+        loans.push_back({"B" + std::to_string(100000 + i), i % 3 ? "book" : "laptop",
+                         "A river through the glass, volume " + std::to_string(i), "U" + std::to_string(i % 97),
+                         "Reader number " + std::to_string(i % 97), 15 + i % 40});
+
+    std::size_t sink = 0;
+    auto run = [&](const char* name, auto&& digest) {
+        long before = newCalls.load();
+        auto t0 = SteadyClock::now();
+        for (long d = 0; d < digests; ++d) sink += digest(d * lines);
+        double ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - t0).count();
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(10) << ms << std::setprecision(1) << std::setw(14)
+                  << static_cast<double>(newCalls.load() - before) / digests << "\n";
+    };
+
+    std::cout << digests << " digests of " << lines << " lines\n\n"
+              << "            total ms   new()/digest\n";
+
+    run("stringstream", [&](long first) {
+        std::vector<std::string> overdueMessages;
+        for (int i = 0; i < lines; ++i) {
+            auto& l = loans[(first + i) % loans.size()];
+            std::stringstream msg;
+            msg << "OVERDUE: " << l.asset << " | " << l.type << " | " << l.title << " | borrowed "
+                << static_cast<int>(l.days) << " days ago" << " by " << l.name;
+            std::string formatted = msg.str();
+            overdueMessages.push_back(formatted);
+        }
+        std::stringstream summary;
+        summary << "You have " << overdueMessages.size() << " overdue assets:\n";
+        for (auto& m : overdueMessages) summary << "- " << m << "\n";
+        std::string subject = "Overdue Assets Summary";
+        std::string body = summary.str();
+        return subject.size() + body.size();
+    });
+
+    OverdueTemplates templates;
+    std::string lineBuffer, subject, body;
+    run("template", [&](long first) {
+        lineBuffer.clear();
+        for (int i = 0; i < lines; ++i) {
+            auto& l = loans[(first + i) % loans.size()];
+            templates.line.renderTo(lineBuffer, {l.asset, l.type, l.title, l.user, l.name, l.days});
+        }
+        NotificationFields totals;
+        totals.count = lines;
+        subject.clear();
+        body.clear();
+        templates.subject.renderTo(subject, totals);
+        templates.header.renderTo(body, totals);
+        body += lineBuffer;
+        return subject.size() + body.size();
+    });
+
+    std::cout << "\n" << sink / 2 / digests << " bytes per digest\n";
+}
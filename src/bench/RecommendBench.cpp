@@ -0,0 +1,76 @@
+// Co-borrow recommendations at catalogue scale: cost per recorded issue,
+// recommend() latency, and the size and load time of the saved state.
+// Demand is skewed so popular titles build long neighbour lists.
+//
+// usage: RecommendBench [issues] [titles] [readers]
+#include "../services/RecommendationEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+static double since(SteadyClock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(SteadyClock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    long issues  = argc > 1 ? std::stol(argv[1]) : 1000000;
+    long titles  = argc > 2 ? std::stol(argv[2]) : 100000;
+    long readers = argc > 3 ? std::stol(argv[3]) : 50000;
+
+    std::vector<std::string> assetIds, userIds;
+    for (long i = 0; i < titles; ++i) assetIds.push_back("A" + std::to_string(i));
+    for (long i = 0; i < readers; ++i) userIds.push_back("U" + std::to_string(i));
+
+    // Title index ~ square of a uniform draw: the low IDs are in demand.
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::vector<std::pair<long, long>> trace;
+    for (long i = 0; i < issues; ++i) {
+        double u = unit(rng);
+        trace.emplace_back(static_cast<long>(u * u * titles) % titles, rng() % readers);
+    }
+
+    RecommendationEngine rec;
+    auto t0 = SteadyClock::now();
+    for (long i = 0; i < issues; ++i)
+        rec.recordIssue(assetIds[trace[i].first], userIds[trace[i].second], i);
+    double recordMs = since(t0);
+
+    std::vector<double> us;
+    for (int i = 0; i < 100000; ++i) {
+        double u = unit(rng);
+        auto& id = assetIds[static_cast<long>(u * u * titles) % titles];
+        auto q0 = SteadyClock::now();
+        auto r = rec.recommend(id, 5);
+        us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - q0).count());
+        if (r.size() > 5) return 1;
+    }
+    std::sort(us.begin(), us.end());
+
+    auto path = (fs::temp_directory_path() / "lm_rec_bench.bin").string();
+    t0 = SteadyClock::now();
+    rec.save(path);
+    double saveMs = since(t0);
+    RecommendationEngine loaded;
+    t0 = SteadyClock::now();
+    bool ok = loaded.load(path);
+    double loadMs = since(t0);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << issues << " issues, " << rec.titles() << " titles, " << rec.pairs() << " pairs\n"
+              << "record:    " << recordMs * 1e6 / issues / 1000 << " us/issue (" << recordMs << " ms total)\n"
+              << "recommend: p50 " << us[us.size() / 2] << " us, p99 " << us[us.size() * 99 / 100] << " us\n"
+              << "file:      " << fs::file_size(path) / 1024 << " KB ("
+              << static_cast<double>(fs::file_size(path)) / rec.pairs() << " bytes/pair), save "
+              << saveMs << " ms, load " << loadMs << " ms" << (ok ? "" : " FAILED") << "\n";
+    fs::remove(path);
+}
@@ -0,0 +1,88 @@
+// Cost of writing a large asset listing to a file: the old per-field
+// printAssetRow (pad lambda, substr and a stream insertion per cell)
+// against Renderer in each format, and against writing the finished bytes
+// in one go, which is the I/O floor.
+//
+// usage: RenderBench [rows]
+#include "../ui/Renderer.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+struct Row {
+    std::string id, type, title, author, status, extra;
+};
+
+// printAssetRow as it was before Renderer.
+static void legacyRow(std::ostream& out, const Row& r) {
+    auto pad = [&](const std::string& s, size_t w) {
+        return s.size() >= w ? s.substr(0, w) : s + std::string(w - s.size(), ' ');
+    };
+    out << pad(r.id, 5) << " | " << pad(r.type, 6) << " | " << pad(r.title, 22) << " | " << pad(r.author, 20)
+        << " | " << pad(r.status, 9) << " | " << r.extra << "\n";
+}
+
+static const std::vector<Renderer::Column> columns = {
+    {"ID", "id", 5}, {"Type", "type", 6}, {"Title", "title", 22}, {"Author/Owner", "author", 20},
+    {"Status", "status", 9}, {"Borrowed Info", "info", 0}};
+
+template <typename F>
+static void measure(const char* name, const fs::path& file, std::size_t rows, F&& write) {
+    auto t0 = SteadyClock::now();
+    {
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        write(out);
+    }
+    double s = std::chrono::duration<double>(SteadyClock::now() - t0).count();
+    double mb = static_cast<double>(fs::file_size(file)) / 1e6;
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << s * 1e9 / static_cast<double>(rows) << std::setw(10) << mb / s << std::setw(10)
+              << mb << "\n";
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    const char* titles[] = {"The Left Hand of Darkness", "Der Steppenwolf, Ausgabe für Bibliothekare",
+                            "三体 (The Three-Body Problem)", "Dune"};
+    std::vector<Row> rows(n);
+    for (std::size_t i = 0; i < n; ++i)
+        rows[i] = {"A" + std::to_string(i), i % 5 ? "book" : "laptop", titles[i % 4], "Author " + std::to_string(i % 997),
+                   i % 3 ? "Available" : "2 of 3", i % 3 ? "" : "borrowed " + std::to_string(i % 30) + "d by Reader"};
+
+    auto dir = fs::temp_directory_path() / "render_bench";
+    fs::create_directories(dir);
+    auto file = dir / "listing.out";
+
+    std::cout << std::left << std::setw(16) << "writer" << std::right << std::setw(10) << "ns/row" << std::setw(10)
+              << "MB/s" << std::setw(10) << "MB" << "\n";
+    measure("printAssetRow", file, n, [&](std::ostream& out) {
+        for (auto& r : rows) legacyRow(out, r);
+    });
+    for (auto [name, format] : {std::pair{"table", OutputFormat::Table}, std::pair{"csv", OutputFormat::Csv},
+                                std::pair{"json", OutputFormat::Json}}) {
+        measure(name, file, n, [&](std::ostream& out) {
+            Renderer r(out, format, columns);
+            for (auto& row : rows) r.row({row.id, row.type, row.title, row.author, row.status, row.extra});
+        });
+    }
+
+    std::ostringstream rendered;
+    {
+        Renderer r(rendered, OutputFormat::Table, columns);
+        for (auto& row : rows) r.row({row.id, row.type, row.title, row.author, row.status, row.extra});
+    }
+    auto bytes = rendered.str();
+    measure("write only", file, n, [&](std::ostream& out) {
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    });
+    fs::remove_all(dir);
+}
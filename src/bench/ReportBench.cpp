@@ -0,0 +1,111 @@
+// Loan report latency as the loan history grows: the maintained aggregates
+// read by ReportService versus re-aggregating loan_history on every report.
+// The first column should stay flat; the second grows with the history.
+//
+// usage: ReportBench [max-history] [runs]
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../services/ReportService.h"
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+template <typename F>
+static double medianUs(int runs, F&& f) {
+    std::vector<double> us;
+    for (int r = 0; r < runs; ++r) {
+        auto t0 = SteadyClock::now();
+        f();
+        us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count());
+    }
+    std::sort(us.begin(), us.end());
+    return us[us.size() / 2];
+}
+
+// What the report would cost without the aggregate tables.
+static void reaggregate(sqlite3* db) {
+    static const char* sql[] = {
+        R"(SELECT a.type, count(*), sum(h.return_date - h.issue_date)
+           FROM loan_history h JOIN assets a ON a.id = h.asset_id GROUP BY a.type;)",
+        R"(SELECT h.asset_id, count(*) AS n, sum(h.return_date - h.issue_date)
+           FROM loan_history h GROUP BY h.asset_id ORDER BY n DESC LIMIT 5;)",
+        R"(SELECT h.return_date / 86400 AS d, count(*) FROM loan_history h
+           WHERE h.return_date >= (SELECT max(return_date) FROM loan_history) - 7 * 86400
+           GROUP BY d;)",
+    };
+    for (auto* q : sql) {
+        sqlite3_stmt* s = nullptr;
+        sqlite3_prepare_v2(db, q, -1, &s, nullptr);
+        while (sqlite3_step(s) == SQLITE_ROW) {}
+        sqlite3_finalize(s);
+    }
+}
+
+int main(int argc, char** argv) {
+    int maxHistory = argc > 1 ? std::stoi(argv[1]) : 100000;
+    int runs       = argc > 2 ? std::stoi(argv[2]) : 50;
+    const int titles = 500, readers = 200;
+
+    std::cout << std::left << std::setw(10) << "history" << std::right << std::setw(14) << "aggregates"
+              << std::setw(14) << "re-scan" << "   (median us)\n";
+
+    for (int history = 1000; history <= maxHistory; history *= 10) {
+        auto path = fs::temp_directory_path() / "lm_report_bench.db";
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+        {
+            auto db     = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Fast);
+            db->initializeSchema();
+            auto assets = std::make_shared<AssetRepository>(db);
+            auto users  = std::make_shared<UserRepository>(db);
+            auto clock  = std::make_shared<ManualClock>(1700000000);
+            LoanService loans(assets, users, clock);
+            ReportService reports(db, clock);
+
+            db->write([&] {
+                for (int i = 0; i < readers; ++i)
+                    users->add({"U" + std::to_string(i), "Reader", Role::User, "x"});
+                for (int i = 0; i < titles; ++i)
+                    assets->add({"T" + std::to_string(i), i % 10 ? AssetType::Book : AssetType::Laptop,
+                                 "Title " + std::to_string(i), "Author", 2, 2});
+            });
+
+            // Skewed demand, a few hours per loan, time drifting forward.
+            auto* out = std::cout.rdbuf(nullptr);   // services narrate every call
+            std::mt19937 rng(history);
+            db->write([&] {
+                for (int i = 0; i < history; ++i) {
+                    auto aid = "T" + std::to_string(std::min(rng() % titles, rng() % titles));
+                    auto uid = "U" + std::to_string(rng() % readers);
+                    loans.issueAsset(aid, uid);
+                    clock->advance(3600 + rng() % 86400);
+                    loans.returnAsset(aid, uid);
+                }
+            });
+            std::cout.rdbuf(out);
+            std::cout.clear();
+
+            sqlite3* raw = nullptr;
+            sqlite3_open(path.string().c_str(), &raw);
+            double fast = medianUs(runs, [&] { reports.report(); });
+            double slow = medianUs(runs, [&] { reaggregate(raw); });
+            sqlite3_close(raw);
+
+            std::cout << std::left << std::setw(10) << history << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(14) << fast << std::setw(14) << slow << "\n";
+        }
+        for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+    }
+}
@@ -0,0 +1,111 @@
+// Full-text search latency over a large synthetic catalog.
+//
+// usage: SearchBench [titles] [queries]
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../models/Asset.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+// Pronounceable pseudo-words so the vocabulary is large but deterministic.
+static std::vector<std::string> makeVocabulary(size_t n, std::mt19937& rng) {
+    static const char* syllables[] = {"ka", "lo", "mi", "ren", "sa", "tor", "vel", "dun", "ar", "is",
+                                      "qua", "zen", "bri", "mor", "el", "fa", "gin", "hol", "ux", "yo"};
+    std::uniform_int_distribution<size_t> pick(0, std::size(syllables) - 1);
+    std::uniform_int_distribution<int> len(2, 4);
+    std::vector<std::string> words;
+    while (words.size() < n) {
+        std::string w;
+        for (int i = len(rng); i > 0; --i) w += syllables[pick(rng)];
+        words.push_back(w);
+    }
+    return words;
+}
+
+static double percentileMs(std::vector<double>& v, double p) {
+    std::sort(v.begin(), v.end());
+    return v[static_cast<size_t>(p * static_cast<double>(v.size() - 1))];
+}
+
+int main(int argc, char** argv) {
+    long titles  = argc > 1 ? std::stol(argv[1]) : 1000000;
+    int  queries = argc > 2 ? std::stoi(argv[2]) : 2000;
+
+    auto path = fs::temp_directory_path() / "lm_search_bench.db";
+    for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+
+    std::mt19937 rng(11);
+    auto vocab = makeVocabulary(20000, rng);
+    // Zipf-ish word frequency: low indices are common words.
+    std::vector<double> cdf(vocab.size());
+    double sum = 0;
+    for (size_t i = 0; i < vocab.size(); ++i) cdf[i] = sum += 1.0 / std::pow(i + 1.0, 0.9);
+    auto word = [&]() -> const std::string& {
+        double u = std::uniform_real_distribution<double>(0, sum)(rng);
+        return vocab[std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()];
+    };
+
+    auto db = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Fast);
+    db->initializeSchema();
+    AssetRepository repo(db);
+
+    auto start = SteadyClock::now();
+    const long chunk = 20000;
+    for (long base = 0; base < titles; base += chunk) {
+        db->write([&] {
+            for (long i = base; i < std::min(base + chunk, titles); ++i) {
+                std::string title = word() + " " + word() + " " + word();
+                std::string author = vocab[i % 3000] + " " + vocab[(i / 7) % 5000];
+                repo.add({"B" + std::to_string(i), AssetType::Book, title, author});
+            }
+        });
+    }
+    double loadSecs = std::chrono::duration<double>(SteadyClock::now() - start).count();
+    std::cout << "indexed " << titles << " titles in " << std::fixed << std::setprecision(1)
+              << loadSecs << " s (" << fs::file_size(path) / (1024 * 1024) << " MiB)\n\n";
+
+    struct Kind { const char* name; std::function<std::string()> make; };
+    std::uniform_int_distribution<size_t> rare(5000, vocab.size() - 1), common(0, 50);
+    std::vector<Kind> kinds = {
+        {"rare word",      [&] { return vocab[rare(rng)]; }},
+        {"common word",    [&] { return vocab[common(rng)]; }},
+        {"3-char prefix",  [&] { return vocab[rare(rng)].substr(0, 3); }},
+        {"two words",      [&] { return word() + " " + word(); }},
+        {"word + author",  [&] { return word() + " " + vocab[rare(rng) % 3000].substr(0, 3); }},
+    };
+
+    std::cout << "query kind     |  p50 ms |  p99 ms |  max ms | avg hits\n"
+              << "-------------------------------------------------------\n";
+    for (auto& k : kinds) {
+        std::vector<double> ms;
+        long hits = 0;
+        for (int q = 0; q < queries; ++q) {
+            auto text = k.make();
+            auto t0 = SteadyClock::now();
+            hits += static_cast<long>(repo.search(text, 20).size());
+            ms.push_back(std::chrono::duration<double, std::milli>(SteadyClock::now() - t0).count());
+        }
+        double p50 = percentileMs(ms, 0.50), p99 = percentileMs(ms, 0.99);
+        std::cout << std::left << std::setw(14) << k.name << " | " << std::right << std::setprecision(3)
+                  << std::setw(7) << p50 << " | " << std::setw(7) << p99 << " | "
+                  << std::setw(7) << ms.back() << " | " << std::setprecision(1)
+                  << std::setw(8) << static_cast<double>(hits) / queries << "\n";
+    }
+
+    db.reset();
+    for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+    return 0;
+}
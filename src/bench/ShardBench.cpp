@@ -0,0 +1,92 @@
+// Cross-branch query latency: sequential per-branch loop versus the
+// parallel fan-out in ShardedCatalog.
+//
+// usage: ShardBench [branches] [assets-per-branch] [rounds]
+#include "../services/ShardedCatalog.h"
+#include "../util/Clock.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+template <typename F>
+static double millis(int rounds, F&& f) {
+    auto start = SteadyClock::now();
+    for (int i = 0; i < rounds; ++i) f();
+    return std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count() / rounds;
+}
+
+int main(int argc, char** argv) {
+    int branches = argc > 1 ? std::stoi(argv[1]) : 4;
+    int perBranch = argc > 2 ? std::stoi(argv[2]) : 20000;
+    int rounds = argc > 3 ? std::stoi(argv[3]) : 20;
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < branches; ++i) {
+        auto p = fs::temp_directory_path() / ("lm_shard_bench_" + std::to_string(i) + ".db");
+        fs::remove(p);
+        paths.push_back(p.string());
+    }
+
+    static const char* words[] = {"river", "stone", "glass", "night", "garden", "winter", "silver", "empire"};
+    auto clock = std::make_shared<ManualClock>(1'700'000'000);
+    {
+        ShardedCatalog catalog(paths, DurabilityProfile::Balanced, clock);
+        long total = static_cast<long>(branches) * perBranch;
+        auto* out = std::cout.rdbuf(nullptr);   // LoanService narrates every issue
+        catalog.addUser({"U0", "Reader", Role::User, "x"});
+        for (int b = 0; b < branches; ++b) {
+            auto& branch = catalog.shard(b);
+            branch.db->write([&] {
+                for (long i = 0; i < total; ++i) {
+                    auto id = "A" + std::to_string(i);
+                    if (catalog.shardFor(id) != static_cast<std::size_t>(b)) continue;
+                    branch.assets->add({id, AssetType::Book,
+                                        std::string(words[i % 8]) + " " + words[(i / 8) % 8] + " " + id,
+                                        "Author " + std::to_string(i % 500)});
+                    if (i % 4 == 0) branch.loans->issueAsset(id, "U0");
+                }
+            });
+        }
+        std::cout.rdbuf(out);
+        std::cout.clear();
+        clock->advanceDays(30);
+
+        std::cout << branches << " branches x ~" << perBranch << " assets, " << rounds << " rounds\n\n"
+                  << "query          | sequential ms | fan-out ms | slowest branch ms\n"
+                  << "---------------------------------------------------------------\n";
+        auto row = [&](const char* name, auto perBranchFn, auto fanOutFn) {
+            double slowest = 0;
+            for (int b = 0; b < branches; ++b)
+                slowest = std::max(slowest, millis(rounds, [&] { perBranchFn(catalog.shard(b)); }));
+            double seq = millis(rounds, [&] { for (int b = 0; b < branches; ++b) perBranchFn(catalog.shard(b)); });
+            double par = millis(rounds, fanOutFn);
+            std::cout << std::left << std::setw(14) << name << " | " << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(13) << seq << " | " << std::setw(10) << par
+                      << " | " << std::setw(17) << slowest << "\n";
+        };
+        row("countOverdue", [](Branch& b) { b.loans->countOverdue(); }, [&] { catalog.countOverdue(); });
+        row("overdueLoans", [](Branch& b) { b.loans->overdueLoans(); }, [&] { catalog.overdueLoans(); });
+        row("search", [](Branch& b) { b.assets->searchRanked("river gla", 20); },
+            [&] { catalog.search("river gla", 20); });
+        auto pageThrough = [](Branch& b) {
+            std::string last;
+            for (auto p = b.assets->page(last, 512); !p.empty(); p = b.assets->page(last, 512))
+                last = p.back().id();
+        };
+        row("list all", pageThrough, [&] { catalog.forEachAsset([](const Asset&) { return true; }); });
+    }
+    for (auto& p : paths) {
+        fs::remove(p);
+        fs::remove(p + "-wal");
+        fs::remove(p + "-shm");
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+// What tracing costs: a bare span with tracing off and on, and an
+// issue + return round trip (service, repository, transaction and SQLite
+// spans) without and with a trace running.
+//
+// usage: TraceBench [spans] [loans]
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../util/Trace.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+template <typename F>
+static double nsPer(long n, F&& f) {
+    auto t0 = SteadyClock::now();
+    for (long i = 0; i < n; ++i) f(i);
+    return std::chrono::duration<double, std::nano>(SteadyClock::now() - t0).count() / static_cast<double>(n);
+}
+
+// Issue + return round trips against a fresh file database; the connection
+// is opened after the caller has switched tracing on or off.
+static double roundTripUs(int loans) {
+    auto path = fs::temp_directory_path() / "lm_trace_bench.db";
+    for (auto suffix : {"", "-wal", "-shm"}) fs::remove(path.string() + suffix);
+    auto db = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Balanced);
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users = std::make_shared<UserRepository>(db);
+    LoanService service(assets, users);
+    db->write([&] {
+        assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+        users->add({"U1", "Reader", Role::User, "x"});
+    });
+    auto* out = std::cout.rdbuf(nullptr);   // services narrate every call
+    double ns = nsPer(loans, [&](long) {
+        service.issueAsset("B1", "U1");
+        service.returnAsset("B1", "U1");
+    });
+    std::cout.rdbuf(out);
+    return ns / 1000.0;
+}
+
+int main(int argc, char** argv) {
+    long spans = argc > 1 ? std::stol(argv[1]) : 10000000;
+    int loans = argc > 2 ? std::stoi(argv[2]) : 2000;
+
+    Tracer::stop();
+    double off = nsPer(spans, [](long) { TraceSpan span("bench", "bench"); });
+    double offTrip = roundTripUs(loans);
+
+    Tracer::start();
+    long recorded = std::min<long>(spans, Tracer::maxEventsPerThread / 2);
+    double on = nsPer(recorded, [](long) { TraceSpan span("bench", "bench"); });
+    Tracer::clear();
+    double onTrip = roundTripUs(loans);
+    auto events = Tracer::eventCount();
+    Tracer::stop();
+
+    auto path = (fs::temp_directory_path() / "lm_trace_bench.json").string();
+    auto t0 = SteadyClock::now();
+    Tracer::writeChromeJson(path);
+    double writeMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - t0).count();
+    auto bytes = fs::file_size(path);
+    fs::remove(path);
+
+    std::cout << std::fixed << std::setprecision(1) << "span, tracing off:     " << off << " ns\n"
+              << "span, tracing on:      " << on << " ns\n"
+              << "issue+return, off:     " << offTrip << " us\n"
+              << "issue+return, on:      " << onTrip << " us  (" << events / loans << " spans each)\n"
+              << "export " << events << " spans: " << writeMs << " ms, " << bytes / 1024 << " KiB\n";
+}
@@ -0,0 +1,104 @@
+// Fuzzy name lookup latency and recall on a large in-memory trigram index,
+// with concurrent readers.
+//
+// usage: UserSearchBench [users] [queries-per-thread] [threads]
+#include "../util/TrigramIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static std::string pseudoName(std::mt19937& rng, int minSyl, int maxSyl) {
+    static const char* syllables[] = {"an", "bel", "car", "da", "el", "fin", "gar", "ha", "is", "jo",
+                                      "ka", "lin", "mar", "nor", "o", "per", "qui", "ros", "sa", "tor",
+                                      "u", "vin", "wen", "xa", "yor", "zel"};
+    std::uniform_int_distribution<size_t> pick(0, std::size(syllables) - 1);
+    std::uniform_int_distribution<int> len(minSyl, maxSyl);
+    std::string s;
+    for (int i = len(rng); i > 0; --i) s += syllables[pick(rng)];
+    s[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(s[0])));
+    return s;
+}
+
+// One random substitution, deletion, insertion or adjacent swap.
+static std::string typo(std::string s, std::mt19937& rng) {
+    if (s.size() < 3) return s;
+    std::uniform_int_distribution<size_t> pos(1, s.size() - 2);
+    std::uniform_int_distribution<int> kind(0, 3), letter('a', 'z');
+    size_t p = pos(rng);
+    switch (kind(rng)) {
+        case 0: s[p] = static_cast<char>(letter(rng)); break;
+        case 1: s.erase(p, 1); break;
+        case 2: s.insert(p, 1, static_cast<char>(letter(rng))); break;
+        default: std::swap(s[p], s[p + 1]); break;
+    }
+    return s;
+}
+
+int main(int argc, char** argv) {
+    long users   = argc > 1 ? std::stol(argv[1]) : 1000000;
+    int  queries = argc > 2 ? std::stoi(argv[2]) : 20000;
+    int  threads = argc > 3 ? std::stoi(argv[3]) : 4;
+
+    std::mt19937 rng(3);
+    std::vector<std::string> first, last;
+    for (int i = 0; i < 3000; ++i)  first.push_back(pseudoName(rng, 1, 3));
+    for (int i = 0; i < 30000; ++i) last.push_back(pseudoName(rng, 2, 4));
+
+    TrigramIndex index;
+    std::vector<std::string> names(users);
+    auto start = SteadyClock::now();
+    for (long i = 0; i < users; ++i) {
+        names[i] = first[rng() % first.size()] + " " + last[rng() % last.size()];
+        index.add("U" + std::to_string(i), names[i]);
+    }
+    std::cout << "indexed " << users << " names in " << std::fixed << std::setprecision(2)
+              << std::chrono::duration<double>(SteadyClock::now() - start).count() << " s\n";
+
+    struct Stats { std::vector<double> us; long found = 0; };
+    std::vector<Stats> stats(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 r(100 + t);
+            std::uniform_int_distribution<long> pick(0, users - 1);
+            for (int q = 0; q < queries; ++q) {
+                long target = pick(r);
+                bool fullName = q % 2 == 0;
+                auto query = fullName ? typo(names[target], r)
+                                      : typo(names[target].substr(names[target].find(' ') + 1), r);
+                auto t0 = SteadyClock::now();
+                auto hits = index.search(query, 10);
+                stats[t].us.push_back(std::chrono::duration<double, std::micro>(SteadyClock::now() - t0).count());
+                // A surname alone is shared by many users; finding it is enough.
+                auto want = fullName ? names[target] : names[target].substr(names[target].find(' ') + 1);
+                for (auto& h : hits) {
+                    if (h.text == names[target] || (!fullName && h.text.size() >= want.size() &&
+                                                    h.text.compare(h.text.size() - want.size(), want.size(), want) == 0)) {
+                        ++stats[t].found;
+                        break;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    std::vector<double> all;
+    long found = 0;
+    for (auto& s : stats) { all.insert(all.end(), s.us.begin(), s.us.end()); found += s.found; }
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all[static_cast<size_t>(p * static_cast<double>(all.size() - 1))]; };
+    std::cout << threads << " threads x " << queries << " one-typo queries (half full name, half surname)\n"
+              << "p50 " << std::setprecision(1) << pct(0.5) << " us | p99 " << pct(0.99)
+              << " us | max " << all.back() << " us | recall@10 "
+              << std::setprecision(3) << static_cast<double>(found) / static_cast<double>(all.size()) << "\n";
+    return 0;
+}
@@ -1,6 +1,30 @@
 #include "ui/CLI.h"
+#include "util/Trace.h"
+#include <exception>
+#include <iostream>
 
-int main() {
-    CLI().run();
-    return 0;
-}
\ No newline at end of file
+int main(int argc, char** argv) {
+    auto options = parseCliOptions(argc, argv);
+    if (!options) { std::cerr << cliUsage; return 2; }
+    if (!options->tracePath.empty()) {
+        Tracer::start();
+        Tracer::nameThread("main");
+    }
+
+    int rc = 0;
+    try {
+        CLI cli(*options);
+        if (!options->command.empty()) rc = cli.runCommand(options->command);
+        else                           cli.run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        rc = 1;
+    }
+
+    if (!options->tracePath.empty()) {
+        Tracer::stop();
+        if (!Tracer::writeChromeJson(options->tracePath))
+            std::cerr << "Could not write trace to " << options->tracePath << "\n";
+    }
+    return rc;
+}
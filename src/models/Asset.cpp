@@ -1,11 +1,29 @@
 #include "Asset.h"
 
-Asset::Asset(std::string id, AssetType type, std::string title, std::string authorOrOwner)
-    : _id(std::move(id)), _type(type), _title(std::move(title)), _authorOrOwner(std::move(authorOrOwner)) {}
+Asset::Asset(std::string_view id, AssetType type, std::string_view title, std::string_view authorOrOwner,
+             const allocator_type& alloc)
+    : _id(id, alloc), _type(type), _title(title, alloc), _authorOrOwner(authorOrOwner, alloc) {}
 
-std::string Asset::id() const { return _id; }
-bool Asset::isIssued() const { return _issued; }
-void Asset::setIssued(bool issued) { _issued = issued; }
+Asset::Asset(std::string_view id, AssetType type, std::string_view title, std::string_view authorOrOwner,
+             int copies, int available, const allocator_type& alloc)
+    : _id(id, alloc), _type(type), _title(title, alloc), _authorOrOwner(authorOrOwner, alloc),
+      _copies(copies), _available(available) {}
+
+Asset::Asset(const Asset& other, const allocator_type& alloc)
+    : _id(other._id, alloc), _type(other._type), _title(other._title, alloc),
+      _authorOrOwner(other._authorOrOwner, alloc), _copies(other._copies), _available(other._available) {}
+
+Asset::Asset(Asset&& other, const allocator_type& alloc)
+    : _id(std::move(other._id), alloc), _type(other._type), _title(std::move(other._title), alloc),
+      _authorOrOwner(std::move(other._authorOrOwner), alloc), _copies(other._copies),
+      _available(other._available) {}
+
+std::string_view Asset::id() const { return _id; }
+bool Asset::isIssued() const { return _available == 0; }
+void Asset::setIssued(bool issued) { _available = issued ? 0 : _copies; }
 AssetType Asset::type() const { return _type; }
-std::string Asset::title() const { return _title; }
-std::string Asset::authorOrOwner() const { return _authorOrOwner; }
\ No newline at end of file
+std::string_view Asset::title() const { return _title; }
+std::string_view Asset::authorOrOwner() const { return _authorOrOwner; }
+int Asset::copies() const { return _copies; }
+int Asset::available() const { return _available; }
+int Asset::onLoan() const { return _copies - _available; }
@@ -1,46 +1,54 @@
 #pragma once
+#include "AssetTypes.h"
 #include "ILendable.h"
+#include <memory_resource>
 #include <string>
+#include <string_view>
 
-enum class AssetType {
-    Book,
-    Laptop,
-    Unknown
-};
-
-inline std::string assetTypeToString(AssetType t) {
-    switch (t) {
-        case AssetType::Book: return "book";
-        case AssetType::Laptop: return "laptop";
-        default: return "unknown";
-    }
-}
-
-inline AssetType stringToAssetType(const std::string& s) {
-    if (s == "book")
-        return AssetType::Book;
-    if (s == "laptop")
-        return AssetType::Laptop;
-
-    return AssetType::Unknown;
-}
-
+// Allocator-aware: an Asset built with an allocator (or as an element of a
+// pmr container) keeps its strings there. Copies use the default resource
+// unless given one.
 class Asset : public ILendable {
 public:
-    Asset(std::string id, AssetType type, std::string title, std::string authorOrOwner);
-
-    std::string id() const override;
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    // A single copy, on the shelf.
+    Asset(std::string_view id, AssetType type, std::string_view title, std::string_view authorOrOwner,
+          const allocator_type& alloc = {});
+    // A title held in several copies, `available` of them on the shelf.
+    Asset(std::string_view id, AssetType type, std::string_view title, std::string_view authorOrOwner, int copies,
+          int available, const allocator_type& alloc = {});
+    // A copy count alone is ambiguous (and 0 would pass as a null
+    // allocator); give both counts.
+    Asset(std::string_view id, AssetType type, std::string_view title, std::string_view authorOrOwner,
+          int copies) = delete;
+
+    Asset(const Asset& other) = default;
+    Asset(Asset&& other) = default;
+    Asset(const Asset& other, const allocator_type& alloc);
+    Asset(Asset&& other, const allocator_type& alloc);
+    Asset& operator=(const Asset& other) = default;
+    Asset& operator=(Asset&& other) = default;
+
+    allocator_type get_allocator() const { return _id.get_allocator(); }
+
+    std::string_view id() const override;
+    // True when every copy is out.
     bool isIssued() const override;
     void setIssued(bool issued) override;
 
     AssetType type() const;
-    std::string title() const;
-    std::string authorOrOwner() const;
+    std::string_view title() const;
+    std::string_view authorOrOwner() const;
+    int copies() const;
+    int available() const;
+    int onLoan() const;
 
 private:
-    std::string _id;
+    std::pmr::string _id;
     AssetType _type;
-    std::string _title;
-    std::string _authorOrOwner;
-    bool _issued = false;
-};
\ No newline at end of file
+    std::pmr::string _title;
+    std::pmr::string _authorOrOwner;
+    int _copies = 1;
+    int _available = 1;
+};
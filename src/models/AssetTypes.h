@@ -0,0 +1,123 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// The kinds of asset the library lends. The value is the code stored in
+// assets.type; keep it stable. A new kind is an enumerator here plus its
+// row in `assetTypes` below: the repositories, services and menus all work
+// from the registry.
+enum class AssetType : std::uint8_t {
+    Unknown   = 0,
+    Book      = 1,
+    Laptop    = 2,
+    Projector = 3,
+    Tablet    = 4,
+};
+
+// How long a loan runs and what it costs once overdue.
+struct LoanPolicy {
+    int          loanDays;
+    int          graceDays;     // overdue days never charged
+    std::int64_t centsPerDay;
+    std::int64_t capCents;      // per loan
+};
+
+struct AssetTypeInfo {
+    AssetType        type;
+    std::string_view name;         // printed and parsed; lower case, unique
+    std::string_view label;        // menus
+    std::string_view titleLabel;   // what Asset::title holds for this type
+    std::string_view ownerLabel;   // ... and Asset::authorOrOwner
+    bool             copies;       // catalogued as a title with several copies
+    LoanPolicy       loan;
+    std::array<std::string_view, 4> attributes;   // asked for at intake; unused slots empty
+};
+
+// Indexed by code.
+inline constexpr std::array assetTypes = {
+    AssetTypeInfo{AssetType::Unknown, "unknown", "Unknown", "Title", "Owner", false, {14, 0, 0, 0}, {}},
+    AssetTypeInfo{AssetType::Book, "book", "Book", "Title", "Author", true, {14, 3, 25, 1000}, {}},
+    AssetTypeInfo{AssetType::Laptop, "laptop", "Laptop", "Model", "Info", false, {14, 1, 500, 10000},
+                  {"Serial", "Charger"}},
+    AssetTypeInfo{AssetType::Projector, "projector", "Projector", "Model", "Info", false, {3, 0, 1000, 20000},
+                  {"Serial", "Lamp hours"}},
+    AssetTypeInfo{AssetType::Tablet, "tablet", "Tablet", "Model", "Info", false, {7, 1, 300, 8000},
+                  {"Serial", "Charger", "Case"}},
+};
+
+namespace asset_types {
+
+constexpr bool indexedByCode() {
+    for (std::size_t i = 0; i < assetTypes.size(); ++i)
+        if (static_cast<std::size_t>(assetTypes[i].type) != i) return false;
+    return true;
+}
+static_assert(indexedByCode(), "assetTypes rows must sit at their type's code");
+
+// Names are looked up through a perfect hash: FNV-1a with a seed searched
+// at compile time so that every registered name gets its own slot. A
+// lookup is one hash, one table load and one comparison to reject names
+// that are not registered.
+constexpr std::uint32_t hash(std::string_view s, std::uint32_t seed) {
+    std::uint32_t h = 2166136261u ^ seed;
+    for (char c : s) h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    return h;
+}
+
+inline constexpr std::size_t slots = std::bit_ceil(assetTypes.size() * 2);
+
+constexpr std::uint32_t findSeed() {
+    for (std::uint32_t seed = 0; seed < 100000; ++seed) {
+        std::array<bool, slots> used{};
+        bool clash = false;
+        for (auto& t : assetTypes) {
+            auto& slot = used[hash(t.name, seed) % slots];
+            clash = clash || slot;
+            slot = true;
+        }
+        if (!clash) return seed;
+    }
+    return ~0u;
+}
+
+inline constexpr std::uint32_t seed = findSeed();
+static_assert(seed != ~0u, "no collision-free seed for the asset type names");
+
+// Code per slot; empty slots hold Unknown's 0.
+inline constexpr auto byName = [] {
+    std::array<std::uint8_t, slots> table{};
+    for (auto& t : assetTypes) table[hash(t.name, seed) % slots] = static_cast<std::uint8_t>(t.type);
+    return table;
+}();
+
+}  // namespace asset_types
+
+constexpr const AssetTypeInfo& assetTypeInfo(AssetType t) {
+    auto code = static_cast<std::size_t>(t);
+    return assetTypes[code < assetTypes.size() ? code : 0];
+}
+
+constexpr AssetType stringToAssetType(std::string_view s) {
+    auto& t = assetTypes[asset_types::byName[asset_types::hash(s, asset_types::seed) % asset_types::slots]];
+    return t.name == s ? t.type : AssetType::Unknown;
+}
+
+inline std::string assetTypeToString(AssetType t) {
+    return std::string(assetTypeInfo(t).name);
+}
+
+// Stored codes; what the assets.type column holds.
+constexpr int assetTypeToCode(AssetType t) {
+    return static_cast<int>(assetTypeInfo(t).type);
+}
+
+constexpr AssetType codeToAssetType(int code) {
+    return code > 0 && code < static_cast<int>(assetTypes.size()) ? assetTypes[code].type : AssetType::Unknown;
+}
+
+static_assert(stringToAssetType("laptop") == AssetType::Laptop);
+static_assert(stringToAssetType("lapto") == AssetType::Unknown);
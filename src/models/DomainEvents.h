@@ -0,0 +1,60 @@
+#pragma once
+#include "Asset.h"
+#include "User.h"
+#include <algorithm>
+#include <ctime>
+#include <string>
+#include <variant>
+#include <vector>
+
+// Facts published on the EventBus once the change has committed. IDs are
+// external IDs.
+struct AssetAdded {
+    std::string assetId;
+    AssetType   type;
+    int         copies;
+};
+
+struct UserAdded {
+    std::string userId;
+    Role        role;
+};
+
+struct AssetIssued {
+    std::string assetId;
+    std::string userId;
+    time_t      at;
+    AssetType   type = AssetType::Unknown;
+};
+
+struct AssetReturned {
+    std::string assetId;
+    std::string userId;
+    time_t      issuedAt;   // of the loan that closed
+    time_t      at;
+    bool        heldForNext;   // went to a waiting hold, not the shelf
+    AssetType   type = AssetType::Unknown;
+};
+
+// Committed by another process sharing the database file (ChangeWatcher).
+// Whatever is mirrored in memory for these IDs should be reloaded; all of
+// it when `everything` is set.
+struct ExternalChange {
+    std::vector<std::string> assetIds;
+    std::vector<std::string> userIds;
+    bool                     everything = false;
+
+    // Adds another change's IDs, keeping each list sorted and unique.
+    void merge(const ExternalChange& other) {
+        auto add = [](std::vector<std::string>& ids, const std::vector<std::string>& more) {
+            ids.insert(ids.end(), more.begin(), more.end());
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        };
+        add(assetIds, other.assetIds);
+        add(userIds, other.userIds);
+        everything = everything || other.everything;
+    }
+};
+
+using DomainEvent = std::variant<AssetAdded, UserAdded, AssetIssued, AssetReturned, ExternalChange>;
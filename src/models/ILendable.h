@@ -1,10 +1,10 @@
 #pragma once
-#include <string>
+#include <string_view>
 
 class ILendable {
 public:
     virtual ~ILendable() = default;
-    virtual std::string id() const = 0;
+    virtual std::string_view id() const = 0;
     virtual bool isIssued() const = 0;
     virtual void setIssued(bool) = 0;
 };
\ No newline at end of file
@@ -1,16 +1,31 @@
 #include "User.h"
 
-User::User(std::string id, std::string name, Role role, std::string passwordHash)
-    : _id(std::move(id))
-    , _name(std::move(name))
+User::User(std::string_view id, std::string_view name, Role role, std::string_view passwordHash,
+           const allocator_type& alloc)
+    : _id(id, alloc)
+    , _name(name, alloc)
     , _role(role)
-    , _passwordHash(std::move(passwordHash))
+    , _passwordHash(passwordHash, alloc)
 {}
 
-std::string User::id()           const { return _id; }
-std::string User::name()         const { return _name; }
-Role        User::role()         const { return _role; }
-std::string User::passwordHash() const { return _passwordHash; }
+User::User(const User& other, const allocator_type& alloc)
+    : _id(other._id, alloc)
+    , _name(other._name, alloc)
+    , _role(other._role)
+    , _passwordHash(other._passwordHash, alloc)
+{}
+
+User::User(User&& other, const allocator_type& alloc)
+    : _id(std::move(other._id), alloc)
+    , _name(std::move(other._name), alloc)
+    , _role(other._role)
+    , _passwordHash(std::move(other._passwordHash), alloc)
+{}
+
+std::string_view User::id()           const { return _id; }
+std::string_view User::name()         const { return _name; }
+Role             User::role()         const { return _role; }
+std::string_view User::passwordHash() const { return _passwordHash; }
 
-void User::setRole(Role r)                    { _role = r; }
-void User::setPasswordHash(const std::string& h) { _passwordHash = h; }
\ No newline at end of file
+void User::setRole(Role r)                     { _role = r; }
+void User::setPasswordHash(std::string_view h) { _passwordHash = h; }
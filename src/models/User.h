@@ -1,26 +1,44 @@
 #pragma once
+#include <memory_resource>
 #include <string>
+#include <string_view>
 
 enum class Role { User, Staff };
 
 inline Role    stringToRole(const std::string& s) { return s=="staff"?Role::Staff:Role::User; }
 inline std::string roleToString(Role r)         { return r==Role::Staff?"staff":"user"; }
+// Stored in users.role.
+inline Role    codeToRole(int code)             { return code==1?Role::Staff:Role::User; }
+inline int     roleToCode(Role r)               { return r==Role::Staff?1:0; }
 
+// Allocator-aware, like Asset.
 class User {
 public:
-    User(std::string id, std::string name, Role role, std::string passwordHash);
+    using allocator_type = std::pmr::polymorphic_allocator<>;
 
-    std::string id()           const;
-    std::string name()         const;
-    Role        role()         const;
-    std::string passwordHash() const;
+    User(std::string_view id, std::string_view name, Role role, std::string_view passwordHash,
+         const allocator_type& alloc = {});
+
+    User(const User& other) = default;
+    User(User&& other) = default;
+    User(const User& other, const allocator_type& alloc);
+    User(User&& other, const allocator_type& alloc);
+    User& operator=(const User& other) = default;
+    User& operator=(User&& other) = default;
+
+    allocator_type get_allocator() const { return _id.get_allocator(); }
+
+    std::string_view id()           const;
+    std::string_view name()         const;
+    Role             role()         const;
+    std::string_view passwordHash() const;
 
     void setRole(Role r);
-    void setPasswordHash(const std::string& h);
+    void setPasswordHash(std::string_view h);
 
 private:
-    std::string _id;
-    std::string _name;
-    Role        _role;
-    std::string _passwordHash;
-};
\ No newline at end of file
+    std::pmr::string _id;
+    std::pmr::string _name;
+    Role             _role;
+    std::pmr::string _passwordHash;
+};
@@ -0,0 +1,246 @@
+#include "ArchiveManager.h"
+#include "DatabaseManager.h"
+#include "Query.h"
+#include "../util/Trace.h"
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+using Retirable = query::Query<R"(
+    SELECT a.id, a.type, a.copies, a.available, (SELECT count(*) FROM holds h WHERE h.asset_id = a.id)
+    FROM assets a
+    WHERE a.ext_id = ? AND a.id NOT IN (SELECT asset_id FROM retired_assets);
+)", query::Row<std::int64_t, int, int, int, int>, std::string_view>;
+
+using InsertRetired = query::Query<"INSERT INTO retired_assets (asset_id, copies, retired_at) VALUES (?, ?, ?);",
+                                   query::Row<>, std::int64_t, int, time_t>;
+
+using WithdrawCopies = query::Query<"UPDATE assets SET copies = 0, available = 0 WHERE id = ?;",
+                                    query::Row<>, std::int64_t>;
+
+using UncountCopies = query::Query<"UPDATE type_stats SET copies = copies - ? WHERE type = ?;",
+                                   query::Row<>, int, int>;
+
+using RetiredPending = query::Query<"SELECT count(*) FROM retired_assets;", query::Row<std::int64_t>>;
+
+// A batch is everything up to the key of its last row, so the copy and
+// the delete that follows it cover exactly the same rows. The copies name
+// retired_assets first with CROSS JOIN, which SQLite keeps as the outer
+// loop; otherwise it may range-scan assets from the start every batch.
+using RetiredBatchEnd = query::Query<R"(
+    SELECT max(asset_id) FROM (SELECT asset_id FROM retired_assets ORDER BY asset_id LIMIT ?);
+)", query::Row<std::optional<std::int64_t>>, int>;
+
+using CopyRetired = query::Query<R"(
+    INSERT OR IGNORE INTO archive.assets
+        (ext_id, type, title, author_or_owner, copies, borrows, seconds_out, retired_at, archived_at)
+    SELECT a.ext_id, a.type, a.title, a.author_or_owner, r.copies,
+           coalesce(s.borrows, 0), coalesce(s.seconds_out, 0), r.retired_at, ?
+    FROM retired_assets r CROSS JOIN assets a ON a.id = r.asset_id
+    LEFT JOIN asset_stats s ON s.asset_id = r.asset_id
+    WHERE r.asset_id <= ?;
+)", query::Row<>, time_t, std::int64_t>;
+
+using CopyRetiredHistory = query::Query<R"(
+    INSERT OR IGNORE INTO archive.loan_history (source_id, asset_ext_id, user_id, issue_date, return_date)
+    SELECT h.id, a.ext_id, h.user_id, h.issue_date, h.return_date
+    FROM retired_assets r CROSS JOIN assets a ON a.id = r.asset_id JOIN loan_history h ON h.asset_id = r.asset_id
+    WHERE r.asset_id <= ?;
+)", query::Row<>, std::int64_t>;
+
+// The delete only takes titles whose copy is already in the archive: one
+// retired after the copy committed, with a key inside the batch, stays in
+// the hot tables for the next batch instead of being dropped unmoved. Its
+// history cannot grow meanwhile, since a retired title has no loans.
+using DeleteRetiredHistory = query::Query<R"(
+    DELETE FROM loan_history WHERE asset_id IN (
+        SELECT r.asset_id FROM retired_assets r CROSS JOIN assets a ON a.id = r.asset_id
+        WHERE r.asset_id <= ? AND EXISTS (
+            SELECT 1 FROM archive.assets x WHERE x.ext_id = a.ext_id AND x.retired_at = r.retired_at));
+)", query::Row<>, std::int64_t>;
+
+using DeleteRetiredAliases = query::Query<R"(
+    DELETE FROM asset_aliases WHERE asset_id IN (
+        SELECT r.asset_id FROM retired_assets r CROSS JOIN assets a ON a.id = r.asset_id
+        WHERE r.asset_id <= ? AND EXISTS (
+            SELECT 1 FROM archive.assets x WHERE x.ext_id = a.ext_id AND x.retired_at = r.retired_at));
+)", query::Row<>, std::int64_t>;
+
+using DeleteRetiredAttributes = query::Query<R"(
+    DELETE FROM asset_attributes WHERE asset_id IN (
+        SELECT r.asset_id FROM retired_assets r CROSS JOIN assets a ON a.id = r.asset_id
+        WHERE r.asset_id <= ? AND EXISTS (
+            SELECT 1 FROM archive.assets x WHERE x.ext_id = a.ext_id AND x.retired_at = r.retired_at));
+)", query::Row<>, std::int64_t>;
+
+using DeleteRetiredStats = query::Query<R"(
+    DELETE FROM asset_stats WHERE asset_id IN (
+        SELECT r.asset_id FROM retired_assets r CROSS JOIN assets a ON a.id = r.asset_id
+        WHERE r.asset_id <= ? AND EXISTS (
+            SELECT 1 FROM archive.assets x WHERE x.ext_id = a.ext_id AND x.retired_at = r.retired_at));
+)", query::Row<>, std::int64_t>;
+
+using DeleteRetiredAssets = query::Query<R"(
+    DELETE FROM assets WHERE id IN (
+        SELECT r.asset_id FROM retired_assets r CROSS JOIN assets a ON a.id = r.asset_id
+        WHERE r.asset_id <= ? AND EXISTS (
+            SELECT 1 FROM archive.assets x WHERE x.ext_id = a.ext_id AND x.retired_at = r.retired_at));
+)", query::Row<>, std::int64_t>;
+
+// Runs last, once the titles it covers are gone from assets.
+using DeleteRetired = query::Query<R"(
+    DELETE FROM retired_assets WHERE asset_id <= ? AND asset_id NOT IN (SELECT id FROM assets);
+)", query::Row<>, std::int64_t>;
+
+using AgedBatchEnd = query::Query<R"(
+    SELECT max(id) FROM (SELECT id FROM loan_history WHERE return_date < ? ORDER BY id LIMIT ?);
+)", query::Row<std::optional<std::int64_t>>, time_t, int>;
+
+using CopyAged = query::Query<R"(
+    INSERT OR IGNORE INTO archive.loan_history (source_id, asset_ext_id, user_id, issue_date, return_date)
+    SELECT h.id, coalesce(a.ext_id, ''), h.user_id, h.issue_date, h.return_date
+    FROM loan_history h LEFT JOIN assets a ON a.id = h.asset_id
+    WHERE h.return_date < ? AND h.id <= ?;
+)", query::Row<>, time_t, std::int64_t>;
+
+using DeleteAged = query::Query<R"(
+    DELETE FROM loan_history AS h
+    WHERE h.return_date < ? AND h.id <= ? AND EXISTS (
+        SELECT 1 FROM archive.loan_history x
+        WHERE x.source_id = h.id AND x.issue_date = h.issue_date AND x.return_date = h.return_date);
+)", query::Row<>, time_t, std::int64_t>;
+
+std::optional<std::int64_t> batchEnd(const std::optional<std::tuple<std::optional<std::int64_t>>>& row) {
+    return row ? std::get<0>(*row) : std::nullopt;
+}
+
+}  // namespace
+
+ArchiveManager::ArchiveManager(std::shared_ptr<DatabaseManager> db, ArchiveOptions options,
+                               std::shared_ptr<Clock> clock)
+    : _db(std::move(db)), _options(std::move(options)), _clock(std::move(clock)) {
+    if (_options.batchRows < 1) _options.batchRows = 1;
+    _db->attachArchive(_options.path);
+    _worker = std::thread(&ArchiveManager::run, this);
+}
+
+ArchiveManager::~ArchiveManager() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _worker.join();
+}
+
+bool ArchiveManager::retire(const std::string& assetId) {
+    TraceSpan span("ArchiveManager::retire", "archive");
+    bool retired = false;
+    _db->write([&] {
+        auto row = Retirable::one(*_db, assetId);
+        if (!row) return;
+        auto [id, type, copies, available, holds] = *row;
+        if (available != copies || holds > 0) return;
+        InsertRetired::exec(*_db, id, copies, _clock->now());
+        WithdrawCopies::exec(*_db, id);
+        UncountCopies::exec(*_db, copies, type);
+        retired = true;
+    });
+    return retired;
+}
+
+std::future<ArchiveSummary> ArchiveManager::archiveNow() {
+    std::promise<ArchiveSummary> request;
+    auto result = request.get_future();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requests.push_back(std::move(request));
+    }
+    _wake.notify_one();
+    return result;
+}
+
+std::size_t ArchiveManager::retiredPending() {
+    auto row = RetiredPending::one(*_db);
+    return row ? static_cast<std::size_t>(std::get<0>(*row)) : 0;
+}
+
+bool ArchiveManager::stopping() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stopping;
+}
+
+void ArchiveManager::run() {
+    while (true) {
+        std::vector<std::promise<ArchiveSummary>> waiting;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stopping || !_requests.empty(); });
+            if (_stopping) break;
+            // Requests that arrive together share one pass.
+            waiting.swap(_requests);
+        }
+
+        try {
+            auto summary = pass();
+            for (auto& w : waiting) w.set_value(summary);
+        } catch (...) {
+            for (auto& w : waiting) w.set_exception(std::current_exception());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& w : _requests)
+        w.set_exception(std::make_exception_ptr(std::runtime_error("Archive manager stopped")));
+}
+
+ArchiveSummary ArchiveManager::pass() {
+    TraceSpan span("ArchiveManager::pass", "archive");
+    auto start = SteadyClock::now();
+    ArchiveSummary summary;
+    auto between = [&] {
+        ++summary.batches;
+        std::this_thread::sleep_for(_options.pause);
+    };
+
+    // Retired titles, with their whole loan history.
+    while (!stopping()) {
+        std::optional<std::int64_t> last;
+        _db->write([&] {
+            last = batchEnd(RetiredBatchEnd::one(*_db, _options.batchRows));
+            if (!last) return;
+            CopyRetired::exec(*_db, _clock->now(), *last);
+            CopyRetiredHistory::exec(*_db, *last);
+        });
+        if (!last) break;
+        _db->write([&] {
+            summary.loanRecords += DeleteRetiredHistory::exec(*_db, *last);
+            DeleteRetiredAliases::exec(*_db, *last);
+            DeleteRetiredAttributes::exec(*_db, *last);
+            DeleteRetiredStats::exec(*_db, *last);
+            DeleteRetiredAssets::exec(*_db, *last);
+            summary.assets += DeleteRetired::exec(*_db, *last);
+        });
+        between();
+    }
+
+    // Aged history of titles still in circulation.
+    time_t cutoff = _clock->now() - _options.historyAge;
+    while (!stopping()) {
+        std::optional<std::int64_t> last;
+        _db->write([&] {
+            last = batchEnd(AgedBatchEnd::one(*_db, cutoff, _options.batchRows));
+            if (last) CopyAged::exec(*_db, cutoff, *last);
+        });
+        if (!last) break;
+        _db->write([&] { summary.loanRecords += DeleteAged::exec(*_db, cutoff, *last); });
+        between();
+    }
+
+    summary.elapsedMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+    return summary;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "../util/Clock.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DatabaseManager;
+
+struct ArchiveOptions {
+    std::string               path = "archive.db";
+    int                       batchRows = 500;                    // titles or loan records per move
+    std::chrono::milliseconds pause{1};                           // gap between batches for writers
+    time_t                    historyAge = 365 * 24 * 60 * 60;   // closed loans older than this move out
+};
+
+struct ArchiveSummary {
+    std::size_t assets = 0;        // retired titles moved
+    std::size_t loanRecords = 0;   // aged closed loans moved (a retired title's history goes with it)
+    std::size_t batches = 0;
+    double      elapsedMs = 0;
+};
+
+// Cold storage for the catalogue. Retired titles and closed loans older
+// than `historyAge` move out of the hot assets/loan_history tables into an
+// attached archive database, so listings, scans and their indexes only
+// cover what is still in circulation. Archived titles stay searchable
+// through AssetRepository::search(..., includeArchived).
+//
+// Passes run on a background thread, `batchRows` at a time. Each batch is
+// copied in one transaction and deleted from the hot tables in the next:
+// SQLite does not commit attached WAL databases atomically, and this way a
+// crash between the two leaves a row in both places, which the next pass
+// finishes moving, rather than in neither. The delete only takes rows the
+// archive already holds, so a title retired between the two waits for the
+// next batch.
+class ArchiveManager {
+public:
+    ArchiveManager(std::shared_ptr<DatabaseManager> db, ArchiveOptions options = {},
+                   std::shared_ptr<Clock> clock = systemClock());
+    ~ArchiveManager();
+
+    // Takes a title out of circulation: its copies are withdrawn at once
+    // and the next pass moves it. False if it is unknown or already
+    // retired, or still has copies on loan or holds waiting.
+    bool retire(const std::string& assetId);
+
+    // Queues a pass; the future yields what it moved or the failure.
+    std::future<ArchiveSummary> archiveNow();
+
+    std::size_t retiredPending();   // retired, not yet moved
+
+private:
+    std::shared_ptr<DatabaseManager> _db;
+    ArchiveOptions                   _options;
+    std::shared_ptr<Clock>           _clock;
+
+    std::mutex                                _mutex;
+    std::condition_variable                   _wake;
+    std::vector<std::promise<ArchiveSummary>> _requests;
+    bool                                      _stopping = false;
+    std::thread                               _worker;
+
+    void run();
+    ArchiveSummary pass();
+    bool stopping();
+};
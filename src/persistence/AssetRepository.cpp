@@ -1,107 +1,240 @@
 #include "AssetRepository.h"
-#include <sqlite3.h>
-#include <stdexcept>
-
-AssetRepository::AssetRepository(std::shared_ptr<DatabaseManager> db)
-    : _db(std::move(db)) {}
-
-void AssetRepository::add(const Asset& asset) {
-    const char* sql = R"(
-        INSERT OR IGNORE INTO assets (id, type, title, author_or_owner, is_issued)
-        VALUES (?, ?, ?, ?, ?);
-    )";
-    sqlite3* db = _db->get();
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        throw std::runtime_error("Prepare asset insert failed");
-
-    sqlite3_bind_text(stmt, 1, asset.id().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, assetTypeToString(asset.type()).c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, asset.title().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, asset.authorOrOwner().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 5, asset.isIssued() ? 1 : 0);
-
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
-        throw std::runtime_error("Asset insert failed");
+#include "Query.h"
+#include "../util/Trace.h"
+#include <cctype>
+
+template <>
+struct query::Column<AssetType> {
+    static AssetType get(sqlite3_stmt* s, int i) {
+        return codeToAssetType(sqlite3_column_int(s, i));
     }
-    sqlite3_finalize(stmt);
+};
+
+namespace {
+
+// Text is read in place; Asset copies it into the caller's resource.
+using AssetRow = query::Row<std::string_view, AssetType, std::string_view, std::string_view, int, int>;
+
+// Rows are keyed by an integer id; the IDs callers see live in ext_id.
+using InsertAsset = query::Query<R"(
+    INSERT OR IGNORE INTO assets (ext_id, type, title, author_or_owner, copies, available)
+    VALUES (?, ?, ?, ?, ?, ?);
+)", query::Row<>, std::string_view, int, std::string_view, std::string_view, int, int>;
+
+using FindAsset = query::Query<
+    "SELECT ext_id, type, title, author_or_owner, copies, available FROM assets WHERE ext_id = ?;",
+    AssetRow, std::string_view>;
+
+// IDs of copies that were merged into a title by the holdings migration.
+using FindAlias = query::Query<R"(
+    SELECT a.ext_id, a.type, a.title, a.author_or_owner, a.copies, a.available
+    FROM asset_aliases x JOIN assets a ON a.id = x.asset_id
+    WHERE x.ext_id = ?;
+)", AssetRow, std::string_view>;
+
+using AllAssets = query::Query<"SELECT ext_id, type, title, author_or_owner, copies, available FROM assets;", AssetRow>;
+
+using SearchAssets = query::Query<R"(
+    SELECT a.ext_id, a.type, a.title, a.author_or_owner, a.copies, a.available, f.rank
+    FROM assets_fts f JOIN assets a ON a.id = f.rowid
+    WHERE assets_fts MATCH ?
+    ORDER BY f.rank
+    LIMIT ? OFFSET ?;
+)", query::Row<std::string_view, AssetType, std::string_view, std::string_view, int, int, double>, std::string_view,
+    int, int>;
+
+// Both indexes use the same bm25 weights, so their ranks interleave.
+using SearchWithArchive = query::Query<R"(
+    SELECT ext_id, type, title, author_or_owner, copies, available, rank, archived FROM (
+        SELECT a.ext_id, a.type, a.title, a.author_or_owner, a.copies, a.available, f.rank, 0 AS archived
+        FROM assets_fts f JOIN assets a ON a.id = f.rowid
+        WHERE assets_fts MATCH ?
+        UNION ALL
+        SELECT a.ext_id, a.type, a.title, a.author_or_owner, a.copies, 0, f.rank, 1
+        FROM archive.assets_fts f JOIN archive.assets a ON a.id = f.rowid
+        WHERE assets_fts MATCH ?)
+    ORDER BY rank
+    LIMIT ? OFFSET ?;
+)", query::Row<std::string_view, AssetType, std::string_view, std::string_view, int, int, double, int>,
+    std::string_view,
+    std::string_view, int, int>;
+
+using AssetPage = query::Query<R"(
+    SELECT ext_id, type, title, author_or_owner, copies, available FROM assets
+    WHERE ext_id > ? ORDER BY ext_id LIMIT ?;
+)", AssetRow, std::string_view, int>;
+
+// Copy counters change in place; the CHECK constraints on assets keep
+// them within 0..copies. Like find(), they take a title's ID or an alias
+// of it, which is why the ID is bound twice.
+using TakeCopy = query::Query<R"(
+    UPDATE assets SET available = available - 1
+    WHERE id = coalesce((SELECT id FROM assets WHERE ext_id = ?), (SELECT asset_id FROM asset_aliases WHERE ext_id = ?))
+      AND available > 0;
+)", query::Row<>, std::string_view, std::string_view>;
+
+using ReturnCopy = query::Query<R"(
+    UPDATE assets SET available = available + 1
+    WHERE id = coalesce((SELECT id FROM assets WHERE ext_id = ?), (SELECT asset_id FROM asset_aliases WHERE ext_id = ?))
+      AND available < copies;
+)", query::Row<>, std::string_view, std::string_view>;
+
+using AddCopies = query::Query<R"(
+    UPDATE assets SET copies = copies + ?, available = available + ?
+    WHERE id = coalesce((SELECT id FROM assets WHERE ext_id = ?), (SELECT asset_id FROM asset_aliases WHERE ext_id = ?))
+      AND available + ? >= 0
+    RETURNING type;
+)", query::Row<int>, int, int, std::string_view, std::string_view, int>;
+
+// Copies per type, for utilization reports.
+using CountCopies = query::Query<R"(
+    INSERT INTO type_stats (type, copies) VALUES (?, ?)
+    ON CONFLICT(type) DO UPDATE SET copies = copies + excluded.copies;
+)", query::Row<>, int, int>;
+
+using RecountCopies = query::Query<"UPDATE type_stats SET copies = copies + ? WHERE type = ?;",
+                                   query::Row<>, int, int>;
+
+using InsertAttribute = query::Query<R"(
+    INSERT OR REPLACE INTO asset_attributes (asset_id, name, value)
+    SELECT id, ?, ? FROM assets WHERE ext_id = ?;
+)", query::Row<>, std::string_view, std::string_view, std::string_view>;
+
+using Attributes = query::Query<R"(
+    SELECT x.name, x.value FROM assets a JOIN asset_attributes x ON x.asset_id = a.id WHERE a.ext_id = ?;
+)", query::Row<std::string, std::string>, std::string_view>;
+
+using Available = query::Query<R"(
+    SELECT available FROM assets
+    WHERE id = coalesce((SELECT id FROM assets WHERE ext_id = ?), (SELECT asset_id FROM asset_aliases WHERE ext_id = ?));
+)", query::Row<int>, std::string_view, std::string_view>;
+
+}  // namespace
+
+AssetRepository::AssetRepository(std::shared_ptr<DatabaseManager> db, std::shared_ptr<EventBus> events)
+    : _db(std::move(db)), _events(std::move(events)) {}
+
+void AssetRepository::add(const Asset& asset, const AssetAttributes& attributes) {
+    TraceSpan span("AssetRepository::add", "repository");
+    _db->write([&] {
+        int code = assetTypeToCode(asset.type());
+        if (InsertAsset::exec(*_db, asset.id(), code, asset.title(), asset.authorOrOwner(), asset.copies(),
+                              asset.available()) == 0)
+            return;
+        CountCopies::exec(*_db, code, asset.copies());
+        for (auto& [name, value] : attributes) InsertAttribute::exec(*_db, name, value, asset.id());
+        if (_events)
+            _db->afterCommit([bus = _events, e = AssetAdded{std::string(asset.id()), asset.type(), asset.copies()}] {
+                bus->publish(e);
+            });
+    });
 }
 
-std::optional<Asset> AssetRepository::find(const std::string& id) {
-    const char* sql = "SELECT type, title, author_or_owner, is_issued FROM assets WHERE id = ?;";
-    sqlite3* db = _db->get();
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return std::nullopt;
-
-    sqlite3_bind_text(stmt, 1, id.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::string typeStr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        std::string title = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        std::string authorOrOwner = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        bool issued = sqlite3_column_int(stmt, 3) != 0;
-        sqlite3_finalize(stmt);
-        Asset asset(id, stringToAssetType(typeStr), title, authorOrOwner);
-        asset.setIssued(issued);
+std::optional<Asset> AssetRepository::find(std::string_view id, std::pmr::memory_resource* memory) {
+    TraceSpan span("AssetRepository::find", "repository");
+    if (auto asset = FindAsset::oneAs<Asset>(*_db, memory, id))
         return asset;
+    return FindAlias::oneAs<Asset>(*_db, memory, id);
+}
+
+std::pmr::vector<Asset> AssetRepository::getAll(std::pmr::memory_resource* memory) {
+    TraceSpan span("AssetRepository::getAll", "repository");
+    return AllAssets::allAs<Asset>(*_db, memory);
+}
+
+// Turns free text into an FTS5 query. Words are quoted so punctuation in
+// user input can't break the MATCH syntax; only the last word is a prefix
+// (search-as-you-type) and only from three characters on, which keeps term
+// expansion and ranking cheap.
+static std::string toMatchExpression(const std::string& query) {
+    std::string expr, word, last;
+    auto flush = [&] {
+        if (word.empty()) return;
+        if (!expr.empty()) expr += ' ';
+        expr += '"' + word + '"';
+        last = std::move(word);
+        word.clear();
+    };
+    for (unsigned char c : query) {
+        if (std::isalnum(c) || c >= 0x80) word += static_cast<char>(c);
+        else flush();
     }
-    sqlite3_finalize(stmt);
-    return std::nullopt;
+    flush();
+    if (last.size() >= 3) expr += '*';
+    return expr;
 }
 
-std::vector<Asset> AssetRepository::getAll() {
-    const char* sql = "SELECT id, type, title, author_or_owner, is_issued FROM assets;";
-    sqlite3* db = _db->get();
-    sqlite3_stmt* stmt = nullptr;
-    std::vector<Asset> out;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return out;
+std::pmr::vector<Asset> AssetRepository::search(const std::string& query, int limit, int offset,
+                                                bool includeArchived, std::pmr::memory_resource* memory) {
+    TraceSpan span("AssetRepository::search", "repository");
+    std::pmr::vector<Asset> out(memory);
+    for (auto& hit : searchRanked(query, limit, offset, includeArchived, memory))
+        out.push_back(std::move(hit.asset));
+    return out;
+}
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::string id = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        std::string typeStr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        std::string title = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        std::string authorOrOwner = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        bool issued = sqlite3_column_int(stmt, 4) != 0;
-        Asset a(id, stringToAssetType(typeStr), title, authorOrOwner);
-        a.setIssued(issued);
-        out.push_back(std::move(a));
+std::pmr::vector<RankedAsset> AssetRepository::searchRanked(const std::string& query, int limit, int offset,
+                                                            bool includeArchived, std::pmr::memory_resource* memory) {
+    TraceSpan span("AssetRepository::searchRanked", "repository");
+    std::pmr::vector<RankedAsset> out(memory);
+    std::string match = toMatchExpression(query);
+    if (match.empty() || limit <= 0)
+        return out;
+    out.reserve(limit);
+    if (includeArchived && _db->hasArchive()) {
+        SearchWithArchive::each(*_db, [&](std::string_view id, AssetType type, std::string_view title,
+                                          std::string_view author, int copies, int available, double rank,
+                                          int archived) {
+            out.push_back({Asset(id, type, title, author, copies, available, memory), rank, archived != 0});
+        }, match, match, limit, offset);
+        return out;
     }
-    sqlite3_finalize(stmt);
+    SearchAssets::each(*_db, [&](std::string_view id, AssetType type, std::string_view title,
+                                 std::string_view author, int copies, int available, double rank) {
+        out.push_back({Asset(id, type, title, author, copies, available, memory), rank});
+    }, match, limit, offset);
     return out;
 }
 
-void AssetRepository::setIssued(const std::string& id, bool issued) {
-    const char* sql = "UPDATE assets SET is_issued = ? WHERE id = ?;";
-    sqlite3* db = _db->get();
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        throw std::runtime_error("Prepare update failed");
+std::pmr::vector<Asset> AssetRepository::page(std::string_view afterId, int limit,
+                                              std::pmr::memory_resource* memory) {
+    TraceSpan span("AssetRepository::page", "repository");
+    return AssetPage::allAs<Asset>(*_db, memory, afterId, limit);
+}
 
-    sqlite3_bind_int(stmt, 1, issued ? 1 : 0);
-    sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+bool AssetRepository::takeCopy(const std::string& id) {
+    TraceSpan span("AssetRepository::takeCopy", "repository");
+    bool taken = false;
+    _db->write([&] { taken = TakeCopy::exec(*_db, id, id) > 0; });
+    return taken;
+}
 
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
-        throw std::runtime_error("Update failed");
-    }
-    sqlite3_finalize(stmt);
+bool AssetRepository::returnCopy(const std::string& id) {
+    TraceSpan span("AssetRepository::returnCopy", "repository");
+    bool returned = false;
+    _db->write([&] { returned = ReturnCopy::exec(*_db, id, id) > 0; });
+    return returned;
 }
 
-bool AssetRepository::isIssued(const std::string& id) {
-    const char* sql = "SELECT is_issued FROM assets WHERE id = ?;";
-    sqlite3* db = _db->get();
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return false;
-
-    sqlite3_bind_text(stmt, 1, id.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        bool issued = sqlite3_column_int(stmt, 0) != 0;
-        sqlite3_finalize(stmt);
-        return issued;
-    }
-    sqlite3_finalize(stmt);
-    return false;
-}
\ No newline at end of file
+bool AssetRepository::addCopies(const std::string& id, int delta) {
+    TraceSpan span("AssetRepository::addCopies", "repository");
+    bool changed = false;
+    _db->write([&] {
+        auto row = AddCopies::one(*_db, delta, delta, id, id, delta);
+        if (!row) return;
+        changed = true;
+        RecountCopies::exec(*_db, delta, std::get<0>(*row));
+    });
+    return changed;
+}
+
+int AssetRepository::available(const std::string& id) {
+    TraceSpan span("AssetRepository::available", "repository");
+    auto row = Available::one(*_db, id, id);
+    return row ? std::get<0>(*row) : 0;
+}
+
+AssetAttributes AssetRepository::attributes(std::string_view id) {
+    TraceSpan span("AssetRepository::attributes", "repository");
+    return Attributes::allAs<AssetAttributes::value_type>(*_db, id);
+}
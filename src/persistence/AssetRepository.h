@@ -1,21 +1,64 @@
 #pragma once
 #include "../models/Asset.h"
 #include "DatabaseManager.h"
+#include "../util/Arena.h"
+#include "../util/EventBus.h"
+#include <memory_resource>
 #include <memory>
 #include <vector>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Name/value details recorded for an asset (a laptop's serial), by name.
+using AssetAttributes = std::vector<std::pair<std::string, std::string>>;
+
+struct RankedAsset {
+    Asset  asset;
+    double rank;              // FTS5 bm25, lower is better
+    bool   archived = false;  // retired; copies as when retired, none available
+};
 
 class AssetRepository {
 public:
-    explicit AssetRepository(std::shared_ptr<DatabaseManager> db);
-    void add(const Asset& asset);
-    std::optional<Asset> find(const std::string& id);
-    std::vector<Asset> getAll();
-    void setIssued(const std::string& id, bool issued);
-    bool isIssued(const std::string& id);
+    // With a bus, add() publishes AssetAdded once it commits.
+    explicit AssetRepository(std::shared_ptr<DatabaseManager> db, std::shared_ptr<EventBus> events = nullptr);
+    // Attributes are stored with the asset, in the same transaction.
+    void add(const Asset& asset, const AssetAttributes& attributes = {});
+
+    // Reads build their results in `memory`: the command's arena when one
+    // is open (see CommandArena), the default resource otherwise.
+    std::optional<Asset> find(std::string_view id, std::pmr::memory_resource* memory = CommandArena::current());
+    std::pmr::vector<Asset> getAll(std::pmr::memory_resource* memory = CommandArena::current());
+    // Ranked title/author search. Every query word must match a whole
+    // word, except the last, which is prefix-matched once it has 3 or
+    // more characters (it may still be being typed).
+    // includeArchived also searches retired titles once the database has
+    // an archive attached (see ArchiveManager).
+    std::pmr::vector<Asset> search(const std::string& query, int limit = 20, int offset = 0,
+                                   bool includeArchived = false,
+                                   std::pmr::memory_resource* memory = CommandArena::current());
+    std::pmr::vector<RankedAsset> searchRanked(const std::string& query, int limit = 20, int offset = 0,
+                                               bool includeArchived = false,
+                                               std::pmr::memory_resource* memory = CommandArena::current());
+    // Up to `limit` assets with id > afterId, in id order (keyset paging).
+    std::pmr::vector<Asset> page(std::string_view afterId, int limit,
+                                 std::pmr::memory_resource* memory = CommandArena::current());
+    // The copy counters take a title's ID or, as find() does, an alias
+    // left by the holdings migration.
+    // Claims one shelf copy of a title; false when none is left.
+    bool takeCopy(const std::string& id);
+    bool returnCopy(const std::string& id);
+    // Adds (or, with a negative delta, withdraws) shelf copies.
+    bool addCopies(const std::string& id, int delta);
+    int available(const std::string& id);
+    AssetAttributes attributes(std::string_view id);
 
     std::shared_ptr<DatabaseManager> getDb() const { return _db; }
+    std::shared_ptr<EventBus> events() const { return _events; }
 
 private:
     std::shared_ptr<DatabaseManager> _db;
+    std::shared_ptr<EventBus>        _events;
 };
\ No newline at end of file
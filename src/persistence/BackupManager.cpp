@@ -0,0 +1,196 @@
+#include "BackupManager.h"
+#include "DatabaseManager.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+BackupManager::BackupManager(DatabaseManager& db, BackupOptions options, std::shared_ptr<Clock> clock)
+    : _db(db), _options(std::move(options)), _clock(std::move(clock)) {
+    fs::create_directories(_options.directory);
+    _worker = std::thread(&BackupManager::run, this);
+}
+
+BackupManager::~BackupManager() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _worker.join();
+}
+
+std::future<std::string> BackupManager::backupNow() {
+    std::promise<std::string> request;
+    auto result = request.get_future();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requests.push_back(std::move(request));
+    }
+    _wake.notify_one();
+    return result;
+}
+
+void BackupManager::schedule(std::chrono::seconds interval) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _interval = interval;
+        _nextScheduled = SteadyClock::now() + interval;
+    }
+    _wake.notify_one();
+}
+
+void BackupManager::stopSchedule() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _interval = std::chrono::seconds(0);
+}
+
+BackupProgress BackupManager::progress() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _progress;
+}
+
+std::vector<std::string> BackupManager::snapshots() const {
+    std::vector<std::string> out;
+    std::error_code ec;
+    for (auto& entry : fs::directory_iterator(_options.directory, ec)) {
+        auto name = entry.path().filename().string();
+        if (name.rfind(_options.prefix + "-", 0) == 0 && entry.path().extension() == ".db")
+            out.push_back(entry.path().string());
+    }
+    // Names embed a sortable timestamp and sequence number.
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+void BackupManager::run() {
+    while (true) {
+        std::vector<std::promise<std::string>> waiting;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            auto due = [&] {
+                return _interval.count() > 0 && SteadyClock::now() >= _nextScheduled;
+            };
+            while (!_stopping && _requests.empty() && !due()) {
+                if (_interval.count() > 0) _wake.wait_until(lock, _nextScheduled);
+                else                       _wake.wait(lock);
+            }
+            if (_stopping) break;
+            if (due()) _nextScheduled = SteadyClock::now() + _interval;
+            // Requests that arrive together share one snapshot.
+            waiting.swap(_requests);
+        }
+
+        try {
+            auto path = snapshot();
+            for (auto& w : waiting) w.set_value(path);
+        } catch (const std::exception& e) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _progress.running = false;
+                _progress.lastError = e.what();
+            }
+            for (auto& w : waiting) w.set_exception(std::current_exception());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& w : _requests)
+        w.set_exception(std::make_exception_ptr(std::runtime_error("Backup manager stopped")));
+}
+
+std::string BackupManager::nextName() {
+    std::time_t now = _clock->now();
+    std::tm tm{};
+    gmtime_r(&now, &tm);
+    char stamp[32];
+    std::strftime(stamp, sizeof stamp, "%Y%m%d-%H%M%S", &tm);
+    char seq[16];
+    std::snprintf(seq, sizeof seq, "%04llu", static_cast<unsigned long long>(++_sequence % 10000));
+    return (fs::path(_options.directory) / (_options.prefix + "-" + stamp + "-" + seq + ".db")).string();
+}
+
+std::string BackupManager::snapshot() {
+    auto path = nextName();
+    auto part = path + ".part";
+    fs::remove(part);
+    auto start = SteadyClock::now();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _progress.running = true;
+        _progress.current = path;
+        _progress.pagesTotal = _progress.pagesRemaining = 0;
+        _progress.elapsedMs = 0;
+    }
+
+    sqlite3* dest = nullptr;
+    if (sqlite3_open(part.c_str(), &dest) != SQLITE_OK) {
+        std::string e = sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        throw std::runtime_error("Cannot open backup file: " + e);
+    }
+
+    sqlite3_backup* backup = nullptr;
+    int rc = SQLITE_OK;
+    int deferred = 0;
+    while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+        // Step aside for writers, but not forever under a steady stream.
+        bool mustStep = deferred >= _options.maxDeferrals;
+        bool stepped = _db.tryExclusive([&] {
+            if (!backup) {
+                backup = sqlite3_backup_init(dest, "main", _db.get(), "main");
+                if (!backup) { rc = sqlite3_errcode(dest); return; }
+            }
+            rc = sqlite3_backup_step(backup, _options.pagesPerStep);
+        }, mustStep);
+        deferred = stepped ? 0 : deferred + 1;
+        if (!backup && stepped) break;   // init failed
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (stepped) {
+                ++_progress.steps;
+                _progress.pagesTotal = sqlite3_backup_pagecount(backup);
+                _progress.pagesRemaining = sqlite3_backup_remaining(backup);
+            } else {
+                ++_progress.yields;
+            }
+            _progress.elapsedMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+            if (_stopping && rc != SQLITE_DONE) rc = SQLITE_INTERRUPT;
+        }
+        if (rc != SQLITE_DONE) std::this_thread::sleep_for(_options.pause);
+    }
+    if (backup) sqlite3_backup_finish(backup);
+    sqlite3_close(dest);
+
+    if (rc != SQLITE_DONE) {
+        fs::remove(part);
+        throw std::runtime_error("Backup failed: " + std::string(sqlite3_errstr(rc)));
+    }
+    fs::rename(part, path);
+
+    double ms = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _progress.running = false;
+        _progress.completed++;
+        _progress.lastSnapshot = path;
+        _progress.lastDurationMs = ms;
+        _progress.elapsedMs = ms;
+        _progress.lastError.clear();
+    }
+    prune();
+    return path;
+}
+
+void BackupManager::prune() {
+    auto all = snapshots();
+    for (std::size_t i = 0; i + _options.keep < all.size(); ++i) {
+        std::error_code ec;
+        fs::remove(all[i], ec);
+    }
+}
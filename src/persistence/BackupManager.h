@@ -0,0 +1,75 @@
+#pragma once
+#include "../util/Clock.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DatabaseManager;
+
+struct BackupOptions {
+    std::string               directory = "backups";
+    std::string               prefix = "library";
+    int                       pagesPerStep = 64;   // copied per write-lock hold
+    std::chrono::milliseconds pause{1};            // gap between steps for writers
+    int                       maxDeferrals = 20;   // then wait for the lock
+    std::size_t               keep = 7;            // snapshots retained
+};
+
+struct BackupProgress {
+    bool          running = false;
+    std::string   current;           // snapshot being written
+    int           pagesTotal = 0;
+    int           pagesRemaining = 0;
+    double        elapsedMs = 0;     // of the running backup
+    std::uint64_t steps = 0;
+    std::uint64_t yields = 0;        // steps deferred because a writer was busy
+    std::uint64_t completed = 0;
+    std::string   lastSnapshot;
+    double        lastDurationMs = 0;
+    std::string   lastError;
+};
+
+// Online snapshots of a live database. Pages are copied a few at a time
+// with the write lock held only for each step, so issues and returns keep
+// flowing; a write made mid-backup through the same connection is carried
+// into the copy by SQLite. Snapshots are written to a .part file and
+// renamed when complete, then the oldest beyond `keep` are deleted.
+class BackupManager {
+public:
+    BackupManager(DatabaseManager& db, BackupOptions options, std::shared_ptr<Clock> clock = systemClock());
+    ~BackupManager();
+
+    // Queues a snapshot; the future yields its path or the failure.
+    std::future<std::string> backupNow();
+    void schedule(std::chrono::seconds interval);
+    void stopSchedule();
+
+    BackupProgress progress() const;
+    std::vector<std::string> snapshots() const;   // oldest first
+
+private:
+    DatabaseManager&       _db;
+    BackupOptions          _options;
+    std::shared_ptr<Clock> _clock;
+
+    mutable std::mutex                       _mutex;
+    std::condition_variable                  _wake;
+    std::vector<std::promise<std::string>>   _requests;
+    std::chrono::seconds                     _interval{0};
+    std::chrono::steady_clock::time_point    _nextScheduled;
+    bool                                     _stopping = false;
+    BackupProgress                           _progress;
+    std::uint64_t                            _sequence = 0;
+    std::thread                              _worker;
+
+    void run();
+    std::string snapshot();
+    std::string nextName();
+    void prune();
+};
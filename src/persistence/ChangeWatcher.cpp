@@ -0,0 +1,48 @@
+#include "ChangeWatcher.h"
+#include "DatabaseManager.h"
+#include "../util/Trace.h"
+
+ChangeWatcher::ChangeWatcher(std::shared_ptr<DatabaseManager> db, std::shared_ptr<EventBus> events)
+    : _db(std::move(db)), _events(std::move(events)) {
+    _db->externalChanges();   // start from now
+}
+
+ChangeWatcher::~ChangeWatcher() {
+    stop();
+}
+
+bool ChangeWatcher::poll() {
+    auto changes = _db->externalChanges();
+    if (changes.empty()) return false;
+    TraceSpan span("ChangeWatcher::publish", "db");
+    _events->publish(ExternalChange{std::move(changes.assetIds), std::move(changes.userIds), changes.everything});
+    ++_published;
+    return true;
+}
+
+void ChangeWatcher::start(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_thread.joinable()) return;
+    _stopping = false;
+    _thread = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_cv.wait_for(lock, interval, [this] { return _stopping; })) {
+            lock.unlock();
+            try {
+                poll();
+            } catch (const std::exception&) {
+                // Busy or locked by another process; the next poll catches up.
+            }
+            lock.lock();
+        }
+    });
+}
+
+void ChangeWatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _cv.notify_all();
+    if (_thread.joinable()) _thread.join();
+}
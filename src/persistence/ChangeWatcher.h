@@ -0,0 +1,43 @@
+#pragma once
+#include "../util/EventBus.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class DatabaseManager;
+
+// Turns commits made by other processes on the same database file into
+// ExternalChange events on the bus, so in-memory mirrors (hold queues,
+// the overdue mirror, the user name index) reload only the assets and
+// users that were touched. Detection is DatabaseManager::externalChanges():
+// a PRAGMA data_version per poll while nothing happens.
+class ChangeWatcher {
+public:
+    ChangeWatcher(std::shared_ptr<DatabaseManager> db, std::shared_ptr<EventBus> events);
+    ~ChangeWatcher();   // stops polling
+
+    ChangeWatcher(const ChangeWatcher&) = delete;
+    ChangeWatcher& operator=(const ChangeWatcher&) = delete;
+
+    // Checks once; publishes and returns true if something changed.
+    bool poll();
+    // Polls every interval on a background thread until stop().
+    void start(std::chrono::milliseconds interval = std::chrono::milliseconds(250));
+    void stop();
+
+    std::uint64_t published() const { return _published; }
+
+private:
+    std::shared_ptr<DatabaseManager> _db;
+    std::shared_ptr<EventBus>        _events;
+
+    std::mutex                 _mutex;
+    std::condition_variable    _cv;
+    bool                       _stopping = false;
+    std::thread                _thread;
+    std::atomic<std::uint64_t> _published{0};
+};
@@ -0,0 +1,347 @@
+#include "ConsistencyChecker.h"
+#include "DatabaseManager.h"
+#include "Query.h"
+#include "../util/ThreadPool.h"
+#include "../util/Trace.h"
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <limits>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+using Connection = std::unique_ptr<sqlite3, int (*)(sqlite3*)>;
+using Statement = std::unique_ptr<sqlite3_stmt, int (*)(sqlite3_stmt*)>;
+using Kind = ConsistencyIssue::Kind;
+
+[[noreturn]] void fail(sqlite3* db) {
+    throw std::runtime_error(std::string("Consistency check failed: ") + sqlite3_errmsg(db));
+}
+
+void exec(sqlite3* db, const char* sql) {
+    if (sqlite3_exec(db, sql, nullptr, nullptr, nullptr) != SQLITE_OK) fail(db);
+}
+
+Statement prepare(sqlite3* db, const char* sql) {
+    sqlite3_stmt* st = nullptr;
+    if (sqlite3_prepare_v2(db, sql, -1, &st, nullptr) != SQLITE_OK) fail(db);
+    return Statement(st, sqlite3_finalize);
+}
+
+bool step(sqlite3_stmt* st) {
+    int rc = sqlite3_step(st);
+    if (rc == SQLITE_ROW) return true;
+    if (rc != SQLITE_DONE) fail(sqlite3_db_handle(st));
+    return false;
+}
+
+Connection openReader(const std::string& path) {
+    sqlite3* conn = nullptr;
+    int rc = sqlite3_open_v2(path.c_str(), &conn, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+    Connection guard(conn, sqlite3_close);
+    if (rc != SQLITE_OK) fail(conn);
+    sqlite3_busy_timeout(conn, 5000);
+    return guard;
+}
+
+// Which user ids exist. Ids are rowids, so nearly dense: a bitmap over the
+// range, unless someone inserted far-flung ids, then a sorted vector.
+class UserSet {
+public:
+    explicit UserSet(sqlite3* db) {
+        auto st = prepare(db, "SELECT id FROM users ORDER BY id;");
+        while (step(st.get())) _ids.push_back(sqlite3_column_int64(st.get(), 0));
+        if (!_ids.empty() && _ids.front() >= 0 &&
+            _ids.back() < static_cast<std::int64_t>(_ids.size()) * 8 + (1 << 20)) {
+            _bits.resize(static_cast<std::size_t>(_ids.back()) / 64 + 1);
+            for (auto id : _ids) _bits[id / 64] |= std::uint64_t{1} << (id % 64);
+            _ids.shrink_to_fit();
+        }
+    }
+
+    bool contains(std::int64_t id) const {
+        if (!_bits.empty())
+            return id >= 0 && static_cast<std::size_t>(id / 64) < _bits.size() && (_bits[id / 64] >> (id % 64) & 1);
+        return std::binary_search(_ids.begin(), _ids.end(), id);
+    }
+    std::size_t size() const { return _ids.size(); }
+
+private:
+    std::vector<std::int64_t>  _ids;
+    std::vector<std::uint64_t> _bits;
+};
+
+struct Totals {
+    std::int64_t copies = 0;
+    std::int64_t onLoan = 0;
+};
+
+struct ChunkResult {
+    std::size_t                   assets = 0, loans = 0, holds = 0;
+    std::vector<ConsistencyIssue> issues;
+    std::map<std::int64_t, Totals> totals;   // by type code
+};
+
+// One worker's statements, reused for every chunk it takes.
+class ChunkScanner {
+public:
+    explicit ChunkScanner(sqlite3* db)
+        : _db(db),
+          _assets(prepare(db, "SELECT id, type, copies, available FROM assets WHERE id BETWEEN ? AND ? ORDER BY id;")),
+          _loans(prepare(db, "SELECT asset_id, user_id, id FROM loans WHERE asset_id BETWEEN ? AND ? "
+                             "ORDER BY asset_id;")),
+          _holds(prepare(db, "SELECT asset_id, user_id, id, ready_at IS NOT NULL FROM holds "
+                             "WHERE asset_id BETWEEN ? AND ? ORDER BY asset_id;")) {}
+
+    void scan(std::int64_t lo, std::int64_t hi, const UserSet& users, ChunkResult& out) {
+        TraceSpan span("ConsistencyChecker::chunk", "check");
+        sqlite3_stmt* assets = _assets.get();
+        sqlite3_stmt* loans = _loans.get();
+        sqlite3_stmt* holds = _holds.get();
+        for (auto* st : {assets, loans, holds}) {
+            sqlite3_bind_int64(st, 1, lo);
+            sqlite3_bind_int64(st, 2, hi);
+        }
+        exec(_db, "BEGIN;");
+        try {
+            bool haveLoan = step(loans), haveHold = step(holds);
+            auto orphan = [&](Kind kind, sqlite3_stmt* st) {
+                out.issues.push_back({kind, sqlite3_column_int64(st, 2), sqlite3_column_int64(st, 0),
+                                      sqlite3_column_int64(st, 1)});
+            };
+            while (step(assets)) {
+                ++out.assets;
+                std::int64_t id = sqlite3_column_int64(assets, 0);
+                std::int64_t onLoan = 0, ready = 0;
+                // Both sides are in asset id order; what sorts before this
+                // asset matched none.
+                for (; haveLoan && sqlite3_column_int64(loans, 0) <= id; haveLoan = step(loans), ++out.loans) {
+                    if (sqlite3_column_int64(loans, 0) < id) { orphan(Kind::LoanWithoutAsset, loans); continue; }
+                    ++onLoan;
+                    if (!users.contains(sqlite3_column_int64(loans, 1))) orphan(Kind::LoanWithoutUser, loans);
+                }
+                for (; haveHold && sqlite3_column_int64(holds, 0) <= id; haveHold = step(holds), ++out.holds) {
+                    if (sqlite3_column_int64(holds, 0) < id) { orphan(Kind::HoldWithoutAsset, holds); continue; }
+                    ready += sqlite3_column_int(holds, 3);
+                    if (!users.contains(sqlite3_column_int64(holds, 1))) orphan(Kind::HoldWithoutUser, holds);
+                }
+                std::int64_t copies = sqlite3_column_int64(assets, 2);
+                std::int64_t available = sqlite3_column_int64(assets, 3);
+                auto& t = out.totals[sqlite3_column_int64(assets, 1)];
+                t.copies += copies;
+                t.onLoan += onLoan;
+                if (available != copies - onLoan - ready)
+                    out.issues.push_back({Kind::ShelfCount, id, id, 0, available, copies - onLoan - ready});
+            }
+            for (; haveLoan; haveLoan = step(loans), ++out.loans) orphan(Kind::LoanWithoutAsset, loans);
+            for (; haveHold; haveHold = step(holds), ++out.holds) orphan(Kind::HoldWithoutAsset, holds);
+        } catch (...) {
+            for (auto* st : {assets, loans, holds}) sqlite3_reset(st);
+            sqlite3_exec(_db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            throw;
+        }
+        for (auto* st : {assets, loans, holds}) sqlite3_reset(st);
+        exec(_db, "COMMIT;");
+    }
+
+private:
+    sqlite3*  _db;
+    Statement _assets, _loans, _holds;
+};
+
+// Repairs. Each one repeats the test it fixes, so a row that was put right
+// (or reused) since the check is not touched.
+using DeleteOrphanLoan = query::Query<R"(
+    DELETE FROM loans WHERE id = ?
+        AND (asset_id NOT IN (SELECT id FROM assets) OR user_id NOT IN (SELECT id FROM users));
+)", query::Row<>, std::int64_t>;
+
+using DeleteOrphanHold = query::Query<R"(
+    DELETE FROM holds WHERE id = ?
+        AND (asset_id NOT IN (SELECT id FROM assets) OR user_id NOT IN (SELECT id FROM users));
+)", query::Row<>, std::int64_t>;
+
+// Copies out are facts; when more are out than the title has, the title
+// gains copies rather than the loans being dropped.
+using RecountShelf = query::Query<R"(
+    UPDATE assets SET copies = max(copies, o.n), available = max(copies, o.n) - o.n
+    FROM (SELECT (SELECT count(*) FROM loans WHERE asset_id = ?) +
+                 (SELECT count(*) FROM holds WHERE asset_id = ? AND ready_at IS NOT NULL) AS n) AS o
+    WHERE id = ? AND (copies < o.n OR available != copies - o.n);
+)", query::Row<>, std::int64_t, std::int64_t, std::int64_t>;
+
+using RecountTypes = query::Query<R"(
+    INSERT INTO type_stats (type, copies, on_loan)
+    SELECT a.type, sum(a.copies), coalesce(sum(o.n), 0)
+    FROM assets a LEFT JOIN (SELECT asset_id, count(*) AS n FROM loans GROUP BY asset_id) o ON o.asset_id = a.id
+    WHERE true
+    GROUP BY a.type
+    ON CONFLICT(type) DO UPDATE SET copies = excluded.copies, on_loan = excluded.on_loan
+        WHERE copies != excluded.copies OR on_loan != excluded.on_loan;
+)", query::Row<>>;
+
+using ClearEmptyTypes = query::Query<R"(
+    UPDATE type_stats SET copies = 0, on_loan = 0
+    WHERE (copies != 0 OR on_loan != 0) AND type NOT IN (SELECT type FROM assets);
+)", query::Row<>>;
+
+}  // namespace
+
+std::string consistencyIssueName(ConsistencyIssue::Kind kind) {
+    switch (kind) {
+        case Kind::LoanWithoutAsset: return "loan without asset";
+        case Kind::LoanWithoutUser:  return "loan without user";
+        case Kind::HoldWithoutAsset: return "hold without asset";
+        case Kind::HoldWithoutUser:  return "hold without user";
+        case Kind::ShelfCount:       return "shelf count";
+        case Kind::TypeCopies:       return "type copies";
+        default:                     return "type on loan";
+    }
+}
+
+ConsistencyChecker::ConsistencyChecker(std::shared_ptr<DatabaseManager> db, CheckOptions options)
+    : _db(std::move(db)), _options(options) {
+    if (_options.threads == 0) _options.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (_options.chunkAssets < 1) _options.chunkAssets = 1;
+    if (_options.repairBatch < 1) _options.repairBatch = 1;
+}
+
+ConsistencyReport ConsistencyChecker::check() {
+    TraceSpan span("ConsistencyChecker::check", "check");
+    auto start = SteadyClock::now();
+    ConsistencyReport report;
+    std::vector<ChunkResult> results;
+    std::map<std::int64_t, Totals> recorded;
+
+    // Users, the id range and the recorded totals, then the chunks. The
+    // first and last chunk are open-ended so loans and holds past either end
+    // of the asset ids are still seen.
+    auto plan = [&](sqlite3* db, std::unique_ptr<UserSet>& users) {
+        users = std::make_unique<UserSet>(db);
+        report.users = users->size();
+        auto bounds = prepare(db, "SELECT min(id), max(id) FROM assets;");
+        step(bounds.get());
+        std::int64_t lo = sqlite3_column_int64(bounds.get(), 0), hi = sqlite3_column_int64(bounds.get(), 1);
+        auto stats = prepare(db, "SELECT type, copies, on_loan FROM type_stats;");
+        while (step(stats.get()))
+            recorded[sqlite3_column_int64(stats.get(), 0)] = {sqlite3_column_int64(stats.get(), 1),
+                                                              sqlite3_column_int64(stats.get(), 2)};
+        std::vector<std::pair<std::int64_t, std::int64_t>> chunks;
+        constexpr auto min = std::numeric_limits<std::int64_t>::min(), max = std::numeric_limits<std::int64_t>::max();
+        for (std::int64_t from = lo; from <= hi; from += _options.chunkAssets) {
+            std::int64_t to = hi - from < _options.chunkAssets ? hi : from + _options.chunkAssets - 1;
+            chunks.push_back({from, to});
+            if (to == hi) break;
+        }
+        if (chunks.empty()) chunks.push_back({min, max});
+        chunks.front().first = min;
+        chunks.back().second = max;
+        results.resize(chunks.size());
+        return chunks;
+    };
+
+    const char* file = sqlite3_db_filename(_db->get(), "main");
+    if (file && *file) {
+        std::string path = file;
+        std::unique_ptr<UserSet> users;
+        auto chunks = plan(openReader(path).get(), users);
+        std::atomic<std::size_t> next{0};
+        ThreadPool pool(std::min(_options.threads, chunks.size()));
+        std::vector<std::future<void>> workers;
+        for (std::size_t w = 0; w < pool.size(); ++w)
+            workers.push_back(pool.submit([&] {
+                auto conn = openReader(path);
+                ChunkScanner scanner(conn.get());
+                for (std::size_t i; (i = next++) < chunks.size();)
+                    scanner.scan(chunks[i].first, chunks[i].second, *users, results[i]);
+            }));
+        for (auto& w : workers) w.get();
+    } else if (!_db->tryExclusive([&] {
+                   std::unique_ptr<UserSet> users;
+                   auto chunks = plan(_db->get(), users);
+                   ChunkScanner scanner(_db->get());
+                   for (std::size_t i = 0; i < chunks.size(); ++i)
+                       scanner.scan(chunks[i].first, chunks[i].second, *users, results[i]);
+               }, true)) {
+        throw std::runtime_error("Consistency check failed: can't run inside a write");
+    }
+
+    std::map<std::int64_t, Totals> totals;
+    auto add = [&](const ConsistencyIssue& issue) {
+        if (report.issues.size() < _options.maxIssues) report.issues.push_back(issue);
+        else ++report.dropped;
+    };
+    for (auto& r : results) {
+        report.assets += r.assets;
+        report.loans += r.loans;
+        report.holds += r.holds;
+        for (auto& issue : r.issues) add(issue);
+        for (auto& [type, t] : r.totals) {
+            totals[type].copies += t.copies;
+            totals[type].onLoan += t.onLoan;
+        }
+    }
+    for (auto& [type, t] : recorded) totals.try_emplace(type);
+    for (auto& [type, t] : totals) {
+        auto r = recorded.find(type);
+        Totals stored = r == recorded.end() ? Totals{} : r->second;
+        if (stored.copies != t.copies) add({Kind::TypeCopies, type, 0, 0, stored.copies, t.copies});
+        if (stored.onLoan != t.onLoan) add({Kind::TypeOnLoan, type, 0, 0, stored.onLoan, t.onLoan});
+    }
+    report.elapsedMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+    return report;
+}
+
+std::size_t ConsistencyChecker::repair(const ConsistencyReport& report) {
+    TraceSpan span("ConsistencyChecker::repair", "check");
+    std::vector<std::pair<Kind, std::int64_t>> deletes;
+    std::set<std::int64_t> recount;   // assets whose shelf count is recomputed
+    bool types = false;
+    for (auto& issue : report.issues) {
+        switch (issue.kind) {
+            case Kind::LoanWithoutAsset:
+            case Kind::HoldWithoutAsset:
+                deletes.push_back({issue.kind, issue.id});
+                break;
+            case Kind::LoanWithoutUser:
+            case Kind::HoldWithoutUser:
+                deletes.push_back({issue.kind, issue.id});
+                recount.insert(issue.assetId);   // the copy comes back
+                break;
+            case Kind::ShelfCount:
+                recount.insert(issue.id);
+                break;
+            default:
+                types = true;
+        }
+    }
+
+    std::size_t changed = 0;
+    for (std::size_t i = 0; i < deletes.size(); i += _options.repairBatch) {
+        _db->write([&] {
+            for (std::size_t j = i; j < std::min(deletes.size(), i + _options.repairBatch); ++j) {
+                auto [kind, id] = deletes[j];
+                bool loan = kind == Kind::LoanWithoutAsset || kind == Kind::LoanWithoutUser;
+                changed += loan ? DeleteOrphanLoan::exec(*_db, id) : DeleteOrphanHold::exec(*_db, id);
+            }
+        });
+    }
+    std::vector<std::int64_t> assets(recount.begin(), recount.end());
+    for (std::size_t i = 0; i < assets.size(); i += _options.repairBatch) {
+        _db->write([&] {
+            for (std::size_t j = i; j < std::min(assets.size(), i + _options.repairBatch); ++j)
+                changed += RecountShelf::exec(*_db, assets[j], assets[j], assets[j]);
+        });
+    }
+    // Any of the above can move the totals too.
+    if (types || changed > 0)
+        _db->write([&] { changed += RecountTypes::exec(*_db) + ClearEmptyTypes::exec(*_db); });
+    return changed;
+}
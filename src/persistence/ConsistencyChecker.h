@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class DatabaseManager;
+
+// A row that disagrees with the rest of the database.
+struct ConsistencyIssue {
+    enum class Kind {
+        LoanWithoutAsset,   // id is loans.id
+        LoanWithoutUser,
+        HoldWithoutAsset,   // id is holds.id
+        HoldWithoutUser,
+        ShelfCount,         // id is assets.id: available != copies - open loans - ready holds
+        TypeCopies,         // id is the type code: type_stats.copies != sum of copies
+        TypeOnLoan,         // type_stats.on_loan != open loans of that type
+    };
+    Kind         kind;
+    std::int64_t id;
+    std::int64_t assetId = 0;
+    std::int64_t userId = 0;
+    std::int64_t recorded = 0;   // ShelfCount and Type*: the stored value
+    std::int64_t expected = 0;   // and what the other tables imply
+};
+
+std::string consistencyIssueName(ConsistencyIssue::Kind kind);
+
+struct ConsistencyReport {
+    std::size_t assets = 0, loans = 0, holds = 0, users = 0;
+    std::vector<ConsistencyIssue> issues;   // by asset id, then type totals
+    std::size_t dropped = 0;                // found past maxIssues, counted only
+    double      elapsedMs = 0;
+
+    bool clean() const { return issues.empty() && dropped == 0; }
+};
+
+struct CheckOptions {
+    std::size_t  threads = 0;            // 0: one per core
+    std::int64_t chunkAssets = 1 << 16;  // asset ids per chunk
+    std::size_t  maxIssues = 1 << 20;
+    std::size_t  repairBatch = 1000;     // fixes per transaction
+};
+
+// Finds where the duplicated state has drifted apart: shelf counters against
+// open loans and ready holds, loans and holds whose asset or user is gone,
+// and the type_stats totals. Foreign keys are declared but not enforced,
+// and a counter and the rows it counts are separate writes, so a crash or a
+// hand edit can leave them disagreeing.
+//
+// The asset id range is cut into chunks that a thread pool scans, each
+// worker on its own read-only connection (file databases; in-memory ones
+// are scanned on the shared connection with the write lock held). A chunk
+// is one read transaction: assets, loans and holds come back sorted by
+// asset id and are merge-joined in a single pass, and user ids are tested
+// against a bitmap of the users table. Nothing is sorted in memory and no
+// per-row query is made.
+class ConsistencyChecker {
+public:
+    explicit ConsistencyChecker(std::shared_ptr<DatabaseManager> db, CheckOptions options = {});
+
+    // Read-only. Throws if the database can't be read.
+    ConsistencyReport check();
+
+    // Fixes what check() found, repairBatch rows per transaction. Loans and
+    // holds without an asset or user are deleted and the copy they held goes
+    // back on the shelf; shelf counters are recomputed (raising copies if more
+    // are out than recorded); type totals are recomputed from the assets.
+    // Each fix re-checks its row under the write lock, so a row that changed
+    // since check() is left alone. Returns the number of rows changed.
+    std::size_t repair(const ConsistencyReport& report);
+
+private:
+    std::shared_ptr<DatabaseManager> _db;
+    CheckOptions                     _options;
+};
@@ -1,47 +1,911 @@
 #include "DatabaseManager.h"
+#include "BackupManager.h"
+#include "Replicator.h"
+#include "../util/Trace.h"
+#include <algorithm>
 #include <stdexcept>
+#include <string_view>
+#include <vector>
 
-DatabaseManager::DatabaseManager(const std::string& dbPath) {
+DatabaseSettings settingsFor(DurabilityProfile profile) {
+    switch (profile) {
+        case DurabilityProfile::Durable:
+            return {"WAL", "FULL", 8 * 1024, 0, "DEFAULT"};
+        case DurabilityProfile::Balanced:
+            return {"WAL", "NORMAL", 64 * 1024, 256LL * 1024 * 1024, "MEMORY"};
+        case DurabilityProfile::Fast:
+            return {"WAL", "OFF", 256 * 1024, 1024LL * 1024 * 1024, "MEMORY"};
+        default:
+            return {"DELETE", "FULL", 2 * 1024, 0, "DEFAULT"};
+    }
+}
+
+// SQLITE_TRACE_STMT fires at a statement's first step and
+// SQLITE_TRACE_PROFILE when it finishes (runs to the end or is reset).
+// SQLite's own elapsed time has millisecond resolution, so the span is
+// timed from the first callback instead. It is named after the statement,
+// whitespace collapsed; long ones keep the full text in the detail.
+static int traceStatement(unsigned type, void*, void* stmt, void* elapsed) {
+    thread_local std::unordered_map<void*, std::int64_t> started;
+    if (type == SQLITE_TRACE_STMT) {
+        started.emplace(stmt, Tracer::nowNs());   // trigger sub-statements keep the first time
+        return 0;
+    }
+    auto now = Tracer::nowNs();
+    auto ns = *static_cast<sqlite3_int64*>(elapsed);
+    if (auto it = started.find(stmt); it != started.end()) {
+        ns = now - it->second;
+        started.erase(it);
+    }
+    const char* sql = sqlite3_sql(static_cast<sqlite3_stmt*>(stmt));
+    if (!sql || !Tracer::enabled()) return 0;
+    std::string text;
+    for (const char* p = sql; *p; ++p) {
+        bool space = *p == ' ' || *p == '\n' || *p == '\t' || *p == '\r';
+        if (!space) text += *p;
+        else if (!text.empty() && text.back() != ' ') text += ' ';
+    }
+    while (!text.empty() && text.back() == ' ') text.pop_back();
+    const std::size_t maxName = 80;
+    Tracer::record(Tracer::intern(std::string_view(text).substr(0, maxName)), "sqlite", now - ns, ns,
+                   text.size() > maxName ? Tracer::intern(text) : nullptr);
+    return 0;
+}
+
+DatabaseManager::DatabaseManager(const std::string& dbPath, DurabilityProfile profile)
+    : _profile(profile) {
     if (sqlite3_open(dbPath.c_str(), &_db) != SQLITE_OK) {
         throw std::runtime_error("Cannot open database: " + std::string(sqlite3_errmsg(_db)));
     }
+    sqlite3_busy_timeout(_db, 5000);
+    // Only connections opened while tracing pay for the hook.
+    if (Tracer::enabled()) sqlite3_trace_v2(_db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE, traceStatement, nullptr);
+    // Default leaves the file exactly as SQLite would open it.
+    if (profile != DurabilityProfile::Default)
+        applySettings(settingsFor(profile));
 }
 
 DatabaseManager::~DatabaseManager() {
+    disableBackups();
+    disableGroupCommit();
+    disableReplication();
+    for (auto& [sql, stmts] : _idleStatements)
+        for (auto* stmt : stmts) sqlite3_finalize(stmt);
     if (_db) sqlite3_close(_db);
 }
 
+CachedStatement::~CachedStatement() {
+    if (_stmt) _owner->release(_sql, _stmt);
+}
+
+CachedStatement DatabaseManager::prepare(const char* sql) {
+    {
+        std::lock_guard<std::mutex> lock(_stmtMutex);
+        auto it = _idleStatements.find(sql);
+        if (it != _idleStatements.end() && !it->second.empty()) {
+            sqlite3_stmt* stmt = it->second.back();
+            it->second.pop_back();
+            return {this, sql, stmt};
+        }
+    }
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(_db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return {};
+    }
+    return {this, sql, stmt};
+}
+
+void DatabaseManager::release(const char* sql, sqlite3_stmt* stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    std::lock_guard<std::mutex> lock(_stmtMutex);
+    _idleStatements[sql].push_back(stmt);
+}
+
 sqlite3* DatabaseManager::get() {
     return _db;
 }
 
-void DatabaseManager::initializeSchema() {
-    const char* sql = R"(
+void DatabaseManager::exec(const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(_db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::string e = err ? err : "unknown";
+        sqlite3_free(err);
+        throw std::runtime_error(std::string("SQL failed (") + sql + "): " + e);
+    }
+}
+
+void DatabaseManager::applySettings(const DatabaseSettings& s) {
+    exec(("PRAGMA journal_mode=" + s.journalMode + ";").c_str());
+    exec(("PRAGMA synchronous=" + s.synchronous + ";").c_str());
+    exec(("PRAGMA cache_size=-" + std::to_string(s.cacheSizeKiB) + ";").c_str());
+    exec(("PRAGMA mmap_size=" + std::to_string(s.mmapSize) + ";").c_str());
+    exec(("PRAGMA temp_store=" + s.tempStore + ";").c_str());
+}
+
+void DatabaseManager::runNested(const std::function<void()>& fn) {
+    exec("SAVEPOINT write;");
+    std::size_t hooks = _afterCommit.size();
+    try {
+        fn();
+    } catch (...) {
+        sqlite3_exec(_db, "ROLLBACK TO write; RELEASE write;", nullptr, nullptr, nullptr);
+        _afterCommit.resize(hooks);
+        throw;
+    }
+    exec("RELEASE write;");
+}
+
+void DatabaseManager::afterCommit(std::function<void()> fn) {
+    if (_writer.load() != std::this_thread::get_id()) {
+        std::vector<std::function<void()>> now{std::move(fn)};
+        runHooks(now);
+        return;
+    }
+    _afterCommit.push_back(std::move(fn));
+}
+
+void DatabaseManager::runHooks(std::vector<std::function<void()>>& hooks) {
+    for (auto& h : hooks) {
+        try { h(); } catch (...) {}
+    }
+    hooks.clear();
+}
+
+void DatabaseManager::write(const std::function<void()>& fn) {
+    TraceSpan span("DatabaseManager::write", "db");
+    // Re-entrant call from inside a running write (or from a group-commit job).
+    if (_writer.load() == std::this_thread::get_id()) {
+        runNested(fn);
+        return;
+    }
+
+    if (_groupCommit) {
+        PendingWrite w{fn, {}};
+        auto done = w.done.get_future();
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> q(_queueMutex);
+            if (!_stopping) {
+                _queue.push_back(std::move(w));
+                queued = true;
+            }
+        }
+        if (queued) {
+            _queueCv.notify_one();
+            done.get();
+            return;
+        }
+    }
+
+    std::vector<std::function<void()>> hooks;
+    {
+        std::lock_guard<std::recursive_mutex> lock(_writeMutex);
+        _writer = std::this_thread::get_id();
+        try {
+            // The caller may have opened its own transaction with raw SQL;
+            // its hooks run when this part of it is done.
+            if (!sqlite3_get_autocommit(_db)) {
+                runNested(fn);
+            } else {
+                exec("BEGIN IMMEDIATE;");
+                try {
+                    fn();
+                    exec("COMMIT;");
+                    ++_commits;
+                } catch (...) {
+                    sqlite3_exec(_db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                    rolledBack();
+                    throw;
+                }
+                committed();
+            }
+        } catch (...) {
+            _afterCommit.clear();
+            _writer = std::thread::id();
+            throw;
+        }
+        hooks.swap(_afterCommit);
+        _writer = std::thread::id();
+    }
+    runHooks(hooks);
+}
+
+// Archived rows get their own keys: the live tables reuse a deleted
+// maximum rowid. The UNIQUE constraints are the natural keys that let a
+// move be retried after a crash between its copy and its delete.
+void DatabaseManager::attachArchive(const std::string& path) {
+    std::lock_guard<std::recursive_mutex> lock(_writeMutex);
+    if (_archive) return;
+    if (!sqlite3_get_autocommit(_db))
+        throw std::runtime_error("Cannot attach the archive inside a transaction");
+
+    sqlite3_stmt* stmt = nullptr;
+    int rc = sqlite3_prepare_v2(_db, "ATTACH DATABASE ? AS archive;", -1, &stmt, nullptr);
+    if (rc == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_OK)
+        throw std::runtime_error("Cannot attach archive: " + std::string(sqlite3_errmsg(_db)));
+
+    try {
+        // Journal, sync, cache and mmap settings are per schema; an attached
+        // file would otherwise get SQLite's defaults.
+        if (_profile != DurabilityProfile::Default) {
+            auto st = settingsFor(_profile);
+            exec(("PRAGMA archive.journal_mode=" + st.journalMode + ";").c_str());
+            exec(("PRAGMA archive.synchronous=" + st.synchronous + ";").c_str());
+            exec(("PRAGMA archive.cache_size=-" + std::to_string(st.cacheSizeKiB) + ";").c_str());
+            exec(("PRAGMA archive.mmap_size=" + std::to_string(st.mmapSize) + ";").c_str());
+        }
+        exec(R"(
+            CREATE TABLE IF NOT EXISTS archive.assets (
+                id              INTEGER PRIMARY KEY,
+                ext_id          TEXT NOT NULL,
+                type            INTEGER NOT NULL,
+                title           TEXT NOT NULL,
+                author_or_owner TEXT NOT NULL,
+                copies          INTEGER NOT NULL,
+                borrows         INTEGER NOT NULL DEFAULT 0,
+                seconds_out     INTEGER NOT NULL DEFAULT 0,
+                retired_at      INTEGER NOT NULL,
+                archived_at     INTEGER NOT NULL,
+                UNIQUE (ext_id, retired_at)
+            );
+            CREATE TABLE IF NOT EXISTS archive.loan_history (
+                id           INTEGER PRIMARY KEY,
+                source_id    INTEGER NOT NULL,   -- loan_history.id it was moved from
+                asset_ext_id TEXT NOT NULL,
+                user_id      INTEGER NOT NULL,   -- users.id in the main database
+                issue_date   INTEGER NOT NULL,
+                return_date  INTEGER NOT NULL,
+                UNIQUE (source_id, issue_date, return_date)
+            );
+        )");
+        bool ftsExisted = false;
+        sqlite3_stmt* probe = nullptr;
+        if (sqlite3_prepare_v2(_db, "SELECT 1 FROM archive.sqlite_master WHERE name = 'assets_fts';", -1, &probe,
+                               nullptr) == SQLITE_OK)
+            ftsExisted = sqlite3_step(probe) == SQLITE_ROW;
+        sqlite3_finalize(probe);
+        // Archived rows are only ever inserted, so one trigger keeps the
+        // index current. Names in a trigger body resolve in its own schema.
+        exec(R"(
+            CREATE VIRTUAL TABLE IF NOT EXISTS archive.assets_fts USING fts5(
+                title, author_or_owner,
+                content='assets', content_rowid='id',
+                tokenize='unicode61 remove_diacritics 2',
+                prefix='2 3'
+            );
+            CREATE TRIGGER IF NOT EXISTS archive.assets_fts_ai AFTER INSERT ON assets BEGIN
+                INSERT INTO assets_fts(rowid, title, author_or_owner)
+                VALUES (new.id, new.title, new.author_or_owner);
+            END;
+        )");
+        if (!ftsExisted)
+            exec("INSERT INTO archive.assets_fts(assets_fts, rank) VALUES('rank', 'bm25(2.0, 1.0)');");
+    } catch (const std::exception& e) {
+        sqlite3_exec(_db, "DETACH DATABASE archive;", nullptr, nullptr, nullptr);
+        throw std::runtime_error(std::string("Archive init failed: ") + e.what());
+    }
+    _archive = true;
+}
+
+bool DatabaseManager::tryExclusive(const std::function<void()>& fn, bool wait) {
+    std::unique_lock<std::recursive_mutex> lock(_writeMutex, std::defer_lock);
+    if (wait) lock.lock();
+    else if (!lock.try_lock()) return false;
+    if (!sqlite3_get_autocommit(_db)) return false;
+    if (!wait) {
+        // Writers queued for group commit go first too.
+        std::lock_guard<std::mutex> q(_queueMutex);
+        if (!_queue.empty()) return false;
+    }
+    fn();
+    return true;
+}
+
+BackupManager& DatabaseManager::enableBackups(const BackupOptions& options) {
+    if (!_backups) _backups = std::make_unique<BackupManager>(*this, options);
+    return *_backups;
+}
+
+void DatabaseManager::disableBackups() {
+    _backups.reset();
+}
+
+void DatabaseManager::enableGroupCommit(std::chrono::microseconds window, std::size_t maxBatch) {
+    if (_groupCommit) return;
+    _window = window;
+    _maxBatch = maxBatch ? maxBatch : 1;
+    _stopping = false;
+    _committer = std::thread(&DatabaseManager::commitLoop, this);
+    _groupCommit = true;
+}
+
+void DatabaseManager::disableGroupCommit() {
+    if (!_groupCommit) return;
+    _groupCommit = false;
+    {
+        std::lock_guard<std::mutex> q(_queueMutex);
+        _stopping = true;
+    }
+    _queueCv.notify_all();
+    _committer.join();
+}
+
+void DatabaseManager::commitLoop() {
+    while (true) {
+        std::vector<PendingWrite> batch;
+        {
+            std::unique_lock<std::mutex> q(_queueMutex);
+            _queueCv.wait(q, [&] { return _stopping || !_queue.empty(); });
+            if (_queue.empty()) return;
+
+            // Give other writers up to one window to join this transaction,
+            // but stop early once they stop arriving.
+            auto deadline = std::chrono::steady_clock::now() + _window;
+            std::size_t seen = _queue.size();
+            while (!_stopping && _queue.size() < _maxBatch) {
+                auto gap = std::min(deadline, std::chrono::steady_clock::now() + _window / 8);
+                if (!_queueCv.wait_until(q, gap, [&] { return _stopping || _queue.size() != seen; }))
+                    break;
+                seen = _queue.size();
+                if (std::chrono::steady_clock::now() >= deadline) break;
+            }
+
+            std::size_t n = std::min(_queue.size(), _maxBatch);
+            batch.reserve(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                batch.push_back(std::move(_queue.front()));
+                _queue.pop_front();
+            }
+        }
+
+        std::vector<std::exception_ptr> errors(batch.size());
+        std::vector<std::function<void()>> hooks;
+        {
+            std::lock_guard<std::recursive_mutex> lock(_writeMutex);
+            _writer = std::this_thread::get_id();
+            try {
+                exec("BEGIN IMMEDIATE;");
+                for (std::size_t i = 0; i < batch.size(); ++i) {
+                    try {
+                        runNested(batch[i].fn);
+                    } catch (...) {
+                        errors[i] = std::current_exception();
+                    }
+                }
+                exec("COMMIT;");
+                ++_commits;
+                committed();
+                hooks.swap(_afterCommit);
+            } catch (...) {
+                sqlite3_exec(_db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                rolledBack();
+                _afterCommit.clear();
+                auto e = std::current_exception();
+                for (auto& err : errors) err = e;
+            }
+            _writer = std::thread::id();
+        }
+        runHooks(hooks);
+
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (errors[i]) batch[i].done.set_exception(errors[i]);
+            else           batch[i].done.set_value();
+        }
+    }
+}
+
+// Replicated tables: everything with a primary key except the search
+// index and the change log, which the follower's own triggers maintain.
+static int replicatedTable(void*, const char* table) {
+    std::string_view name(table);
+    return name.rfind("assets_fts", 0) != 0 && name.rfind("sqlite_", 0) != 0 && name != "change_log";
+}
+
+void DatabaseManager::startSession() {
+    if (sqlite3session_create(_db, "main", &_session) != SQLITE_OK)
+        throw std::runtime_error("Cannot start session: " + std::string(sqlite3_errmsg(_db)));
+    sqlite3session_table_filter(_session, replicatedTable, nullptr);
+    sqlite3session_attach(_session, nullptr);
+}
+
+void DatabaseManager::enableReplication(const std::string& followerPath) {
+    std::lock_guard<std::recursive_mutex> lock(_writeMutex);
+    if (_replicator) return;
+
+    // Start the follower as an exact copy; from here on only changes ship.
+    sqlite3* dest = nullptr;
+    if (sqlite3_open(followerPath.c_str(), &dest) != SQLITE_OK) {
+        std::string e = sqlite3_errmsg(dest);
+        sqlite3_close(dest);
+        throw std::runtime_error("Cannot open follower: " + e);
+    }
+    sqlite3_busy_timeout(dest, 5000);
+    sqlite3_backup* backup = sqlite3_backup_init(dest, "main", _db, "main");
+    int rc = backup ? sqlite3_backup_step(backup, -1) : sqlite3_errcode(dest);
+    if (backup) sqlite3_backup_finish(backup);
+    sqlite3_close(dest);
+    if (rc != SQLITE_DONE)
+        throw std::runtime_error("Follower copy failed: " + std::string(sqlite3_errstr(rc)));
+
+    auto follower = std::make_shared<DatabaseManager>(followerPath, DurabilityProfile::Balanced);
+    _replicator = std::make_shared<Replicator>(follower);
+    startSession();
+}
+
+void DatabaseManager::disableReplication() {
+    std::lock_guard<std::recursive_mutex> lock(_writeMutex);
+    if (_session) sqlite3session_delete(_session);
+    _session = nullptr;
+    _replicator.reset();   // applies whatever is still queued
+}
+
+void DatabaseManager::committed() {
+    if (!_session) return;
+    int size = 0;
+    void* changes = nullptr;
+    if (sqlite3session_changeset(_session, &size, &changes) == SQLITE_OK && size > 0)
+        _replicator->enqueue(std::string(static_cast<const char*>(changes), static_cast<std::size_t>(size)));
+    sqlite3_free(changes);
+    // A session accumulates forever; start a fresh one per transaction.
+    sqlite3session_delete(_session);
+    startSession();
+}
+
+void DatabaseManager::rolledBack() {
+    if (!_session) return;
+    sqlite3session_delete(_session);
+    startSession();
+}
+
+bool DatabaseManager::hasTable(const std::string& name) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(_db, "SELECT 1 FROM sqlite_master WHERE name = ?;", -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+    sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+bool DatabaseManager::hasColumn(const std::string& table, const std::string& column) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(_db, "SELECT 1 FROM pragma_table_info(?) WHERE name = ?;", -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+    sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, column.c_str(), -1, SQLITE_TRANSIENT);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+// Version 0: the original TEXT-keyed layout.
+// Version 1: integer row keys, external IDs in unique ext_id columns,
+//            integer type/role codes.
+// Version 2: one assets row per title with copy counters; loans have
+//            their own key, so a title can be on several loans at once.
+static const int currentSchemaVersion = 2;
+
+int DatabaseManager::schemaVersion() {
+    sqlite3_stmt* stmt = nullptr;
+    int version = 0;
+    if (sqlite3_prepare_v2(_db, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW)
+        version = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+bool DatabaseManager::hasTextKeys() {
+    sqlite3_stmt* stmt = nullptr;
+    bool text = false;
+    if (sqlite3_prepare_v2(_db, "SELECT type FROM pragma_table_info('assets') WHERE name = 'id';",
+                           -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW)
+        text = std::string_view(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))) == "TEXT";
+    sqlite3_finalize(stmt);
+    return text;
+}
+
+// Rebuilds the TEXT-keyed tables with integer keys. Old IDs become ext_id;
+// loans are re-pointed through them. The search index is dropped here and
+// recreated (and rebuilt) by initializeSchema.
+void DatabaseManager::migrateTextKeys() {
+    write([&] {
+        exec(R"(
+            DROP TRIGGER IF EXISTS assets_fts_ai;
+            DROP TRIGGER IF EXISTS assets_fts_ad;
+            DROP TRIGGER IF EXISTS assets_fts_au;
+            DROP TABLE IF EXISTS assets_fts;
+            ALTER TABLE users  RENAME TO users_v0;
+            ALTER TABLE assets RENAME TO assets_v0;
+            ALTER TABLE loans  RENAME TO loans_v0;
+        )");
+        exec(R"(
+            CREATE TABLE users (
+                id            INTEGER PRIMARY KEY,
+                ext_id        TEXT NOT NULL UNIQUE,
+                name          TEXT NOT NULL,
+                role          INTEGER NOT NULL DEFAULT 0,
+                password_hash TEXT NOT NULL
+            );
+            CREATE TABLE assets (
+                id              INTEGER PRIMARY KEY,
+                ext_id          TEXT NOT NULL UNIQUE,
+                type            INTEGER NOT NULL,
+                title           TEXT NOT NULL,
+                author_or_owner TEXT NOT NULL,
+                is_issued       INTEGER NOT NULL DEFAULT 0
+            );
+            CREATE TABLE loans (
+                asset_id   INTEGER PRIMARY KEY REFERENCES assets(id),
+                user_id    INTEGER NOT NULL REFERENCES users(id),
+                issue_date INTEGER
+            );
+
+            INSERT INTO users (ext_id, name, role, password_hash)
+            SELECT id, name, CASE role WHEN 'staff' THEN 1 ELSE 0 END, password_hash
+            FROM users_v0 ORDER BY rowid;
+
+            INSERT INTO assets (ext_id, type, title, author_or_owner, is_issued)
+            SELECT id, CASE type WHEN 'book' THEN 1 WHEN 'laptop' THEN 2 ELSE 0 END,
+                   title, author_or_owner, is_issued
+            FROM assets_v0 ORDER BY rowid;
+
+            INSERT INTO loans (asset_id, user_id, issue_date)
+            SELECT a.id, u.id, l.issue_date
+            FROM loans_v0 l
+            JOIN assets a ON a.ext_id = l.asset_id
+            JOIN users  u ON u.ext_id = l.user_id;
+
+            DROP TABLE loans_v0;
+            DROP TABLE assets_v0;
+            DROP TABLE users_v0;
+            PRAGMA user_version = 1;
+        )");
+    });
+}
+
+// Folds one-row-per-item assets into titles. Rows with the same type,
+// title and author become copies of the lowest-numbered one; the other
+// IDs stay resolvable through asset_aliases and their loans move over.
+void DatabaseManager::migrateHoldings() {
+    write([&] {
+        exec(R"(
+            DROP TRIGGER IF EXISTS assets_fts_ai;
+            DROP TRIGGER IF EXISTS assets_fts_ad;
+            DROP TRIGGER IF EXISTS assets_fts_au;
+            DROP TABLE IF EXISTS assets_fts;
+            ALTER TABLE assets RENAME TO assets_v1;
+            ALTER TABLE loans  RENAME TO loans_v1;
+        )");
+        createTables();
+        exec(R"(
+            CREATE TEMP TABLE copy_map AS
+            SELECT id AS old_id, ext_id, is_issued,
+                   min(id) OVER (PARTITION BY type, title, author_or_owner) AS new_id
+            FROM assets_v1;
+
+            INSERT INTO assets (id, ext_id, type, title, author_or_owner, copies, available)
+            SELECT a.id, a.ext_id, a.type, a.title, a.author_or_owner, count(*), sum(1 - m.is_issued)
+            FROM copy_map m JOIN assets_v1 a ON a.id = m.new_id
+            GROUP BY m.new_id;
+
+            INSERT INTO asset_aliases (ext_id, asset_id)
+            SELECT ext_id, new_id FROM copy_map WHERE old_id <> new_id;
+
+            INSERT INTO loans (asset_id, user_id, issue_date)
+            SELECT m.new_id, l.user_id, l.issue_date
+            FROM loans_v1 l JOIN copy_map m ON m.old_id = l.asset_id
+            ORDER BY l.issue_date;
+
+            DROP TABLE copy_map;
+            DROP TABLE loans_v1;
+            DROP TABLE assets_v1;
+            PRAGMA user_version = 2;
+        )");
+    });
+}
+
+void DatabaseManager::createTables() {
+    exec(R"(
         CREATE TABLE IF NOT EXISTS users (
-            id            TEXT PRIMARY KEY,
+            id            INTEGER PRIMARY KEY,
+            ext_id        TEXT NOT NULL UNIQUE,
             name          TEXT NOT NULL,
-            role          TEXT NOT NULL DEFAULT 'user',
+            role          INTEGER NOT NULL DEFAULT 0,
             password_hash TEXT NOT NULL
         );
         CREATE TABLE IF NOT EXISTS assets (
-            id              TEXT PRIMARY KEY,
-            type            TEXT NOT NULL,
+            id              INTEGER PRIMARY KEY,
+            ext_id          TEXT NOT NULL UNIQUE,
+            type            INTEGER NOT NULL,
             title           TEXT NOT NULL,
             author_or_owner TEXT NOT NULL,
-            is_issued       INTEGER NOT NULL DEFAULT 0
+            copies          INTEGER NOT NULL DEFAULT 1 CHECK (copies >= 0),
+            available       INTEGER NOT NULL DEFAULT 1 CHECK (available BETWEEN 0 AND copies)
+        );
+        CREATE TABLE IF NOT EXISTS asset_aliases (
+            ext_id   TEXT PRIMARY KEY,
+            asset_id INTEGER NOT NULL REFERENCES assets(id)
         );
+        -- Per-type details such as a laptop's serial (AssetTypeInfo::attributes).
+        CREATE TABLE IF NOT EXISTS asset_attributes (
+            asset_id INTEGER NOT NULL REFERENCES assets(id),
+            name     TEXT NOT NULL,
+            value    TEXT NOT NULL,
+            PRIMARY KEY (asset_id, name)
+        ) WITHOUT ROWID;
         CREATE TABLE IF NOT EXISTS loans (
-            asset_id   TEXT PRIMARY KEY,
-            user_id    TEXT NOT NULL,
-            issue_date INTEGER,
-            FOREIGN KEY(asset_id) REFERENCES assets(id),
-            FOREIGN KEY(user_id)  REFERENCES users(id)
+            id         INTEGER PRIMARY KEY,
+            asset_id   INTEGER NOT NULL REFERENCES assets(id),
+            user_id    INTEGER NOT NULL REFERENCES users(id),
+            issue_date INTEGER
+        );
+        CREATE INDEX IF NOT EXISTS loans_asset_user ON loans(asset_id, user_id);
+        CREATE TABLE IF NOT EXISTS holds (
+            id        INTEGER PRIMARY KEY,
+            asset_id  INTEGER NOT NULL REFERENCES assets(id),
+            user_id   INTEGER NOT NULL REFERENCES users(id),
+            priority  INTEGER NOT NULL DEFAULT 0,
+            placed_at INTEGER NOT NULL,
+            ready_at  INTEGER,
+            UNIQUE (asset_id, user_id)
+        );
+        CREATE INDEX IF NOT EXISTS holds_queue ON holds(asset_id, ready_at, priority DESC, id);
+
+        CREATE TABLE IF NOT EXISTS loan_history (
+            id          INTEGER PRIMARY KEY,
+            asset_id    INTEGER NOT NULL REFERENCES assets(id),
+            user_id     INTEGER NOT NULL REFERENCES users(id),
+            issue_date  INTEGER NOT NULL,
+            return_date INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS loan_history_user ON loan_history(user_id, return_date);
+        CREATE INDEX IF NOT EXISTS loan_history_asset ON loan_history(asset_id);   -- archiving a title
+
+        -- Running totals, bumped by AssetRepository and LoanService in the
+        -- same transaction as the change they count.
+        CREATE TABLE IF NOT EXISTS asset_stats (
+            asset_id    INTEGER PRIMARY KEY REFERENCES assets(id),
+            borrows     INTEGER NOT NULL DEFAULT 0,
+            seconds_out INTEGER NOT NULL DEFAULT 0
+        );
+        CREATE INDEX IF NOT EXISTS asset_stats_borrows ON asset_stats(borrows DESC);
+        CREATE TABLE IF NOT EXISTS type_stats (
+            type        INTEGER PRIMARY KEY,
+            copies      INTEGER NOT NULL DEFAULT 0,
+            on_loan     INTEGER NOT NULL DEFAULT 0,
+            borrows     INTEGER NOT NULL DEFAULT 0,
+            returns     INTEGER NOT NULL DEFAULT 0,
+            seconds_out INTEGER NOT NULL DEFAULT 0
         );
+        CREATE TABLE IF NOT EXISTS daily_stats (
+            day      INTEGER PRIMARY KEY,   -- days since the epoch, UTC
+            issued   INTEGER NOT NULL DEFAULT 0,
+            returned INTEGER NOT NULL DEFAULT 0
+        );
+
+        -- Fines ledger, written by FinesJob: one row per loan that accrued
+        -- on a run day, holding that run's increment. A run is complete
+        -- once finished_at is set; until then it belongs to owner, which
+        -- renews leased_at as it goes.
+        CREATE TABLE IF NOT EXISTS fine_runs (
+            day         INTEGER PRIMARY KEY,   -- days since the epoch, UTC
+            prev_day    INTEGER,               -- last complete run before it
+            loans       INTEGER NOT NULL DEFAULT 0,
+            accruals    INTEGER NOT NULL DEFAULT 0,
+            total_cents INTEGER NOT NULL DEFAULT 0,
+            finished_at INTEGER,
+            owner       INTEGER,
+            leased_at   INTEGER
+        );
+        CREATE TABLE IF NOT EXISTS fines (
+            run_day      INTEGER NOT NULL,
+            loan_id      INTEGER NOT NULL,
+            asset_id     INTEGER NOT NULL REFERENCES assets(id),
+            user_id      INTEGER NOT NULL REFERENCES users(id),
+            issue_date   INTEGER NOT NULL,
+            days_overdue INTEGER NOT NULL,
+            cents        INTEGER NOT NULL,
+            PRIMARY KEY (run_day, loan_id)
+        ) WITHOUT ROWID;
+        CREATE INDEX IF NOT EXISTS fines_user ON fines(user_id);
+
+        -- Titles taken out of circulation, waiting for ArchiveManager to
+        -- move them to the archive. Their copies are already withdrawn.
+        CREATE TABLE IF NOT EXISTS retired_assets (
+            asset_id   INTEGER PRIMARY KEY REFERENCES assets(id),
+            copies     INTEGER NOT NULL,
+            retired_at INTEGER NOT NULL
+        );
+    )");
+}
+
+void DatabaseManager::initializeSchema() {
+    if (schemaVersion() == 0 && hasTextKeys())
+        migrateTextKeys();
+    if (schemaVersion() == 1)
+        migrateHoldings();
+    bool statsExisted = hasTable("type_stats");
+    try {
+        createTables();
+        // fine_runs predates run leases.
+        if (!hasColumn("fine_runs", "owner")) {
+            exec("ALTER TABLE fine_runs ADD COLUMN owner INTEGER;");
+            exec("ALTER TABLE fine_runs ADD COLUMN leased_at INTEGER;");
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Schema init failed: ") + e.what());
+    }
+    if (!statsExisted) {
+        // Seed the totals from what is on the shelves and out on loan now;
+        // loans closed before this point left no history.
+        write([&] {
+            exec(R"(
+                INSERT INTO type_stats (type, copies)
+                SELECT type, sum(copies) FROM assets GROUP BY type;
+                UPDATE type_stats SET
+                    on_loan = (SELECT count(*) FROM loans l JOIN assets a ON a.id = l.asset_id
+                               WHERE a.type = type_stats.type),
+                    borrows = (SELECT count(*) FROM loans l JOIN assets a ON a.id = l.asset_id
+                               WHERE a.type = type_stats.type);
+                INSERT INTO asset_stats (asset_id, borrows)
+                SELECT asset_id, count(*) FROM loans GROUP BY asset_id;
+            )");
+        });
+    }
+    exec(("PRAGMA user_version = " + std::to_string(currentSchemaVersion) + ";").c_str());
+
+    // Full-text index over titles and authors, kept in sync by triggers.
+    const char* ftsSql = R"(
+        CREATE VIRTUAL TABLE IF NOT EXISTS assets_fts USING fts5(
+            title, author_or_owner,
+            content='assets', content_rowid='id',
+            tokenize='unicode61 remove_diacritics 2',
+            prefix='2 3'
+        );
+        CREATE TRIGGER IF NOT EXISTS assets_fts_ai AFTER INSERT ON assets BEGIN
+            INSERT INTO assets_fts(rowid, title, author_or_owner)
+            VALUES (new.rowid, new.title, new.author_or_owner);
+        END;
+        CREATE TRIGGER IF NOT EXISTS assets_fts_ad AFTER DELETE ON assets BEGIN
+            INSERT INTO assets_fts(assets_fts, rowid, title, author_or_owner)
+            VALUES ('delete', old.rowid, old.title, old.author_or_owner);
+        END;
+        CREATE TRIGGER IF NOT EXISTS assets_fts_au AFTER UPDATE OF title, author_or_owner ON assets BEGIN
+            INSERT INTO assets_fts(assets_fts, rowid, title, author_or_owner)
+            VALUES ('delete', old.rowid, old.title, old.author_or_owner);
+            INSERT INTO assets_fts(rowid, title, author_or_owner)
+            VALUES (new.rowid, new.title, new.author_or_owner);
+        END;
     )";
+    bool ftsExisted = hasTable("assets_fts");
     char* err = nullptr;
-    if (sqlite3_exec(_db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+    if (sqlite3_exec(_db, ftsSql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::string e = err ? err : "unknown";
+        sqlite3_free(err);
+        throw std::runtime_error("Search index init failed: " + e);
+    }
+    if (!ftsExisted) {
+        // Title matches weigh twice as much as author matches; index rows
+        // that predate the search table.
+        exec("INSERT INTO assets_fts(assets_fts, rank) VALUES('rank', 'bm25(2.0, 1.0)');");
+        exec("INSERT INTO assets_fts(assets_fts) VALUES('rebuild');");
+    }
+
+    // Which assets and users each write touched, by external ID, so other
+    // processes on the same file can tell (externalChanges). Triggers fill
+    // it whichever connection writes; it keeps the last 64Ki rows.
+    const char* changeLogSql = R"(
+        CREATE TABLE IF NOT EXISTS change_log (
+            seq      INTEGER PRIMARY KEY AUTOINCREMENT,
+            asset_id TEXT,
+            user_id  TEXT
+        );
+        CREATE TRIGGER IF NOT EXISTS change_log_trim AFTER INSERT ON change_log
+        WHEN new.seq % 1024 = 0 BEGIN
+            DELETE FROM change_log WHERE seq <= new.seq - 65536;
+        END;
+        CREATE TRIGGER IF NOT EXISTS assets_log_ai AFTER INSERT ON assets BEGIN
+            INSERT INTO change_log (asset_id) VALUES (new.ext_id);
+        END;
+        -- available moves with a loan or hold row, which is logged itself.
+        CREATE TRIGGER IF NOT EXISTS assets_log_au
+        AFTER UPDATE OF ext_id, type, title, author_or_owner, copies ON assets BEGIN
+            INSERT INTO change_log (asset_id) VALUES (new.ext_id);
+        END;
+        CREATE TRIGGER IF NOT EXISTS assets_log_ad AFTER DELETE ON assets BEGIN
+            INSERT INTO change_log (asset_id) VALUES (old.ext_id);
+        END;
+        CREATE TRIGGER IF NOT EXISTS users_log_ai AFTER INSERT ON users BEGIN
+            INSERT INTO change_log (user_id) VALUES (new.ext_id);
+        END;
+        CREATE TRIGGER IF NOT EXISTS users_log_au AFTER UPDATE ON users BEGIN
+            INSERT INTO change_log (user_id) VALUES (new.ext_id);
+        END;
+        CREATE TRIGGER IF NOT EXISTS users_log_ad AFTER DELETE ON users BEGIN
+            INSERT INTO change_log (user_id) VALUES (old.ext_id);
+        END;
+        CREATE TRIGGER IF NOT EXISTS loans_log_ai AFTER INSERT ON loans BEGIN
+            INSERT INTO change_log (asset_id, user_id) VALUES (
+                (SELECT ext_id FROM assets WHERE id = new.asset_id), (SELECT ext_id FROM users WHERE id = new.user_id));
+        END;
+        CREATE TRIGGER IF NOT EXISTS loans_log_ad AFTER DELETE ON loans BEGIN
+            INSERT INTO change_log (asset_id, user_id) VALUES (
+                (SELECT ext_id FROM assets WHERE id = old.asset_id), (SELECT ext_id FROM users WHERE id = old.user_id));
+        END;
+        CREATE TRIGGER IF NOT EXISTS holds_log_ai AFTER INSERT ON holds BEGIN
+            INSERT INTO change_log (asset_id, user_id) VALUES (
+                (SELECT ext_id FROM assets WHERE id = new.asset_id), (SELECT ext_id FROM users WHERE id = new.user_id));
+        END;
+        CREATE TRIGGER IF NOT EXISTS holds_log_au AFTER UPDATE ON holds BEGIN
+            INSERT INTO change_log (asset_id, user_id) VALUES (
+                (SELECT ext_id FROM assets WHERE id = new.asset_id), (SELECT ext_id FROM users WHERE id = new.user_id));
+        END;
+        CREATE TRIGGER IF NOT EXISTS holds_log_ad AFTER DELETE ON holds BEGIN
+            INSERT INTO change_log (asset_id, user_id) VALUES (
+                (SELECT ext_id FROM assets WHERE id = old.asset_id), (SELECT ext_id FROM users WHERE id = old.user_id));
+        END;
+    )";
+    if (sqlite3_exec(_db, changeLogSql, nullptr, nullptr, &err) != SQLITE_OK) {
         std::string e = err ? err : "unknown";
         sqlite3_free(err);
-        throw std::runtime_error("Schema init failed: " + e);
+        throw std::runtime_error("Change log init failed: " + e);
     }
-}
\ No newline at end of file
+}
+
+ExternalChanges DatabaseManager::externalChanges() {
+    ExternalChanges changes;
+    auto scalar = [&](const char* sql) {
+        auto stmt = prepare(sql);
+        if (!stmt || sqlite3_step(stmt.get()) != SQLITE_ROW)
+            throw std::runtime_error("Change poll failed: " + std::string(sqlite3_errmsg(_db)));
+        return sqlite3_column_int64(stmt.get(), 0);
+    };
+    tryExclusive([&] {
+        // The common case: no commits at all since the last poll.
+        if (_changeSeq >= 0 && _commits == _pollCommits && scalar("PRAGMA data_version;") == _dataVersion) return;
+
+        exec("BEGIN;");
+        try {
+            // The read starts the snapshot; data_version then says whether
+            // anyone else committed before it.
+            auto last = scalar("SELECT coalesce(max(seq), 0) FROM change_log;");
+            auto first = scalar("SELECT coalesce(min(seq), 0) FROM change_log;");
+            auto version = scalar("PRAGMA data_version;");
+            if (_changeSeq >= 0 && version != _dataVersion && last > _changeSeq) {
+                if (first > _changeSeq + 1) {
+                    changes.everything = true;   // trimmed before we saw it
+                } else {
+                    auto stmt = prepare("SELECT asset_id, user_id FROM change_log WHERE seq > ? ORDER BY seq;");
+                    sqlite3_bind_int64(stmt.get(), 1, _changeSeq);
+                    while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+                        for (int c = 0; c < 2; ++c) {
+                            if (auto* id = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), c)))
+                                (c == 0 ? changes.assetIds : changes.userIds).emplace_back(id);
+                        }
+                    }
+                    for (auto* ids : {&changes.assetIds, &changes.userIds}) {
+                        std::sort(ids->begin(), ids->end());
+                        ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+                    }
+                }
+            }
+            _changeSeq = last;
+            _dataVersion = version;
+            _pollCommits = _commits.load();
+        } catch (...) {
+            exec("ROLLBACK;");
+            throw;
+        }
+        exec("COMMIT;");
+    });
+    return changes;
+}
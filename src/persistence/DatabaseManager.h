@@ -1,15 +1,215 @@
 #pragma once
 #include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Named trade-offs between durability and write throughput.
+enum class DurabilityProfile {
+    Default,   // SQLite defaults: rollback journal, synchronous=FULL
+    Durable,   // WAL, synchronous=FULL
+    Balanced,  // WAL, synchronous=NORMAL, larger cache, mmap
+    Fast       // WAL, synchronous=OFF, everything cached in memory
+};
+
+struct DatabaseSettings {
+    std::string   journalMode;
+    std::string   synchronous;
+    int           cacheSizeKiB;
+    sqlite3_int64 mmapSize;
+    std::string   tempStore;
+};
+
+inline std::string durabilityProfileToString(DurabilityProfile p) {
+    switch (p) {
+        case DurabilityProfile::Durable:  return "durable";
+        case DurabilityProfile::Balanced: return "balanced";
+        case DurabilityProfile::Fast:     return "fast";
+        default: return "default";
+    }
+}
+
+inline DurabilityProfile stringToDurabilityProfile(const std::string& s) {
+    if (s == "durable")
+        return DurabilityProfile::Durable;
+    if (s == "balanced")
+        return DurabilityProfile::Balanced;
+    if (s == "fast")
+        return DurabilityProfile::Fast;
+
+    return DurabilityProfile::Default;
+}
+
+DatabaseSettings settingsFor(DurabilityProfile profile);
+
+// Assets and users other connections wrote, by external ID; see
+// DatabaseManager::externalChanges().
+struct ExternalChanges {
+    std::vector<std::string> assetIds;   // sorted, each once
+    std::vector<std::string> userIds;
+    bool everything = false;             // too much to list: assume anything changed
+
+    bool empty() const { return assetIds.empty() && userIds.empty() && !everything; }
+};
+
+class DatabaseManager;
+class Replicator;
+class BackupManager;
+struct BackupOptions;
+
+// A prepared statement borrowed from DatabaseManager's cache. It is reset,
+// unbound and handed back for reuse when the lease ends.
+class CachedStatement {
+public:
+    CachedStatement() = default;
+    CachedStatement(DatabaseManager* owner, const char* sql, sqlite3_stmt* stmt)
+        : _owner(owner), _sql(sql), _stmt(stmt) {}
+    CachedStatement(CachedStatement&& o) noexcept
+        : _owner(o._owner), _sql(o._sql), _stmt(std::exchange(o._stmt, nullptr)) {}
+    CachedStatement(const CachedStatement&) = delete;
+    CachedStatement& operator=(const CachedStatement&) = delete;
+    ~CachedStatement();
+
+    sqlite3_stmt* get() const { return _stmt; }
+    explicit operator bool() const { return _stmt != nullptr; }
+
+private:
+    DatabaseManager* _owner = nullptr;
+    const char*      _sql = nullptr;
+    sqlite3_stmt*    _stmt = nullptr;
+};
 
 class DatabaseManager {
 public:
-    explicit DatabaseManager(const std::string& dbPath);
+    explicit DatabaseManager(const std::string& dbPath,
+                             DurabilityProfile profile = DurabilityProfile::Default);
     ~DatabaseManager();
 
     sqlite3* get();
+    // Creates the schema, migrating older layouts in place.
     void initializeSchema();
+    int schemaVersion();
+
+    void applySettings(const DatabaseSettings& settings);
+    DurabilityProfile profile() const { return _profile; }
+
+    // Runs fn inside a transaction. Nested calls become savepoints of the
+    // enclosing transaction. With group commit enabled, writes from
+    // concurrent callers are batched into one transaction (one fsync) and
+    // the call returns once that transaction has committed.
+    void write(const std::function<void()>& fn);
+
+    // Defers fn until the enclosing write() commits; it is dropped if that
+    // write (or the savepoint it was registered in) rolls back. Runs at once
+    // outside a write. Hooks run on the committing thread after the write
+    // lock is released; exceptions they throw are discarded.
+    void afterCommit(std::function<void()> fn);
+
+    void enableGroupCommit(std::chrono::microseconds window, std::size_t maxBatch = 256);
+    void disableGroupCommit();
+    bool groupCommitEnabled() const { return _groupCommit; }
+
+    std::uint64_t commitCount() const { return _commits; }
+
+    // Prepared statement for sql, reused across calls. Keyed by the
+    // pointer, so sql must have static storage (a literal). Empty if the
+    // statement does not compile.
+    CachedStatement prepare(const char* sql);
+
+    // Hot standby: copies the database to followerPath, then captures a
+    // changeset for every transaction committed through write() and has
+    // it applied to the follower in order, in the background.
+    void enableReplication(const std::string& followerPath);
+    void disableReplication();
+    std::shared_ptr<Replicator> replicator() const { return _replicator; }
+
+    // Online snapshots in the background; see BackupManager. The manager
+    // lives (and its thread runs) until disableBackups or destruction.
+    BackupManager& enableBackups(const BackupOptions& options);
+    void disableBackups();
+    BackupManager* backups() const { return _backups.get(); }
+
+    // Runs fn holding the write lock, with no transaction open; returns
+    // whether fn ran. Unless `wait` is set it gives up at once if a writer
+    // is busy or queued, so background work can step aside for writers.
+    bool tryExclusive(const std::function<void()>& fn, bool wait = false);
+
+    // Attaches cold storage for retired assets and aged loan history as
+    // schema "archive", creating its tables if missing. Not inside a
+    // transaction; a second call is a no-op.
+    void attachArchive(const std::string& path);
+    bool hasArchive() const { return _archive; }
+
+    // What other connections to the file (usually other processes) have
+    // committed since the last call, from the change_log table. The first
+    // call only sets the starting point. When neither side has committed
+    // it costs one PRAGMA data_version, which reads no pages. Our own
+    // writes are left out unless another connection's were interleaved
+    // with them, so handlers must tolerate an ID they already know about.
+    // Empty while a writer is busy or inside a write; call again later.
+    ExternalChanges externalChanges();
 
 private:
+    friend class CachedStatement;
+
+    struct PendingWrite {
+        std::function<void()> fn;
+        std::promise<void>    done;
+    };
+
     sqlite3* _db = nullptr;
-};
\ No newline at end of file
+    DurabilityProfile _profile;
+
+    std::recursive_mutex         _writeMutex;
+    std::atomic<std::thread::id> _writer;
+    std::atomic<std::uint64_t>   _commits{0};
+    std::vector<std::function<void()>> _afterCommit;   // guarded by _writeMutex
+
+    std::atomic<bool>         _groupCommit{false};
+    bool                      _stopping = false;
+    std::chrono::microseconds _window{0};
+    std::size_t               _maxBatch = 0;
+    std::mutex                _queueMutex;
+    std::condition_variable   _queueCv;
+    std::deque<PendingWrite>  _queue;
+    std::thread               _committer;
+
+    std::mutex _stmtMutex;
+    std::unordered_map<const char*, std::vector<sqlite3_stmt*>> _idleStatements;
+
+    sqlite3_session*            _session = nullptr;
+    std::shared_ptr<Replicator> _replicator;
+    std::unique_ptr<BackupManager> _backups;
+    std::atomic<bool>           _archive{false};
+
+    // externalChanges() position, guarded by _writeMutex.
+    std::int64_t  _changeSeq = -1;
+    std::int64_t  _dataVersion = 0;
+    std::uint64_t _pollCommits = 0;
+
+    void exec(const char* sql);
+    bool hasTable(const std::string& name);
+    bool hasColumn(const std::string& table, const std::string& column);
+    bool hasTextKeys();
+    void createTables();
+    void migrateTextKeys();
+    void migrateHoldings();
+    void runNested(const std::function<void()>& fn);
+    void commitLoop();
+    void release(const char* sql, sqlite3_stmt* stmt);
+    void startSession();
+    void committed();
+    void rolledBack();
+    static void runHooks(std::vector<std::function<void()>>& hooks);
+};
@@ -0,0 +1,522 @@
+#include "Exporter.h"
+#include "DatabaseManager.h"
+#include "../models/AssetTypes.h"
+#include "../util/Escape.h"
+#include "../util/Trace.h"
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::optional<ExportFormat> parseExportFormat(std::string_view name) {
+    if (name == "csv")      return ExportFormat::Csv;
+    if (name == "jsonl")    return ExportFormat::Jsonl;
+    if (name == "columnar") return ExportFormat::Columnar;
+    return std::nullopt;
+}
+
+std::optional<ExportTable> parseExportTable(std::string_view name) {
+    if (name == "assets") return ExportTable::Assets;
+    if (name == "users")  return ExportTable::Users;
+    if (name == "loans")  return ExportTable::Loans;
+    if (name == "active") return ExportTable::Active;
+    return std::nullopt;
+}
+
+std::string exportTableName(ExportTable table) {
+    switch (table) {
+        case ExportTable::Assets: return "assets";
+        case ExportTable::Users:  return "users";
+        case ExportTable::Loans:  return "loans";
+        default: return "active";
+    }
+}
+
+namespace {
+
+using SteadyClock = std::chrono::steady_clock;
+
+enum class Kind : std::uint8_t { Integer = 1, Text = 2 };
+
+// Values written other than as stored.
+enum class Decode : std::uint8_t {
+    None,
+    AssetType,   // code, written as the registry name
+    AssetId,     // assets.id, written as its ext_id
+    UserId,      // users.id, written as its ext_id
+};
+
+struct Column {
+    std::string_view name;
+    Kind             kind;
+    Decode           decode = Decode::None;
+};
+
+struct Table {
+    const char*         sql;
+    std::vector<Column> columns;
+};
+
+const Table& tableFor(ExportTable table) {
+    static const Table assets{R"(
+        SELECT ext_id, type, title, author_or_owner, copies, available FROM assets ORDER BY id;
+    )", {{"id", Kind::Text}, {"type", Kind::Text, Decode::AssetType}, {"title", Kind::Text},
+         {"author", Kind::Text}, {"copies", Kind::Integer}, {"available", Kind::Integer}}};
+    static const Table users{R"(
+        SELECT ext_id, name, CASE role WHEN 1 THEN 'staff' ELSE 'user' END FROM users ORDER BY id;
+    )", {{"id", Kind::Text}, {"name", Kind::Text}, {"role", Kind::Text}}};
+    // The history can be many times the size of the catalogue, so its keys
+    // are translated through ExtIds rather than joined: two point lookups
+    // per row cost SQLite ten times the scan itself.
+    static const Table loans{R"(
+        SELECT asset_id, user_id, issue_date, return_date FROM loan_history
+        UNION ALL
+        SELECT asset_id, user_id, issue_date, NULL FROM loans;
+    )", {{"asset_id", Kind::Text, Decode::AssetId}, {"user_id", Kind::Text, Decode::UserId},
+         {"issue_date", Kind::Integer}, {"return_date", Kind::Integer}}};
+    static const Table active{R"(
+        SELECT a.ext_id, a.type, a.title, u.ext_id, u.name, l.issue_date
+        FROM loans l JOIN assets a ON a.id = l.asset_id JOIN users u ON u.id = l.user_id
+        ORDER BY l.id;
+    )", {{"asset_id", Kind::Text}, {"type", Kind::Text, Decode::AssetType}, {"title", Kind::Text},
+         {"user_id", Kind::Text}, {"user_name", Kind::Text}, {"issue_date", Kind::Integer}}};
+    switch (table) {
+        case ExportTable::Assets: return assets;
+        case ExportTable::Users:  return users;
+        case ExportTable::Loans:  return loans;
+        default: return active;
+    }
+}
+
+bool needsIds(const Table& t) {
+    return std::any_of(t.columns.begin(), t.columns.end(),
+                       [](auto& c) { return c.decode == Decode::AssetId || c.decode == Decode::UserId; });
+}
+
+// Integer key -> ext_id for one table, read in key order into one string.
+// Keys are usually SQLite-assigned rowids and so dense, and are looked up
+// by index; a missing key reads empty. Explicit keys can leave the range
+// far larger than the table (or negative), so then the sorted keys are
+// kept and binary-searched instead.
+class ExtIds {
+public:
+    ExtIds() = default;
+    ExtIds(sqlite3* conn, const char* sql) {
+        sqlite3_stmt* st = nullptr;
+        if (sqlite3_prepare_v2(conn, sql, -1, &st, nullptr) != SQLITE_OK)
+            throw std::runtime_error(std::string("Export failed: ") + sqlite3_errmsg(conn));
+        std::unique_ptr<sqlite3_stmt, int (*)(sqlite3_stmt*)> guard(st, sqlite3_finalize);
+        int rc;
+        while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+            _keys.push_back(sqlite3_column_int64(st, 0));
+            _starts.push_back(_text.size());
+            _text.append(reinterpret_cast<const char*>(sqlite3_column_text(st, 1)),
+                         static_cast<std::size_t>(sqlite3_column_bytes(st, 1)));
+        }
+        if (rc != SQLITE_DONE) throw std::runtime_error(std::string("Export failed: ") + sqlite3_errmsg(conn));
+        _starts.push_back(_text.size());
+        if (_keys.empty() || _keys.front() < 0 ||
+            static_cast<std::uint64_t>(_keys.back()) >= maxSlotsPerKey * _keys.size() + slack)
+            return;
+
+        std::vector<std::size_t> dense;
+        dense.reserve(static_cast<std::size_t>(_keys.back()) + 2);
+        for (std::size_t i = 0; i < _keys.size(); ++i)
+            while (dense.size() <= static_cast<std::size_t>(_keys[i])) dense.push_back(_starts[i]);
+        dense.push_back(_text.size());
+        _starts = std::move(dense);
+        _keys.clear();
+        _keys.shrink_to_fit();
+    }
+
+    std::string_view operator[](std::int64_t id) const {
+        std::size_t slot;
+        if (_keys.empty()) {
+            if (id < 0 || static_cast<std::size_t>(id) + 1 >= _starts.size()) return {};
+            slot = static_cast<std::size_t>(id);
+        } else {
+            auto it = std::lower_bound(_keys.begin(), _keys.end(), id);
+            if (it == _keys.end() || *it != id) return {};
+            slot = static_cast<std::size_t>(it - _keys.begin());
+        }
+        return std::string_view(_text).substr(_starts[slot], _starts[slot + 1] - _starts[slot]);
+    }
+
+private:
+    static constexpr std::uint64_t maxSlotsPerKey = 4, slack = 1024;   // dense while within this
+
+    std::string               _text;
+    std::vector<std::int64_t> _keys;     // sorted; empty when indexed by key
+    std::vector<std::size_t>  _starts;   // entry i's ext_id is [_starts[i], _starts[i + 1])
+};
+
+struct Ids {
+    ExtIds assets, users;
+};
+
+std::string extension(const ExportOptions& o) {
+    std::string ext = o.format == ExportFormat::Csv ? ".csv" : o.format == ExportFormat::Jsonl ? ".jsonl" : ".lmc";
+    return o.gzip ? ext + ".gz" : ext;
+}
+
+// A file written through one reusable buffer, gzip-compressed on the way
+// out if asked. Callers reserve room for what they are about to write and
+// fill it through the returned pointer.
+class Output {
+public:
+    Output(const std::string& path, const ExportOptions& options)
+        : _buf(std::make_unique<char[]>(std::max<std::size_t>(options.bufferBytes, 4096))),
+          _capacity(std::max<std::size_t>(options.bufferBytes, 4096)) {
+        if (options.gzip) {
+#ifdef HAVE_ZLIB
+            std::string mode = "wb" + std::to_string(std::clamp(options.gzipLevel, 1, 9));
+            _gz = gzopen(path.c_str(), mode.c_str());
+            if (!_gz) throw std::runtime_error("Export failed: can't open " + path);
+            gzbuffer(_gz, 256 * 1024);
+            return;
+#else
+            throw std::runtime_error("Export failed: built without zlib, gzip unavailable");
+#endif
+        }
+        _file = std::fopen(path.c_str(), "wb");
+        if (!_file) throw std::runtime_error("Export failed: can't open " + path);
+    }
+
+    ~Output() {
+        if (_file) std::fclose(_file);
+#ifdef HAVE_ZLIB
+        if (_gz) gzclose(_gz);
+#endif
+    }
+
+    char* reserve(std::size_t n) {
+        if (_size + n > _capacity) {
+            flush();
+            if (n > _capacity) {   // a cell larger than the buffer
+                _buf = std::make_unique<char[]>(n);
+                _capacity = n;
+            }
+        }
+        return _buf.get() + _size;
+    }
+    void commit(char* end) {
+        _size = end - _buf.get();
+        if (_size >= _capacity / 2) flush();
+    }
+    void write(const void* p, std::size_t n) {
+        auto* at = reserve(n);
+        std::memcpy(at, p, n);
+        commit(at + n);
+    }
+    template <typename T>
+    void put(T v) {
+        static_assert(std::is_integral_v<T>);
+        if constexpr (std::endian::native == std::endian::big) {
+            unsigned char b[sizeof v];
+            for (std::size_t i = 0; i < sizeof v; ++i) b[i] = static_cast<unsigned char>(v >> (8 * i));
+            write(b, sizeof b);
+        } else {
+            write(&v, sizeof v);
+        }
+    }
+
+    void close() {
+        flush();
+        bool ok = true;
+        if (_file) ok = std::fclose(_file) == 0;
+        _file = nullptr;
+#ifdef HAVE_ZLIB
+        if (_gz) ok = gzclose(_gz) == Z_OK && ok;
+        _gz = nullptr;
+#endif
+        if (!ok) throw std::runtime_error("Export failed: close");
+    }
+
+private:
+    std::unique_ptr<char[]> _buf;
+    std::size_t             _size = 0;
+    std::size_t             _capacity;
+    std::FILE*              _file = nullptr;
+#ifdef HAVE_ZLIB
+    gzFile                  _gz = nullptr;
+#endif
+
+    void flush() {
+        if (_size == 0) return;
+        bool ok = true;
+        if (_file) ok = std::fwrite(_buf.get(), 1, _size, _file) == _size;
+#ifdef HAVE_ZLIB
+        if (_gz) ok = gzwrite(_gz, _buf.get(), static_cast<unsigned>(_size)) == static_cast<int>(_size);
+#endif
+        if (!ok) throw std::runtime_error("Export failed: write");
+        _size = 0;
+    }
+};
+
+// A cell as SQLite holds it: text points into the statement's own buffer
+// and is valid until the next step.
+struct Cell {
+    int              type;
+    std::int64_t     integer = 0;
+    std::string_view text;
+};
+
+Cell cell(sqlite3_stmt* st, int i, const Column& column, const Ids& ids) {
+    Cell c{sqlite3_column_type(st, i), 0, {}};
+    if (c.type == SQLITE_NULL) return c;
+    if (column.decode != Decode::None) {
+        c.type = SQLITE_TEXT;
+        auto key = sqlite3_column_int64(st, i);
+        switch (column.decode) {
+            case Decode::AssetType: c.text = assetTypeInfo(codeToAssetType(static_cast<int>(key))).name; break;
+            case Decode::AssetId:   c.text = ids.assets[key]; break;
+            default:                c.text = ids.users[key];
+        }
+    } else if (column.kind == Kind::Integer) {
+        c.type = SQLITE_INTEGER;
+        c.integer = sqlite3_column_int64(st, i);
+    } else {
+        auto* p = reinterpret_cast<const char*>(sqlite3_column_text(st, i));
+        c.type = SQLITE_TEXT;
+        c.text = {p, static_cast<std::size_t>(sqlite3_column_bytes(st, i))};
+    }
+    return c;
+}
+
+bool step(sqlite3_stmt* st) {
+    int rc = sqlite3_step(st);
+    if (rc == SQLITE_ROW) return true;
+    if (rc == SQLITE_DONE) return false;
+    throw std::runtime_error(std::string("Export failed: ") + sqlite3_errmsg(sqlite3_db_handle(st)));
+}
+
+char* putInteger(char* out, std::int64_t v) {
+    return std::to_chars(out, out + 20, v).ptr;
+}
+
+std::size_t writeCsv(sqlite3_stmt* st, const Table& t, const Ids& ids, Output& out) {
+    std::string header;
+    for (auto& c : t.columns) header += (header.empty() ? "" : ",") + std::string(c.name);
+    header += '\n';
+    out.write(header.data(), header.size());
+
+    const int n = static_cast<int>(t.columns.size());
+    std::vector<Cell> cells(n);
+    std::size_t rows = 0;
+    while (step(st)) {
+        std::size_t need = 1;
+        for (int i = 0; i < n; ++i) {
+            cells[i] = cell(st, i, t.columns[i], ids);
+            need += 2 * cells[i].text.size() + 24;
+        }
+        char* p = out.reserve(need);
+        for (int i = 0; i < n; ++i) {
+            if (i) *p++ = ',';
+            if (cells[i].type == SQLITE_INTEGER) p = putInteger(p, cells[i].integer);
+            else if (cells[i].type == SQLITE_TEXT) p = putCsvField(p, cells[i].text);
+        }
+        *p++ = '\n';
+        out.commit(p);
+        ++rows;
+    }
+    return rows;
+}
+
+std::size_t writeJsonl(sqlite3_stmt* st, const Table& t, const Ids& ids, Output& out) {
+    // `{"name":` for the first column, `,"name":` after.
+    std::vector<std::string> keys;
+    std::size_t keyBytes = 0;
+    for (auto& c : t.columns) {
+        std::string key(6 * c.name.size() + 3, '\0');
+        key[0] = keys.empty() ? '{' : ',';
+        char* end = putJsonString(key.data() + 1, c.name);
+        *end++ = ':';
+        key.resize(end - key.data());
+        keyBytes += key.size();
+        keys.push_back(std::move(key));
+    }
+
+    const int n = static_cast<int>(t.columns.size());
+    std::vector<Cell> cells(n);
+    std::size_t rows = 0;
+    while (step(st)) {
+        std::size_t need = keyBytes + 2;
+        for (int i = 0; i < n; ++i) {
+            cells[i] = cell(st, i, t.columns[i], ids);
+            need += 6 * cells[i].text.size() + 24;
+        }
+        char* p = out.reserve(need);
+        for (int i = 0; i < n; ++i) {
+            std::memcpy(p, keys[i].data(), keys[i].size());
+            p += keys[i].size();
+            if (cells[i].type == SQLITE_INTEGER) p = putInteger(p, cells[i].integer);
+            else if (cells[i].type == SQLITE_TEXT) p = putJsonString(p, cells[i].text);
+            else { std::memcpy(p, "null", 4); p += 4; }
+        }
+        *p++ = '}';
+        *p++ = '\n';
+        out.commit(p);
+        ++rows;
+    }
+    return rows;
+}
+
+// One group's worth of a column, reused from group to group.
+struct ColumnChunk {
+    std::vector<std::uint8_t>  nulls;
+    std::vector<std::int64_t>  integers;
+    std::vector<std::uint32_t> ends;
+    std::string                text;
+};
+
+std::size_t writeColumnar(sqlite3_stmt* st, const Table& t, const Ids& ids, Output& out, std::size_t groupRows) {
+    out.write("LMC1", 4);
+    out.put(static_cast<std::uint32_t>(t.columns.size()));
+    for (auto& c : t.columns) {
+        out.put(static_cast<std::uint8_t>(c.kind));
+        out.put(static_cast<std::uint16_t>(c.name.size()));
+        out.write(c.name.data(), c.name.size());
+    }
+
+    const int n = static_cast<int>(t.columns.size());
+    std::vector<ColumnChunk> chunks(n);
+    std::size_t rows = 0, inGroup = 0;
+    auto writeGroup = [&] {
+        out.put(static_cast<std::uint32_t>(inGroup));
+        for (int i = 0; i < n; ++i) {
+            auto& c = chunks[i];
+            out.write(c.nulls.data(), c.nulls.size());
+            if (t.columns[i].kind == Kind::Integer) {
+                if constexpr (std::endian::native == std::endian::little)
+                    out.write(c.integers.data(), c.integers.size() * sizeof(std::int64_t));
+                else
+                    for (auto v : c.integers) out.put(v);
+            } else {
+                if constexpr (std::endian::native == std::endian::little)
+                    out.write(c.ends.data(), c.ends.size() * sizeof(std::uint32_t));
+                else
+                    for (auto v : c.ends) out.put(v);
+                out.write(c.text.data(), c.text.size());
+            }
+            c.nulls.clear();
+            c.integers.clear();
+            c.ends.clear();
+            c.text.clear();
+        }
+        inGroup = 0;
+    };
+
+    while (step(st)) {
+        for (int i = 0; i < n; ++i) {
+            auto v = cell(st, i, t.columns[i], ids);
+            auto& c = chunks[i];
+            if (inGroup % 8 == 0) c.nulls.push_back(0);
+            if (v.type == SQLITE_NULL) c.nulls.back() |= static_cast<std::uint8_t>(1u << (inGroup % 8));
+            if (t.columns[i].kind == Kind::Integer) {
+                c.integers.push_back(v.integer);
+            } else {
+                c.text.append(v.text);
+                if (c.text.size() > UINT32_MAX) throw std::runtime_error("Export failed: group text over 4 GiB");
+                c.ends.push_back(static_cast<std::uint32_t>(c.text.size()));
+            }
+        }
+        ++rows;
+        if (++inGroup == groupRows) writeGroup();
+    }
+    if (inGroup) writeGroup();
+    out.put(std::uint32_t{0});
+    out.put(static_cast<std::uint64_t>(rows));
+    return rows;
+}
+
+void exec(sqlite3* db, const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::string msg = err ? err : sqlite3_errmsg(db);
+        sqlite3_free(err);
+        throw std::runtime_error("Export failed: " + msg);
+    }
+}
+
+}  // namespace
+
+Exporter::Exporter(std::shared_ptr<DatabaseManager> db, ExportOptions options)
+    : _db(std::move(db)), _options(std::move(options)) {
+    if (_options.groupRows < 1) _options.groupRows = 1;
+}
+
+bool Exporter::gzipAvailable() {
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::vector<ExportSummary> Exporter::run(const std::vector<ExportTable>& tables, const std::string& directory) {
+    TraceSpan span("Exporter::run", "export");
+    fs::create_directories(directory);
+    std::vector<ExportSummary> out;
+
+    auto exportAll = [&](sqlite3* conn) {
+        exec(conn, "BEGIN;");
+        try {
+            Ids ids;
+            if (std::any_of(tables.begin(), tables.end(), [](auto t) { return needsIds(tableFor(t)); })) {
+                ids.assets = ExtIds(conn, "SELECT id, ext_id FROM assets ORDER BY id;");
+                ids.users = ExtIds(conn, "SELECT id, ext_id FROM users ORDER BY id;");
+            }
+            for (auto table : tables) {
+                TraceSpan tableSpan("Exporter::table", "export", exportTableName(table));
+                auto start = SteadyClock::now();
+                auto& t = tableFor(table);
+                ExportSummary s{table, (fs::path(directory) / (exportTableName(table) + extension(_options))).string()};
+                sqlite3_stmt* st = nullptr;
+                if (sqlite3_prepare_v2(conn, t.sql, -1, &st, nullptr) != SQLITE_OK)
+                    throw std::runtime_error(std::string("Export failed: ") + sqlite3_errmsg(conn));
+                std::unique_ptr<sqlite3_stmt, int (*)(sqlite3_stmt*)> guard(st, sqlite3_finalize);
+                Output file(s.path, _options);
+                switch (_options.format) {
+                    case ExportFormat::Csv:   s.rows = writeCsv(st, t, ids, file); break;
+                    case ExportFormat::Jsonl: s.rows = writeJsonl(st, t, ids, file); break;
+                    default: s.rows = writeColumnar(st, t, ids, file, _options.groupRows);
+                }
+                file.close();
+                s.bytes = fs::file_size(s.path);
+                s.elapsedMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - start).count();
+                out.push_back(std::move(s));
+            }
+        } catch (...) {
+            sqlite3_exec(conn, "ROLLBACK;", nullptr, nullptr, nullptr);
+            throw;
+        }
+        exec(conn, "COMMIT;");
+    };
+
+    const char* file = sqlite3_db_filename(_db->get(), "main");
+    if (file && *file) {
+        sqlite3* conn = nullptr;
+        int rc = sqlite3_open_v2(file, &conn, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+        std::unique_ptr<sqlite3, int (*)(sqlite3*)> guard(conn, sqlite3_close);
+        if (rc != SQLITE_OK) throw std::runtime_error(std::string("Export failed: ") + sqlite3_errmsg(conn));
+        sqlite3_busy_timeout(conn, 5000);
+        exportAll(conn);
+    } else if (!_db->tryExclusive([&] { exportAll(_db->get()); }, true)) {
+        throw std::runtime_error("Export failed: can't run inside a write");
+    }
+    return out;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class DatabaseManager;
+
+enum class ExportFormat { Csv, Jsonl, Columnar };
+
+// What can be exported. Loans are every loan, returned or not (return_date
+// empty while open); active is the open loans joined with their title and
+// borrower. IDs are external IDs; users never include password hashes.
+enum class ExportTable { Assets, Users, Loans, Active };
+
+// "csv", "jsonl" or "columnar"; nullopt for anything else.
+std::optional<ExportFormat> parseExportFormat(std::string_view name);
+// "assets", "users", "loans" or "active"; nullopt for anything else.
+std::optional<ExportTable> parseExportTable(std::string_view name);
+std::string exportTableName(ExportTable table);
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::Csv;
+    bool         gzip = false;            // needs zlib at build time (gzipAvailable)
+    int          gzipLevel = 1;
+    std::size_t  bufferBytes = 1 << 20;   // written out in chunks of about this size
+    std::size_t  groupRows = 65536;       // columnar rows per group
+};
+
+struct ExportSummary {
+    ExportTable   table;
+    std::string   path;
+    std::size_t   rows = 0;
+    std::uint64_t bytes = 0;   // file size, after compression
+    double        elapsedMs = 0;
+};
+
+// Streams tables out of the database for reporting. Cells are escaped
+// straight from SQLite's column buffers into one large output buffer, so
+// memory stays flat however many rows there are.
+//
+// All tables of a run are read in one read transaction, so they agree with
+// each other. File databases are read through a second, read-only
+// connection and writers carry on (in WAL mode; under a rollback journal
+// they wait for the export). In-memory databases are read on the shared
+// connection with the write lock held.
+//
+// CSV has a header row and RFC 4180 quoting; JSONL is one object per line
+// with numbers unquoted and NULL as null. Columnar files are:
+//
+//   "LMC1", u32 column count, per column: u8 kind (1 integer, 2 text),
+//   u16 name length, name; then groups of up to groupRows rows: u32 rows,
+//   per column a null bitmap of (rows + 7) / 8 bytes (bit set = NULL) and
+//   either rows i64 values or rows u32 end offsets followed by the text;
+//   then u32 0 and the u64 total row count. Integers are little-endian.
+class Exporter {
+public:
+    explicit Exporter(std::shared_ptr<DatabaseManager> db, ExportOptions options = {});
+
+    // Writes each table to <directory>/<name>.<csv|jsonl|lmc>[.gz],
+    // replacing what is there. Throws if the snapshot can't be read or a
+    // file can't be written.
+    std::vector<ExportSummary> run(const std::vector<ExportTable>& tables, const std::string& directory);
+
+    static bool gzipAvailable();
+
+private:
+    std::shared_ptr<DatabaseManager> _db;
+    ExportOptions                    _options;
+};
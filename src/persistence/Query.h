@@ -0,0 +1,310 @@
+#pragma once
+#include "DatabaseManager.h"
+#include <sqlite3.h>
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Typed statements checked at compile time.
+//
+//   using FindUser = query::Query<"SELECT name, role FROM users WHERE id = ?;",
+//                                 query::Row<std::string, Role>, std::string_view>;
+//   auto row = FindUser::one(*db, id);   // std::optional<std::tuple<std::string, Role>>
+//
+// The number of parameters must match the '?' placeholders, and the row
+// arity must match the SELECT list, or the code does not compile; so does
+// a parameter or column type without a Param/Column mapping. Text and
+// blobs are bound with SQLITE_STATIC (no copy), so arguments only have to
+// live until the call returns, which temporaries in the argument list do.
+// Statements are prepared once per connection and reused.
+namespace query {
+
+template <std::size_t N>
+struct Sql {
+    char text[N]{};
+    constexpr Sql(const char (&s)[N]) { std::copy_n(s, N, text); }
+    constexpr std::string_view view() const { return {text, N - 1}; }
+};
+
+template <typename... Cols>
+struct Row {};
+
+namespace detail {
+
+constexpr bool isWordChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+constexpr char lower(char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; }
+
+// Whole-word, case-insensitive keyword at position i.
+constexpr bool keywordAt(std::string_view s, std::size_t i, std::string_view kw) {
+    if (i + kw.size() > s.size()) return false;
+    if (i > 0 && isWordChar(s[i - 1])) return false;
+    for (std::size_t k = 0; k < kw.size(); ++k)
+        if (lower(s[i + k]) != kw[k]) return false;
+    return i + kw.size() == s.size() || !isWordChar(s[i + kw.size()]);
+}
+
+// Skips a quoted literal or identifier starting at i; returns the index
+// just past it.
+constexpr std::size_t skipQuoted(std::string_view s, std::size_t i) {
+    char q = s[i];
+    for (++i; i < s.size(); ++i) {
+        if (s[i] == q) {
+            if (i + 1 < s.size() && s[i + 1] == q) { ++i; continue; }
+            return i + 1;
+        }
+    }
+    return i;
+}
+
+constexpr std::size_t placeholders(std::string_view s) {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < s.size();) {
+        if (s[i] == '\'' || s[i] == '"') { i = skipQuoted(s, i); continue; }
+        if (s[i] == '?') ++n;
+        ++i;
+    }
+    return n;
+}
+
+// Result columns of a leading SELECT, or -1 for other statements.
+constexpr int selectColumns(std::string_view s) {
+    std::size_t i = 0;
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\n' || s[i] == '\t' || s[i] == '\r')) ++i;
+    if (!keywordAt(s, i, "select")) return -1;
+    int columns = 1, depth = 0;
+    for (i += 6; i < s.size();) {
+        char c = s[i];
+        if (c == '\'' || c == '"') { i = skipQuoted(s, i); continue; }
+        if (c == '(') ++depth;
+        else if (c == ')') --depth;
+        else if (depth == 0 && c == ',') ++columns;
+        else if (depth == 0 && (c == ';' || keywordAt(s, i, "from"))) break;
+        ++i;
+    }
+    return columns;
+}
+
+}  // namespace detail
+
+// How a C++ value is bound to a parameter. Specialize for other types.
+template <typename T>
+struct Param;
+
+template <>
+struct Param<std::string_view> {
+    static int bind(sqlite3_stmt* s, int i, std::string_view v) {
+        // A null data pointer would bind SQL NULL, not ''.
+        return sqlite3_bind_text(s, i, v.data() ? v.data() : "", static_cast<int>(v.size()), SQLITE_STATIC);
+    }
+};
+
+template <>
+struct Param<std::string> {
+    static int bind(sqlite3_stmt* s, int i, const std::string& v) {
+        return sqlite3_bind_text(s, i, v.data(), static_cast<int>(v.size()), SQLITE_STATIC);
+    }
+};
+
+template <std::integral T>
+struct Param<T> {
+    static int bind(sqlite3_stmt* s, int i, T v) { return sqlite3_bind_int64(s, i, static_cast<sqlite3_int64>(v)); }
+};
+
+template <std::floating_point T>
+struct Param<T> {
+    static int bind(sqlite3_stmt* s, int i, T v) { return sqlite3_bind_double(s, i, static_cast<double>(v)); }
+};
+
+template <typename T>
+struct Param<std::optional<T>> {
+    static int bind(sqlite3_stmt* s, int i, const std::optional<T>& v) {
+        return v ? Param<T>::bind(s, i, *v) : sqlite3_bind_null(s, i);
+    }
+};
+
+// How a result column is decoded. Text as std::string_view points into
+// SQLite's row buffer and is only valid until the next step.
+template <typename T>
+struct Column;
+
+template <>
+struct Column<std::string_view> {
+    static std::string_view get(sqlite3_stmt* s, int i) {
+        auto text = reinterpret_cast<const char*>(sqlite3_column_text(s, i));
+        if (!text) return {};
+        return {text, static_cast<std::size_t>(sqlite3_column_bytes(s, i))};
+    }
+};
+
+template <>
+struct Column<std::string> {
+    static std::string get(sqlite3_stmt* s, int i) { return std::string(Column<std::string_view>::get(s, i)); }
+};
+
+template <std::integral T>
+struct Column<T> {
+    static T get(sqlite3_stmt* s, int i) { return static_cast<T>(sqlite3_column_int64(s, i)); }
+};
+
+template <std::floating_point T>
+struct Column<T> {
+    static T get(sqlite3_stmt* s, int i) { return static_cast<T>(sqlite3_column_double(s, i)); }
+};
+
+template <typename T>
+struct Column<std::optional<T>> {
+    static std::optional<T> get(sqlite3_stmt* s, int i) {
+        if (sqlite3_column_type(s, i) == SQLITE_NULL) return std::nullopt;
+        return Column<T>::get(s, i);
+    }
+};
+
+template <typename T>
+concept Bindable = requires(sqlite3_stmt* s, const T& v) {
+    { Param<T>::bind(s, 1, v) } -> std::same_as<int>;
+};
+
+template <typename T>
+concept Decodable = requires(sqlite3_stmt* s) {
+    { Column<T>::get(s, 0) } -> std::convertible_to<T>;
+};
+
+template <typename T>
+inline constexpr bool borrows = std::is_same_v<T, std::string_view> || std::is_same_v<T, std::optional<std::string_view>>;
+
+template <Sql S, typename R, typename... Params>
+class Query;
+
+template <Sql S, typename... Cols, typename... Params>
+class Query<S, Row<Cols...>, Params...> {
+    static_assert(detail::placeholders(S.view()) == sizeof...(Params),
+                  "parameter count does not match the '?' placeholders");
+    static_assert(detail::selectColumns(S.view()) < 0 ||
+                      detail::selectColumns(S.view()) == static_cast<int>(sizeof...(Cols)),
+                  "row type does not match the SELECT list");
+    static_assert((Bindable<Params> && ...), "no query::Param mapping for a parameter type");
+    static_assert((Decodable<Cols> && ...), "no query::Column mapping for a column type");
+
+public:
+    using Tuple = std::tuple<Cols...>;
+
+    static constexpr const char* sql() { return S.text; }
+
+    // Runs a statement that returns no rows; throws on failure. Returns
+    // the number of rows changed.
+    static int exec(DatabaseManager& db, const Params&... params) {
+        auto stmt = db.prepare(S.text);
+        if (!stmt) throw std::runtime_error(std::string("Prepare failed: ") + sqlite3_errmsg(db.get()));
+        bind(stmt.get(), params...);
+        int rc;
+        while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {}
+        if (rc != SQLITE_DONE) throw std::runtime_error(std::string("Statement failed: ") + sqlite3_errmsg(db.get()));
+        return sqlite3_changes(db.get());
+    }
+
+    // Calls f(cols...) for each row; f may return false to stop early.
+    // Returns false if the statement could not be prepared; throws if a
+    // step fails, so an error never passes for the end of the rows.
+    template <typename F>
+    static bool each(DatabaseManager& db, F&& f, const Params&... params) {
+        auto stmt = db.prepare(S.text);
+        if (!stmt) return false;
+        bind(stmt.get(), params...);
+        int rc;
+        while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW) {
+            if constexpr (std::is_same_v<std::invoke_result_t<F&, Cols...>, bool>) {
+                if (!call(f, stmt.get(), std::index_sequence_for<Cols...>{})) return true;
+            } else {
+                call(f, stmt.get(), std::index_sequence_for<Cols...>{});
+            }
+        }
+        if (rc != SQLITE_DONE) throw std::runtime_error(std::string("Statement failed: ") + sqlite3_errmsg(db.get()));
+        return true;
+    }
+
+    static std::optional<Tuple> one(DatabaseManager& db, const Params&... params) {
+        return oneAs<Tuple>(db, params...);
+    }
+
+    static std::vector<Tuple> all(DatabaseManager& db, const Params&... params) {
+        return allAs<Tuple>(db, params...);
+    }
+
+    // Builds T straight from the columns, in order: T(cols...).
+    template <typename T>
+    static std::optional<T> oneAs(DatabaseManager& db, const Params&... params) {
+        static_assert(!(borrows<Cols> || ...), "string_view columns can only be read through each()");
+        std::optional<T> out;
+        each(db, [&](Cols... cols) { out.emplace(make<T>(std::move(cols)...)); return false; }, params...);
+        return out;
+    }
+
+    template <typename T>
+    static std::vector<T> allAs(DatabaseManager& db, const Params&... params) {
+        static_assert(!(borrows<Cols> || ...), "string_view columns can only be read through each()");
+        std::vector<T> out;
+        each(db, [&](Cols... cols) { out.push_back(make<T>(std::move(cols)...)); }, params...);
+        return out;
+    }
+
+    // The same into `memory`, for allocator-aware T: each T is built by
+    // uses-allocator construction, T(cols..., allocator). Such a T copies
+    // what it keeps, so string_view columns are allowed and save a string
+    // per text column.
+    template <typename T>
+    static std::optional<T> oneAs(DatabaseManager& db, std::pmr::memory_resource* memory, const Params&... params) {
+        static_assert(std::uses_allocator_v<T, std::pmr::polymorphic_allocator<>>, "T is not allocator-aware");
+        std::optional<T> out;
+        std::pmr::polymorphic_allocator<> alloc(memory);
+        each(db, [&](Cols... cols) {
+            out.emplace(std::make_obj_using_allocator<T>(alloc, std::move(cols)...));
+            return false;
+        }, params...);
+        return out;
+    }
+
+    template <typename T>
+    static std::pmr::vector<T> allAs(DatabaseManager& db, std::pmr::memory_resource* memory,
+                                     const Params&... params) {
+        static_assert(std::uses_allocator_v<T, std::pmr::polymorphic_allocator<>>, "T is not allocator-aware");
+        std::pmr::vector<T> out(memory);
+        each(db, [&](Cols... cols) { out.emplace_back(std::move(cols)...); }, params...);
+        return out;
+    }
+
+private:
+    // Throws if a value can't be bound (out of range, too big).
+    static void bind([[maybe_unused]] sqlite3_stmt* stmt, const Params&... params) {
+        if constexpr (sizeof...(Params) > 0) {
+            int i = 0;
+            if (!((Param<Params>::bind(stmt, ++i, params) == SQLITE_OK) && ...))
+                throw std::runtime_error(std::string("Bind failed: ") + sqlite3_errmsg(sqlite3_db_handle(stmt)));
+        }
+    }
+
+    template <typename F, std::size_t... I>
+    static decltype(auto) call(F& f, sqlite3_stmt* stmt, std::index_sequence<I...>) {
+        return f(Column<Cols>::get(stmt, static_cast<int>(I))...);
+    }
+
+    template <typename T, typename... A>
+    static T make(A&&... a) {
+        if constexpr (std::is_constructible_v<T, A...>) return T(std::forward<A>(a)...);
+        else return T{std::forward<A>(a)...};
+    }
+};
+
+}  // namespace query
@@ -0,0 +1,141 @@
+#include "Replicator.h"
+#include "Query.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+using SaveSequence = query::Query<"INSERT OR REPLACE INTO replication_state (id, seq) VALUES (1, ?);",
+                                  query::Row<>, std::uint64_t>;
+
+using LoadSequence = query::Query<"SELECT seq FROM replication_state WHERE id = 1;",
+                                  query::Row<std::uint64_t>>;
+
+// The follower is a copy, so the primary's row wins any disagreement.
+int onConflict(void* ctx, int reason, sqlite3_changeset_iter*) {
+    ++*static_cast<std::uint64_t*>(ctx);
+    switch (reason) {
+        case SQLITE_CHANGESET_DATA:
+        case SQLITE_CHANGESET_CONFLICT:
+            return SQLITE_CHANGESET_REPLACE;
+        default:
+            return SQLITE_CHANGESET_OMIT;
+    }
+}
+
+}  // namespace
+
+Replicator::Replicator(std::shared_ptr<DatabaseManager> follower)
+    : _follower(std::move(follower)) {
+    _follower->write([&] {
+        char* err = nullptr;
+        if (sqlite3_exec(_follower->get(),
+                         "CREATE TABLE IF NOT EXISTS replication_state (id INTEGER PRIMARY KEY, seq INTEGER NOT NULL);",
+                         nullptr, nullptr, &err) != SQLITE_OK) {
+            std::string e = err ? err : "unknown";
+            sqlite3_free(err);
+            throw std::runtime_error("Replication state init failed: " + e);
+        }
+    });
+    _nextSeq = appliedSequence() + 1;
+    _worker = std::thread(&Replicator::run, this);
+}
+
+Replicator::~Replicator() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _worker.join();
+}
+
+std::uint64_t Replicator::appliedSequence() {
+    auto row = LoadSequence::one(*_follower);
+    return row ? std::get<0>(*row) : 0;
+}
+
+void Replicator::enqueue(std::string changeset) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats.captured++;
+        _stats.bytesShipped += changeset.size();
+        _queue.push_back({_nextSeq++, std::move(changeset), SteadyClock::now()});
+    }
+    _wake.notify_one();
+}
+
+void Replicator::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _drained.wait(lock, [&] { return (_queue.empty() && !_applying) || _stopping; });
+}
+
+ReplicationStats Replicator::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ReplicationStats s = _stats;
+    s.queued = _queue.size();
+    if (!_queue.empty())
+        s.oldestPendingMs =
+            std::chrono::duration<double, std::milli>(SteadyClock::now() - _queue.front().capturedAt).count();
+    return s;
+}
+
+void Replicator::run() {
+    while (true) {
+        std::deque<Pending> batch;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _stopping || !_queue.empty(); });
+            if (_queue.empty()) {
+                _drained.notify_all();
+                return;
+            }
+            batch.swap(_queue);
+            _applying = true;
+        }
+
+        // Everything that queued up while the last batch was applied goes
+        // in one follower transaction.
+        bool ok = true;
+        try {
+            apply(batch);
+        } catch (const std::exception& e) {
+            ok = false;
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stats.lastError = e.what();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _applying = false;
+            // Keep order: a failed batch goes back in front and is retried,
+            // unless we are shutting down.
+            if (!ok && !_stopping) _queue.insert(_queue.begin(), batch.begin(), batch.end());
+        }
+        if (!ok && !_stopping) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        _drained.notify_all();
+    }
+}
+
+void Replicator::apply(std::deque<Pending>& batch) {
+    std::uint64_t conflicts = 0;
+    _follower->write([&] {
+        for (auto& p : batch) {
+            int rc = sqlite3changeset_apply(_follower->get(), static_cast<int>(p.changeset.size()),
+                                            p.changeset.data(), nullptr, onConflict, &conflicts);
+            if (rc != SQLITE_OK)
+                throw std::runtime_error("Changeset apply failed: " + std::string(sqlite3_errstr(rc)));
+        }
+        SaveSequence::exec(*_follower, batch.back().seq);
+    });
+
+    auto now = SteadyClock::now();
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& p : batch) {
+        double lag = std::chrono::duration<double, std::milli>(now - p.capturedAt).count();
+        _stats.lastLagMs = lag;
+        _stats.maxLagMs = std::max(_stats.maxLagMs, lag);
+    }
+    _stats.applied += batch.size();
+    _stats.conflicts += conflicts;
+}
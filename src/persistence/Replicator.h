@@ -0,0 +1,63 @@
+#pragma once
+#include "DatabaseManager.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ReplicationStats {
+    std::uint64_t captured = 0;        // changesets received from the primary
+    std::uint64_t applied = 0;         // changesets committed on the follower
+    std::uint64_t conflicts = 0;       // rows the follower had to overwrite or skip
+    std::uint64_t bytesShipped = 0;
+    std::size_t   queued = 0;          // captured but not yet applied
+    double        lastLagMs = 0;       // primary commit -> follower commit
+    double        maxLagMs = 0;
+    double        oldestPendingMs = 0; // age of the oldest queued changeset
+    std::string   lastError;           // last failed apply; it is retried
+};
+
+// Applies changesets from a primary to a follower database file, in commit
+// order, on a background thread. The follower keeps the sequence number of
+// the last applied changeset in replication_state.
+class Replicator {
+public:
+    explicit Replicator(std::shared_ptr<DatabaseManager> follower);
+    ~Replicator();
+
+    void enqueue(std::string changeset);
+    // Blocks until everything enqueued so far has been applied.
+    void flush();
+    ReplicationStats stats() const;
+
+    std::shared_ptr<DatabaseManager> follower() const { return _follower; }
+    std::uint64_t appliedSequence();
+
+private:
+    using SteadyClock = std::chrono::steady_clock;
+
+    struct Pending {
+        std::uint64_t          seq;
+        std::string            changeset;
+        SteadyClock::time_point capturedAt;
+    };
+
+    std::shared_ptr<DatabaseManager> _follower;
+
+    mutable std::mutex      _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _drained;
+    std::deque<Pending>     _queue;
+    bool                    _applying = false;
+    bool                    _stopping = false;
+    std::uint64_t           _nextSeq = 1;
+    ReplicationStats        _stats;
+    std::thread             _worker;
+
+    void run();
+    void apply(std::deque<Pending>& batch);
+};
@@ -1,61 +1,117 @@
 #include "UserRepository.h"
-#include <sqlite3.h>
+#include "Query.h"
+#include "../util/Trace.h"
 #include <stdexcept>
+#include <utility>
 
-UserRepository::UserRepository(std::shared_ptr<DatabaseManager> db)
-    : _db(std::move(db)) {}
+template <>
+struct query::Column<Role> {
+    static Role get(sqlite3_stmt* s, int i) { return codeToRole(sqlite3_column_int(s, i)); }
+};
+
+namespace {
+
+using InsertUser = query::Query<"INSERT OR IGNORE INTO users (ext_id,name,role,password_hash) VALUES (?,?,?,?);",
+                                query::Row<>, std::string_view, std::string_view, int, std::string_view>;
+
+using FindUser = query::Query<"SELECT ext_id,name,role,password_hash FROM users WHERE ext_id = ?;",
+                              query::Row<std::string_view, std::string_view, Role, std::string_view>, std::string_view>;
+
+using AllUsers = query::Query<"SELECT ext_id,name,role,password_hash FROM users;",
+                              query::Row<std::string_view, std::string_view, Role, std::string_view>>;
+
+using UserNames = query::Query<"SELECT ext_id,name FROM users;", query::Row<std::string_view, std::string_view>>;
+
+using UserName = query::Query<"SELECT name FROM users WHERE ext_id = ?;", query::Row<std::string>, std::string_view>;
+
+}  // namespace
+
+UserRepository::UserRepository(std::shared_ptr<DatabaseManager> db, std::shared_ptr<EventBus> events)
+    : _db(std::move(db)), _events(std::move(events)) {
+    if (!_events) return;
+    _subscription = _events->subscribe("user-names", [this](std::span<const DomainEvent> events) {
+        for (auto& event : events)
+            if (auto* change = std::get_if<ExternalChange>(&event)) reindex(*change);
+    });
+}
 
 void UserRepository::add(const User& user) {
-    const char* sql =
-      "INSERT OR IGNORE INTO users (id,name,role,password_hash) VALUES (?,?,?,?);";
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(_db->get(), sql, -1, &stmt, nullptr) != SQLITE_OK)
-        throw std::runtime_error("Prepare user insert failed");
-
-    sqlite3_bind_text(stmt, 1, user.id().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, user.name().c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, roleToString(user.role()).c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, user.passwordHash().c_str(), -1, SQLITE_TRANSIENT);
-
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        sqlite3_finalize(stmt);
-        throw std::runtime_error("User insert failed");
-    }
-    sqlite3_finalize(stmt);
+    TraceSpan span("UserRepository::add", "repository");
+    _db->write([&] {
+        if (InsertUser::exec(*_db, user.id(), user.name(), roleToCode(user.role()), user.passwordHash()) == 0)
+            return;
+        if (_events)
+            _db->afterCommit([bus = _events, e = UserAdded{std::string(user.id()), user.role()}] { bus->publish(e); });
+        // Only once it commits: an enclosing write may still roll it back.
+        _db->afterCommit([this, id = std::string(user.id()), name = std::string(user.name())] {
+            std::lock_guard<std::mutex> lock(_nameIndexMutex);
+            if (_nameIndexReady) _nameIndex.add(id, name);
+        });
+    });
 }
 
-std::optional<User> UserRepository::find(const std::string& id) {
-    const char* sql = "SELECT name,role,password_hash FROM users WHERE id = ?;";
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(_db->get(), sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return std::nullopt;
-
-    sqlite3_bind_text(stmt, 1, id.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::string name    = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        std::string roleStr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        std::string pwdHash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        sqlite3_finalize(stmt);
-        return User(id, name, stringToRole(roleStr), pwdHash);
-    }
-    sqlite3_finalize(stmt);
-    return std::nullopt;
+std::optional<User> UserRepository::find(std::string_view id, std::pmr::memory_resource* memory) {
+    TraceSpan span("UserRepository::find", "repository");
+    return FindUser::oneAs<User>(*_db, memory, id);
 }
 
-std::vector<User> UserRepository::getAll() {
-    const char* sql = "SELECT id,name,role,password_hash FROM users;";
-    sqlite3_stmt* stmt = nullptr;
-    std::vector<User> out;
-    if (sqlite3_prepare_v2(_db->get(), sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return out;
-
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::string id      = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        std::string name    = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        std::string roleStr = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        std::string pwdHash = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        out.emplace_back(id, name, stringToRole(roleStr), pwdHash);
+std::pmr::vector<User> UserRepository::getAll(std::pmr::memory_resource* memory) {
+    TraceSpan span("UserRepository::getAll", "repository");
+    return AllUsers::allAs<User>(*_db, memory);
+}
+
+void UserRepository::buildNameIndex() {
+    TraceSpan span("UserRepository::buildNameIndex", "repository");
+    std::lock_guard<std::mutex> lock(_nameIndexMutex);
+    if (_nameIndexReady) return;
+
+    bool ok = UserNames::each(*_db, [&](std::string_view id, std::string_view name) {
+        _nameIndex.add(std::string(id), std::string(name));
+    });
+    if (!ok) throw std::runtime_error("Prepare name index load failed");
+    _nameIndexReady = true;
+}
+
+// Users another process added, renamed or deleted. Names are read with
+// the write lock held so a transaction open on this connection isn't seen
+// half done, and without the index lock, which add() takes inside writes.
+// If that transaction is this thread's own, the index is left as it is
+// and the change is read with the next one.
+void UserRepository::reindex(const ExternalChange& incoming) {
+    auto change = std::exchange(_deferred, {});
+    change.merge(incoming);
+    if (change.userIds.empty() && !change.everything) return;
+    {
+        std::lock_guard<std::mutex> lock(_nameIndexMutex);
+        if (!_nameIndexReady) return;   // built from the table when first searched
+    }
+    TraceSpan span("UserRepository::reindex", "repository");
+    std::vector<std::pair<std::string, std::optional<std::string>>> names;
+    bool read = _db->tryExclusive([&] {
+        if (change.everything) {
+            UserNames::each(*_db, [&](std::string_view id, std::string_view name) { names.emplace_back(id, name); });
+            return;
+        }
+        for (auto& id : change.userIds) {
+            auto row = UserName::one(*_db, id);
+            names.emplace_back(id, row ? std::optional(std::get<0>(*row)) : std::nullopt);
+        }
+    }, true);
+    if (!read) {
+        _deferred = std::move(change);
+        return;
     }
-    sqlite3_finalize(stmt);
-    return out;
-}
\ No newline at end of file
+
+    std::lock_guard<std::mutex> lock(_nameIndexMutex);
+    if (change.everything) _nameIndex.clear();
+    for (auto& [id, name] : names) {
+        if (name) _nameIndex.replace(id, *name);
+        else      _nameIndex.remove(id);
+    }
+}
+
+std::vector<TrigramIndex::Match> UserRepository::searchByName(const std::string& query, std::size_t limit) {
+    TraceSpan span("UserRepository::searchByName", "repository");
+    if (!_nameIndexReady) buildNameIndex();
+    return _nameIndex.search(query, limit);
+}
@@ -2,18 +2,43 @@
 
 #include "../models/User.h"
 #include "DatabaseManager.h"
+#include "../util/Arena.h"
+#include "../util/EventBus.h"
+#include "../util/TrigramIndex.h"
+#include <atomic>
+#include <memory_resource>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 
 class UserRepository {
 public:
-    explicit UserRepository(std::shared_ptr<DatabaseManager> db);
+    // With a bus, add() publishes UserAdded once it commits.
+    explicit UserRepository(std::shared_ptr<DatabaseManager> db, std::shared_ptr<EventBus> events = nullptr);
 
     void add(const User& user);
-    std::optional<User> find(const std::string& id);
-    std::vector<User>   getAll();
+    // Results are built in `memory`, as in AssetRepository.
+    std::optional<User>    find(std::string_view id, std::pmr::memory_resource* memory = CommandArena::current());
+    std::pmr::vector<User> getAll(std::pmr::memory_resource* memory = CommandArena::current());
+
+    // Typo-tolerant lookup by name, closest match first. The in-memory
+    // index is built on first use and kept current by add() and, with a
+    // bus, by ExternalChange events for users other processes added.
+    std::vector<TrigramIndex::Match> searchByName(const std::string& query, std::size_t limit = 10);
+
+    std::shared_ptr<EventBus> events() const { return _events; }
 
 private:
     std::shared_ptr<DatabaseManager> _db;
+    std::shared_ptr<EventBus>        _events;
+
+    TrigramIndex      _nameIndex;
+    std::mutex        _nameIndexMutex;
+    std::atomic<bool> _nameIndexReady{false};
+    ExternalChange    _deferred;   // not read yet; only the subscriber thread touches it
+    EventBus::Subscription _subscription;   // last: stops before the index goes
+
+    void buildNameIndex();
+    void reindex(const ExternalChange& incoming);
 };
\ No newline at end of file
@@ -8,6 +8,7 @@ public:
     void notify(const std::string& recipient,
                 const std::string& subject,
                 const std::string& body) override;
+    std::string_view channel() const override { return "email"; }
 
 private:
     std::string _from;
@@ -0,0 +1,226 @@
+#include "FinesJob.h"
+#include "../persistence/Query.h"
+#include "../util/ThreadPool.h"
+#include "../util/Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <optional>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+// A run renews its lease with every chunk; an unfinished run whose lease
+// is older than this is taken to have died, and its rows are discarded.
+const time_t leaseSeconds = 10 * 60;
+
+using DropStaleFines = query::Query<R"(
+    DELETE FROM fines WHERE run_day IN (
+        SELECT day FROM fine_runs WHERE finished_at IS NULL AND coalesce(leased_at, 0) < ?);
+)", query::Row<>, time_t>;
+
+using DropStaleRuns = query::Query<R"(
+    DELETE FROM fine_runs WHERE finished_at IS NULL AND coalesce(leased_at, 0) < ?;
+)", query::Row<>, time_t>;
+
+using FinishedRun = query::Query<R"(
+    SELECT loans, accruals, total_cents FROM fine_runs WHERE day = ? AND finished_at IS NOT NULL;
+)", query::Row<std::size_t, std::size_t, std::int64_t>, long>;
+
+using RunInProgress = query::Query<"SELECT day FROM fine_runs WHERE finished_at IS NULL;", query::Row<long>>;
+
+using LastRun = query::Query<"SELECT max(day) FROM fine_runs WHERE finished_at IS NOT NULL;",
+                             query::Row<std::optional<long>>>;
+
+using StartRun = query::Query<"INSERT INTO fine_runs (day, prev_day, owner, leased_at) VALUES (?, ?, ?, ?);",
+                              query::Row<>, long, std::optional<long>, std::int64_t, time_t>;
+
+using RenewLease = query::Query<R"(
+    UPDATE fine_runs SET leased_at = ? WHERE day = ? AND owner = ? AND finished_at IS NULL;
+)", query::Row<>, time_t, long, std::int64_t>;
+
+using FinishRun = query::Query<R"(
+    UPDATE fine_runs SET loans = ?, accruals = ?, total_cents = ?, finished_at = ?
+    WHERE day = ? AND owner = ? AND finished_at IS NULL;
+)", query::Row<>, std::size_t, std::size_t, std::int64_t, time_t, long, std::int64_t>;
+
+using OpenLoans = query::Query<R"(
+    SELECT l.id, l.asset_id, l.user_id, l.issue_date, a.type
+    FROM loans l JOIN assets a ON a.id = l.asset_id;
+)", query::Row<std::int64_t, std::int64_t, std::int64_t, time_t, int>>;
+
+using InsertFine = query::Query<R"(
+    INSERT INTO fines (run_day, loan_id, asset_id, user_id, issue_date, days_overdue, cents)
+    VALUES (?, ?, ?, ?, ?, ?, ?);
+)", query::Row<>, long, std::int64_t, std::int64_t, std::int64_t, time_t, int, std::int64_t>;
+
+// Only complete runs count.
+using Balance = query::Query<R"(
+    SELECT coalesce(sum(f.cents), 0)
+    FROM users u JOIN fines f ON f.user_id = u.id JOIN fine_runs r ON r.day = f.run_day
+    WHERE u.ext_id = ? AND r.finished_at IS NOT NULL;
+)", query::Row<std::int64_t>, std::string_view>;
+
+// Titles archived since keep their charges; the ID comes from the archive.
+using Ledger = query::Query<R"(
+    SELECT f.run_day, coalesce(a.ext_id, '(archived)'), f.issue_date, f.days_overdue, f.cents
+    FROM users u JOIN fines f ON f.user_id = u.id LEFT JOIN assets a ON a.id = f.asset_id
+    JOIN fine_runs r ON r.day = f.run_day
+    WHERE u.ext_id = ? AND r.finished_at IS NOT NULL
+    ORDER BY f.run_day DESC, f.loan_id DESC
+    LIMIT ?;
+)", query::Row<long, std::string, time_t, int, std::int64_t>, std::string_view, int>;
+
+const time_t secondsPerDay = 24 * 60 * 60;
+
+struct OpenLoan {
+    std::int64_t id, assetId, userId;
+    time_t       issueDate;
+    AssetType    type;
+};
+
+struct Accrual {
+    const OpenLoan* loan;
+    int             daysOverdue;
+    std::int64_t    cents;
+};
+
+}  // namespace
+
+std::map<AssetType, LoanPolicy> registeredLoanPolicies() {
+    std::map<AssetType, LoanPolicy> rates;
+    for (auto& t : assetTypes)
+        if (t.type != AssetType::Unknown) rates.emplace(t.type, t.loan);
+    return rates;
+}
+
+int FinePolicy::daysOverdue(AssetType type, time_t issueDate, time_t at) const {
+    if (at <= issueDate) return 0;
+    auto rate = rates.find(type);
+    int loanDays = rate != rates.end() ? rate->second.loanDays : assetTypeInfo(type).loan.loanDays;
+    return std::max(static_cast<int>((at - issueDate) / secondsPerDay) - loanDays, 0);
+}
+
+std::int64_t FinePolicy::owed(AssetType type, time_t issueDate, time_t at) const {
+    auto rate = rates.find(type);
+    if (rate == rates.end()) return 0;
+    int chargeable = daysOverdue(type, issueDate, at) - rate->second.graceDays;
+    if (chargeable <= 0) return 0;
+    return std::min(chargeable * rate->second.centsPerDay, rate->second.capCents);
+}
+
+FinesJob::FinesJob(std::shared_ptr<DatabaseManager> db, FinePolicy policy, std::size_t threads,
+                   std::size_t chunkRows)
+    : _db(std::move(db)), _policy(std::move(policy)),
+      _threads(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      _chunkRows(std::max<std::size_t>(chunkRows, 1)) {}
+
+FineRunSummary FinesJob::run(time_t asOf) {
+    TraceSpan span("FinesJob::run", "service");
+    auto started = std::chrono::steady_clock::now();
+    auto elapsedMs = [&] {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    };
+    FineRunSummary summary{asOf / secondsPerDay, false, 0, 0, 0, 0};
+    const long day = summary.day;
+
+    // Claim the day, after clearing whatever a dead run left. A run that
+    // still holds its lease is left alone.
+    std::random_device entropy;
+    const std::int64_t owner = static_cast<std::int64_t>((std::uint64_t{entropy()} << 32) | entropy());
+    std::optional<long> prev;
+    _db->write([&] {
+        const time_t now = std::time(nullptr);
+        DropStaleFines::exec(*_db, now - leaseSeconds);
+        DropStaleRuns::exec(*_db, now - leaseSeconds);
+        if (auto done = FinishedRun::one(*_db, day)) {
+            std::tie(summary.loans, summary.accruals, summary.totalCents) = *done;
+            summary.alreadyRun = true;
+            return;
+        }
+        if (RunInProgress::one(*_db))
+            throw std::runtime_error("Fines run already in progress");
+        if (auto last = LastRun::one(*_db)) prev = std::get<0>(*last);
+        if (prev && *prev > day)
+            throw std::runtime_error("Fines already accrued through a later day");
+        StartRun::exec(*_db, day, prev, owner, now);
+    });
+    // Every later write first checks the run is still ours.
+    auto holdLease = [&] {
+        if (RenewLease::exec(*_db, std::time(nullptr), day, owner) == 0)
+            throw std::runtime_error("Fines run lost its lease");
+    };
+    if (summary.alreadyRun) {
+        summary.elapsedMs = elapsedMs();
+        return summary;
+    }
+
+    std::vector<OpenLoan> loans;
+    OpenLoans::each(*_db, [&](std::int64_t id, std::int64_t asset, std::int64_t user, time_t issued, int type) {
+        loans.push_back({id, asset, user, issued, codeToAssetType(type)});
+    });
+    summary.loans = loans.size();
+
+    // Each loan owes what it owes at the end of the run day, less what it
+    // already owed at the end of the previous run. Slices outnumber workers
+    // so an uneven split still keeps every thread busy.
+    const time_t at = (day + 1) * secondsPerDay;
+    const std::optional<time_t> before = prev ? std::optional<time_t>((*prev + 1) * secondsPerDay) : std::nullopt;
+    std::vector<std::future<std::vector<Accrual>>> parts;
+    {
+        ThreadPool pool(_threads);
+        const std::size_t slices = std::min(loans.size(), pool.size() * 8);
+        for (std::size_t s = 0; s < slices; ++s) {
+            std::size_t begin = loans.size() * s / slices, end = loans.size() * (s + 1) / slices;
+            parts.push_back(pool.submit([this, &loans, begin, end, at, before] {
+                std::vector<Accrual> out;
+                for (std::size_t i = begin; i < end; ++i) {
+                    const auto& l = loans[i];
+                    auto cents = _policy.owed(l.type, l.issueDate, at);
+                    if (before) cents -= _policy.owed(l.type, l.issueDate, *before);
+                    if (cents > 0) out.push_back({&l, _policy.daysOverdue(l.type, l.issueDate, at), cents});
+                }
+                return out;
+            }));
+        }
+    }
+    std::vector<Accrual> accruals;
+    for (auto& p : parts) {
+        auto part = p.get();
+        accruals.insert(accruals.end(), part.begin(), part.end());
+    }
+
+    for (std::size_t begin = 0; begin < accruals.size(); begin += _chunkRows) {
+        std::size_t end = std::min(begin + _chunkRows, accruals.size());
+        _db->write([&] {
+            holdLease();
+            for (std::size_t i = begin; i < end; ++i) {
+                const auto& a = accruals[i];
+                InsertFine::exec(*_db, day, a.loan->id, a.loan->assetId, a.loan->userId, a.loan->issueDate,
+                                 a.daysOverdue, a.cents);
+            }
+        });
+    }
+
+    summary.accruals = accruals.size();
+    for (auto& a : accruals) summary.totalCents += a.cents;
+    _db->write([&] {
+        if (FinishRun::exec(*_db, summary.loans, summary.accruals, summary.totalCents, std::time(nullptr), day,
+                            owner) == 0)
+            throw std::runtime_error("Fines run lost its lease");
+    });
+    summary.elapsedMs = elapsedMs();
+    return summary;
+}
+
+std::int64_t FinesJob::balance(const std::string& userId) {
+    TraceSpan span("FinesJob::balance", "service");
+    auto row = Balance::one(*_db, userId);
+    return row ? std::get<0>(*row) : 0;
+}
+
+std::vector<FineEntry> FinesJob::ledger(const std::string& userId, int limit) {
+    TraceSpan span("FinesJob::ledger", "service");
+    return Ledger::allAs<FineEntry>(*_db, userId, limit);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "../models/Asset.h"
+#include "../persistence/DatabaseManager.h"
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Each type's loan policy from the registry unless overridden.
+std::map<AssetType, LoanPolicy> registeredLoanPolicies();
+
+struct FinePolicy {
+    std::map<AssetType, LoanPolicy> rates = registeredLoanPolicies();
+
+    // What a loan issued at issueDate owes at `at`: charged per whole day
+    // past the type's loan period and grace, up to the cap. Types without
+    // a rate are free.
+    std::int64_t owed(AssetType type, time_t issueDate, time_t at) const;
+    int daysOverdue(AssetType type, time_t issueDate, time_t at) const;
+};
+
+struct FineRunSummary {
+    long         day;           // days since the epoch, UTC
+    bool         alreadyRun;    // an earlier call completed this day
+    std::size_t  loans;         // open loans in the snapshot
+    std::size_t  accruals;      // loans charged this run
+    std::int64_t totalCents;
+    double       elapsedMs;
+};
+
+struct FineEntry {
+    long         day;
+    std::string  assetId;
+    time_t       issueDate;
+    int          daysOverdue;
+    std::int64_t cents;
+};
+
+// Nightly fines accrual. A run snapshots the open loans, works out what
+// each owes at the end of the run day in parallel, and appends the
+// increment since the previous complete run to the `fines` ledger, so a
+// loan is never charged twice for the same day and a missed night is
+// caught up by the next. Rows are written in chunks of `chunkRows`, each
+// its own transaction, so issues and returns keep going during a long run.
+//
+// Runs are idempotent per day: repeating a finished day returns its
+// summary. Only one run may be in progress at a time: a run holds a lease
+// on its day, renewed with each chunk, and another run started meanwhile
+// throws rather than charge the same loans again. Rows left by a run whose
+// lease has lapsed are discarded before the next one starts. A loan
+// returned between runs is not charged for the days since the last run.
+class FinesJob {
+public:
+    explicit FinesJob(std::shared_ptr<DatabaseManager> db, FinePolicy policy = {}, std::size_t threads = 0,
+                      std::size_t chunkRows = 50000);
+
+    // Accrues for the UTC day containing asOf. Throws if a later day has
+    // already been run or another run is in progress.
+    FineRunSummary run(time_t asOf);
+
+    std::int64_t balance(const std::string& userId);
+    std::vector<FineEntry> ledger(const std::string& userId, int limit = 20);   // newest first
+
+    const FinePolicy& policy() const { return _policy; }
+
+private:
+    std::shared_ptr<DatabaseManager> _db;
+    FinePolicy                       _policy;
+    std::size_t                      _threads;
+    std::size_t                      _chunkRows;
+};
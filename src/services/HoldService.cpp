@@ -0,0 +1,244 @@
+#include "HoldService.h"
+#include "../persistence/Query.h"
+#include "../util/Trace.h"
+#include <iostream>
+#include <utility>
+
+namespace {
+
+// A retired title has no copies coming back, so it takes no holds.
+using InsertHold = query::Query<R"(
+    INSERT OR IGNORE INTO holds (asset_id, user_id, priority, placed_at)
+    SELECT a.id, u.id, ?, ? FROM assets a, users u
+    WHERE a.ext_id = ? AND u.ext_id = ? AND a.id NOT IN (SELECT asset_id FROM retired_assets)
+    RETURNING id;
+)", query::Row<std::int64_t>, int, time_t, std::string_view, std::string_view>;
+
+using Retired = query::Query<R"(
+    SELECT 1 FROM retired_assets r JOIN assets a ON a.id = r.asset_id WHERE a.ext_id = ?;
+)", query::Row<int>, std::string_view>;
+
+// Returns the removed hold's ready_at, so callers can tell whether a copy
+// had been put aside for it.
+using DeleteHold = query::Query<R"(
+    DELETE FROM holds WHERE id = (
+        SELECT h.id FROM holds h
+        JOIN assets a ON a.id = h.asset_id JOIN users u ON u.id = h.user_id
+        WHERE a.ext_id = ? AND u.ext_id = ?)
+    RETURNING ready_at;
+)", query::Row<std::optional<time_t>>, std::string_view, std::string_view>;
+
+using CollectHold = query::Query<R"(
+    DELETE FROM holds WHERE ready_at IS NOT NULL AND id = (
+        SELECT h.id FROM holds h
+        JOIN assets a ON a.id = h.asset_id JOIN users u ON u.id = h.user_id
+        WHERE a.ext_id = ? AND u.ext_id = ?);
+)", query::Row<>, std::string_view, std::string_view>;
+
+// Head of the queue, straight off the holds_queue index.
+using NextWaiting = query::Query<R"(
+    SELECT h.id, u.ext_id FROM holds h JOIN users u ON u.id = h.user_id
+    WHERE h.asset_id = (SELECT id FROM assets WHERE ext_id = ?) AND h.ready_at IS NULL
+    ORDER BY h.priority DESC, h.id
+    LIMIT 1;
+)", query::Row<std::int64_t, std::string>, std::string_view>;
+
+using MarkReady = query::Query<"UPDATE holds SET ready_at = ? WHERE id = ?;",
+                               query::Row<>, time_t, std::int64_t>;
+
+using HoldsFor = query::Query<R"(
+    SELECT u.ext_id, h.priority, h.placed_at, h.ready_at
+    FROM holds h JOIN users u ON u.id = h.user_id
+    WHERE h.asset_id = (SELECT id FROM assets WHERE ext_id = ?)
+    ORDER BY h.ready_at IS NULL, h.priority DESC, h.id;
+)", query::Row<std::string, int, time_t, std::optional<time_t>>, std::string_view>;
+
+using WaitingFor = query::Query<R"(
+    SELECT u.ext_id, h.id, h.priority
+    FROM holds h JOIN users u ON u.id = h.user_id
+    WHERE h.asset_id = (SELECT id FROM assets WHERE ext_id = ?) AND h.ready_at IS NULL;
+)", query::Row<std::string_view, std::int64_t, int>, std::string_view>;
+
+using WaitingHolds = query::Query<R"(
+    SELECT a.ext_id, u.ext_id, h.id, h.priority
+    FROM holds h JOIN assets a ON a.id = h.asset_id JOIN users u ON u.id = h.user_id
+    WHERE h.ready_at IS NULL;
+)", query::Row<std::string_view, std::string_view, std::int64_t, int>>;
+
+}  // namespace
+
+HoldService::HoldService(std::shared_ptr<AssetRepository> assetRepo, std::shared_ptr<UserRepository> userRepo,
+                         std::vector<std::shared_ptr<NotificationStrategy>> notifiers,
+                         std::shared_ptr<Clock> clock)
+    : _assetRepo(std::move(assetRepo)), _userRepo(std::move(userRepo)), _notifiers(std::move(notifiers)),
+      _clock(std::move(clock)) {
+    // Subscribe first so a change committed during the load is not missed.
+    if (auto bus = _assetRepo->events())
+        _subscription = bus->subscribe("hold-queues", [this](std::span<const DomainEvent> events) {
+            for (auto& event : events)
+                if (auto* change = std::get_if<ExternalChange>(&event)) reload(*change);
+        });
+    load();
+}
+
+void HoldService::load() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    WaitingHolds::each(*_assetRepo->getDb(), [&](std::string_view asset, std::string_view user,
+                                                 std::int64_t id, int priority) {
+        _queues[std::string(asset)].push({id, std::string(user), priority});
+    });
+}
+
+// Another process placed, cancelled or filled holds on these titles: read
+// their queues again. The read holds the write lock so a transaction open
+// on this connection isn't seen half done; if it is this thread's own, the
+// queues are left as they are and the change is read with the next one.
+void HoldService::reload(const ExternalChange& incoming) {
+    auto change = std::exchange(_deferred, {});
+    change.merge(incoming);
+    if (change.assetIds.empty() && !change.everything) return;
+    TraceSpan span("HoldService::reload", "service");
+    auto db = _assetRepo->getDb();
+    std::unordered_map<std::string, HoldQueue> fresh;
+    bool read = db->tryExclusive([&] {
+        if (change.everything) {
+            WaitingHolds::each(*db, [&](std::string_view asset, std::string_view user, std::int64_t id, int priority) {
+                fresh[std::string(asset)].push({id, std::string(user), priority});
+            });
+            return;
+        }
+        for (auto& asset : change.assetIds) {
+            auto& queue = fresh[asset];
+            WaitingFor::each(*db, [&](std::string_view user, std::int64_t id, int priority) {
+                queue.push({id, std::string(user), priority});
+            }, asset);
+        }
+    }, true);
+    if (!read) {
+        _deferred = std::move(change);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (change.everything) {
+        _queues = std::move(fresh);
+        return;
+    }
+    for (auto& [asset, queue] : fresh) {
+        if (queue.empty()) _queues.erase(asset);
+        else _queues.insert_or_assign(asset, std::move(queue));
+    }
+}
+
+bool HoldService::placeHold(const std::string& assetId, const std::string& userId, int priority) {
+    TraceSpan span("HoldService::placeHold", "service");
+    auto assetOpt = _assetRepo->find(assetId);
+    if (!assetOpt.has_value()) {
+        std::cout << "Asset not found\n";
+        return false;
+    }
+    if (!_userRepo->find(userId).has_value()) {
+        std::cout << "User not found\n";
+        return false;
+    }
+    const std::string id(assetOpt->id());
+    if (assetOpt->available() > 0 && queueLength(id) == 0) {
+        std::cout << "A copy is available; issue it instead\n";
+        return false;
+    }
+
+    auto db = _assetRepo->getDb();
+    std::optional<std::int64_t> holdId;
+    bool retired = false;
+    db->write([&] {
+        if (auto row = InsertHold::one(*db, priority, _clock->now(), id, userId)) {
+            holdId = std::get<0>(*row);
+            db->afterCommit([this, id, userId, priority, hid = *holdId] {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _queues[id].push({hid, userId, priority});
+            });
+        } else {
+            retired = Retired::one(*db, id).has_value();
+        }
+    });
+    if (retired) {
+        std::cout << assetOpt->title() << " has been retired\n";
+        return false;
+    }
+    if (!holdId) {
+        std::cout << "Already holding " << assetOpt->title() << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool HoldService::cancelHold(const std::string& assetId, const std::string& userId) {
+    TraceSpan span("HoldService::cancelHold", "service");
+    auto assetOpt = _assetRepo->find(assetId);
+    if (!assetOpt.has_value()) return false;
+    const std::string id(assetOpt->id());
+
+    auto db = _assetRepo->getDb();
+    bool found = false;
+    db->write([&] {
+        auto row = DeleteHold::one(*db, id, userId);
+        if (!row) return;
+        found = true;
+        if (std::get<0>(*row).has_value() && !allocate(id))
+            _assetRepo->returnCopy(id);
+        db->afterCommit([this, id, userId] {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (auto q = _queues.find(id); q != _queues.end()) q->second.erase(userId);
+        });
+    });
+    return found;
+}
+
+std::size_t HoldService::queueLength(const std::string& assetId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto q = _queues.find(assetId);
+    return q == _queues.end() ? 0 : q->second.size();
+}
+
+std::vector<HoldQueue::Entry> HoldService::queue(const std::string& assetId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto q = _queues.find(assetId);
+    return q == _queues.end() ? std::vector<HoldQueue::Entry>{} : q->second.entries();
+}
+
+std::vector<Hold> HoldService::holdsFor(const std::string& assetId) {
+    TraceSpan span("HoldService::holdsFor", "service");
+    return HoldsFor::allAs<Hold>(*_assetRepo->getDb(), assetId);
+}
+
+bool HoldService::allocate(const std::string& assetId) {
+    TraceSpan span("HoldService::allocate", "service");
+    auto db = _assetRepo->getDb();
+    auto next = NextWaiting::one(*db, assetId);
+    if (!next) return false;
+    auto [holdId, userId] = *next;
+    MarkReady::exec(*db, _clock->now(), holdId);
+
+    auto assetOpt = _assetRepo->find(assetId);
+    std::string title = assetOpt ? std::string(assetOpt->title()) : assetId;
+    db->afterCommit([this, assetId, userId, title] {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (auto q = _queues.find(assetId); q != _queues.end()) q->second.erase(userId);
+        }
+        notifyReady(userId, title);
+    });
+    return true;
+}
+
+bool HoldService::collect(const std::string& assetId, const std::string& userId) {
+    return CollectHold::exec(*_assetRepo->getDb(), assetId, userId) > 0;
+}
+
+void HoldService::notifyReady(const std::string& userId, const std::string& title) {
+    auto userOpt = _userRepo->find(userId);
+    std::string name = userOpt ? std::string(userOpt->name()) : userId;
+    for (auto& n : _notifiers)
+        n->notify(userId, "Your hold is ready", "Hi " + name + ", a copy of " + title +
+                                                " is being held for you at the desk.");
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "NotificationStrategy.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../util/Clock.h"
+#include "../util/HoldQueue.h"
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Hold {
+    std::string           userId;
+    int                   priority;
+    time_t                placedAt;
+    std::optional<time_t> readyAt;   // set once a copy is put aside for the holder
+};
+
+// Waiting lists for titles whose copies are all out. Holds are stored in
+// the holds table; the waiting ones are mirrored in memory per title
+// (updated only once the change has committed). Higher priority goes
+// first, then first come.
+//
+// LoanService calls allocate() when a copy comes back and collect() when
+// a holder picks theirs up, both inside its own transaction, so a copy is
+// never both on the shelf and set aside. With a bus, queues for titles
+// another process touched are read again on ExternalChange.
+class HoldService {
+public:
+    HoldService(std::shared_ptr<AssetRepository> assetRepo, std::shared_ptr<UserRepository> userRepo,
+                std::vector<std::shared_ptr<NotificationStrategy>> notifiers = {},
+                std::shared_ptr<Clock> clock = systemClock());
+
+    // False if a copy is on the shelf, the user already holds the title,
+    // or it has been retired.
+    bool placeHold(const std::string& assetId, const std::string& userId, int priority = 0);
+    // A copy already set aside for the user passes to the next holder.
+    bool cancelHold(const std::string& assetId, const std::string& userId);
+
+    std::size_t queueLength(const std::string& assetId) const;     // waiting holds
+    std::vector<HoldQueue::Entry> queue(const std::string& assetId) const;
+    std::vector<Hold> holdsFor(const std::string& assetId);        // ready first, then queue order
+
+    // Sets a returned copy aside for the next holder and notifies them once
+    // the transaction commits. False when nobody is waiting.
+    bool allocate(const std::string& assetId);
+    // Consumes the user's ready hold; false if no copy was put aside for them.
+    bool collect(const std::string& assetId, const std::string& userId);
+
+private:
+    std::shared_ptr<AssetRepository> _assetRepo;
+    std::shared_ptr<UserRepository>  _userRepo;
+    std::vector<std::shared_ptr<NotificationStrategy>> _notifiers;
+    std::shared_ptr<Clock> _clock;
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, HoldQueue> _queues;   // by asset ID
+    ExternalChange _deferred;   // not read yet; only the subscriber thread touches it
+    EventBus::Subscription _subscription;   // last: stops before the queues go
+
+    void load();
+    void reload(const ExternalChange& incoming);
+    void notifyReady(const std::string& userId, const std::string& title);
+};
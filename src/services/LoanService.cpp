@@ -1,137 +1,295 @@
 #include "LoanService.h"
-#include <sqlite3.h>
+#include "../persistence/Query.h"
+#include "../util/Trace.h"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <cmath>
 
-LoanService::LoanService(std::shared_ptr<AssetRepository> assetRepo, std::shared_ptr<UserRepository> userRepo)
-    : _assetRepo(std::move(assetRepo)), _userRepo(std::move(userRepo)) {}
-
-void LoanService::setLoan(const std::string& assetId, const std::string& userId) {
-    const char* sql = R"(
-        INSERT OR REPLACE INTO loans (asset_id, user_id, issue_date)
-        VALUES (?, ?, ?);
-    )";
-    sqlite3* db = _assetRepo->getDb()->get();
-    sqlite3_stmt* stmt = nullptr;
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        throw std::runtime_error(std::string("Loan prepare failed: ") + sqlite3_errmsg(db));
-    }
+namespace {
+
+// loans holds integer row keys; external IDs are resolved here. A title
+// with several copies can be on several loans, oldest first.
+using InsertLoan = query::Query<R"(
+    INSERT INTO loans (asset_id, user_id, issue_date)
+    SELECT a.id, u.id, ? FROM assets a, users u
+    WHERE a.ext_id = ? AND u.ext_id = ?;
+)", query::Row<>, time_t, std::string_view, std::string_view>;
+
+using OpenLoan = query::Query<R"(
+    SELECT l.id, l.asset_id, l.user_id, l.issue_date, a.type
+    FROM assets a JOIN loans l ON l.asset_id = a.id JOIN users u ON u.id = l.user_id
+    WHERE a.ext_id = ? AND u.ext_id = ?
+    ORDER BY l.issue_date, l.id LIMIT 1;
+)", query::Row<std::int64_t, std::int64_t, std::int64_t, time_t, int>, std::string_view, std::string_view>;
+
+using DeleteLoan = query::Query<"DELETE FROM loans WHERE id = ?;", query::Row<>, std::int64_t>;
+
+// History and running totals; see the stats tables in DatabaseManager.
+using AppendHistory = query::Query<R"(
+    INSERT INTO loan_history (asset_id, user_id, issue_date, return_date) VALUES (?, ?, ?, ?);
+)", query::Row<>, std::int64_t, std::int64_t, time_t, time_t>;
+
+using CountAssetIssue = query::Query<R"(
+    INSERT INTO asset_stats (asset_id, borrows) SELECT id, 1 FROM assets WHERE ext_id = ?
+    ON CONFLICT(asset_id) DO UPDATE SET borrows = borrows + 1;
+)", query::Row<>, std::string_view>;
+
+using CountTypeIssue = query::Query<R"(
+    INSERT INTO type_stats (type, on_loan, borrows) SELECT type, 1, 1 FROM assets WHERE ext_id = ?
+    ON CONFLICT(type) DO UPDATE SET on_loan = on_loan + 1, borrows = borrows + 1;
+)", query::Row<>, std::string_view>;
+
+using CountDayIssue = query::Query<R"(
+    INSERT INTO daily_stats (day, issued) VALUES (?, 1)
+    ON CONFLICT(day) DO UPDATE SET issued = issued + 1;
+)", query::Row<>, time_t>;
+
+using CountAssetReturn = query::Query<R"(
+    INSERT INTO asset_stats (asset_id, seconds_out) VALUES (?, ?)
+    ON CONFLICT(asset_id) DO UPDATE SET seconds_out = seconds_out + excluded.seconds_out;
+)", query::Row<>, std::int64_t, time_t>;
+
+using CountTypeReturn = query::Query<R"(
+    UPDATE type_stats SET on_loan = max(on_loan - 1, 0), returns = returns + 1, seconds_out = seconds_out + ?
+    WHERE type = ?;
+)", query::Row<>, time_t, int>;
+
+using CountDayReturn = query::Query<R"(
+    INSERT INTO daily_stats (day, returned) VALUES (?, 1)
+    ON CONFLICT(day) DO UPDATE SET returned = returned + 1;
+)", query::Row<>, time_t>;
+
+using FindLoans = query::Query<R"(
+    SELECT u.ext_id, l.issue_date
+    FROM assets a JOIN loans l ON l.asset_id = a.id JOIN users u ON u.id = l.user_id
+    WHERE a.ext_id = ?
+    ORDER BY l.issue_date, l.id;
+)", query::Row<std::string_view, time_t>, std::string_view>;
 
-    time_t now = std::time(nullptr);
-    sqlite3_bind_text(stmt, 1, assetId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, userId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(now));
+constexpr time_t secondsPerDay = 24 * 60 * 60;
 
-    if (sqlite3_step(stmt) != SQLITE_DONE) {
-        std::string err = sqlite3_errmsg(db);
-        sqlite3_finalize(stmt);
-        throw std::runtime_error("Loan insert failed: " + err);
+constexpr void appendNumber(std::string& out, long long v) {
+    char digits[20];
+    int n = 0;
+    do digits[n++] = static_cast<char>('0' + v % 10); while ((v /= 10) > 0);
+    while (n > 0) out += digits[--n];
+}
+
+// sql with {periods} replaced by one VALUES row per registered type,
+// (type code, loan period in seconds), and {unknown} by Unknown's period.
+constexpr std::string withPeriods(std::string_view sql) {
+    std::string values = "VALUES ", unknown;
+    for (auto& t : assetTypes) {
+        if (t.type != assetTypes.front().type) values += ", ";
+        values += '(';
+        appendNumber(values, assetTypeToCode(t.type));
+        values += ", ";
+        appendNumber(values, t.loan.loanDays * secondsPerDay);
+        values += ')';
+    }
+    appendNumber(unknown, assetTypeInfo(AssetType::Unknown).loan.loanDays * secondsPerDay);
+
+    std::string out;
+    for (auto at = sql.find('{'); at != std::string_view::npos; at = sql.find('{')) {
+        auto end = sql.find('}', at);
+        out += sql.substr(0, at);
+        out += sql.substr(at + 1, end - at - 1) == "periods" ? values : unknown;
+        sql.remove_prefix(end + 1);
     }
-    sqlite3_finalize(stmt);
+    return out += sql;
 }
 
-std::optional<LoanInfo> LoanService::loanInfo(const std::string& assetId) {
-    return getLoanInfo(assetId);
+// Built at compile time, so loan periods stay in AssetTypes.h and the
+// statement is still prepared once.
+template <query::Sql S>
+inline constexpr auto periodSql = [] {
+    constexpr std::size_t n = withPeriods(S.view()).size() + 1;
+    char text[n]{};
+    auto sql = withPeriods(S.view());
+    std::copy_n(sql.data(), sql.size(), text);
+    return query::Sql<n>(text);
+}();
+
+// A loan is overdue once its type's period has passed; codes missing from
+// the registry get Unknown's period, as codeToAssetType does.
+using OverdueLoans = query::Query<periodSql<R"(
+    SELECT a.ext_id, a.title, u.ext_id, l.issue_date
+    FROM loans l JOIN assets a ON a.id = l.asset_id JOIN users u ON u.id = l.user_id
+    LEFT JOIN ({periods}) p ON p.column1 = a.type
+    WHERE l.issue_date + coalesce(p.column2, {unknown}) < ?
+    ORDER BY l.issue_date, a.ext_id;
+)">, query::Row<std::string, std::string, std::string, time_t>, time_t>;
+
+using CountOverdue = query::Query<periodSql<R"(
+    SELECT count(*)
+    FROM loans l JOIN assets a ON a.id = l.asset_id
+    LEFT JOIN ({periods}) p ON p.column1 = a.type
+    WHERE l.issue_date + coalesce(p.column2, {unknown}) < ?;
+)">, query::Row<int>, time_t>;
+
+}  // namespace
+
+LoanService::LoanService(std::shared_ptr<AssetRepository> assetRepo, std::shared_ptr<UserRepository> userRepo,
+                         std::shared_ptr<Clock> clock, std::shared_ptr<HoldService> holds,
+                         std::shared_ptr<RecommendationEngine> recommender)
+    : _assetRepo(std::move(assetRepo)), _userRepo(std::move(userRepo)), _clock(std::move(clock)),
+      _holds(std::move(holds)), _recommender(std::move(recommender)) {}
+
+time_t LoanService::setLoan(const std::string& assetId, const std::string& userId) {
+    try {
+        auto& db = *_assetRepo->getDb();
+        time_t now = _clock->now();
+        if (InsertLoan::exec(db, now, assetId, userId) == 0)
+            throw std::runtime_error("unknown asset or user");
+        CountAssetIssue::exec(db, assetId);
+        CountTypeIssue::exec(db, assetId);
+        CountDayIssue::exec(db, now / secondsPerDay);
+        return now;
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Loan insert failed: ") + e.what());
+    }
 }
 
-void LoanService::clearLoan(const std::string& assetId) {
-    const char* sql = "DELETE FROM loans WHERE asset_id = ?;";
-    sqlite3* db = _assetRepo->getDb()->get();
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return;
+std::optional<LoanInfo> LoanService::loanInfo(std::string_view assetId, std::pmr::memory_resource* memory) {
+    TraceSpan span("LoanService::loanInfo", "service");
+    auto all = loansFor(assetId, memory);
+    if (all.empty()) return std::nullopt;
+    return std::move(all.front());
+}
 
-    sqlite3_bind_text(stmt, 1, assetId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+std::pmr::vector<LoanInfo> LoanService::loansFor(std::string_view assetId, std::pmr::memory_resource* memory) {
+    TraceSpan span("LoanService::loansFor", "service");
+    return FindLoans::allAs<LoanInfo>(*_assetRepo->getDb(), memory, assetId);
 }
 
-std::optional<LoanInfo> LoanService::getLoanInfo(const std::string& assetId) {
-    const char* sql = "SELECT user_id, issue_date FROM loans WHERE asset_id = ?;";
-    sqlite3* db = _assetRepo->getDb()->get();
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
-        return std::nullopt;
-
-    sqlite3_bind_text(stmt, 1, assetId.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        std::string userId = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        sqlite3_int64 dateInt = sqlite3_column_int64(stmt, 1);
-        sqlite3_finalize(stmt);
-        return LoanInfo{userId, static_cast<time_t>(dateInt)};
-    }
-    sqlite3_finalize(stmt);
-    return std::nullopt;
+// Closes the user's oldest loan of the title into loan_history.
+std::optional<time_t> LoanService::clearLoan(const std::string& assetId, const std::string& userId) {
+    auto& db = *_assetRepo->getDb();
+    auto loan = OpenLoan::one(db, assetId, userId);
+    if (!loan) return std::nullopt;
+    auto [loanId, assetRow, userRow, issued, type] = *loan;
+    time_t now = _clock->now();
+    time_t out = std::max<time_t>(now - issued, 0);
+    DeleteLoan::exec(db, loanId);
+    AppendHistory::exec(db, assetRow, userRow, issued, now);
+    CountAssetReturn::exec(db, assetRow, out);
+    CountTypeReturn::exec(db, out, type);
+    CountDayReturn::exec(db, now / secondsPerDay);
+    return issued;
 }
 
 bool LoanService::issueAsset(const std::string& assetId, const std::string& userId) {
+    TraceSpan span("LoanService::issueAsset", "service", assetId);
     auto assetOpt = _assetRepo->find(assetId);
     if (!assetOpt.has_value()) {
         std::cout << "Asset not found\n";
         return false;
     }
-    if (assetOpt->isIssued()) {
-        std::cout << "Asset is already issued\n";
-        return false;
-    }
     auto userOpt = _userRepo->find(userId);
     if (!userOpt.has_value()) {
         std::cout << "User not found\n";
         return false;
     }
 
-    sqlite3* db = _assetRepo->getDb()->get();
-    char* err = nullptr;
-    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, &err);
-
+    // A copy put aside for this user's hold is theirs; otherwise the
+    // counter update claims one or fails if another caller took the last.
+    const std::string id(assetOpt->id());
+    bool noCopy = false;
     try {
-        _assetRepo->setIssued(assetId, true);
-        setLoan(assetId, userId);
-        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, &err);
+        auto db = _assetRepo->getDb();
+        db->write([&] {
+            bool reserved = _holds && _holds->collect(id, userId);
+            if (!reserved && !_assetRepo->takeCopy(id)) { noCopy = true; return; }
+            auto at = setLoan(id, userId);
+            if (_recommender)
+                db->afterCommit([rec = _recommender, id, userId, at] { rec->recordIssue(id, userId, at); });
+            if (auto bus = _assetRepo->events())
+                db->afterCommit([bus, e = AssetIssued{id, userId, at, assetOpt->type()}] { bus->publish(e); });
+        });
     } catch (const std::exception& e) {
-        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, &err);
         std::cout << "Failed to issue: " << e.what() << "\n";
         return false;
     }
+    if (noCopy) {
+        std::cout << "No copies available";
+        if (_holds) std::cout << "; " << _holds->queueLength(id) << " waiting, place a hold to join them";
+        std::cout << "\n";
+        return false;
+    }
 
     std::cout << "✅ Issued " << assetOpt->title() << " (" << assetTypeToString(assetOpt->type())
               << ") to " << userOpt->name() << ".\n";
     return true;
 }
 
-bool LoanService::returnAsset(const std::string& assetId) {
+bool LoanService::returnAsset(const std::string& assetId, const std::string& userId) {
+    TraceSpan span("LoanService::returnAsset", "service", assetId);
     auto assetOpt = _assetRepo->find(assetId);
     if (!assetOpt.has_value()) {
         std::cout << "Asset not found\n";
         return false;
     }
-    if (!assetOpt->isIssued()) {
+    const std::string id(assetOpt->id());
+    std::string borrower = userId;
+    if (borrower.empty()) {
+        auto loans = loansFor(id);
+        if (loans.empty()) {
+            std::cout << "Asset is not currently issued\n";
+            return false;
+        }
+        for (auto& l : loans) {
+            if (l.userId != loans.front().userId) {
+                std::cout << "Several borrowers have copies; specify the user\n";
+                return false;
+            }
+        }
+        borrower = std::string(loans.front().userId);
+    }
+
+    // The copy goes to the next holder, if any, in the same transaction.
+    bool notIssued = false, handedOff = false;
+    try {
+        auto db = _assetRepo->getDb();
+        db->write([&] {
+            auto issued = clearLoan(id, borrower);
+            if (!issued) { notIssued = true; return; }
+            handedOff = _holds && _holds->allocate(id);
+            if (!handedOff) _assetRepo->returnCopy(id);
+            if (auto bus = _assetRepo->events())
+                db->afterCommit([bus, e = AssetReturned{id, borrower, *issued, _clock->now(), handedOff,
+                                                         assetOpt->type()}] {
+                    bus->publish(e);
+                });
+        });
+    } catch (const std::exception& e) {
+        std::cout << "Failed to return: " << e.what() << "\n";
+        return false;
+    }
+    if (notIssued) {
         std::cout << "Asset is not currently issued\n";
         return false;
     }
-
-    _assetRepo->setIssued(assetId, false);
-    clearLoan(assetId);
-    std::cout << "✅ Returned " << assetOpt->title() << " (" << assetTypeToString(assetOpt->type()) << ").\n";
+    std::cout << "✅ Returned " << assetOpt->title() << " (" << assetTypeToString(assetOpt->type()) << ")"
+              << (handedOff ? "; held for the next reader.\n" : ".\n");
     return true;
 }
 
 void LoanService::listAll() {
     auto all = _assetRepo->getAll();
+    time_t now = _clock->now();
     for (auto& a : all) {
         std::cout << a.id() << " | " << assetTypeToString(a.type()) << " | " << a.title()
                   << " | " << a.authorOrOwner() << " | "
                   << (a.isIssued() ? "Issued" : "Available");
+        if (a.copies() > 1)
+            std::cout << " (" << a.available() << "/" << a.copies() << ")";
 
-        if (a.isIssued()) {
-            auto loanInfo = getLoanInfo(a.id());
-            if (loanInfo.has_value()) {
-                time_t now = std::time(nullptr);
-                double days = difftime(now, loanInfo->issueDate) / (60 * 60 * 24);
+        if (a.onLoan() > 0) {
+            for (auto& loan : loansFor(a.id())) {
+                double days = difftime(now, loan.issueDate) / (60 * 60 * 24);
                 std::cout << " | borrowed " << static_cast<int>(std::floor(days)) << " days ago";
-                auto userOpt = _userRepo->find(loanInfo->userId);
+                auto userOpt = _userRepo->find(loan.userId);
                 if (userOpt.has_value()) {
                     std::cout << " by " << userOpt->name();
                 }
@@ -143,21 +301,30 @@ void LoanService::listAll() {
 
 void LoanService::showOverdues() {
     auto all = _assetRepo->getAll();
-    time_t now = std::time(nullptr);
+    time_t now = _clock->now();
     for (auto& a : all) {
-        if (!a.isIssued()) continue;
-        auto loanInfo = getLoanInfo(a.id());
-        if (!loanInfo.has_value()) continue;
-        double days = difftime(now, loanInfo->issueDate) / (60 * 60 * 24);
-        if (days > 14) {
+        if (a.onLoan() == 0) continue;
+        for (auto& loan : loansFor(a.id())) {
+            double days = difftime(now, loan.issueDate) / (60 * 60 * 24);
+            if (days <= assetTypeInfo(a.type()).loan.loanDays) continue;
             std::cout << "⚠️ OVERDUE: " << a.id() << " | " << assetTypeToString(a.type())
                       << " | " << a.title() << " | borrowed " << static_cast<int>(std::floor(days))
                       << " days ago";
-            auto userOpt = _userRepo->find(loanInfo->userId);
+            auto userOpt = _userRepo->find(loan.userId);
             if (userOpt.has_value()) {
                 std::cout << " by " << userOpt->name();
             }
             std::cout << "\n";
         }
     }
-}
\ No newline at end of file
+}
+
+std::vector<OverdueLoan> LoanService::overdueLoans() {
+    TraceSpan span("LoanService::overdueLoans", "service");
+    return OverdueLoans::allAs<OverdueLoan>(*_assetRepo->getDb(), _clock->now());
+}
+
+int LoanService::countOverdue() {
+    auto row = CountOverdue::one(*_assetRepo->getDb(), _clock->now());
+    return row ? std::get<0>(*row) : 0;
+}
@@ -1,33 +1,76 @@
 #pragma once
 
+#include "HoldService.h"
+#include "RecommendationEngine.h"
 #include "../persistence/AssetRepository.h"
 #include "../persistence/UserRepository.h"
+#include "../util/Clock.h"
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <optional>
+#include <vector>
+#include <ctime>
 
+// Allocator-aware, like Asset.
 struct LoanInfo {
-    std::string userId;
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    std::pmr::string userId;
     time_t issueDate;
+
+    LoanInfo(std::string_view userId, time_t issueDate, const allocator_type& alloc = {})
+        : userId(userId, alloc), issueDate(issueDate) {}
+    LoanInfo(const LoanInfo& other) = default;
+    LoanInfo(LoanInfo&& other) = default;
+    LoanInfo(const LoanInfo& other, const allocator_type& alloc)
+        : userId(other.userId, alloc), issueDate(other.issueDate) {}
+    LoanInfo(LoanInfo&& other, const allocator_type& alloc)
+        : userId(std::move(other.userId), alloc), issueDate(other.issueDate) {}
+    LoanInfo& operator=(const LoanInfo& other) = default;
+    LoanInfo& operator=(LoanInfo&& other) = default;
+};
+
+struct OverdueLoan {
+    std::string assetId;
+    std::string title;
+    std::string userId;
+    time_t      issueDate;
 };
 
 class LoanService {
 public:
-    LoanService(std::shared_ptr<AssetRepository> assetRepo, std::shared_ptr<UserRepository> userRepo);
+    LoanService(std::shared_ptr<AssetRepository> assetRepo, std::shared_ptr<UserRepository> userRepo,
+                std::shared_ptr<Clock> clock = systemClock(), std::shared_ptr<HoldService> holds = nullptr,
+                std::shared_ptr<RecommendationEngine> recommender = nullptr);
 
     bool issueAsset(const std::string& assetId, const std::string& userId);
-    bool returnAsset(const std::string& assetId);
+    // Without a user, returns the title's only borrower's copy.
+    bool returnAsset(const std::string& assetId, const std::string& userId = "");
     void listAll();
-    void showOverdues(); // borrowed > 14 days
+    void showOverdues(); // borrowed past the type's loan period
+
+    // Loans past their type's loan period, oldest first, in one query.
+    std::vector<OverdueLoan> overdueLoans();
+    int countOverdue();
 
-    // public accessor for outside consumers
-    std::optional<LoanInfo> loanInfo(const std::string& assetId);
+    // public accessor for outside consumers; built in `memory`, as repository reads are
+    std::optional<LoanInfo> loanInfo(std::string_view assetId,       // oldest loan
+                                     std::pmr::memory_resource* memory = CommandArena::current());
+    std::pmr::vector<LoanInfo> loansFor(std::string_view assetId,    // oldest first
+                                        std::pmr::memory_resource* memory = CommandArena::current());
+    std::shared_ptr<Clock> clock() const { return _clock; }
+    std::shared_ptr<HoldService> holds() const { return _holds; }
+    std::shared_ptr<RecommendationEngine> recommender() const { return _recommender; }
 
 private:
     std::shared_ptr<AssetRepository> _assetRepo;
     std::shared_ptr<UserRepository> _userRepo;
+    std::shared_ptr<Clock> _clock;
+    std::shared_ptr<HoldService> _holds;   // optional; returns hand off to waiting holders
+    std::shared_ptr<RecommendationEngine> _recommender;   // optional; fed each committed issue
 
-    std::optional<LoanInfo> getLoanInfo(const std::string& assetId);
-    void setLoan(const std::string& assetId, const std::string& userId);
-    void clearLoan(const std::string& assetId);
+    time_t setLoan(const std::string& assetId, const std::string& userId);   // returns the issue time
+    std::optional<time_t> clearLoan(const std::string& assetId, const std::string& userId);   // issue time
 };
\ No newline at end of file
@@ -1,78 +1,196 @@
 #include "NotificationService.h"
 #include "LoanService.h"
+#include "../persistence/Query.h"
+#include "../util/Trace.h"
+#include <algorithm>
 #include <iostream>
-#include <sstream>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+using OpenLoans = query::Query<R"(
+    SELECT l.issue_date, a.type, a.ext_id, u.ext_id
+    FROM loans l JOIN assets a ON a.id = l.asset_id JOIN users u ON u.id = l.user_id;
+)", query::Row<time_t, int, std::string, std::string>>;
+
+using OpenLoansFor = query::Query<R"(
+    SELECT l.issue_date, a.type, a.ext_id, u.ext_id
+    FROM loans l JOIN assets a ON a.id = l.asset_id JOIN users u ON u.id = l.user_id
+    WHERE a.ext_id = ?;
+)", query::Row<time_t, int, std::string, std::string>, std::string_view>;
+
+// A loan is overdue once its type's loan period has passed.
+time_t dueAt(AssetType type, time_t issued) {
+    return issued + static_cast<time_t>(assetTypeInfo(type).loan.loanDays) * 24 * 60 * 60;
+}
+
+}  // namespace
 
 NotificationService::NotificationService(std::shared_ptr<AssetRepository> assetRepo,
                                          std::shared_ptr<UserRepository> userRepo,
-                                         std::vector<std::shared_ptr<NotificationStrategy>> strategies)
+                                         std::vector<std::shared_ptr<NotificationStrategy>> strategies,
+                                         std::shared_ptr<Clock> clock)
     : _assetRepo(std::move(assetRepo)),
       _userRepo(std::move(userRepo)),
-      _strategies(std::move(strategies)) {}
+      _strategies(std::move(strategies)),
+      _clock(std::move(clock)) {
+    auto bus = _assetRepo->events();
+    if (!bus) return;
+    // Subscribe first so nothing committed after the load is missed.
+    std::lock_guard<std::mutex> lock(_loansMutex);
+    _subscription = bus->subscribe("overdue-notifier", [this](std::span<const DomainEvent> events) {
+        apply(events);
+    });
+    OpenLoans::each(*_assetRepo->getDb(), [&](time_t issued, int type, std::string asset, std::string user) {
+        _openLoans.emplace(dueAt(codeToAssetType(type), issued), issued, std::move(asset), std::move(user));
+    });
+}
+
+void NotificationService::apply(std::span<const DomainEvent> events) {
+    TraceSpan span("NotificationService::apply", "service");
+    std::unique_lock<std::mutex> lock(_loansMutex);
+    for (auto& event : events) {
+        std::visit([&](auto& e) {
+            using E = std::decay_t<decltype(e)>;
+            if constexpr (std::is_same_v<E, AssetIssued>) {
+                // A reload for another process's change may have read it already.
+                auto loan = OpenLoan{dueAt(e.type, e.at), e.at, e.assetId, e.userId};
+                if (_openLoans.find(loan) == _openLoans.end()) _openLoans.insert(std::move(loan));
+            } else if constexpr (std::is_same_v<E, ExternalChange>) {
+                lock.unlock();
+                reload(e);
+                lock.lock();
+            } else if constexpr (std::is_same_v<E, AssetReturned>) {
+                auto loan = OpenLoan{dueAt(e.type, e.issuedAt), e.issuedAt, e.assetId, e.userId};
+                if (auto it = _openLoans.find(loan); it != _openLoans.end())
+                    _openLoans.erase(it);
+            }
+        }, event);
+    }
+}
+
+// Another process issued or returned these titles: read their open loans
+// again. The read holds the write lock so a transaction open on this
+// connection isn't seen half done; if it is this thread's own, the mirror
+// is left as it is and the change is read with the next one.
+void NotificationService::reload(const ExternalChange& incoming) {
+    auto change = std::exchange(_deferred, {});
+    change.merge(incoming);
+    if (change.assetIds.empty() && !change.everything) return;
+    std::vector<OpenLoan> loans;
+    auto& db = *_assetRepo->getDb();
+    bool read = db.tryExclusive([&] {
+        auto add = [&](time_t issued, int type, std::string asset, std::string user) {
+            loans.emplace_back(dueAt(codeToAssetType(type), issued), issued, std::move(asset), std::move(user));
+        };
+        if (change.everything) OpenLoans::each(db, add);
+        else for (auto& id : change.assetIds) OpenLoansFor::each(db, add, id);
+    }, true);
+    if (!read) {
+        _deferred = std::move(change);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_loansMutex);
+    if (change.everything) _openLoans.clear();
+    else std::erase_if(_openLoans, [&](const OpenLoan& loan) {
+        return std::binary_search(change.assetIds.begin(), change.assetIds.end(), std::get<2>(loan));
+    });
+    _openLoans.insert(loans.begin(), loans.end());
+}
+
+std::vector<NotificationService::OpenLoan> NotificationService::overdueLoans(time_t now) {
+    std::lock_guard<std::mutex> lock(_loansMutex);
+    return {_openLoans.begin(), _openLoans.lower_bound({now, std::numeric_limits<time_t>::min(), "", ""})};
+}
 
 int NotificationService::countOverdue() {
-    LoanService loan(_assetRepo, _userRepo);
-    // capture overdue count without printing
-    std::stringstream ss;
-    auto originalBuf = std::cout.rdbuf(); // preserve if needed
+    TraceSpan span("NotificationService::countOverdue", "service");
+    time_t now = _clock->now();
+    if (_subscription) return static_cast<int>(overdueLoans(now).size());
+
+    LoanService loan(_assetRepo, _userRepo, _clock);
     int count = 0;
     auto all = _assetRepo->getAll();
-    time_t now = std::time(nullptr);
     for (auto& a : all) {
-        if (!a.isIssued()) continue;
-        auto loanInfoOpt = loan.loanInfo(a.id());
-        if (!loanInfoOpt.has_value()) continue;
-        double days = difftime(now, loanInfoOpt->issueDate) / (60 * 60 * 24);
-        if (days > 14) {
-            count++;
+        if (a.onLoan() == 0) continue;
+        for (auto& info : loan.loansFor(a.id())) {
+            if (now > dueAt(a.type(), info.issueDate)) {
+                count++;
+            }
         }
     }
     return count;
 }
 
 void NotificationService::checkAndNotifyOverdue() {
-    LoanService loan(_assetRepo, _userRepo);
-    std::vector<std::string> overdueMessages;
+    TraceSpan span("NotificationService::checkAndNotifyOverdue", "service");
+    time_t now = _clock->now();
 
-    auto all = _assetRepo->getAll();
-    time_t now = std::time(nullptr);
-    for (auto& a : all) {
-        if (!a.isIssued()) continue;
-        auto loanInfoOpt = loan.loanInfo(a.id());
-        if (!loanInfoOpt.has_value()) continue;
-        double days = difftime(now, loanInfoOpt->issueDate) / (60 * 60 * 24);
-        if (days > 14) {
-            std::stringstream msg;
-            msg << "OVERDUE: " << a.id()
-                << " | " << assetTypeToString(a.type())
-                << " | " << a.title()
-                << " | borrowed " << static_cast<int>(days) << " days ago";
-            if (auto userOpt = _userRepo->find(loanInfoOpt->userId); userOpt.has_value()) {
-                msg << " by " << userOpt->name();
-            }
-            std::string formatted = msg.str();
-            overdueMessages.push_back(formatted);
-            // also print to console immediately
-            std::cout << "⚠️ " << formatted << "\n";
+    // One digest per channel, each line rendered straight into it.
+    struct Digest {
+        std::string_view        channel;
+        const OverdueTemplates* templates;
+        std::string             lines;
+    };
+    std::vector<Digest> digests;
+    for (auto& strategy : _strategies) {
+        auto channel = strategy->channel();
+        if (std::none_of(digests.begin(), digests.end(), [&](auto& d) { return d.channel == channel; }))
+            digests.push_back({channel, &_templates.overdue(channel), {}});
+    }
+    auto& console = _templates.overdue("console").line;
+    std::string line;
+    long count = 0;
+
+    auto report = [&](const Asset& a, std::string_view userId, time_t issued) {
+        auto userOpt = _userRepo->find(userId);
+        NotificationFields fields{a.id(), assetTypeInfo(a.type()).name, a.title(), userId,
+                                  userOpt ? userOpt->name() : userId,
+                                  static_cast<long>(difftime(now, issued) / (60 * 60 * 24))};
+        ++count;
+        // also print to console immediately
+        line.clear();
+        console.renderTo(line, fields);
+        std::cout << line;
+        for (auto& d : digests) d.templates->line.renderTo(d.lines, fields);
+    };
+
+    if (_subscription) {
+        for (auto& [due, issued, assetId, userId] : overdueLoans(now))
+            if (auto a = _assetRepo->find(assetId)) report(*a, userId, issued);
+    } else {
+        LoanService loan(_assetRepo, _userRepo, _clock);
+        for (auto& a : _assetRepo->getAll()) {
+            if (a.onLoan() == 0) continue;
+            for (auto& info : loan.loansFor(a.id()))
+                if (now > dueAt(a.type(), info.issueDate)) report(a, info.userId, info.issueDate);
         }
     }
 
-    if (overdueMessages.empty()) {
+    if (count == 0) {
         std::cout << "No overdue assets found.\n";
         return;
     }
 
-    // Send summary via strategies
-    std::stringstream summary;
-    summary << "You have " << overdueMessages.size() << " overdue assets:\n";
-    for (auto& m : overdueMessages) summary << "- " << m << "\n";
-
-    std::string subject = "Overdue Assets Summary";
-    std::string body = summary.str();
-
     // For demo, send to admin email (hardcoded)
     std::string recipient = "admin@library.local";
-    for (auto& strategy : _strategies) {
-        strategy->notify(recipient, subject, body);
+    std::string subject, body;
+    NotificationFields totals;
+    totals.count = count;
+    for (auto& d : digests) {
+        subject.clear();
+        body.clear();
+        d.templates->subject.renderTo(subject, totals);
+        d.templates->header.renderTo(body, totals);
+        body += d.lines;
+        for (auto& strategy : _strategies)
+            if (strategy->channel() == d.channel) strategy->notify(recipient, subject, body);
     }
-}
\ No newline at end of file
+}
+
+NotificationTemplates& NotificationService::templates() {
+    return _templates;
+}
@@ -1,21 +1,60 @@
 #pragma once
+#include <ctime>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <string>
+#include <tuple>
 #include <vector>
 #include "../persistence/AssetRepository.h"
 #include "../persistence/UserRepository.h"
 #include "NotificationStrategy.h"
+#include "NotificationTemplate.h"
+#include "../util/Clock.h"
+#include "../util/EventBus.h"
 
+// A loan is overdue once its asset type's loan period (see AssetTypes.h)
+// has passed. When the asset repository has an event bus, open loans are
+// mirrored in memory by due time from AssetIssued/AssetReturned events, so
+// overdue checks read only the overdue loans instead of rescanning the
+// catalogue.
+// The mirror trails commits by the bus's delivery delay. Loans another
+// process issues or returns reach it as ExternalChange events (see
+// ChangeWatcher), and only those titles are read again.
+//
+// Messages come from templates compiled once (NotificationTemplate.h):
+// each strategy gets the digest for its channel, built by rendering one
+// line per overdue loan into a buffer.
 class NotificationService {
 public:
     NotificationService(std::shared_ptr<AssetRepository> assetRepo,
                         std::shared_ptr<UserRepository> userRepo,
-                        std::vector<std::shared_ptr<NotificationStrategy>> strategies);
+                        std::vector<std::shared_ptr<NotificationStrategy>> strategies,
+                        std::shared_ptr<Clock> clock = systemClock());
 
     void checkAndNotifyOverdue();
     int countOverdue();
 
+    // Per-channel message templates; set before checkAndNotifyOverdue().
+    NotificationTemplates& templates();
+
 private:
+    using OpenLoan = std::tuple<time_t, time_t, std::string, std::string>;   // due, issued, asset, user
+
     std::shared_ptr<AssetRepository> _assetRepo;
     std::shared_ptr<UserRepository> _userRepo;
     std::vector<std::shared_ptr<NotificationStrategy>> _strategies;
+    std::shared_ptr<Clock> _clock;
+    NotificationTemplates  _templates;
+
+    std::mutex                _loansMutex;
+    std::multiset<OpenLoan>   _openLoans;
+    ExternalChange            _deferred;       // not read yet; only the subscriber thread touches it
+    EventBus::Subscription    _subscription;   // last: delivery stops before the mirror goes
+
+    void apply(std::span<const DomainEvent> events);
+    void reload(const ExternalChange& incoming);
+    // Loans due before now, longest overdue first.
+    std::vector<OpenLoan> overdueLoans(time_t now);
 };
\ No newline at end of file
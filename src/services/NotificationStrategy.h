@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 
 class NotificationStrategy {
 public:
@@ -7,4 +8,6 @@ public:
     virtual void notify(const std::string& recipient,
                         const std::string& subject,
                         const std::string& body) = 0;
+    // Picks the templates this strategy's messages are rendered with.
+    virtual std::string_view channel() const { return "default"; }
 };
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "NotificationTemplate.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+
+[[noreturn]] void fail(std::string_view text, std::string_view why) {
+    throw std::runtime_error("Template parse failed: " + std::string(why) + " in \"" + std::string(text) + "\"");
+}
+
+// Characters, not bytes, so a cut or a pad never splits a UTF-8 sequence.
+std::size_t characters(std::string_view s) {
+    std::size_t n = 0;
+    for (char c : s) n += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    return n;
+}
+
+std::string_view firstCharacters(std::string_view s, std::size_t n) {
+    for (std::size_t i = 0; i < s.size(); ++i)
+        if ((static_cast<unsigned char>(s[i]) & 0xC0) != 0x80 && n-- == 0) return s.substr(0, i);
+    return s;
+}
+
+std::uint32_t number(std::string_view text, std::string_view& spec) {
+    std::uint32_t v = 0;
+    auto [end, ec] = std::from_chars(spec.data(), spec.data() + spec.size(), v);
+    if (ec != std::errc()) fail(text, "bad width or precision");
+    spec.remove_prefix(end - spec.data());
+    return v;
+}
+
+}  // namespace
+
+NotificationTemplate::NotificationTemplate(std::string_view text) {
+    auto literal = [&](std::string_view s) {
+        if (s.empty()) return;
+        if (!_pieces.empty() && _pieces.back().field == Field::Literal) {
+            _pieces.back().size += static_cast<std::uint32_t>(s.size());
+        } else {
+            Piece p{Field::Literal};
+            p.offset = static_cast<std::uint32_t>(_literals.size());
+            p.size = static_cast<std::uint32_t>(s.size());
+            _pieces.push_back(p);
+        }
+        _literals += s;
+    };
+
+    for (std::size_t i = 0; i < text.size();) {
+        auto brace = text.find_first_of("{}", i);
+        literal(text.substr(i, brace - i));
+        if (brace == std::string_view::npos) break;
+        if (brace + 1 < text.size() && text[brace + 1] == text[brace]) {   // {{ or }}
+            literal(text.substr(brace, 1));
+            i = brace + 2;
+            continue;
+        }
+        if (text[brace] == '}') fail(text, "unmatched '}'");
+        auto close = text.find('}', brace);
+        if (close == std::string_view::npos) fail(text, "unclosed '{'");
+        std::string_view inside = text.substr(brace + 1, close - brace - 1);
+        std::string_view name = inside.substr(0, inside.find(':'));
+        std::string_view spec = name.size() < inside.size() ? inside.substr(name.size() + 1) : std::string_view{};
+
+        Piece p{};
+        static constexpr std::pair<std::string_view, Field> names[] = {
+            {"asset", Field::Asset}, {"type", Field::Type}, {"title", Field::Title}, {"user", Field::User},
+            {"name", Field::Name},   {"days", Field::Days}, {"count", Field::Count},
+        };
+        for (auto& [n, f] : names)
+            if (n == name) p.field = f;
+        if (p.field == Field::Literal) fail(text, "unknown placeholder {" + std::string(name) + "}");
+        bool numeric = p.field == Field::Days || p.field == Field::Count;
+
+        // [[fill]align][width][.precision][type]
+        auto isAlign = [](char c) { return c == '<' || c == '>' || c == '^'; };
+        if (spec.size() >= 2 && isAlign(spec[1])) {
+            p.fill = spec[0];
+            p.align = spec[1];
+            spec.remove_prefix(2);
+        } else if (!spec.empty() && isAlign(spec[0])) {
+            p.align = spec[0];
+            spec.remove_prefix(1);
+        }
+        if (!spec.empty() && spec[0] >= '1' && spec[0] <= '9') p.width = number(text, spec);
+        if (!spec.empty() && spec[0] == '.') {
+            if (numeric) fail(text, "precision on a number");
+            spec.remove_prefix(1);
+            p.precision = number(text, spec);
+        }
+        if (!spec.empty() && spec == (numeric ? "d" : "s")) spec = {};
+        if (!spec.empty()) fail(text, "bad format spec '" + std::string(inside) + "'");
+        if (!p.align) p.align = numeric ? '>' : '<';
+        _pieces.push_back(p);
+        i = close + 1;
+    }
+}
+
+void NotificationTemplate::renderTo(std::string& out, const NotificationFields& fields) const {
+    char digits[24];
+    for (auto& p : _pieces) {
+        std::string_view value;
+        switch (p.field) {
+            case Field::Literal:
+                out.append(_literals, p.offset, p.size);
+                continue;
+            case Field::Asset: value = fields.asset; break;
+            case Field::Type:  value = fields.type; break;
+            case Field::Title: value = fields.title; break;
+            case Field::User:  value = fields.user; break;
+            case Field::Name:  value = fields.name; break;
+            case Field::Days:
+            case Field::Count: {
+                long n = p.field == Field::Days ? fields.days : fields.count;
+                value = {digits, static_cast<std::size_t>(std::to_chars(digits, digits + sizeof digits, n).ptr - digits)};
+                break;
+            }
+        }
+        if (p.precision != UINT32_MAX) value = firstCharacters(value, p.precision);
+        if (p.width == 0) {
+            out += value;
+            continue;
+        }
+        std::size_t have = characters(value);
+        std::size_t pad = p.width > have ? p.width - have : 0;
+        std::size_t before = p.align == '>' ? pad : p.align == '^' ? pad / 2 : 0;
+        out.append(before, p.fill);
+        out += value;
+        out.append(pad - before, p.fill);
+    }
+}
+
+std::string NotificationTemplate::render(const NotificationFields& fields) const {
+    std::string out;
+    renderTo(out, fields);
+    return out;
+}
+
+NotificationTemplates::NotificationTemplates() {
+    OverdueTemplates console;
+    console.line = NotificationTemplate("⚠️ OVERDUE: {asset} | {type} | {title} | borrowed {days} days ago by {name}\n");
+    _overdue.emplace("default", OverdueTemplates{});
+    _overdue.emplace("console", std::move(console));
+}
+
+void NotificationTemplates::set(std::string channel, OverdueTemplates templates) {
+    _overdue.insert_or_assign(std::move(channel), std::move(templates));
+}
+
+const OverdueTemplates& NotificationTemplates::overdue(std::string_view channel) const {
+    auto it = _overdue.find(channel);
+    return it != _overdue.end() ? it->second : _overdue.find("default")->second;
+}
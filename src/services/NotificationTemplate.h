@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What a notification template can refer to.
+struct NotificationFields {
+    std::string_view asset;   // {asset}: asset ID
+    std::string_view type;    // {type}
+    std::string_view title;   // {title}
+    std::string_view user;    // {user}: user ID
+    std::string_view name;    // {name}: the user's name, or their ID if unknown
+    long             days = 0;    // {days}: days since the loan was issued
+    long             count = 0;   // {count}: lines in the digest
+};
+
+// A subject or body with {placeholders}, parsed once and then rendered
+// without reparsing. Placeholders take std::format's spec after a colon:
+// {title:.20} keeps the first 20 characters, {days:>4} right-aligns in 4
+// columns, {name:*^12} centres with '*'. Widths count UTF-8 characters.
+// Strings align left and numbers right by default; {{ and }} are literal
+// braces. Throws std::runtime_error on an
+// unknown placeholder or a malformed spec.
+class NotificationTemplate {
+public:
+    explicit NotificationTemplate(std::string_view text);
+
+    // Appends to out, so one buffer can be reused across renders.
+    void renderTo(std::string& out, const NotificationFields& fields) const;
+    std::string render(const NotificationFields& fields) const;
+
+private:
+    enum class Field : std::uint8_t { Literal, Asset, Type, Title, User, Name, Days, Count };
+    struct Piece {
+        Field         field;
+        char          fill = ' ';
+        char          align = 0;            // '<', '>', '^' or 0 for the default
+        std::uint32_t width = 0;
+        std::uint32_t precision = UINT32_MAX;
+        std::uint32_t offset = 0, size = 0;   // Literal: span of _literals
+    };
+
+    std::string        _literals;
+    std::vector<Piece> _pieces;
+};
+
+// Everything the overdue digest renders for one channel: a line per
+// overdue loan, and a subject and header for the digest around them.
+struct OverdueTemplates {
+    NotificationTemplate subject{"Overdue Assets Summary"};
+    NotificationTemplate header{"You have {count} overdue assets:\n"};
+    NotificationTemplate line{"- OVERDUE: {asset} | {type} | {title} | borrowed {days} days ago by {name}\n"};
+};
+
+// Templates by channel (NotificationStrategy::channel()). A channel without
+// its own set uses "default"; the console listing uses "console".
+class NotificationTemplates {
+public:
+    NotificationTemplates();
+
+    void set(std::string channel, OverdueTemplates templates);
+    const OverdueTemplates& overdue(std::string_view channel) const;
+
+private:
+    std::map<std::string, OverdueTemplates, std::less<>> _overdue;
+};
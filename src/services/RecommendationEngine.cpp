@@ -0,0 +1,299 @@
+#include "RecommendationEngine.h"
+#include "../persistence/Query.h"
+#include "../util/Trace.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Issues in time order: closed loans from history plus the open ones.
+using IssuesAfter = query::Query<R"(
+    SELECT a.ext_id, u.ext_id, t.issue_date
+    FROM (SELECT asset_id, user_id, issue_date FROM loan_history WHERE issue_date > ?
+          UNION ALL
+          SELECT asset_id, user_id, issue_date FROM loans WHERE issue_date > ?) t
+    JOIN assets a ON a.id = t.asset_id JOIN users u ON u.id = t.user_id
+    ORDER BY t.issue_date;
+)", query::Row<std::string_view, std::string_view, time_t>, time_t, time_t>;
+
+const char magic[4] = {'L', 'M', 'R', 'C'};
+const unsigned char formatVersion = 1;
+
+void putVarint(std::string& out, std::uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void putString(std::string& out, const std::string& s) {
+    putVarint(out, s.size());
+    out += s;
+}
+
+// Bounds-checked cursor over a loaded file; throws on truncation.
+struct Reader {
+    const std::string& buf;
+    std::size_t        pos = 0;
+
+    std::uint64_t varint() {
+        std::uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= buf.size()) throw std::runtime_error("truncated");
+            auto byte = static_cast<unsigned char>(buf[pos++]);
+            v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return v;
+        }
+        throw std::runtime_error("bad varint");
+    }
+
+    std::string string() {
+        auto n = varint();
+        if (n > buf.size() - pos) throw std::runtime_error("truncated");
+        std::string s = buf.substr(pos, n);
+        pos += n;
+        return s;
+    }
+};
+
+}  // namespace
+
+RecommendationEngine::RecommendationEngine(std::size_t topK, std::size_t window)
+    : _topK(std::max<std::size_t>(topK, 1)), _window(std::max<std::size_t>(window, 1)) {}
+
+RecommendationEngine::Index RecommendationEngine::intern(const std::string& assetId) {
+    auto [it, added] = _index.try_emplace(assetId, static_cast<Index>(_ids.size()));
+    if (added) {
+        _ids.push_back(assetId);
+        _top.emplace_back();
+    }
+    return it->second;
+}
+
+// Counts only grow, so a partner enters the top list by passing its
+// smallest entry and then bubbles up.
+void RecommendationEngine::promote(Index from, Index to, std::uint32_t count) {
+    auto& top = _top[from];
+    auto it = std::find_if(top.begin(), top.end(), [&](auto& e) { return e.first == to; });
+    if (it != top.end()) {
+        it->second = count;
+    } else if (top.size() < _topK) {
+        top.emplace_back(to, count);
+        it = std::prev(top.end());
+    } else if (count > top.back().second) {
+        top.back() = {to, count};
+        it = std::prev(top.end());
+    } else {
+        return;
+    }
+    for (; it != top.begin() && std::prev(it)->second < it->second; --it) std::iter_swap(it, std::prev(it));
+}
+
+void RecommendationEngine::record(const std::string& assetId, const std::string& userId, time_t issuedAt) {
+    auto asset = intern(assetId);
+    auto& recent = _recent[userId];
+    _lastIssue = std::max(_lastIssue, issuedAt);
+    if (auto seen = std::find(recent.begin(), recent.end(), asset); seen != recent.end()) {
+        recent.erase(seen);
+        recent.push_back(asset);
+        return;
+    }
+    for (auto other : recent) {
+        auto count = _counts.increment(asset, other);
+        promote(asset, other, count);
+        promote(other, asset, count);
+    }
+    if (recent.size() == _window) recent.erase(recent.begin());
+    recent.push_back(asset);
+}
+
+void RecommendationEngine::recordIssue(const std::string& assetId, const std::string& userId, time_t issuedAt) {
+    TraceSpan span("RecommendationEngine::recordIssue", "service");
+    std::lock_guard<std::mutex> lock(_mutex);
+    record(assetId, userId, issuedAt);
+}
+
+std::vector<Recommendation> RecommendationEngine::recommend(const std::string& assetId, std::size_t k) const {
+    TraceSpan span("RecommendationEngine::recommend", "service");
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<Recommendation> out;
+    auto it = _index.find(assetId);
+    if (it == _index.end()) return out;
+    auto& top = _top[it->second];
+    auto n = std::min(k, top.size());
+    out.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) out.push_back({_ids[top[i].first], top[i].second});
+    return out;
+}
+
+void RecommendationEngine::clear() {
+    _index.clear();
+    _ids.clear();
+    _top.clear();
+    _counts.clear();
+    _recent.clear();
+    _lastIssue = 0;
+}
+
+std::size_t RecommendationEngine::replay(DatabaseManager& db, time_t after) {
+    std::size_t n = 0;
+    IssuesAfter::each(db, [&](std::string_view asset, std::string_view user, time_t issued) {
+        record(std::string(asset), std::string(user), issued);
+        ++n;
+    }, after, after);
+    return n;
+}
+
+void RecommendationEngine::rebuild(DatabaseManager& db) {
+    TraceSpan span("RecommendationEngine::rebuild", "service");
+    std::lock_guard<std::mutex> lock(_mutex);
+    clear();
+    replay(db, std::numeric_limits<time_t>::min());
+}
+
+std::size_t RecommendationEngine::catchUp(DatabaseManager& db) {
+    TraceSpan span("RecommendationEngine::catchUp", "service");
+    std::lock_guard<std::mutex> lock(_mutex);
+    return replay(db, _lastIssue);
+}
+
+bool RecommendationEngine::save(const std::string& path) const {
+    TraceSpan span("RecommendationEngine::save", "service");
+    std::string out(magic, sizeof magic);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        out.push_back(static_cast<char>(formatVersion));
+        putVarint(out, _topK);
+        putVarint(out, _window);
+        putVarint(out, static_cast<std::uint64_t>(_lastIssue));
+        putVarint(out, _ids.size());
+        for (auto& id : _ids) putString(out, id);
+        // Pairs as (low, high, count) in order: low as a delta from the
+        // previous low, high as a delta from the previous high under the
+        // same low, else from low.
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> pairs;
+        pairs.reserve(_counts.size());
+        _counts.forEach([&](Index low, Index high, std::uint32_t count) {
+            pairs.emplace_back(static_cast<std::uint64_t>(low) << 32 | high, count);
+        });
+        std::sort(pairs.begin(), pairs.end());
+        putVarint(out, pairs.size());
+        Index prevLow = 0, prevHigh = 0;
+        for (auto& [key, count] : pairs) {
+            auto low = static_cast<Index>(key >> 32), high = static_cast<Index>(key);
+            putVarint(out, low - prevLow);
+            putVarint(out, high - (low == prevLow ? prevHigh : low));
+            putVarint(out, count);
+            prevLow = low;
+            prevHigh = high;
+        }
+        for (auto& top : _top) {
+            putVarint(out, top.size());
+            for (auto& e : top) putVarint(out, e.first);
+        }
+        putVarint(out, _recent.size());
+        for (auto& [user, assets] : _recent) {
+            putString(out, user);
+            putVarint(out, assets.size());
+            for (auto a : assets) putVarint(out, a);
+        }
+    }
+
+    auto part = path + ".part";
+    {
+        std::ofstream f(part, std::ios::binary | std::ios::trunc);
+        if (!f.write(out.data(), static_cast<std::streamsize>(out.size()))) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(part, path, ec);
+    return !ec;
+}
+
+bool RecommendationEngine::load(const std::string& path) {
+    TraceSpan span("RecommendationEngine::load", "service");
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    std::string buf((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (buf.size() < sizeof magic + 1 || buf.compare(0, sizeof magic, magic, sizeof magic) != 0 ||
+        static_cast<unsigned char>(buf[sizeof magic]) != formatVersion)
+        return false;
+
+    try {
+        Reader in{buf, sizeof magic + 1};
+        if (in.varint() != _topK || in.varint() != _window) return false;
+        auto lastIssue = static_cast<time_t>(in.varint());
+        auto titles = in.varint();
+        if (titles > buf.size()) return false;
+
+        std::unordered_map<std::string, Index> index;
+        std::vector<std::string> ids;
+        ids.reserve(titles);
+        for (std::uint64_t i = 0; i < titles; ++i) {
+            ids.push_back(in.string());
+            index.emplace(ids.back(), static_cast<Index>(i));
+        }
+        auto checked = [&](std::uint64_t i) {
+            if (i >= titles) throw std::runtime_error("bad index");
+            return static_cast<Index>(i);
+        };
+        PairCounter counts;
+        auto pairs = in.varint();
+        if (pairs > buf.size()) return false;
+        counts.reserve(pairs);
+        std::uint64_t low = 0, high = 0;
+        for (std::uint64_t i = 0; i < pairs; ++i) {
+            auto lowDelta = in.varint();
+            low += lowDelta;
+            high = (lowDelta ? low : high) + in.varint();
+            auto count = static_cast<std::uint32_t>(in.varint());
+            if (high <= low || !count) throw std::runtime_error("bad pair");
+            counts.set(checked(low), checked(high), count);
+        }
+        std::vector<TopList> tops(titles);
+        for (std::size_t t = 0; t < tops.size(); ++t) {
+            auto n = in.varint();
+            for (std::uint64_t i = 0; i < n; ++i) {
+                auto other = checked(in.varint());
+                tops[t].emplace_back(other, counts.get(static_cast<Index>(t), other));
+            }
+        }
+        std::unordered_map<std::string, std::vector<Index>> recent;
+        auto users = in.varint();
+        for (std::uint64_t u = 0; u < users; ++u) {
+            auto& assets = recent[in.string()];
+            auto n = in.varint();
+            for (std::uint64_t i = 0; i < n; ++i) assets.push_back(checked(in.varint()));
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _index = std::move(index);
+        _ids = std::move(ids);
+        _top = std::move(tops);
+        _counts = std::move(counts);
+        _recent = std::move(recent);
+        _lastIssue = lastIssue;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+std::size_t RecommendationEngine::titles() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _ids.size();
+}
+
+std::size_t RecommendationEngine::pairs() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _counts.size();
+}
+
+time_t RecommendationEngine::lastIssue() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _lastIssue;
+}
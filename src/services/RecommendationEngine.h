@@ -0,0 +1,72 @@
+#pragma once
+#include "../persistence/DatabaseManager.h"
+#include "../util/PairCounter.h"
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct Recommendation {
+    std::string   assetId;
+    std::uint32_t count;   // readers who borrowed both
+};
+
+// "Readers who borrowed this also borrowed". Keeps a sparse co-borrow
+// count for every pair of titles (PairCounter, one entry per pair) and,
+// per title, its `topK` most frequent partners in order, so recommend()
+// is a short copy.
+//
+// Each issue pairs the title with the borrower's last `window` distinct
+// titles, bumping each pair's count and the two top-K lists: at most
+// window * topK steps, however large the catalogue. Re-borrowing a title
+// already in the window only refreshes it.
+//
+// State is saved to a compact binary file (varints, pairs delta-coded in
+// order) with the time of the last issue it has seen; catchUp() replays
+// later issues from the database after load(). Thread-safe.
+class RecommendationEngine {
+public:
+    explicit RecommendationEngine(std::size_t topK = 10, std::size_t window = 20);
+
+    void recordIssue(const std::string& assetId, const std::string& userId, time_t issuedAt);
+    // Up to min(k, topK) titles, most co-borrowed first.
+    std::vector<Recommendation> recommend(const std::string& assetId, std::size_t k = 5) const;
+
+    // Replaces the state with every issue on record, oldest first.
+    void rebuild(DatabaseManager& db);
+    // Replays issues after the last one seen; returns how many.
+    std::size_t catchUp(DatabaseManager& db);
+
+    // Written to path.part, then renamed. load() leaves the state untouched
+    // and returns false if the file is missing or not ours.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    std::size_t titles() const;
+    std::size_t pairs() const;   // distinct co-borrowed pairs
+    time_t lastIssue() const;
+
+private:
+    using Index   = std::uint32_t;
+    using TopList = std::vector<std::pair<Index, std::uint32_t>>;   // count desc
+
+    std::size_t _topK;
+    std::size_t _window;
+
+    mutable std::mutex                     _mutex;
+    std::unordered_map<std::string, Index> _index;   // asset ID -> slot in _ids/_top
+    std::vector<std::string>               _ids;
+    std::vector<TopList>                   _top;
+    PairCounter                            _counts;
+    std::unordered_map<std::string, std::vector<Index>> _recent;   // per user, oldest first
+    time_t                                 _lastIssue = 0;
+
+    Index intern(const std::string& assetId);
+    void promote(Index from, Index to, std::uint32_t count);
+    void record(const std::string& assetId, const std::string& userId, time_t issuedAt);
+    std::size_t replay(DatabaseManager& db, time_t after);
+    void clear();
+};
@@ -0,0 +1,83 @@
+#include "ReportService.h"
+#include "../persistence/Query.h"
+#include "../util/Trace.h"
+
+namespace {
+
+using TypeStats = query::Query<R"(
+    SELECT type, copies, on_loan, borrows, returns, seconds_out FROM type_stats ORDER BY type;
+)", query::Row<int, int, int, long, long, long>>;
+
+using TopTitles = query::Query<R"(
+    SELECT a.ext_id, a.title, s.borrows, s.seconds_out
+    FROM asset_stats s JOIN assets a ON a.id = s.asset_id
+    ORDER BY s.borrows DESC
+    LIMIT ?;
+)", query::Row<std::string, std::string, long, long>, int>;
+
+using TitleStats = query::Query<R"(
+    SELECT a.ext_id, a.title, coalesce(s.borrows, 0), coalesce(s.seconds_out, 0)
+    FROM assets a LEFT JOIN asset_stats s ON s.asset_id = a.id
+    WHERE a.ext_id = ?;
+)", query::Row<std::string, std::string, long, long>, std::string_view>;
+
+using DailyStats = query::Query<R"(
+    SELECT day, issued, returned FROM daily_stats WHERE day BETWEEN ? AND ? ORDER BY day;
+)", query::Row<time_t, int, int>, time_t, time_t>;
+
+using UserHistory = query::Query<R"(
+    SELECT a.ext_id, a.title, h.issue_date, h.return_date
+    FROM loan_history h JOIN assets a ON a.id = h.asset_id
+    WHERE h.user_id = (SELECT id FROM users WHERE ext_id = ?)
+    ORDER BY h.return_date DESC
+    LIMIT ?;
+)", query::Row<std::string, std::string, time_t, time_t>, std::string_view, int>;
+
+const time_t secondsPerDay = 24 * 60 * 60;
+
+}  // namespace
+
+ReportService::ReportService(std::shared_ptr<DatabaseManager> db, std::shared_ptr<Clock> clock)
+    : _db(std::move(db)), _clock(std::move(clock)) {}
+
+LoanReport ReportService::report(int topN, int days) {
+    TraceSpan span("ReportService::report", "service");
+    return {byType(), topTitles(topN), daily(days)};
+}
+
+std::vector<TypeUsage> ReportService::byType() {
+    std::vector<TypeUsage> out;
+    TypeStats::each(*_db, [&](int type, int copies, int onLoan, long borrows, long returns, long secondsOut) {
+        out.push_back({codeToAssetType(type), copies, onLoan, borrows, returns, secondsOut});
+    });
+    return out;
+}
+
+std::vector<TitleUsage> ReportService::topTitles(int limit) {
+    return TopTitles::allAs<TitleUsage>(*_db, limit);
+}
+
+std::optional<TitleUsage> ReportService::title(const std::string& assetId) {
+    return TitleStats::oneAs<TitleUsage>(*_db, assetId);
+}
+
+std::vector<DayCount> ReportService::daily(int days) {
+    time_t today = _clock->now() / secondsPerDay;
+    time_t first = today - days + 1;
+    // Days without activity have no row; fill them in.
+    std::vector<DayCount> out;
+    out.reserve(days > 0 ? days : 0);
+    time_t next = first;
+    DailyStats::each(*_db, [&](time_t day, int issued, int returned) {
+        for (; next < day; ++next) out.push_back({next * secondsPerDay, 0, 0});
+        out.push_back({day * secondsPerDay, issued, returned});
+        next = day + 1;
+    }, first, today);
+    for (; next <= today; ++next) out.push_back({next * secondsPerDay, 0, 0});
+    return out;
+}
+
+std::vector<LoanRecord> ReportService::history(const std::string& userId, int limit) {
+    TraceSpan span("ReportService::history", "service");
+    return UserHistory::allAs<LoanRecord>(*_db, userId, limit);
+}
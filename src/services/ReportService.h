@@ -0,0 +1,70 @@
+#pragma once
+#include "../models/Asset.h"
+#include "../persistence/DatabaseManager.h"
+#include "../util/Clock.h"
+#include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct TypeUsage {
+    AssetType type;
+    int       copies;
+    int       onLoan;
+    long      borrows;
+    long      returns;
+    long      secondsOut;   // summed over completed loans
+
+    double utilization() const { return copies ? static_cast<double>(onLoan) / copies : 0; }
+    double avgDaysOut() const { return returns ? secondsOut / 86400.0 / returns : 0; }
+};
+
+struct TitleUsage {
+    std::string assetId;
+    std::string title;
+    long        borrows;
+    long        secondsOut;
+
+    double daysOut() const { return secondsOut / 86400.0; }
+};
+
+struct DayCount {
+    time_t day;   // start of the UTC day
+    int    issued;
+    int    returned;
+};
+
+struct LoanRecord {
+    std::string assetId;
+    std::string title;
+    time_t      issueDate;
+    time_t      returnDate;
+};
+
+struct LoanReport {
+    std::vector<TypeUsage>  types;
+    std::vector<TitleUsage> topTitles;
+    std::vector<DayCount>   days;   // oldest first, one entry per day
+};
+
+// Reads the loan aggregates kept by AssetRepository and LoanService. Each
+// query touches a fixed handful of rows (types, the requested days, the
+// top of the borrows index), however long the history grows.
+class ReportService {
+public:
+    explicit ReportService(std::shared_ptr<DatabaseManager> db, std::shared_ptr<Clock> clock = systemClock());
+
+    LoanReport report(int topTitles = 5, int days = 7);
+
+    std::vector<TypeUsage>    byType();
+    std::vector<TitleUsage>   topTitles(int limit);
+    std::optional<TitleUsage> title(const std::string& assetId);
+    std::vector<DayCount>     daily(int days);
+    // A borrower's completed loans, newest first.
+    std::vector<LoanRecord>   history(const std::string& userId, int limit = 20);
+
+private:
+    std::shared_ptr<DatabaseManager> _db;
+    std::shared_ptr<Clock>           _clock;
+};
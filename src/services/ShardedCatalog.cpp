@@ -0,0 +1,147 @@
+#include "ShardedCatalog.h"
+#include "../util/KWayMerge.h"
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+// Pages through one branch's assets in id order, fetching the next page
+// on the pool while the current one is being merged.
+class AssetPageSource {
+public:
+    AssetPageSource(AssetRepository& repo, ThreadPool& pool, int pageSize)
+        : _repo(&repo), _pool(&pool), _pageSize(pageSize) {
+        _next = fetch("");
+        advancePage();
+    }
+
+    const Asset* peek() const { return _pos < _page.size() ? &_page[_pos] : nullptr; }
+
+    void pop() {
+        if (++_pos == _page.size() && _next.valid()) advancePage();
+    }
+
+private:
+    AssetRepository*                 _repo;
+    ThreadPool*                      _pool;
+    int                              _pageSize;
+    std::pmr::vector<Asset>               _page;
+    std::size_t                           _pos = 0;
+    std::future<std::pmr::vector<Asset>>  _next;
+
+    // Pages are built on the pool thread, so in the default resource.
+    std::future<std::pmr::vector<Asset>> fetch(std::string afterId) {
+        return _pool->submit([repo = _repo, afterId = std::move(afterId), n = _pageSize] {
+            return repo->page(afterId, n);
+        });
+    }
+
+    void advancePage() {
+        _page = _next.get();
+        _pos = 0;
+        if (static_cast<int>(_page.size()) == _pageSize) _next = fetch(std::string(_page.back().id()));
+    }
+};
+
+}  // namespace
+
+ShardedCatalog::ShardedCatalog(const std::vector<std::string>& paths, DurabilityProfile profile,
+                               std::shared_ptr<Clock> clock)
+    : _pool(paths.size()) {
+    if (paths.empty()) throw std::runtime_error("ShardedCatalog needs at least one branch");
+    for (auto& path : paths) {
+        Branch b;
+        b.path   = path;
+        b.db     = std::make_shared<DatabaseManager>(path, profile);
+        b.db->initializeSchema();
+        b.assets = std::make_shared<AssetRepository>(b.db);
+        b.users  = std::make_shared<UserRepository>(b.db);
+        b.loans  = std::make_shared<LoanService>(b.assets, b.users, clock);
+        _branches.push_back(std::move(b));
+    }
+}
+
+std::size_t ShardedCatalog::shardFor(std::string_view id) const {
+    // FNV-1a: unlike std::hash, stable across builds and platforms.
+    std::uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : id) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return static_cast<std::size_t>(h % _branches.size());
+}
+
+void ShardedCatalog::addAsset(const Asset& asset) {
+    branchFor(asset.id()).assets->add(asset);
+}
+
+void ShardedCatalog::addUser(const User& user) {
+    for (auto& b : _branches) b.users->add(user);
+}
+
+std::optional<Asset> ShardedCatalog::findAsset(const std::string& id) {
+    return branchFor(id).assets->find(id);
+}
+
+std::optional<User> ShardedCatalog::findUser(const std::string& id) {
+    return branchFor(id).users->find(id);
+}
+
+bool ShardedCatalog::issueAsset(const std::string& assetId, const std::string& userId) {
+    return branchFor(assetId).loans->issueAsset(assetId, userId);
+}
+
+bool ShardedCatalog::returnAsset(const std::string& assetId, const std::string& userId) {
+    return branchFor(assetId).loans->returnAsset(assetId, userId);
+}
+
+std::vector<RankedAsset> ShardedCatalog::search(const std::string& query, int limit, int offset) {
+    std::vector<RankedAsset> out;
+    if (limit <= 0) return out;
+    // Any branch could hold every one of the top offset + limit hits.
+    auto perBranch = fanOut([&](Branch& b) { return b.assets->searchRanked(query, offset + limit); });
+
+    std::vector<VectorSource<RankedAsset, std::pmr::polymorphic_allocator<RankedAsset>>> sources;
+    for (auto& hits : perBranch) sources.emplace_back(std::move(hits));
+    int seen = 0;
+    kWayMerge(sources,
+              [](const RankedAsset& a, const RankedAsset& b) { return a.rank < b.rank; },
+              [&](const RankedAsset& hit, std::size_t) {
+                  if (seen++ >= offset) out.push_back(hit);
+                  return static_cast<int>(out.size()) < limit;
+              });
+    return out;
+}
+
+int ShardedCatalog::countOverdue() {
+    int total = 0;
+    for (int n : fanOut([&](Branch& b) { return b.loans->countOverdue(); })) total += n;
+    return total;
+}
+
+std::vector<OverdueLoan> ShardedCatalog::overdueLoans() {
+    auto perBranch = fanOut([&](Branch& b) { return b.loans->overdueLoans(); });
+
+    std::vector<VectorSource<OverdueLoan>> sources;
+    std::size_t total = 0;
+    for (auto& loans : perBranch) {
+        total += loans.size();
+        sources.emplace_back(std::move(loans));
+    }
+    std::vector<OverdueLoan> out;
+    out.reserve(total);
+    kWayMerge(sources,
+              [](const OverdueLoan& a, const OverdueLoan& b) {
+                  return a.issueDate != b.issueDate ? a.issueDate < b.issueDate : a.assetId < b.assetId;
+              },
+              [&](const OverdueLoan& loan, std::size_t) { out.push_back(loan); return true; });
+    return out;
+}
+
+void ShardedCatalog::forEachAsset(const std::function<bool(const Asset&)>& fn, int pageSize) {
+    std::vector<AssetPageSource> sources;
+    for (auto& b : _branches) sources.emplace_back(*b.assets, _pool, pageSize > 0 ? pageSize : 1);
+    kWayMerge(sources,
+              [](const Asset& a, const Asset& b) { return a.id() < b.id(); },
+              [&](const Asset& a, std::size_t) { return fn(a); });
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "LoanService.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../util/Clock.h"
+#include "../util/ThreadPool.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One branch's database and the services over it.
+struct Branch {
+    std::string                      path;
+    std::shared_ptr<DatabaseManager> db;
+    std::shared_ptr<AssetRepository> assets;
+    std::shared_ptr<UserRepository>  users;
+    std::shared_ptr<LoanService>     loans;
+};
+
+// Catalog spread over several branch databases. Asset IDs are routed to a
+// branch by a stable hash, so the branch list must keep its order (and
+// size) once data has been written. Users are stored on every branch, so
+// whichever branch holds an asset can lend it to any of them.
+//
+// Cross-branch queries run on every branch at once on a thread pool and
+// are merged in order as results arrive, so they take about as long as
+// the slowest branch rather than the sum of all of them.
+class ShardedCatalog {
+public:
+    explicit ShardedCatalog(const std::vector<std::string>& paths,
+                            DurabilityProfile profile = DurabilityProfile::Default,
+                            std::shared_ptr<Clock> clock = systemClock());
+
+    std::size_t shardCount() const { return _branches.size(); }
+    std::size_t shardFor(std::string_view id) const;
+    Branch&     shard(std::size_t i) { return _branches[i]; }
+    Branch&     branchFor(std::string_view id) { return _branches[shardFor(id)]; }
+
+    void addAsset(const Asset& asset);
+    void addUser(const User& user);
+    std::optional<Asset> findAsset(const std::string& id);
+    std::optional<User>  findUser(const std::string& id);
+
+    // On the asset's branch.
+    bool issueAsset(const std::string& assetId, const std::string& userId);
+    bool returnAsset(const std::string& assetId, const std::string& userId = "");
+
+    // Best-ranked matches across all branches. Ranks come from each
+    // branch's own index, so they are comparable but not identical to a
+    // single combined index.
+    std::vector<RankedAsset> search(const std::string& query, int limit = 20, int offset = 0);
+
+    int countOverdue();
+    std::vector<OverdueLoan> overdueLoans();   // oldest first
+
+    // Streams every asset in id order, paging through each branch; stop
+    // early by returning false.
+    void forEachAsset(const std::function<bool(const Asset&)>& fn, int pageSize = 512);
+
+private:
+    std::vector<Branch> _branches;
+    ThreadPool          _pool;   // declared last: drains before branches close
+
+    // Runs fn on every branch in parallel; results in branch order.
+    template <typename F>
+    auto fanOut(F fn) -> std::vector<std::invoke_result_t<F&, Branch&>> {
+        std::vector<std::future<std::invoke_result_t<F&, Branch&>>> pending;
+        for (auto& b : _branches)
+            pending.push_back(_pool.submit([&fn, &b] { return fn(b); }));
+        for (auto& p : pending) p.wait();   // fn must outlive every task, even on error
+        std::vector<std::invoke_result_t<F&, Branch&>> out;
+        for (auto& p : pending) out.push_back(p.get());
+        return out;
+    }
+};
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include "../persistence/ArchiveManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/HoldService.h"
+#include "../services/LoanService.h"
+#include "../services/ReportService.h"
+
+#include <functional>
+#include <utility>
+
+static long scalar(DatabaseManager& db, const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db.get(), sql, -1, &stmt, nullptr);
+    long v = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return v;
+}
+
+namespace {
+
+const time_t day = 24 * 60 * 60;
+
+struct Library {
+    std::shared_ptr<ManualClock>      clock = std::make_shared<ManualClock>(1'700'000'000);
+    std::shared_ptr<DatabaseManager>  db = std::make_shared<DatabaseManager>(":memory:");
+    std::shared_ptr<AssetRepository>  assets;
+    std::shared_ptr<UserRepository>   users;
+    std::unique_ptr<LoanService>      loans;
+    std::unique_ptr<ArchiveManager>   archive;
+
+    explicit Library(ArchiveOptions options = {}) {
+        db->initializeSchema();
+        assets = std::make_shared<AssetRepository>(db);
+        users = std::make_shared<UserRepository>(db);
+        loans = std::make_unique<LoanService>(assets, users, clock);
+        options.path = ":memory:";
+        archive = std::make_unique<ArchiveManager>(db, options, clock);
+        users->add({"U1", "Alice", Role::User, "x"});
+        users->add({"U2", "Bob", Role::User, "x"});
+    }
+};
+
+}  // namespace
+
+TEST(ArchiveManagerTest, RetiredTitleMovesWithItsHistoryAndStaysSearchable) {
+    Library lib;
+    lib.assets->add({"B1", AssetType::Book, "Dune", "Herbert", 2, 2});
+    lib.assets->add({"B2", AssetType::Book, "Dune Messiah", "Herbert"});
+    ASSERT_TRUE(lib.loans->issueAsset("B1", "U1"));
+    lib.clock->advanceDays(2);
+    ASSERT_TRUE(lib.loans->returnAsset("B1", "U1"));
+
+    ASSERT_TRUE(lib.archive->retire("B1"));
+    EXPECT_FALSE(lib.archive->retire("B1"));
+    EXPECT_EQ(lib.assets->available("B1"), 0);
+    EXPECT_EQ(scalar(*lib.db, "SELECT copies FROM type_stats WHERE type = 1;"), 1);
+
+    auto s = lib.archive->archiveNow().get();
+    EXPECT_EQ(s.assets, 1u);
+    EXPECT_EQ(s.loanRecords, 1u);
+    EXPECT_EQ(lib.archive->retiredPending(), 0u);
+    EXPECT_FALSE(lib.assets->find("B1"));
+    EXPECT_EQ(lib.assets->getAll().size(), 1u);
+    EXPECT_EQ(scalar(*lib.db, "SELECT count(*) FROM loan_history;"), 0);
+    EXPECT_EQ(scalar(*lib.db, "SELECT count(*) FROM asset_stats;"), 0);
+    EXPECT_EQ(scalar(*lib.db, "SELECT borrows FROM archive.assets WHERE ext_id = 'B1';"), 1);
+    EXPECT_EQ(scalar(*lib.db, "SELECT seconds_out FROM archive.assets WHERE ext_id = 'B1';"), 2 * day);
+
+    auto hot = lib.assets->searchRanked("dune");
+    ASSERT_EQ(hot.size(), 1u);
+    EXPECT_EQ(hot[0].asset.id(), "B2");
+
+    auto all = lib.assets->searchRanked("dune", 20, 0, true);
+    ASSERT_EQ(all.size(), 2u);
+    auto archived = all[0].archived ? all[0] : all[1];
+    EXPECT_TRUE(archived.archived);
+    EXPECT_EQ(archived.asset.id(), "B1");
+    EXPECT_EQ(archived.asset.copies(), 2);
+    EXPECT_EQ(archived.asset.available(), 0);
+
+    // The ID is free again once the title has moved.
+    lib.assets->add({"B1", AssetType::Book, "Emma", "Austen"});
+    EXPECT_EQ(lib.assets->find("B1")->title(), "Emma");
+}
+
+TEST(ArchiveManagerTest, TitlesOnLoanOrOnHoldCannotBeRetired) {
+    Library lib;
+    auto holds = std::make_shared<HoldService>(lib.assets, lib.users);
+    lib.loans = std::make_unique<LoanService>(lib.assets, lib.users, lib.clock, holds);
+    lib.assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    ASSERT_TRUE(lib.loans->issueAsset("B1", "U1"));
+    ASSERT_TRUE(holds->placeHold("B1", "U2"));
+
+    EXPECT_FALSE(lib.archive->retire("B1"));   // on loan
+    ASSERT_TRUE(lib.loans->returnAsset("B1", "U1"));
+    EXPECT_FALSE(lib.archive->retire("B1"));   // set aside for U2
+    EXPECT_FALSE(lib.archive->retire("nope"));
+    EXPECT_EQ(lib.archive->retiredPending(), 0u);
+
+    ASSERT_TRUE(holds->cancelHold("B1", "U2"));
+    EXPECT_TRUE(lib.archive->retire("B1"));
+    EXPECT_EQ(lib.archive->retiredPending(), 1u);
+
+    // Nothing will come back to fill a hold on it.
+    auto* out = std::cout.rdbuf(nullptr);
+    EXPECT_FALSE(holds->placeHold("B1", "U2"));
+    std::cout.rdbuf(out);
+    EXPECT_EQ(holds->queueLength("B1"), 0u);
+    EXPECT_EQ(scalar(*lib.db, "SELECT count(*) FROM holds;"), 0);
+}
+
+TEST(ArchiveManagerTest, AgedHistoryMovesInBatches) {
+    ArchiveOptions options;
+    options.batchRows = 3;
+    options.historyAge = 30 * day;
+    Library lib(options);
+    ReportService reports(lib.db, lib.clock);
+    lib.assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(lib.loans->issueAsset("B1", "U1"));
+        lib.clock->advanceDays(7);
+        ASSERT_TRUE(lib.loans->returnAsset("B1", "U1"));
+    }
+    // Returns landed 0..63 days ago; five are past the 30-day cut.
+    auto s = lib.archive->archiveNow().get();
+    EXPECT_EQ(s.loanRecords, 5u);
+    EXPECT_EQ(s.batches, 2u);
+    EXPECT_EQ(reports.history("U1").size(), 5u);
+    EXPECT_EQ(scalar(*lib.db, "SELECT count(*) FROM archive.loan_history WHERE asset_ext_id = 'B1';"), 5);
+
+    // Nothing left to move.
+    EXPECT_EQ(lib.archive->archiveNow().get().loanRecords, 0u);
+}
+
+TEST(ArchiveManagerTest, InterruptedMoveIsFinishedWithoutDuplicates) {
+    Library lib;
+    lib.assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    ASSERT_TRUE(lib.archive->retire("B1"));
+    // As if a pass died after its copy committed but before the delete.
+    sqlite3_exec(lib.db->get(), R"(
+        INSERT INTO archive.assets
+            (ext_id, type, title, author_or_owner, copies, retired_at, archived_at)
+        SELECT a.ext_id, a.type, a.title, a.author_or_owner, r.copies, r.retired_at, 0
+        FROM retired_assets r JOIN assets a ON a.id = r.asset_id;
+    )", nullptr, nullptr, nullptr);
+
+    EXPECT_EQ(lib.archive->archiveNow().get().assets, 1u);
+    EXPECT_EQ(scalar(*lib.db, "SELECT count(*) FROM archive.assets;"), 1);
+    EXPECT_EQ(lib.assets->searchRanked("dune", 20, 0, true).size(), 1u);
+}
+
+namespace {
+
+// Runs `hook` once, after the transaction that next asks for the time.
+struct HookClock : ManualClock {
+    std::shared_ptr<DatabaseManager> db;
+    mutable std::function<void()>    hook;
+
+    HookClock(std::shared_ptr<DatabaseManager> d) : ManualClock(1'700'000'000), db(std::move(d)) {}
+    std::time_t now() const override {
+        if (hook) db->afterCommit(std::exchange(hook, nullptr));
+        return ManualClock::now();
+    }
+};
+
+}  // namespace
+
+TEST(ArchiveManagerTest, TitleRetiredBetweenCopyAndDeleteIsNotLost) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto clock = std::make_shared<HookClock>(db);
+    AssetRepository assets(db);
+    ArchiveManager archive(db, {.path = ":memory:"}, clock);
+    assets.add({"B1", AssetType::Book, "Dune", "Herbert"});
+    assets.add({"B2", AssetType::Book, "Emma", "Austen"});
+    ASSERT_TRUE(archive.retire("B2"));
+
+    // B1 is retired once B2's copy commits; its key is inside that batch.
+    clock->hook = [&] { EXPECT_TRUE(archive.retire("B1")); };
+    auto s = archive.archiveNow().get();
+    EXPECT_EQ(s.assets, 2u);
+    EXPECT_EQ(archive.retiredPending(), 0u);
+    EXPECT_EQ(scalar(*db, "SELECT count(*) FROM archive.assets;"), 2);
+    EXPECT_EQ(scalar(*db, "SELECT count(*) FROM assets;"), 0);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../util/Arena.h"
+
+#include <iostream>
+
+namespace {
+
+// Counts what reaches it; stands in for the default resource so a test can
+// tell whether anything bypassed the arena.
+struct CountingResource : std::pmr::memory_resource {
+    int allocations = 0;
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+struct DefaultResource {
+    CountingResource           counting;
+    std::pmr::memory_resource* previous = std::pmr::set_default_resource(&counting);
+    ~DefaultResource() { std::pmr::set_default_resource(previous); }
+};
+
+}  // namespace
+
+TEST(ArenaTest, ScopesNestPerThread) {
+    EXPECT_EQ(CommandArena::current(), std::pmr::get_default_resource());
+    {
+        CommandArena outer;
+        EXPECT_EQ(CommandArena::current(), outer.resource());
+        {
+            CommandArena inner;
+            EXPECT_EQ(CommandArena::current(), inner.resource());
+        }
+        EXPECT_EQ(CommandArena::current(), outer.resource());
+    }
+    EXPECT_EQ(CommandArena::current(), std::pmr::get_default_resource());
+}
+
+TEST(ArenaTest, RepositoryResultsLiveInTheCommandArena) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users = std::make_shared<UserRepository>(db);
+    LoanService loans(assets, users, std::make_shared<ManualClock>(1'700'000'000));
+    // Longer than the small-string buffer, so every field allocates.
+    for (int i = 0; i < 50; ++i)
+        assets->add({"B" + std::to_string(i), AssetType::Book, "A title long enough to allocate " + std::to_string(i),
+                     "An author long enough to allocate", 2, 2});
+    users->add({"reader-with-a-long-identifier", "A reader with a long name", Role::User, "hash"});
+    auto* out = std::cout.rdbuf(nullptr);
+    loans.issueAsset("B7", "reader-with-a-long-identifier");
+    std::cout.rdbuf(out);
+
+    DefaultResource heap;
+    std::optional<Asset> kept;
+    {
+        CommandArena arena(std::pmr::new_delete_resource());
+        auto all = assets->getAll();
+        ASSERT_EQ(all.size(), 50u);
+        EXPECT_EQ(all.get_allocator().resource(), arena.resource());
+        EXPECT_EQ(all[3].get_allocator().resource(), arena.resource());
+
+        auto page = assets->page("B1", 5);
+        auto hits = assets->searchRanked("title", 10);
+        auto found = assets->find("B7");
+        auto user = users->find("reader-with-a-long-identifier");
+        auto loan = loans.loanInfo("B7");
+        ASSERT_TRUE(found && user && loan);
+        EXPECT_EQ(found->get_allocator().resource(), arena.resource());
+        EXPECT_EQ(user->get_allocator().resource(), arena.resource());
+        EXPECT_EQ(loan->userId.get_allocator().resource(), arena.resource());
+        EXPECT_EQ(loan->userId, "reader-with-a-long-identifier");
+        EXPECT_EQ(heap.counting.allocations, 0);
+
+        // A copy leaves the arena and survives it.
+        kept = *found;
+        EXPECT_EQ(kept->get_allocator().resource(), &heap.counting);
+    }
+    EXPECT_EQ(kept->title(), "A title long enough to allocate 7");
+
+    // Without an arena, results come from the default resource as before.
+    int before = heap.counting.allocations;
+    auto all = assets->getAll();
+    EXPECT_EQ(all.get_allocator().resource(), &heap.counting);
+    EXPECT_GT(heap.counting.allocations, before + 50);
+}
+
+TEST(ArenaTest, ExplicitResourceOverridesTheScope) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    AssetRepository assets(db);
+    assets.add({"L1", AssetType::Laptop, "XPS 13", "Dell"});
+
+    CommandArena arena;
+    std::pmr::monotonic_buffer_resource mine;
+    auto all = assets.getAll(&mine);
+    EXPECT_EQ(all.get_allocator().resource(), &mine);
+    auto one = assets.find("L1", std::pmr::get_default_resource());
+    ASSERT_TRUE(one);
+    EXPECT_EQ(one->get_allocator().resource(), std::pmr::get_default_resource());
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "../models/AssetTypes.h"
+#include "../persistence/ArchiveManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/FinesJob.h"
+#include "../services/LoanService.h"
+#include "../services/NotificationService.h"
+#include "../util/EventBus.h"
+
+static const time_t day = 24 * 60 * 60;
+
+TEST(AssetTypeTest, EveryRegisteredNameAndCodeRoundTrips) {
+    for (auto& t : assetTypes) {
+        EXPECT_EQ(stringToAssetType(t.name), t.type) << t.name;
+        EXPECT_EQ(stringToAssetType(assetTypeToString(t.type)), t.type);
+        EXPECT_EQ(codeToAssetType(assetTypeToCode(t.type)), t.type);
+    }
+    EXPECT_EQ(assetTypeToCode(AssetType::Book), 1);   // stored; must not move
+    EXPECT_EQ(assetTypeToCode(AssetType::Laptop), 2);
+
+    for (auto name : {"", "Book", "books", "lap", "tablets", "projector "})
+        EXPECT_EQ(stringToAssetType(name), AssetType::Unknown) << name;
+    EXPECT_EQ(codeToAssetType(-1), AssetType::Unknown);
+    EXPECT_EQ(codeToAssetType(static_cast<int>(assetTypes.size())), AssetType::Unknown);
+    EXPECT_EQ(assetTypeToString(static_cast<AssetType>(200)), "unknown");
+}
+
+TEST(AssetTypeTest, AttributesAreStoredWithTheAssetAndLeaveWithIt) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    AssetRepository assets(db);
+    assets.add({"L1", AssetType::Laptop, "XPS", "Dell"}, {{"Serial", "SN-42"}, {"Charger", "USB-C"}});
+    assets.add({"L2", AssetType::Laptop, "X1", "Lenovo"});
+
+    auto attrs = assets.attributes("L1");
+    ASSERT_EQ(attrs.size(), 2u);
+    EXPECT_EQ(attrs[0], (AssetAttributes::value_type{"Charger", "USB-C"}));
+    EXPECT_EQ(attrs[1], (AssetAttributes::value_type{"Serial", "SN-42"}));
+    EXPECT_TRUE(assets.attributes("L2").empty());
+
+    // A duplicate ID adds nothing, attributes included.
+    assets.add({"L1", AssetType::Laptop, "Other", "Other"}, {{"Serial", "SN-99"}});
+    EXPECT_EQ(assets.attributes("L1")[1].second, "SN-42");
+
+    ArchiveOptions options;
+    options.path = ":memory:";
+    ArchiveManager archive(db, options);
+    ASSERT_TRUE(archive.retire("L1"));
+    archive.archiveNow().get();
+    EXPECT_TRUE(assets.attributes("L1").empty());
+}
+
+TEST(AssetTypeTest, LoanPeriodAndFinesFollowTheType) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto bus    = std::make_shared<EventBus>();
+    auto assets = std::make_shared<AssetRepository>(db, bus);
+    auto users  = std::make_shared<UserRepository>(db, bus);
+    auto clock  = std::make_shared<ManualClock>(1'700'000'000);
+    LoanService loans(assets, users, clock);
+    NotificationService mirrored(assets, users, {}, clock);
+    NotificationService scanning(std::make_shared<AssetRepository>(db), users, {}, clock);
+
+    const auto& projector = assetTypeInfo(AssetType::Projector).loan;
+    ASSERT_LT(projector.loanDays, assetTypeInfo(AssetType::Book).loan.loanDays);
+    assets->add({"P1", AssetType::Projector, "EX3280", "Epson"});
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    users->add({"U1", "Alice", Role::User, "x"});
+    time_t issued = clock->now();
+    ASSERT_TRUE(loans.issueAsset("P1", "U1"));
+    ASSERT_TRUE(loans.issueAsset("B1", "U1"));
+    bus->flush();
+
+    clock->advanceDays(projector.loanDays);
+    EXPECT_EQ(mirrored.countOverdue(), 0);
+    EXPECT_EQ(scanning.countOverdue(), 0);
+    EXPECT_EQ(loans.countOverdue(), 0);
+    clock->advance(1);
+    EXPECT_EQ(mirrored.countOverdue(), 1);
+    EXPECT_EQ(scanning.countOverdue(), 1);
+    EXPECT_EQ(loans.countOverdue(), 1);
+    auto overdue = loans.overdueLoans();   // the book is not due yet
+    ASSERT_EQ(overdue.size(), 1u);
+    EXPECT_EQ(overdue[0].assetId, "P1");
+
+    FinePolicy policy;
+    time_t late = issued + (projector.loanDays + projector.graceDays + 2) * day;
+    EXPECT_EQ(policy.daysOverdue(AssetType::Projector, issued, late), projector.graceDays + 2);
+    EXPECT_EQ(policy.owed(AssetType::Projector, issued, late), 2 * projector.centsPerDay);
+    EXPECT_EQ(policy.owed(AssetType::Book, issued, late), 0);
+    EXPECT_EQ(policy.owed(AssetType::Unknown, issued, late + 365 * day), 0);
+
+    ASSERT_TRUE(loans.returnAsset("P1", "U1"));
+    bus->flush();
+    EXPECT_EQ(mirrored.countOverdue(), 0);
+}
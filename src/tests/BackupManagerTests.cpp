@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "../persistence/AssetRepository.h"
+#include "../persistence/BackupManager.h"
+#include "../persistence/DatabaseManager.h"
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+TEST(BackupManagerTest, SnapshotsWhileWritingAndPrunes) {
+    auto dir  = fs::temp_directory_path() / "lm_backup_test";
+    auto path = fs::temp_directory_path() / "lm_backup_source.db";
+    fs::remove_all(dir);
+    fs::remove(path);
+    {
+        auto db = std::make_shared<DatabaseManager>(path.string());
+        db->initializeSchema();
+        AssetRepository repo(db);
+        for (int i = 0; i < 500; ++i)
+            repo.add({"A" + std::to_string(i), AssetType::Book, std::string(200, 'x'), "Author"});
+
+        BackupOptions options;
+        options.directory = dir.string();
+        options.pagesPerStep = 4;   // many small steps
+        options.keep = 2;
+        auto& backups = db->enableBackups(options);
+
+        // Keep writing while the first snapshot is taken.
+        std::atomic<bool> done{false};
+        std::thread writer([&] {
+            for (int i = 0; !done; ++i)
+                repo.add({"W" + std::to_string(i), AssetType::Book, "During backup", "Author"});
+        });
+        auto first = backups.backupNow().get();
+        done = true;
+        writer.join();
+
+        auto progress = backups.progress();
+        EXPECT_FALSE(progress.running);
+        EXPECT_EQ(progress.lastSnapshot, first);
+        EXPECT_GT(progress.steps, 1u);
+        EXPECT_EQ(progress.pagesRemaining, 0);
+
+        {
+            auto copy = std::make_shared<DatabaseManager>(first);
+            AssetRepository copyRepo(copy);
+            EXPECT_TRUE(copyRepo.find("A499").has_value());
+            EXPECT_EQ(copyRepo.search("author").size(), 20u);   // FTS index came along
+        }
+
+        backups.backupNow().get();
+        backups.backupNow().get();
+        auto kept = backups.snapshots();
+        ASSERT_EQ(kept.size(), 2u);
+        EXPECT_FALSE(fs::exists(first));
+        EXPECT_EQ(kept.back(), backups.progress().lastSnapshot);
+    }
+    fs::remove_all(dir);
+    fs::remove(path);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../ui/CLI.h"
+#include "../util/Security.h"
+
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// The CLI keeps library.db and its side files in the working directory.
+struct TempCwd {
+    fs::path dir = fs::temp_directory_path() / "lm_cli_test";
+    fs::path previous = fs::current_path();
+    TempCwd() {
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        fs::current_path(dir);
+    }
+    ~TempCwd() {
+        fs::current_path(previous);
+        fs::remove_all(dir);
+    }
+};
+
+// Runs the interactive CLI on scripted input and returns what it printed.
+std::string runCli(const std::string& input) {
+    std::istringstream in(input);
+    std::ostringstream out;
+    auto* oldIn = std::cin.rdbuf(in.rdbuf());
+    auto* oldOut = std::cout.rdbuf(out.rdbuf());
+    try {
+        CLI().run();
+    } catch (...) {
+        std::cin.rdbuf(oldIn);
+        std::cout.rdbuf(oldOut);
+        throw;
+    }
+    std::cin.rdbuf(oldIn);
+    std::cout.rdbuf(oldOut);
+    return out.str();
+}
+
+}  // namespace
+
+TEST(CLITest, RegularUserIssuesAndReturns) {
+    ASSERT_TRUE(initCrypto());
+    TempCwd cwd;
+    {
+        auto db = std::make_shared<DatabaseManager>((cwd.dir / "library.db").string());
+        db->initializeSchema();
+        UserRepository(db).add({"S1", "Staff", Role::Staff, hashPassword("spw")});
+        UserRepository(db).add({"U1", "Alice", Role::User, hashPassword("upw")});
+        AssetRepository(db).add({"B1", AssetType::Book, "Dune", "Herbert"});
+    }
+
+    // Login as U1, issue B1, list my loans, return B1, exit, quit.
+    auto out = runCli("1\nU1\nupw\n3\nB1\n4\n5\nB1\ny\n6\n2\n");
+    EXPECT_NE(out.find("[User] Welcome, Alice!"), std::string::npos) << out;
+    EXPECT_NE(out.find("Borrowed B1"), std::string::npos) << out;
+    EXPECT_NE(out.find("Issued"), std::string::npos) << out;   // My Loans lists it
+    EXPECT_NE(out.find("Returned."), std::string::npos) << out;
+
+    auto db = std::make_shared<DatabaseManager>((cwd.dir / "library.db").string());
+    auto b1 = AssetRepository(db).find("B1");
+    ASSERT_TRUE(b1.has_value());
+    EXPECT_EQ(b1->onLoan(), 0);
+}
+
+TEST(CLITest, FailedCommandReturnsToThePrompt) {
+    ASSERT_TRUE(initCrypto());
+    TempCwd cwd;
+    {
+        auto db = std::make_shared<DatabaseManager>((cwd.dir / "library.db").string());
+        db->initializeSchema();
+        UserRepository(db).add({"S1", "Staff", Role::Staff, hashPassword("spw")});
+        UserRepository(db).add({"U1", "Alice", Role::User, hashPassword("upw")});
+        AssetRepository(db).add({"B1", AssetType::Book, "Dune", "Herbert", 1, 0});
+        sqlite3_exec(db->get(), "CREATE TRIGGER no_holds BEFORE INSERT ON holds "
+                                "BEGIN SELECT RAISE(ABORT, 'holds are frozen'); END;",
+                     nullptr, nullptr, nullptr);
+    }
+
+    // Login as U1, try to hold B1 (which throws), then exit and quit.
+    auto out = runCli("1\nU1\nupw\n3\nB1\ny\n6\n2\n");
+    EXPECT_NE(out.find("Command failed: "), std::string::npos) << out;
+    EXPECT_NE(out.find("holds are frozen"), std::string::npos) << out;
+    EXPECT_NE(out.find("Goodbye, Alice!"), std::string::npos) << out;
+}
@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include "../persistence/AssetRepository.h"
+#include "../persistence/ChangeWatcher.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/HoldService.h"
+#include "../services/LoanService.h"
+#include "../services/NotificationService.h"
+
+#include <sqlite3.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct TempDb {
+    fs::path path = fs::temp_directory_path() / "lm_change_test.db";
+    TempDb() { fs::remove(path); }
+    ~TempDb() {
+        for (auto suffix : {"", "-wal", "-shm", "-journal"}) fs::remove(path.string() + suffix);
+    }
+};
+
+// One process's view of the library file.
+struct Desk {
+    std::shared_ptr<ManualClock>         clock = std::make_shared<ManualClock>(1'700'000'000);
+    std::shared_ptr<DatabaseManager>     db;
+    std::shared_ptr<EventBus>            events;
+    std::shared_ptr<AssetRepository>     assets;
+    std::shared_ptr<UserRepository>      users;
+    std::shared_ptr<HoldService>         holds;
+    std::unique_ptr<LoanService>         loans;
+    std::unique_ptr<NotificationService> notifier;
+
+    Desk(const fs::path& path, bool withBus) : db(std::make_shared<DatabaseManager>(path.string())) {
+        db->initializeSchema();
+        if (withBus) events = std::make_shared<EventBus>();
+        assets = std::make_shared<AssetRepository>(db, events);
+        users = std::make_shared<UserRepository>(db, events);
+        holds = std::make_shared<HoldService>(assets, users, std::vector<std::shared_ptr<NotificationStrategy>>{},
+                                              clock);
+        loans = std::make_unique<LoanService>(assets, users, clock, holds);
+        notifier = std::make_unique<NotificationService>(assets, users,
+                                                         std::vector<std::shared_ptr<NotificationStrategy>>{}, clock);
+    }
+};
+
+}  // namespace
+
+TEST(ChangeWatcherTest, ReportsWhatOtherConnectionsCommitted) {
+    TempDb file;
+    auto mine = std::make_shared<DatabaseManager>(file.path.string());
+    mine->initializeSchema();
+    EXPECT_TRUE(mine->externalChanges().empty());   // starting point
+
+    auto theirs = std::make_shared<DatabaseManager>(file.path.string());
+    AssetRepository theirAssets(theirs);
+    UserRepository theirUsers(theirs);
+    theirAssets.add({"B2", AssetType::Book, "Emma", "Austen"});
+    theirAssets.add({"B1", AssetType::Book, "Dune", "Herbert"});
+    theirUsers.add({"U1", "Alice", Role::User, "x"});
+
+    auto changes = mine->externalChanges();
+    EXPECT_EQ(changes.assetIds, (std::vector<std::string>{"B1", "B2"}));
+    EXPECT_EQ(changes.userIds, (std::vector<std::string>{"U1"}));
+    EXPECT_FALSE(changes.everything);
+    EXPECT_TRUE(mine->externalChanges().empty());
+
+    // Our own writes are not reported back to us.
+    AssetRepository myAssets(mine);
+    myAssets.add({"L1", AssetType::Laptop, "XPS 13", "Dell"});
+    EXPECT_TRUE(mine->externalChanges().empty());
+
+    // Unless someone else's commit lands in between.
+    myAssets.add({"L2", AssetType::Laptop, "ThinkPad", "Lenovo"});
+    theirAssets.add({"B3", AssetType::Book, "Ulysses", "Joyce"});
+    changes = mine->externalChanges();
+    EXPECT_TRUE(std::count(changes.assetIds.begin(), changes.assetIds.end(), "B3"));
+}
+
+TEST(ChangeWatcherTest, TrimmedLogMeansEverything) {
+    TempDb file;
+    DatabaseManager mine(file.path.string());
+    mine.initializeSchema();
+    mine.externalChanges();
+
+    auto theirs = std::make_shared<DatabaseManager>(file.path.string());
+    AssetRepository theirAssets(theirs);
+    theirAssets.add({"B1", AssetType::Book, "Dune", "Herbert"});
+    ASSERT_EQ(sqlite3_exec(theirs->get(), "DELETE FROM change_log;", nullptr, nullptr, nullptr), SQLITE_OK);
+    theirAssets.add({"B2", AssetType::Book, "Emma", "Austen"});
+
+    auto changes = mine.externalChanges();
+    EXPECT_TRUE(changes.everything);
+    EXPECT_TRUE(mine.externalChanges().empty());
+}
+
+TEST(ChangeWatcherTest, MirrorsReloadWhatAnotherProcessChanged) {
+    TempDb file;
+    Desk front(file.path, true);
+    front.assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    front.assets->add({"B2", AssetType::Book, "Emma", "Austen"});
+    front.users->add({"U1", "Alice", Role::User, "x"});
+    front.users->add({"U2", "Bob", Role::User, "x"});
+    EXPECT_EQ(front.users->searchByName("Zelda").size(), 0u);   // builds the index
+    ChangeWatcher watcher(front.db, front.events);
+    EXPECT_FALSE(watcher.poll());
+
+    Desk back(file.path, false);
+    auto* out = std::cout.rdbuf(nullptr);
+    ASSERT_TRUE(back.loans->issueAsset("B1", "U1"));
+    ASSERT_TRUE(back.holds->placeHold("B1", "U2"));
+    back.users->add({"U3", "Zelda Fitzgerald", Role::User, "x"});
+    std::cout.rdbuf(out);
+
+    EXPECT_EQ(front.holds->queueLength("B1"), 0u);   // not seen yet
+    ASSERT_TRUE(watcher.poll());
+    front.events->flush();
+    EXPECT_EQ(watcher.published(), 1u);
+
+    EXPECT_EQ(front.holds->queueLength("B1"), 1u);
+    auto found = front.users->searchByName("Zelda");
+    ASSERT_FALSE(found.empty());
+    EXPECT_EQ(found[0].key, "U3");
+    front.clock->advanceDays(40);
+    EXPECT_EQ(front.notifier->countOverdue(), 1);
+
+    // The loan comes back at the other desk.
+    out = std::cout.rdbuf(nullptr);
+    ASSERT_TRUE(back.loans->returnAsset("B1", "U1"));
+    std::cout.rdbuf(out);
+    ASSERT_TRUE(watcher.poll());
+    front.events->flush();
+    EXPECT_EQ(front.notifier->countOverdue(), 0);
+    EXPECT_EQ(front.holds->queueLength("B1"), 0u);   // the copy went to U2
+}
+
+TEST(ChangeWatcherTest, NameIndexFollowsRenamesAndDeletes) {
+    TempDb file;
+    Desk front(file.path, true);
+    front.users->add({"U1", "Alice Munro", Role::User, "x"});
+    front.users->add({"U2", "Bob Dylan", Role::User, "x"});
+    ASSERT_EQ(front.users->searchByName("Munro").size(), 1u);   // builds the index
+    ChangeWatcher watcher(front.db, front.events);
+
+    Desk back(file.path, false);
+    ASSERT_EQ(sqlite3_exec(back.db->get(), "UPDATE users SET name = 'Alice Walker' WHERE ext_id = 'U1';"
+                                           "DELETE FROM users WHERE ext_id = 'U2';",
+                           nullptr, nullptr, nullptr),
+              SQLITE_OK);
+    ASSERT_TRUE(watcher.poll());
+    front.events->flush();
+
+    EXPECT_TRUE(front.users->searchByName("Munro").empty());
+    EXPECT_TRUE(front.users->searchByName("Dylan").empty());
+    auto found = front.users->searchByName("Walker");
+    ASSERT_EQ(found.size(), 1u);
+    EXPECT_EQ(found[0].key, "U1");
+    EXPECT_EQ(found[0].text, "Alice Walker");
+
+    // A trimmed log reloads every name.
+    ASSERT_EQ(sqlite3_exec(back.db->get(), "DELETE FROM change_log; DELETE FROM users WHERE ext_id = 'U1';",
+                           nullptr, nullptr, nullptr),
+              SQLITE_OK);
+    back.users->add({"U3", "Carol Shields", Role::User, "x"});
+    ASSERT_TRUE(watcher.poll());
+    front.events->flush();
+    EXPECT_TRUE(front.users->searchByName("Walker").empty());
+    EXPECT_EQ(front.users->searchByName("Shields").size(), 1u);
+}
+
+TEST(ChangeWatcherTest, BackgroundPolling) {
+    TempDb file;
+    Desk front(file.path, true);
+    std::atomic<int> changes{0};
+    auto sub = front.events->subscribe("count", [&](std::span<const DomainEvent> events) {
+        for (auto& e : events) changes += std::holds_alternative<ExternalChange>(e);
+    });
+    ChangeWatcher watcher(front.db, front.events);
+    watcher.start(std::chrono::milliseconds(5));
+
+    Desk back(file.path, false);
+    back.assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    for (int i = 0; i < 400 && changes == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    watcher.stop();
+    EXPECT_EQ(changes, 1);
+}
+
+TEST(ChangeWatcherTest, MirrorsKeepTheirStateUntilTheyCanRead) {
+    TempDb file;
+    Desk front(file.path, true);
+    front.assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    front.assets->add({"B2", AssetType::Book, "Emma", "Austen"});
+    front.users->add({"U1", "Alice", Role::User, "x"});
+    front.users->add({"U2", "Bob", Role::User, "x"});
+    ASSERT_TRUE(front.loans->issueAsset("B1", "U1"));
+    ASSERT_EQ(front.users->searchByName("Alice").size(), 1u);   // builds the index
+    front.clock->advanceDays(40);
+
+    Desk back(file.path, false);
+    auto* out = std::cout.rdbuf(nullptr);
+    ASSERT_TRUE(back.holds->placeHold("B1", "U2"));
+    back.users->add({"U3", "Zelda Fitzgerald", Role::User, "x"});
+    std::cout.rdbuf(out);
+
+    // With a transaction open on the connection the mirrors can't read, so
+    // they keep what they have rather than start from nothing.
+    ASSERT_EQ(sqlite3_exec(front.db->get(), "BEGIN; SELECT count(*) FROM users;", nullptr, nullptr, nullptr),
+              SQLITE_OK);
+    front.events->publish(ExternalChange{{}, {}, true});
+    front.events->flush();
+    EXPECT_EQ(front.users->searchByName("Alice").size(), 1u);
+    EXPECT_EQ(front.notifier->countOverdue(), 1);
+    EXPECT_EQ(front.holds->queueLength("B1"), 0u);
+
+    // The next change, however small, reads what was put off.
+    ASSERT_EQ(sqlite3_exec(front.db->get(), "COMMIT;", nullptr, nullptr, nullptr), SQLITE_OK);
+    front.events->publish(ExternalChange{});
+    front.events->flush();
+    EXPECT_EQ(front.holds->queueLength("B1"), 1u);
+    EXPECT_EQ(front.users->searchByName("Zelda").size(), 1u);
+    EXPECT_EQ(front.users->searchByName("Alice").size(), 1u);
+    EXPECT_EQ(front.notifier->countOverdue(), 1);
+}
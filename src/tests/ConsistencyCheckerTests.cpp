@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include "../persistence/AssetRepository.h"
+#include "../persistence/ConsistencyChecker.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../services/HoldService.h"
+#include "../services/LoanService.h"
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+using Kind = ConsistencyIssue::Kind;
+
+namespace {
+
+struct Library {
+    std::shared_ptr<DatabaseManager> db;
+    std::shared_ptr<AssetRepository> assets;
+    std::shared_ptr<UserRepository>  users;
+    std::shared_ptr<HoldService>     holds;
+    std::unique_ptr<LoanService>     loans;
+
+    explicit Library(const std::string& path = ":memory:") : db(std::make_shared<DatabaseManager>(path)) {
+        db->initializeSchema();
+        assets = std::make_shared<AssetRepository>(db);
+        users = std::make_shared<UserRepository>(db);
+        holds = std::make_shared<HoldService>(assets, users);
+        loans = std::make_unique<LoanService>(assets, users, std::make_shared<ManualClock>(1'700'000'000), holds);
+        for (int i = 1; i <= 20; ++i) assets->add({"B" + std::to_string(i), AssetType::Book, "Title", "Author", 2, 2});
+        assets->add({"L1", AssetType::Laptop, "XPS 13", "Dell"});
+        for (auto id : {"U1", "U2", "U3"}) users->add({id, id, Role::User, "x"});
+        auto* out = std::cout.rdbuf(nullptr);
+        loans->issueAsset("B1", "U1");
+        loans->issueAsset("B2", "U2");
+        loans->issueAsset("B5", "U1");
+        loans->issueAsset("L1", "U3");
+        holds->placeHold("L1", "U1");
+        loans->returnAsset("L1", "U3");   // the hold becomes ready
+        std::cout.rdbuf(out);
+    }
+
+    void sql(const char* text) { ASSERT_EQ(sqlite3_exec(db->get(), text, nullptr, nullptr, nullptr), SQLITE_OK) << text; }
+
+    std::int64_t scalar(const std::string& text) {
+        sqlite3_stmt* st = nullptr;
+        sqlite3_prepare_v2(db->get(), text.c_str(), -1, &st, nullptr);
+        sqlite3_step(st);
+        auto v = sqlite3_column_int64(st, 0);
+        sqlite3_finalize(st);
+        return v;
+    }
+
+    // Deletes U2 (who has B2 out), knocks B3's shelf count down, adds a loan
+    // and a hold for an asset that doesn't exist and a hold for a user that
+    // doesn't, and inflates the book total.
+    void corrupt() {
+        sql("DELETE FROM users WHERE ext_id = 'U2';");
+        sql("UPDATE assets SET available = 1 WHERE ext_id = 'B3';");
+        sql("INSERT INTO loans (asset_id, user_id, issue_date) VALUES (100000, 1, 0);");
+        sql("INSERT INTO holds (asset_id, user_id, placed_at) VALUES (100000, 1, 0);");
+        sql("INSERT INTO holds (asset_id, user_id, placed_at) "
+            "SELECT id, 99, 0 FROM assets WHERE ext_id = 'B4';");
+        sql("UPDATE type_stats SET copies = copies + 5 WHERE type = 1;");
+    }
+};
+
+std::size_t count(const ConsistencyReport& report, Kind kind) {
+    return std::count_if(report.issues.begin(), report.issues.end(), [&](auto& i) { return i.kind == kind; });
+}
+
+struct TempDb {
+    fs::path path = fs::temp_directory_path() / "lm_consistency_test.db";
+    TempDb() { fs::remove(path); }
+    ~TempDb() { fs::remove(path); }
+};
+
+void expectFindsAndRepairs(Library& lib, CheckOptions options) {
+    ConsistencyChecker checker(lib.db, options);
+    auto clean = checker.check();
+    EXPECT_TRUE(clean.clean()) << consistencyIssueName(clean.issues.at(0).kind);
+    EXPECT_EQ(clean.assets, 21u);
+    EXPECT_EQ(clean.loans, 3u);
+    EXPECT_EQ(clean.holds, 1u);
+    EXPECT_EQ(clean.users, 3u);
+
+    lib.corrupt();
+    auto report = checker.check();
+    EXPECT_EQ(count(report, Kind::LoanWithoutUser), 1u);
+    EXPECT_EQ(count(report, Kind::LoanWithoutAsset), 1u);
+    EXPECT_EQ(count(report, Kind::HoldWithoutAsset), 1u);
+    EXPECT_EQ(count(report, Kind::HoldWithoutUser), 1u);
+    EXPECT_EQ(count(report, Kind::ShelfCount), 1u);
+    EXPECT_EQ(count(report, Kind::TypeCopies), 1u);
+    EXPECT_EQ(count(report, Kind::TypeOnLoan), 0u);
+    auto shelf = std::find_if(report.issues.begin(), report.issues.end(),
+                              [](auto& i) { return i.kind == Kind::ShelfCount; });
+    EXPECT_EQ(shelf->recorded, 1);
+    EXPECT_EQ(shelf->expected, 2);
+
+    EXPECT_GE(checker.repair(report), 6u);
+    EXPECT_TRUE(checker.check().clean());
+    EXPECT_EQ(lib.assets->available("B2"), 2);   // U2's copy is back
+    EXPECT_EQ(lib.assets->available("B3"), 2);
+    EXPECT_EQ(lib.scalar("SELECT on_loan FROM type_stats WHERE type = 1;"), 2);
+    EXPECT_EQ(checker.repair(checker.check()), 0u);
+}
+
+}  // namespace
+
+TEST(ConsistencyCheckerTest, FindsAndRepairsInMemory) {
+    Library lib;
+    expectFindsAndRepairs(lib, {});
+}
+
+TEST(ConsistencyCheckerTest, FindsAndRepairsAcrossChunksAndWorkers) {
+    TempDb file;
+    Library lib(file.path.string());
+    // Three ids per chunk: issues fall on chunk edges and past the last one.
+    expectFindsAndRepairs(lib, {.threads = 3, .chunkAssets = 3, .repairBatch = 2});
+}
+
+TEST(ConsistencyCheckerTest, MoreLoansThanCopiesRaisesCopies) {
+    Library lib;
+    lib.sql("INSERT INTO loans (asset_id, user_id, issue_date) "
+            "SELECT id, 3, 0 FROM assets WHERE ext_id = 'L1';");
+    ConsistencyChecker checker(lib.db);
+    auto report = checker.check();
+    ASSERT_EQ(count(report, Kind::ShelfCount), 1u);
+    EXPECT_EQ(count(report, Kind::TypeOnLoan), 1u);
+    checker.repair(report);
+    EXPECT_TRUE(checker.check().clean());
+    EXPECT_EQ(lib.scalar("SELECT copies FROM assets WHERE ext_id = 'L1';"), 2);
+    EXPECT_EQ(lib.assets->available("L1"), 0);
+}
+
+TEST(ConsistencyCheckerTest, RepairSkipsRowsFixedSinceTheCheck) {
+    Library lib;
+    lib.sql("UPDATE assets SET available = 0 WHERE ext_id = 'B7';");
+    lib.sql("INSERT INTO loans (asset_id, user_id, issue_date) VALUES (100000, 1, 0);");
+    ConsistencyChecker checker(lib.db);
+    auto report = checker.check();
+    ASSERT_EQ(report.issues.size(), 2u);
+
+    // Someone puts both right before the repair runs.
+    lib.sql("UPDATE assets SET available = 2 WHERE ext_id = 'B7';");
+    lib.sql("UPDATE assets SET available = 1 WHERE ext_id = 'B20';");
+    lib.sql("UPDATE loans SET asset_id = (SELECT id FROM assets WHERE ext_id = 'B20') WHERE asset_id = 100000;");
+    EXPECT_EQ(checker.repair(report), 0u);
+}
+
+TEST(ConsistencyCheckerTest, IssuesPastTheCapAreCounted) {
+    Library lib;
+    lib.sql("UPDATE assets SET available = 0 WHERE type = 1;");
+    ConsistencyChecker checker(lib.db, {.maxIssues = 5});
+    auto report = checker.check();
+    EXPECT_EQ(report.issues.size(), 5u);
+    EXPECT_EQ(report.dropped, 15u);
+    EXPECT_FALSE(report.clean());
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../models/Asset.h"
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string pragmaText(DatabaseManager& db, const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db.get(), sql, -1, &stmt, nullptr);
+    std::string out;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        out = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    sqlite3_finalize(stmt);
+    return out;
+}
+
+TEST(DatabaseManagerTest, ProfileAppliesPragmas) {
+    auto path = fs::temp_directory_path() / "lm_profile_test.db";
+    fs::remove(path);
+    {
+        DatabaseManager db(path.string(), DurabilityProfile::Balanced);
+        EXPECT_EQ(pragmaText(db, "PRAGMA journal_mode;"), "wal");
+        EXPECT_EQ(pragmaText(db, "PRAGMA synchronous;"), "1");   // NORMAL
+        EXPECT_EQ(pragmaText(db, "PRAGMA temp_store;"), "2");    // MEMORY
+    }
+    fs::remove(path);
+    fs::remove(path.string() + "-wal");
+    fs::remove(path.string() + "-shm");
+}
+
+TEST(DatabaseManagerTest, GroupCommitBatchesConcurrentWriters) {
+    auto path = fs::temp_directory_path() / "lm_group_commit_test.db";
+    fs::remove(path);
+    {
+        auto db = std::make_shared<DatabaseManager>(path.string(), DurabilityProfile::Durable);
+        db->initializeSchema();
+        AssetRepository repo(db);
+        db->enableGroupCommit(std::chrono::milliseconds(5));
+
+        const int threads = 8, perThread = 25;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < perThread; ++i) {
+                    auto id = "g" + std::to_string(t) + "-" + std::to_string(i);
+                    repo.add({id, AssetType::Book, "Title", "Author"});
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        db->disableGroupCommit();
+
+        EXPECT_EQ(repo.getAll().size(), static_cast<size_t>(threads * perThread));
+        EXPECT_LT(db->commitCount(), static_cast<std::uint64_t>(threads * perThread));
+
+        // A failing write rolls back only itself.
+        db->enableGroupCommit(std::chrono::milliseconds(1));
+        EXPECT_THROW(db->write([&] { repo.add({"boom", AssetType::Book, "T", "A"});
+                                     throw std::runtime_error("fail"); }),
+                     std::runtime_error);
+        EXPECT_FALSE(repo.find("boom").has_value());
+    }
+    fs::remove(path);
+    fs::remove(path.string() + "-wal");
+    fs::remove(path.string() + "-shm");
+}
+
+TEST(DatabaseManagerTest, MigratesOriginalSchema) {
+    auto path = fs::temp_directory_path() / "lm_migrate_test.db";
+    fs::remove(path);
+    {
+        // The original layout: TEXT primary keys, string codes, one row per copy.
+        sqlite3* raw = nullptr;
+        ASSERT_EQ(sqlite3_open(path.string().c_str(), &raw), SQLITE_OK);
+        ASSERT_EQ(sqlite3_exec(raw, R"(
+            CREATE TABLE users (id TEXT PRIMARY KEY, name TEXT NOT NULL,
+                                role TEXT NOT NULL DEFAULT 'user', password_hash TEXT NOT NULL);
+            CREATE TABLE assets (id TEXT PRIMARY KEY, type TEXT NOT NULL, title TEXT NOT NULL,
+                                 author_or_owner TEXT NOT NULL, is_issued INTEGER NOT NULL DEFAULT 0);
+            CREATE TABLE loans (asset_id TEXT PRIMARY KEY, user_id TEXT NOT NULL, issue_date INTEGER,
+                                FOREIGN KEY(asset_id) REFERENCES assets(id),
+                                FOREIGN KEY(user_id)  REFERENCES users(id));
+            CREATE VIRTUAL TABLE assets_fts USING fts5(title, author_or_owner,
+                                 content='assets', content_rowid='rowid');
+            INSERT INTO users VALUES ('U1', 'Alice', 'staff', 'h1'), ('U2', 'Bob', 'user', 'h2');
+            INSERT INTO assets VALUES ('B1', 'book', 'Dune', 'Herbert', 1),
+                                      ('L1', 'laptop', 'XPS', 'Dell', 0),
+                                      ('B2', 'book', 'Dune', 'Herbert', 0),
+                                      ('B3', 'book', 'Dune', 'Herbert', 1);
+            INSERT INTO loans VALUES ('B1', 'U2', 1000), ('GONE', 'U1', 2000), ('B3', 'U1', 1500);
+            INSERT INTO assets_fts(assets_fts) VALUES ('rebuild');
+        )", nullptr, nullptr, nullptr), SQLITE_OK);
+        sqlite3_close(raw);
+    }
+    {
+        auto db = std::make_shared<DatabaseManager>(path.string());
+        db->initializeSchema();
+        EXPECT_EQ(db->schemaVersion(), 2);
+        EXPECT_EQ(pragmaText(*db, "SELECT type FROM pragma_table_info('assets') WHERE name = 'id';"), "INTEGER");
+
+        auto assets = std::make_shared<AssetRepository>(db);
+        auto users  = std::make_shared<UserRepository>(db);
+        LoanService loans(assets, users);
+
+        ASSERT_TRUE(assets->find("L1").has_value());
+        EXPECT_EQ(assets->find("L1")->type(), AssetType::Laptop);
+        EXPECT_EQ(users->find("U1")->role(), Role::Staff);
+        EXPECT_EQ(users->find("U2")->role(), Role::User);
+        ASSERT_EQ(assets->search("herbert").size(), 1u);   // index rebuilt on new keys
+
+        // The three Dune rows became one title; B2 and B3 still resolve to it.
+        auto dune = assets->find("B3");
+        ASSERT_TRUE(dune.has_value());
+        EXPECT_EQ(dune->id(), "B1");
+        EXPECT_EQ(dune->copies(), 3);
+        EXPECT_EQ(dune->available(), 1);
+
+        auto loan = loans.loanInfo("B1");
+        ASSERT_TRUE(loan.has_value());
+        EXPECT_EQ(loan->userId, "U2");
+        EXPECT_EQ(loan->issueDate, 1000);
+        EXPECT_EQ(loans.loansFor("B1").size(), 2u);
+        EXPECT_EQ(pragmaText(*db, "SELECT count(*) FROM loans;"), "2");   // orphan dropped
+
+        // Migrated data keeps working through the normal paths.
+        ASSERT_TRUE(loans.issueAsset("L1", "U1"));
+        EXPECT_EQ(loans.loanInfo("L1")->userId, "U1");
+        ASSERT_TRUE(loans.returnAsset("B3", "U1"));
+        ASSERT_TRUE(loans.returnAsset("B1"));
+        EXPECT_FALSE(loans.loanInfo("B1").has_value());
+        EXPECT_EQ(assets->available("B1"), 3);
+
+        db->initializeSchema();   // idempotent once migrated
+        EXPECT_EQ(assets->getAll().size(), 2u);
+    }
+    fs::remove(path);
+    fs::remove(path.string() + "-wal");
+    fs::remove(path.string() + "-shm");
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../services/NotificationService.h"
+#include "../util/EventBus.h"
+
+#include <map>
+#include <thread>
+
+TEST(EventBusTest, DeliversEveryEventInBatchesPerProducerOrder) {
+    EventBus bus(64);   // small ring, so producers hit back-pressure
+    std::map<std::string, std::vector<time_t>> seen;   // by producer
+    std::size_t batches = 0, largest = 0;
+    auto sub = bus.subscribe("collector", [&](std::span<const DomainEvent> events) {
+        ++batches;
+        largest = std::max(largest, events.size());
+        for (auto& e : events) {
+            auto& issued = std::get<AssetIssued>(e);
+            seen[issued.userId].push_back(issued.at);
+        }
+    }, 32);
+    int counted = 0;
+    auto counter = bus.subscribe("counter", [&](std::span<const DomainEvent> events) {
+        counted += static_cast<int>(events.size());
+    });
+
+    const int producers = 4, each = 5000;
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < each; ++i) bus.publish(AssetIssued{"A", "P" + std::to_string(p), i});
+        });
+    for (auto& t : threads) t.join();
+    bus.flush();
+
+    ASSERT_EQ(seen.size(), static_cast<std::size_t>(producers));
+    for (auto& [producer, order] : seen) {
+        ASSERT_EQ(order.size(), static_cast<std::size_t>(each)) << producer;
+        EXPECT_TRUE(std::is_sorted(order.begin(), order.end())) << producer;
+    }
+    EXPECT_EQ(counted, producers * each);
+    EXPECT_LE(largest, 32u);
+    EXPECT_LT(batches, static_cast<std::size_t>(producers * each));
+
+    // An ended subscription gets nothing more; the others carry on.
+    counter.reset();
+    bus.publish(UserAdded{"U1", Role::User});
+    bus.flush();
+    EXPECT_EQ(counted, producers * each);
+    auto stats = bus.stats();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].delivered, static_cast<std::uint64_t>(producers * each + 1));
+    EXPECT_EQ(stats[0].errors, 1u);   // std::get<AssetIssued> on UserAdded threw
+}
+
+TEST(EventBusTest, PublishesCommittedChangesOnly) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto bus = std::make_shared<EventBus>();
+    std::vector<DomainEvent> log;
+    auto sub = bus->subscribe("log", [&](std::span<const DomainEvent> events) {
+        log.insert(log.end(), events.begin(), events.end());
+    });
+    auto assets = std::make_shared<AssetRepository>(db, bus);
+    auto users  = std::make_shared<UserRepository>(db, bus);
+    auto clock  = std::make_shared<ManualClock>(1'700'000'000);
+    LoanService loans(assets, users, clock);
+
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert", 2, 2});
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert", 2, 2});   // duplicate, ignored
+    users->add({"U1", "Alice", Role::User, "x"});
+    try {
+        db->write([&] {
+            assets->add({"B2", AssetType::Book, "Emma", "Austen"});
+            throw std::runtime_error("roll back");
+        });
+    } catch (const std::runtime_error&) {}
+    ASSERT_TRUE(loans.issueAsset("B1", "U1"));
+    clock->advanceDays(2);
+    ASSERT_TRUE(loans.returnAsset("B1", "U1"));
+    bus->flush();
+
+    ASSERT_EQ(log.size(), 4u);
+    EXPECT_EQ(std::get<AssetAdded>(log[0]).copies, 2);
+    EXPECT_EQ(std::get<UserAdded>(log[1]).userId, "U1");
+    EXPECT_EQ(std::get<AssetIssued>(log[2]).at, 1'700'000'000);
+    auto& returned = std::get<AssetReturned>(log[3]);
+    EXPECT_EQ(returned.issuedAt, 1'700'000'000);
+    EXPECT_EQ(returned.at, clock->now());
+    EXPECT_FALSE(returned.heldForNext);
+}
+
+TEST(EventBusTest, NotifierTracksOverdueLoansFromEvents) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto bus    = std::make_shared<EventBus>();
+    auto assets = std::make_shared<AssetRepository>(db, bus);
+    auto users  = std::make_shared<UserRepository>(db, bus);
+    auto clock  = std::make_shared<ManualClock>(1'700'000'000);
+    LoanService loans(assets, users, clock);
+
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert", 3, 3});
+    users->add({"U1", "Alice", Role::User, "x"});
+    users->add({"U2", "Bob", Role::User, "x"});
+    ASSERT_TRUE(loans.issueAsset("B1", "U1"));   // before the notifier: loaded from the table
+
+    NotificationService notifier(assets, users, {}, clock);
+    clock->advanceDays(1);
+    ASSERT_TRUE(loans.issueAsset("B1", "U2"));
+    bus->flush();
+    clock->advanceDays(14);
+    EXPECT_EQ(notifier.countOverdue(), 1);
+    clock->advanceDays(1);
+    EXPECT_EQ(notifier.countOverdue(), 2);
+
+    ASSERT_TRUE(loans.returnAsset("B1", "U1"));
+    bus->flush();
+    EXPECT_EQ(notifier.countOverdue(), 1);
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include "../persistence/AssetRepository.h"
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/Exporter.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string slurp(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream s;
+    s << in.rdbuf();
+    return s.str();
+}
+
+struct Library {
+    std::shared_ptr<ManualClock>     clock = std::make_shared<ManualClock>(1'700'000'000);
+    std::shared_ptr<DatabaseManager> db;
+    std::shared_ptr<AssetRepository> assets;
+    std::shared_ptr<UserRepository>  users;
+    std::unique_ptr<LoanService>     loans;
+
+    explicit Library(const std::string& path = ":memory:") : db(std::make_shared<DatabaseManager>(path)) {
+        db->initializeSchema();
+        assets = std::make_shared<AssetRepository>(db);
+        users = std::make_shared<UserRepository>(db);
+        loans = std::make_unique<LoanService>(assets, users, clock);
+        assets->add({"B1", AssetType::Book, "Dune, \"Deluxe\"", "Herbert", 2, 2});
+        assets->add({"L1", AssetType::Laptop, "XPS\n13", "Dell"});
+        users->add({"U1", "Zoë", Role::User, "secret-hash"});
+        users->add({"S1", "Boss", Role::Staff, "secret-hash"});
+        auto* out = std::cout.rdbuf(nullptr);
+        loans->issueAsset("B1", "U1");
+        clock->advanceDays(3);
+        loans->returnAsset("B1", "U1");
+        loans->issueAsset("L1", "U1");
+        std::cout.rdbuf(out);
+    }
+};
+
+struct TempDir {
+    fs::path path = fs::temp_directory_path() / "lm_export_test";
+    TempDir() { fs::remove_all(path); }
+    ~TempDir() { fs::remove_all(path); }
+};
+
+}  // namespace
+
+TEST(ExporterTest, WritesCsvAndJsonlWithoutPasswordHashes) {
+    Library lib;
+    TempDir dir;
+    Exporter csv(lib.db);
+    auto s = csv.run({ExportTable::Assets, ExportTable::Users, ExportTable::Loans, ExportTable::Active},
+                     dir.path.string());
+    ASSERT_EQ(s.size(), 4u);
+    EXPECT_EQ(s[0].rows, 2u);
+    EXPECT_EQ(s[2].rows, 2u);   // one returned, one open
+    EXPECT_EQ(s[3].rows, 1u);
+
+    EXPECT_EQ(slurp(s[0].path), "id,type,title,author,copies,available\n"
+                                "B1,book,\"Dune, \"\"Deluxe\"\"\",Herbert,2,2\n"
+                                "L1,laptop,\"XPS\n13\",Dell,1,0\n");
+    EXPECT_EQ(slurp(s[1].path), "id,name,role\nU1,Zoë,user\nS1,Boss,staff\n");
+    EXPECT_EQ(slurp(s[2].path), "asset_id,user_id,issue_date,return_date\n"
+                                "B1,U1,1700000000,1700259200\n"
+                                "L1,U1,1700259200,\n");
+    EXPECT_EQ(slurp(s[3].path), "asset_id,type,title,user_id,user_name,issue_date\n"
+                                "L1,laptop,\"XPS\n13\",U1,Zoë,1700259200\n");
+
+    ExportOptions options;
+    options.format = ExportFormat::Jsonl;
+    Exporter jsonl(lib.db, options);
+    auto j = jsonl.run({ExportTable::Users, ExportTable::Loans}, dir.path.string());
+    EXPECT_EQ(slurp(j[0].path), "{\"id\":\"U1\",\"name\":\"Zoë\",\"role\":\"user\"}\n"
+                                "{\"id\":\"S1\",\"name\":\"Boss\",\"role\":\"staff\"}\n");
+    EXPECT_EQ(slurp(j[1].path),
+              "{\"asset_id\":\"B1\",\"user_id\":\"U1\",\"issue_date\":1700000000,\"return_date\":1700259200}\n"
+              "{\"asset_id\":\"L1\",\"user_id\":\"U1\",\"issue_date\":1700259200,\"return_date\":null}\n");
+    EXPECT_EQ(slurp(j[0].path).find("secret"), std::string::npos);
+}
+
+TEST(ExporterTest, SparseKeysAreTranslated) {
+    Library lib;
+    TempDir dir;
+    // Explicit keys far past the row count, and a negative one.
+    ASSERT_EQ(sqlite3_exec(lib.db->get(), R"(
+        INSERT INTO users (id, ext_id, name, role, password_hash) VALUES (1099511627776, 'U9', 'Far', 0, 'x');
+        INSERT INTO users (id, ext_id, name, role, password_hash) VALUES (-5, 'U8', 'Below', 0, 'x');
+    )", nullptr, nullptr, nullptr), SQLITE_OK);
+    auto* out = std::cout.rdbuf(nullptr);
+    ASSERT_TRUE(lib.loans->issueAsset("B1", "U9"));
+    ASSERT_TRUE(lib.loans->issueAsset("B1", "U8"));
+    std::cout.rdbuf(out);
+
+    auto s = Exporter(lib.db).run({ExportTable::Active}, dir.path.string());
+    ASSERT_EQ(s.size(), 1u);
+    EXPECT_EQ(s[0].rows, 3u);
+    auto text = slurp(s[0].path);
+    EXPECT_NE(text.find("B1,book,\"Dune, \"\"Deluxe\"\"\",U9,Far,"), std::string::npos) << text;
+    EXPECT_NE(text.find("B1,book,\"Dune, \"\"Deluxe\"\"\",U8,Below,"), std::string::npos) << text;
+}
+
+TEST(ExporterTest, ColumnarGroupsReadBack) {
+    auto path = fs::temp_directory_path() / "lm_export_test.db";
+    fs::remove(path);
+    {
+        Library lib(path.string());
+        for (int i = 2; i <= 5; ++i) lib.assets->add({"B" + std::to_string(i), AssetType::Book, "T", "A"});
+        TempDir dir;
+        ExportOptions options;
+        options.format = ExportFormat::Columnar;
+        options.groupRows = 2;
+        Exporter exporter(lib.db, options);   // file database: read through its own connection
+        auto s = exporter.run({ExportTable::Assets, ExportTable::Loans}, dir.path.string());
+        ASSERT_EQ(s[0].rows, 6u);
+
+        auto data = slurp(s[0].path);
+        std::size_t at = 0;
+        auto take = [&](auto v) {
+            std::memcpy(&v, data.data() + at, sizeof v);
+            at += sizeof v;
+            return v;
+        };
+        ASSERT_EQ(data.substr(0, 4), "LMC1");
+        at = 4;
+        ASSERT_EQ(take(std::uint32_t{}), 6u);
+        std::vector<std::uint8_t> kinds;
+        for (int c = 0; c < 6; ++c) {
+            kinds.push_back(take(std::uint8_t{}));
+            at += take(std::uint16_t{});
+        }
+        EXPECT_EQ(kinds, (std::vector<std::uint8_t>{2, 2, 2, 2, 1, 1}));
+
+        std::vector<std::string> ids;
+        std::vector<std::int64_t> available;
+        std::size_t groups = 0;
+        while (auto rows = take(std::uint32_t{})) {
+            ++groups;
+            for (int c = 0; c < 6; ++c) {
+                at += (rows + 7) / 8;
+                if (kinds[c] == 1) {
+                    for (std::uint32_t r = 0; r < rows; ++r) {
+                        auto v = take(std::int64_t{});
+                        if (c == 5) available.push_back(v);
+                    }
+                } else {
+                    std::vector<std::uint32_t> ends;
+                    for (std::uint32_t r = 0; r < rows; ++r) ends.push_back(take(std::uint32_t{}));
+                    for (std::uint32_t r = 0, begin = 0; r < rows; begin = ends[r++])
+                        if (c == 0) ids.push_back(data.substr(at + begin, ends[r] - begin));
+                    at += ends.back();
+                }
+            }
+        }
+        EXPECT_EQ(groups, 3u);
+        EXPECT_EQ(take(std::uint64_t{}), 6u);
+        EXPECT_EQ(at, data.size());
+        EXPECT_EQ(ids, (std::vector<std::string>{"B1", "L1", "B2", "B3", "B4", "B5"}));
+        EXPECT_EQ(available, (std::vector<std::int64_t>{2, 0, 1, 1, 1, 1}));
+
+        // One group: its row count, asset_id and user_id (bitmap, two
+        // offsets, four bytes of text each), issue_date (bitmap, two
+        // values), then return_date's bitmap with the open loan's bit.
+        auto loans = slurp(s[1].path);
+        EXPECT_EQ(s[1].rows, 2u);
+        auto bitmap = loans.find("return_date") + std::strlen("return_date") + 4 + 2 * (1 + 8 + 4) + (1 + 16);
+        EXPECT_EQ(loans[bitmap], 0x02);
+    }
+    fs::remove(path);
+}
+
+TEST(ExporterTest, GzipOutputIsCompressed) {
+    if (!Exporter::gzipAvailable()) GTEST_SKIP() << "built without zlib";
+    Library lib;
+    TempDir dir;
+    ExportOptions options;
+    options.gzip = true;
+    auto s = Exporter(lib.db, options).run({ExportTable::Assets}, dir.path.string());
+    EXPECT_EQ(fs::path(s[0].path).extension(), ".gz");
+    auto data = slurp(s[0].path);
+    ASSERT_GE(data.size(), 2u);
+    EXPECT_EQ(static_cast<unsigned char>(data[0]), 0x1f);
+    EXPECT_EQ(static_cast<unsigned char>(data[1]), 0x8b);
+    EXPECT_EQ(s[0].bytes, data.size());
+}
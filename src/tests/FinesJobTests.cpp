@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../services/FinesJob.h"
+#include "../services/LoanService.h"
+
+#include <future>
+#include <vector>
+
+static long scalar(DatabaseManager& db, const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db.get(), sql, -1, &stmt, nullptr);
+    long v = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return v;
+}
+
+static const time_t day = 24 * 60 * 60;
+static const time_t start = 1'700'000'000 / day * day;   // midnight UTC
+
+TEST(FinesJobTest, AccruesIncrementsOncePerDay) {
+    auto clock = std::make_shared<ManualClock>(start);
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users  = std::make_shared<UserRepository>(db);
+    LoanService loans(assets, users, clock);
+    FinesJob job(db, FinePolicy{}, 4, 1);
+
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    assets->add({"L1", AssetType::Laptop, "XPS", "Dell"});
+    users->add({"U1", "Alice", Role::User, "x"});
+    ASSERT_TRUE(loans.issueAsset("B1", "U1"));
+    ASSERT_TRUE(loans.issueAsset("L1", "U1"));
+
+    // Day 20 ends 21 days after issue: 7 overdue, less grace.
+    auto r = job.run(start + 20 * day + 3600);
+    EXPECT_FALSE(r.alreadyRun);
+    EXPECT_EQ(r.loans, 2u);
+    EXPECT_EQ(r.accruals, 2u);
+    EXPECT_EQ(r.totalCents, 4 * 25 + 6 * 500);
+
+    auto again = job.run(start + 20 * day + 7200);
+    EXPECT_TRUE(again.alreadyRun);
+    EXPECT_EQ(again.totalCents, r.totalCents);
+    EXPECT_EQ(scalar(*db, "SELECT count(*) FROM fines;"), 2);
+
+    // Two nights later only the difference is charged.
+    r = job.run(start + 22 * day);
+    EXPECT_EQ(r.totalCents, 2 * 25 + 2 * 500);
+    EXPECT_EQ(job.balance("U1"), 150 + 4000);
+
+    // Caps stop further accrual.
+    r = job.run(start + 80 * day);
+    EXPECT_EQ(r.totalCents, (1000 - 150) + (10000 - 4000));
+    EXPECT_EQ(job.run(start + 81 * day).accruals, 0u);
+    EXPECT_EQ(job.balance("U1"), 11000);
+
+    auto ledger = job.ledger("U1");
+    ASSERT_EQ(ledger.size(), 6u);
+    EXPECT_EQ(ledger[0].day, (start + 80 * day) / day);
+    EXPECT_EQ(ledger[0].assetId, "L1");
+    EXPECT_EQ(ledger[0].daysOverdue, 81 - 14);
+
+    EXPECT_THROW(job.run(start + 30 * day), std::runtime_error);
+}
+
+TEST(FinesJobTest, DiscardsInterruptedRunAndMatchesSerialSum) {
+    auto clock = std::make_shared<ManualClock>(start);
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users  = std::make_shared<UserRepository>(db);
+    LoanService loans(assets, users, clock);
+    FinePolicy policy;
+    FinesJob job(db, policy, 4, 64);
+
+    const int readers = 500;
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert", readers, readers});
+    std::vector<time_t> issued;
+    for (int i = 0; i < readers; ++i) {
+        users->add({"U" + std::to_string(i), "Reader", Role::User, "x"});
+        ASSERT_TRUE(loans.issueAsset("B1", "U" + std::to_string(i)));
+        issued.push_back(clock->now());
+        clock->advance(day / 7);
+    }
+
+    // A run that died half way through its chunks.
+    long runDay = (start + 60 * day) / day;
+    sqlite3_exec(db->get(), ("INSERT INTO fine_runs (day) VALUES (" + std::to_string(runDay) + ");"
+                             "INSERT INTO fines VALUES (" + std::to_string(runDay) + ", 1, 1, 1, 0, 99, 12345);")
+                                .c_str(), nullptr, nullptr, nullptr);
+
+    auto r = job.run(start + 60 * day);
+    std::int64_t expected = 0;
+    std::size_t charged = 0;
+    for (auto t : issued) {
+        auto owed = policy.owed(AssetType::Book, t, (runDay + 1) * day);
+        expected += owed;
+        charged += owed > 0;
+    }
+    EXPECT_FALSE(r.alreadyRun);
+    EXPECT_EQ(r.loans, static_cast<std::size_t>(readers));
+    EXPECT_EQ(r.accruals, charged);
+    EXPECT_EQ(r.totalCents, expected);
+    EXPECT_EQ(scalar(*db, "SELECT sum(cents) FROM fines;"), expected);
+    EXPECT_EQ(scalar(*db, "SELECT count(*) FROM fine_runs WHERE finished_at IS NULL;"), 0);
+}
+
+TEST(FinesJobTest, OverlappingRunsDoNotChargeTwice) {
+    auto clock = std::make_shared<ManualClock>(start);
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users  = std::make_shared<UserRepository>(db);
+    LoanService loans(assets, users, clock);
+
+    const int readers = 200;
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert", readers, readers});
+    for (int i = 0; i < readers; ++i) {
+        users->add({"U" + std::to_string(i), "Reader", Role::User, "x"});
+        ASSERT_TRUE(loans.issueAsset("B1", "U" + std::to_string(i)));
+    }
+    const time_t asOf = start + 30 * day;
+    const long runDay = asOf / day;
+
+    // Another process is part way through the day and still holds its lease.
+    sqlite3_exec(db->get(), ("INSERT INTO fine_runs (day, owner, leased_at) VALUES (" + std::to_string(runDay) +
+                             ", 1, " + std::to_string(std::time(nullptr)) + ");"
+                             "INSERT INTO fines VALUES (" + std::to_string(runDay) + ", 1, 1, 1, 0, 16, 325);")
+                                .c_str(), nullptr, nullptr, nullptr);
+    FinesJob job(db, FinePolicy{}, 2, 16);
+    EXPECT_THROW(job.run(asOf), std::runtime_error);
+    EXPECT_EQ(scalar(*db, "SELECT count(*) FROM fines;"), 1);
+
+    // Once it has lapsed the day is taken over.
+    sqlite3_exec(db->get(), "UPDATE fine_runs SET leased_at = 0;", nullptr, nullptr, nullptr);
+    auto single = job.run(asOf);
+    EXPECT_EQ(scalar(*db, "SELECT count(*) FROM fines;"), readers);
+    sqlite3_exec(db->get(), "DELETE FROM fines; DELETE FROM fine_runs;", nullptr, nullptr, nullptr);
+
+    // Two jobs racing for the same day: one charges it, the other either
+    // sees it finished or finds it in progress.
+    FinesJob other(db, FinePolicy{}, 2, 16);
+    std::vector<std::future<bool>> runs;
+    for (auto* j : {&job, &other})
+        runs.push_back(std::async(std::launch::async, [j, asOf] {
+            try {
+                return !j->run(asOf).alreadyRun;
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+        }));
+    int charged = 0;
+    for (auto& r : runs) charged += r.get();
+    EXPECT_EQ(charged, 1);
+    EXPECT_EQ(scalar(*db, "SELECT sum(cents) FROM fines;"), single.totalCents);
+    EXPECT_EQ(scalar(*db, "SELECT count(*) FROM fine_runs WHERE finished_at IS NULL;"), 0);
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../services/HoldService.h"
+#include "../services/LoanService.h"
+#include "../util/Security.h"
+
+namespace {
+
+struct Recorder : NotificationStrategy {
+    std::vector<std::string> recipients;
+    void notify(const std::string& recipient, const std::string&, const std::string&) override {
+        recipients.push_back(recipient);
+    }
+};
+
+struct Library {
+    std::shared_ptr<DatabaseManager> db = std::make_shared<DatabaseManager>(":memory:");
+    std::shared_ptr<AssetRepository> assets;
+    std::shared_ptr<UserRepository>  users;
+    std::shared_ptr<Recorder>        outbox = std::make_shared<Recorder>();
+    std::shared_ptr<HoldService>     holds;
+    std::unique_ptr<LoanService>     loans;
+
+    Library() {
+        db->initializeSchema();
+        assets = std::make_shared<AssetRepository>(db);
+        users  = std::make_shared<UserRepository>(db);
+        holds  = std::make_shared<HoldService>(assets, users, std::vector<std::shared_ptr<NotificationStrategy>>{outbox});
+        loans  = std::make_unique<LoanService>(assets, users, systemClock(), holds);
+        assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+        for (auto id : {"U1", "U2", "U3", "U4"}) users->add({id, id, Role::User, "x"});
+    }
+};
+
+}  // namespace
+
+TEST(HoldServiceTest, ReturnHandsCopyToNextHolder) {
+    Library lib;
+    EXPECT_FALSE(lib.holds->placeHold("B1", "U2"));   // a copy is on the shelf
+    ASSERT_TRUE(lib.loans->issueAsset("B1", "U1"));
+
+    ASSERT_TRUE(lib.holds->placeHold("B1", "U2"));
+    ASSERT_TRUE(lib.holds->placeHold("B1", "U3"));
+    ASSERT_TRUE(lib.holds->placeHold("B1", "U4", 5));  // jumps the queue
+    EXPECT_FALSE(lib.holds->placeHold("B1", "U3"));   // already waiting
+    auto q = lib.holds->queue("B1");
+    ASSERT_EQ(q.size(), 3u);
+    EXPECT_EQ(q[0].userId, "U4");
+    EXPECT_EQ(q[1].userId, "U2");
+
+    ASSERT_TRUE(lib.loans->returnAsset("B1"));
+    EXPECT_EQ(lib.outbox->recipients, std::vector<std::string>{"U4"});
+    EXPECT_EQ(lib.holds->queueLength("B1"), 2u);
+    EXPECT_EQ(lib.assets->available("B1"), 0);        // set aside, not shelved
+    ASSERT_TRUE(lib.holds->holdsFor("B1").front().readyAt.has_value());
+
+    EXPECT_FALSE(lib.loans->issueAsset("B1", "U2"));  // reserved for U4
+    ASSERT_TRUE(lib.loans->issueAsset("B1", "U4"));
+    EXPECT_EQ(lib.holds->holdsFor("B1").size(), 2u);
+
+    // Cancelling a ready hold passes the copy on; the last one shelves it.
+    ASSERT_TRUE(lib.loans->returnAsset("B1"));
+    EXPECT_EQ(lib.outbox->recipients.back(), "U2");
+    ASSERT_TRUE(lib.holds->cancelHold("B1", "U2"));
+    EXPECT_EQ(lib.outbox->recipients.back(), "U3");
+    ASSERT_TRUE(lib.holds->cancelHold("B1", "U3"));
+    EXPECT_EQ(lib.assets->available("B1"), 1);
+    EXPECT_EQ(lib.holds->queueLength("B1"), 0u);
+    EXPECT_FALSE(lib.holds->cancelHold("B1", "U3"));
+}
+
+TEST(HoldServiceTest, QueueSurvivesRestartAndRollback) {
+    Library lib;
+    ASSERT_TRUE(lib.loans->issueAsset("B1", "U1"));
+    ASSERT_TRUE(lib.holds->placeHold("B1", "U2"));
+
+    // A hold placed in a transaction that rolls back never reaches the mirror.
+    EXPECT_THROW(lib.db->write([&] {
+        lib.holds->placeHold("B1", "U3");
+        throw std::runtime_error("abort");
+    }), std::runtime_error);
+    EXPECT_EQ(lib.holds->queueLength("B1"), 1u);
+
+    // A fresh service rebuilds its queues from the table.
+    HoldService reloaded(lib.assets, lib.users);
+    auto q = reloaded.queue("B1");
+    ASSERT_EQ(q.size(), 1u);
+    EXPECT_EQ(q[0].userId, "U2");
+}
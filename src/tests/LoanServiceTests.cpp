@@ -42,4 +42,38 @@ TEST(LoanServiceTest, IssueAndReturn) {
     maybeA = assetRepo->find("A1");
     ASSERT_TRUE(maybeA.has_value());
     EXPECT_FALSE(maybeA->isIssued());
-}
\ No newline at end of file
+}
+TEST(LoanServiceTest, IssuesCopiesOfOneTitle) {
+    ASSERT_TRUE(initCrypto());
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assetRepo = std::make_shared<AssetRepository>(db);
+    auto userRepo  = std::make_shared<UserRepository>(db);
+    LoanService service(assetRepo, userRepo);
+
+    assetRepo->add({"T1", AssetType::Book, "Emma", "Austen", 2, 2});
+    for (auto id : {"U1", "U2", "U3"}) userRepo->add({id, id, Role::User, hashPassword("pw")});
+
+    EXPECT_TRUE(service.issueAsset("T1", "U1"));
+    EXPECT_FALSE(assetRepo->find("T1")->isIssued());   // one copy still on the shelf
+    EXPECT_TRUE(service.issueAsset("T1", "U2"));
+    EXPECT_FALSE(service.issueAsset("T1", "U3"));      // no copies left
+    EXPECT_EQ(assetRepo->available("T1"), 0);
+    EXPECT_EQ(service.loansFor("T1").size(), 2u);
+
+    EXPECT_FALSE(service.returnAsset("T1"));           // ambiguous: two borrowers
+    EXPECT_FALSE(service.returnAsset("T1", "U3"));     // U3 has no copy
+    EXPECT_TRUE(service.returnAsset("T1", "U1"));
+    EXPECT_EQ(assetRepo->available("T1"), 1);
+    EXPECT_TRUE(service.returnAsset("T1"));            // U2 is the only borrower left
+    EXPECT_EQ(assetRepo->find("T1")->available(), 2);
+
+    // Withdrawing copies can't strand a loan.
+    EXPECT_TRUE(service.issueAsset("T1", "U3"));
+    EXPECT_FALSE(assetRepo->addCopies("T1", -2));
+    EXPECT_TRUE(assetRepo->addCopies("T1", -1));
+    EXPECT_TRUE(assetRepo->addCopies("T1", 3));
+    auto t = assetRepo->find("T1");
+    EXPECT_EQ(t->copies(), 4);
+    EXPECT_EQ(t->available(), 3);
+}
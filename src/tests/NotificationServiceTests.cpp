@@ -7,6 +7,7 @@
 #include "../models/Asset.h"
 #include "../models/User.h"
 #include "../util/Security.h"
+#include "../util/Clock.h"
 #include <sqlite3.h>
 
 TEST(NotificationServiceTest, CountOverdue) {
@@ -33,10 +34,101 @@ TEST(NotificationServiceTest, CountOverdue) {
     std::string sql =
       "UPDATE loans "
       "SET issue_date=" + std::to_string(fifteen_days_ago) + " "
-      "WHERE asset_id='L1';";
+      "WHERE asset_id=(SELECT id FROM assets WHERE ext_id='L1');";
     EXPECT_EQ(SQLITE_OK, sqlite3_exec(db->get(), sql.c_str(), nullptr, nullptr, nullptr));
 
     // 4) Now count overdue (default threshold = 14 days)
     int count = notifier.countOverdue();
     EXPECT_EQ(1, count);
-}
\ No newline at end of file
+}
+TEST(NotificationServiceTest, CountOverdueWithManualClock) {
+    ASSERT_TRUE(initCrypto());
+
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assetRepo = std::make_shared<AssetRepository>(db);
+    auto userRepo  = std::make_shared<UserRepository>(db);
+    auto clock     = std::make_shared<ManualClock>(1'700'000'000);
+    LoanService loanSvc(assetRepo, userRepo, clock);
+    NotificationService notifier(assetRepo, userRepo, {}, clock);
+
+    assetRepo->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    userRepo->add({"U1", "Alice", Role::User, hashPassword("pw")});
+    ASSERT_TRUE(loanSvc.issueAsset("B1", "U1"));
+    EXPECT_EQ(loanSvc.loanInfo("B1")->issueDate, clock->now());
+
+    // Travel forward instead of back-dating rows.
+    clock->advanceDays(14);
+    EXPECT_EQ(0, notifier.countOverdue());
+    clock->advanceDays(1);
+    EXPECT_EQ(1, notifier.countOverdue());
+}
+
+TEST(NotificationTemplateTest, RendersPlaceholdersWithFormatSpecs) {
+    NotificationFields f{"B1", "book", "Dune Messiah", "U1", "Zoë", 9, 3};
+    EXPECT_EQ(NotificationTemplate("{asset} {type}: {title} ({user}, {name}) {days}/{count}").render(f),
+              "B1 book: Dune Messiah (U1, Zoë) 9/3");
+    EXPECT_EQ(NotificationTemplate("[{title:.4}|{days:>4}|{days:<3d}|{name:*^7}|{asset:5s}]").render(f),
+              "[Dune|   9|9  |**Zoë**|B1   ]");
+    EXPECT_EQ(NotificationTemplate("{{literal}} }}{{").render(f), "{literal} }{");
+
+    // Appends, so a buffer can be reused.
+    std::string out = "x";
+    NotificationTemplate("{days}").renderTo(out, f);
+    EXPECT_EQ(out, "x9");
+
+    for (auto bad : {"{nope}", "{asset", "oops}", "{days:.2}", "{title:q}", "{title:>x}"})
+        EXPECT_THROW(NotificationTemplate{bad}, std::runtime_error) << bad;
+}
+
+namespace {
+
+struct Outbox : NotificationStrategy {
+    std::string                 name;
+    std::vector<std::string>    subjects, bodies;
+    explicit Outbox(std::string channel) : name(std::move(channel)) {}
+    void notify(const std::string&, const std::string& subject, const std::string& body) override {
+        subjects.push_back(subject);
+        bodies.push_back(body);
+    }
+    std::string_view channel() const override { return name; }
+};
+
+}  // namespace
+
+TEST(NotificationServiceTest, DigestUsesEachChannelsTemplates) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assetRepo = std::make_shared<AssetRepository>(db);
+    auto userRepo  = std::make_shared<UserRepository>(db);
+    auto clock     = std::make_shared<ManualClock>(1'700'000'000);
+    LoanService loanSvc(assetRepo, userRepo, clock);
+    auto email = std::make_shared<Outbox>("email");
+    auto sms   = std::make_shared<Outbox>("sms");
+    NotificationService notifier(assetRepo, userRepo, {email, sms}, clock);
+
+    OverdueTemplates shortForm;
+    shortForm.subject = NotificationTemplate("{count} overdue");
+    shortForm.header = NotificationTemplate("");
+    shortForm.line = NotificationTemplate("{asset}:{days};");
+    notifier.templates().set("sms", std::move(shortForm));
+
+    assetRepo->add({"B1", AssetType::Book, "Dune", "Herbert"});
+    assetRepo->add({"B2", AssetType::Book, "Emma", "Austen"});
+    userRepo->add({"U1", "Alice", Role::User, "x"});
+    auto* out = std::cout.rdbuf(nullptr);
+    ASSERT_TRUE(loanSvc.issueAsset("B1", "U1"));
+    ASSERT_TRUE(loanSvc.issueAsset("B2", "U1"));
+    clock->advanceDays(30);
+    notifier.checkAndNotifyOverdue();
+    std::cout.rdbuf(out);
+
+    ASSERT_EQ(email->bodies.size(), 1u);
+    EXPECT_EQ(email->subjects[0], "Overdue Assets Summary");
+    EXPECT_EQ(email->bodies[0], "You have 2 overdue assets:\n"
+                                "- OVERDUE: B1 | book | Dune | borrowed 30 days ago by Alice\n"
+                                "- OVERDUE: B2 | book | Emma | borrowed 30 days ago by Alice\n");
+    ASSERT_EQ(sms->bodies.size(), 1u);
+    EXPECT_EQ(sms->subjects[0], "2 overdue");
+    EXPECT_EQ(sms->bodies[0], "B1:30;B2:30;");
+}
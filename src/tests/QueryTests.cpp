@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/Query.h"
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace query;
+
+using CreateNotes = Query<"CREATE TABLE notes (id INTEGER PRIMARY KEY, body TEXT, score REAL);", Row<>>;
+using InsertNote  = Query<"INSERT INTO notes (id, body, score) VALUES (?, ?, ?);",
+                          Row<>, int, std::optional<std::string_view>, double>;
+using NoteBodies  = Query<"SELECT id, body, score FROM notes WHERE id >= ? ORDER BY id;",
+                          Row<int, std::optional<std::string>, double>, int>;
+using BodyViews   = Query<"SELECT body FROM notes WHERE body IS NOT NULL ORDER BY id;", Row<std::string_view>>;
+using Absolute    = Query<"SELECT abs(?);", Row<std::int64_t>, std::int64_t>;
+
+static_assert(detail::placeholders("SELECT '?', \"a?b\" FROM t WHERE x = ? AND y = ?") == 2);
+static_assert(detail::selectColumns("SELECT a, count(b, c), 'x,y' FROM t WHERE d IN (1, 2)") == 3);
+static_assert(detail::selectColumns("select id from t") == 1);
+static_assert(detail::selectColumns("UPDATE t SET a = ?, b = ?") == -1);
+
+struct Note {
+    int id;
+    std::optional<std::string> body;
+    double score;
+};
+
+TEST(QueryTest, BindsAndDecodesWithNulls) {
+    DatabaseManager db(":memory:");
+    CreateNotes::exec(db);
+    EXPECT_EQ(InsertNote::exec(db, 1, std::string("first"), 1.5), 1);
+    InsertNote::exec(db, 2, std::nullopt, 2.0);
+    InsertNote::exec(db, 3, std::string_view(), 0.0);   // empty, not NULL
+
+    auto notes = NoteBodies::allAs<Note>(db, 1);
+    ASSERT_EQ(notes.size(), 3u);
+    EXPECT_EQ(notes[0].body, "first");
+    EXPECT_DOUBLE_EQ(notes[0].score, 1.5);
+    EXPECT_FALSE(notes[1].body.has_value());
+    ASSERT_TRUE(notes[2].body.has_value());
+    EXPECT_EQ(*notes[2].body, "");
+
+    auto row = NoteBodies::one(db, 2);
+    ASSERT_TRUE(row.has_value());
+    EXPECT_EQ(std::get<0>(*row), 2);
+    EXPECT_FALSE(NoteBodies::one(db, 4).has_value());
+}
+
+TEST(QueryTest, EachStreamsViewsAndStopsEarly) {
+    DatabaseManager db(":memory:");
+    CreateNotes::exec(db);
+    for (int i = 0; i < 5; ++i) InsertNote::exec(db, i, "note " + std::to_string(i), 0.0);
+
+    std::string seen;
+    BodyViews::each(db, [&](std::string_view body) {
+        seen += body.back();
+        return seen.size() < 3;
+    });
+    EXPECT_EQ(seen, "012");
+}
+
+TEST(QueryTest, StatementsAreReused) {
+    DatabaseManager db(":memory:");
+    CreateNotes::exec(db);
+    sqlite3_stmt* first;
+    {
+        auto s = db.prepare(NoteBodies::sql());
+        ASSERT_TRUE(s);
+        first = s.get();
+    }
+    auto again = db.prepare(NoteBodies::sql());
+    EXPECT_EQ(again.get(), first);
+    auto concurrent = db.prepare(NoteBodies::sql());
+    EXPECT_NE(concurrent.get(), first);
+
+    EXPECT_FALSE(db.prepare("SELECT * FROM missing_table;"));
+}
+
+TEST(QueryTest, BindAndStepFailuresThrow) {
+    DatabaseManager db(":memory:");
+    CreateNotes::exec(db);
+    EXPECT_EQ(std::get<0>(*Absolute::one(db, -5)), 5);
+
+    // abs() of the smallest integer overflows while stepping.
+    EXPECT_THROW(Absolute::one(db, std::numeric_limits<std::int64_t>::min()), std::runtime_error);
+    EXPECT_THROW(Absolute::each(db, [](std::int64_t) {}, std::numeric_limits<std::int64_t>::min()),
+                 std::runtime_error);
+
+    sqlite3_limit(db.get(), SQLITE_LIMIT_LENGTH, 8);
+    EXPECT_THROW(InsertNote::exec(db, 1, std::string("longer than eight"), 0.0), std::runtime_error);
+    EXPECT_TRUE(NoteBodies::all(db, 0).empty());
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../services/RecommendationEngine.h"
+
+#include <filesystem>
+#include <fstream>
+
+static std::vector<std::string> ids(const std::vector<Recommendation>& rs) {
+    std::vector<std::string> out;
+    for (auto& r : rs) out.push_back(r.assetId);
+    return out;
+}
+
+TEST(RecommendationEngineTest, RanksCoBorrowsAndKeepsTopK) {
+    RecommendationEngine rec(2, 3);
+    // Three readers borrow A and B, two also C, one also D.
+    rec.recordIssue("A", "U1", 1); rec.recordIssue("B", "U1", 2); rec.recordIssue("C", "U1", 3);
+    rec.recordIssue("A", "U2", 4); rec.recordIssue("B", "U2", 5); rec.recordIssue("C", "U2", 6);
+    rec.recordIssue("A", "U3", 7); rec.recordIssue("D", "U3", 8); rec.recordIssue("B", "U3", 9);
+
+    auto a = rec.recommend("A", 5);
+    ASSERT_EQ(ids(a), (std::vector<std::string>{"B", "C"}));   // D falls outside the top 2
+    EXPECT_EQ(a[0].count, 3u);
+    EXPECT_EQ(a[1].count, 2u);
+    EXPECT_EQ(ids(rec.recommend("D", 1)), std::vector<std::string>{"A"});
+    EXPECT_TRUE(rec.recommend("nope").empty());
+
+    // Re-borrowing doesn't count twice; the window forgets the oldest.
+    rec.recordIssue("A", "U3", 10);
+    EXPECT_EQ(rec.recommend("A", 1)[0].count, 3u);
+    rec.recordIssue("E", "U3", 11);   // pairs with D, B, A; then D leaves the window
+    rec.recordIssue("C", "U3", 12);   // pairs with B, A, E only
+    EXPECT_EQ(rec.recommend("C", 5)[0].count, 3u);
+    rec.recordIssue("D", "U4", 13);
+    rec.recordIssue("E", "U4", 14);
+    auto e = rec.recommend("E", 5);
+    EXPECT_EQ(ids(e), (std::vector<std::string>{"D", "B"}));   // ties keep first come
+    EXPECT_EQ(e[0].count, 2u);
+    EXPECT_EQ(rec.pairs(), 9u);
+}
+
+TEST(RecommendationEngineTest, FollowsIssuesAndRestoresFromFile) {
+    auto clock = std::make_shared<ManualClock>(1'700'000'000);
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users  = std::make_shared<UserRepository>(db);
+    auto rec    = std::make_shared<RecommendationEngine>();
+    LoanService loans(assets, users, clock, nullptr, rec);
+
+    for (auto id : {"B1", "B2", "B3"}) assets->add({id, AssetType::Book, std::string("Title ") + id, "A", 3, 3});
+    for (auto id : {"U1", "U2"}) users->add({id, "Reader", Role::User, "x"});
+    auto issue = [&](const char* a, const char* u) {
+        clock->advance(60);
+        ASSERT_TRUE(loans.issueAsset(a, u));
+    };
+    issue("B1", "U1");
+    issue("B2", "U1");
+    ASSERT_TRUE(loans.returnAsset("B1", "U1"));
+    issue("B1", "U2");
+    issue("B3", "U2");
+    EXPECT_EQ(ids(rec->recommend("B1")), (std::vector<std::string>{"B2", "B3"}));
+
+    auto path = (std::filesystem::temp_directory_path() / "lm_rec_test.bin").string();
+    ASSERT_TRUE(rec->save(path));
+
+    // Issues after the save are replayed from the database.
+    issue("B2", "U2");
+    RecommendationEngine restored;
+    ASSERT_TRUE(restored.load(path));
+    EXPECT_EQ(restored.titles(), 3u);
+    EXPECT_EQ(restored.catchUp(*db), 1u);
+    EXPECT_EQ(restored.recommend("B2", 1)[0].assetId, "B1");
+    EXPECT_EQ(restored.recommend("B2", 1)[0].count, 2u);
+
+    RecommendationEngine rebuilt;
+    rebuilt.rebuild(*db);
+    for (auto id : {"B1", "B2", "B3"}) {
+        auto x = restored.recommend(id), y = rebuilt.recommend(id);
+        ASSERT_EQ(ids(x), ids(y)) << id;
+        for (std::size_t i = 0; i < x.size(); ++i) EXPECT_EQ(x[i].count, y[i].count);
+    }
+
+    { std::ofstream(path, std::ios::binary | std::ios::trunc) << "LMRC\x01\x0a"; }
+    EXPECT_FALSE(restored.load(path));
+    EXPECT_EQ(restored.titles(), 3u);   // untouched
+    RecommendationEngine otherK(5);
+    ASSERT_TRUE(rec->save(path));
+    EXPECT_FALSE(otherK.load(path));
+    std::filesystem::remove(path);
+}
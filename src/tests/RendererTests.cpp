@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "../ui/Renderer.h"
+
+#include <sstream>
+
+namespace {
+
+const std::vector<Renderer::Column> columns = {{"ID", "id", 4}, {"Title", "title", 6}, {"Note", "note", 0}};
+
+}  // namespace
+
+TEST(RendererTest, TablePadsByDisplayWidthAndNeverSplitsCharacters) {
+    EXPECT_EQ(displayWidth("abc"), 3u);
+    EXPECT_EQ(displayWidth("für"), 3u);
+    EXPECT_EQ(displayWidth("三体"), 4u);
+    EXPECT_EQ(displayWidth("e\xCC\x81"), 1u);   // e + combining acute
+
+    std::ostringstream out;
+    {
+        Renderer r(out, OutputFormat::Table, columns);
+        r.row({"A1", "für", "x"});
+        r.row({"A2", "三体三体", "line\nbreak"});   // 8 columns wide
+        r.row({"A3", "ab三体三", ""});             // the third wide char doesn't fit
+    }
+    EXPECT_EQ(out.str(),
+              "ID   | Title  | Note\n"
+              "--------------------\n"
+              "A1   | für    | x\n"
+              "A2   | 三体三 | line break\n"
+              "A3   | ab三体 | \n");
+}
+
+TEST(RendererTest, CsvAndJsonEscapeValues) {
+    std::ostringstream csv;
+    {
+        Renderer r(csv, OutputFormat::Csv, columns);
+        r.row({"A1", "Dune, Part \"One\"", "plain"});
+    }
+    EXPECT_EQ(csv.str(), "ID,Title,Note\nA1,\"Dune, Part \"\"One\"\"\",plain\n");
+
+    std::ostringstream json;
+    {
+        Renderer r(json, OutputFormat::Json, columns);
+        r.row({"A1", "say \"hi\"\\", "tab\there"});
+        r.row({"A2", "三体", std::string_view("\x01", 1)});
+    }
+    EXPECT_EQ(json.str(),
+              "[\n"
+              "{\"id\":\"A1\",\"title\":\"say \\\"hi\\\"\\\\\",\"note\":\"tab\\there\"},\n"
+              "{\"id\":\"A2\",\"title\":\"三体\",\"note\":\"\\u0001\"}\n"
+              "]\n");
+
+    std::ostringstream empty;
+    Renderer(empty, OutputFormat::Json, columns).finish();
+    EXPECT_EQ(empty.str(), "[]\n");
+}
+
+TEST(RendererTest, PagerStopsWhenTheReaderDeclines) {
+    std::ostringstream out;
+    int asked = 0;
+    Renderer r(out, OutputFormat::Table, columns, 2, [&] { return ++asked < 2; });
+    int written = 0;
+    for (int i = 0; i < 10; ++i)
+        if (r.row({std::to_string(i), "t", "n"})) ++written;
+    r.finish();
+    EXPECT_EQ(asked, 2);
+    EXPECT_EQ(written, 4);
+    EXPECT_TRUE(r.stopped());
+
+    // CSV and JSON are never paged.
+    std::ostringstream csv;
+    Renderer all(csv, OutputFormat::Csv, columns, 2, [] { return false; });
+    for (int i = 0; i < 10; ++i) EXPECT_TRUE(all.row({"x", "y", "z"}));
+}
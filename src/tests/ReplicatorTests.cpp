@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/Replicator.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../util/Security.h"
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+static void removeDb(const fs::path& p) {
+    for (auto suffix : {"", "-wal", "-shm", "-journal"}) fs::remove(p.string() + suffix);
+}
+
+TEST(ReplicatorTest, FollowerTracksPrimary) {
+    ASSERT_TRUE(initCrypto());
+    auto primaryPath  = fs::temp_directory_path() / "lm_primary_test.db";
+    auto followerPath = fs::temp_directory_path() / "lm_follower_test.db";
+    removeDb(primaryPath);
+    removeDb(followerPath);
+    {
+        auto db = std::make_shared<DatabaseManager>(primaryPath.string(), DurabilityProfile::Durable);
+        db->initializeSchema();
+        auto assets = std::make_shared<AssetRepository>(db);
+        auto users  = std::make_shared<UserRepository>(db);
+        LoanService loans(assets, users);
+
+        // Rows written before replication starts reach the follower through the initial copy.
+        assets->add({"B1", AssetType::Book, "Dune", "Herbert"});
+        db->enableReplication(followerPath.string());
+        auto replicator = db->replicator();
+        auto follower   = std::make_shared<AssetRepository>(replicator->follower());
+
+        assets->add({"B2", AssetType::Book, "Emma", "Austen"});
+        users->add({"U1", "Alice", Role::User, hashPassword("pw")});
+        ASSERT_TRUE(loans.issueAsset("B2", "U1"));
+        EXPECT_THROW(db->write([&] {
+            assets->add({"GONE", AssetType::Book, "Rolled back", "Nobody"});
+            throw std::runtime_error("abort");
+        }), std::runtime_error);
+
+        replicator->flush();
+        EXPECT_TRUE(follower->find("B1").has_value());
+        ASSERT_TRUE(follower->find("B2").has_value());
+        EXPECT_TRUE(follower->find("B2")->isIssued());
+        EXPECT_FALSE(follower->find("GONE").has_value());
+        EXPECT_EQ(follower->search("austen").size(), 1u);   // follower's own FTS triggers ran
+
+        ASSERT_TRUE(loans.returnAsset("B2"));
+        replicator->flush();
+        EXPECT_FALSE(follower->find("B2")->isIssued());
+
+        auto stats = replicator->stats();
+        EXPECT_EQ(stats.captured, 4u);   // add B2, add U1, issue, return
+        EXPECT_EQ(stats.applied, stats.captured);
+        EXPECT_EQ(stats.queued, 0u);
+        EXPECT_EQ(stats.conflicts, 0u);
+        EXPECT_EQ(replicator->appliedSequence(), 4u);
+    }
+    removeDb(primaryPath);
+    removeDb(followerPath);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../services/ReportService.h"
+
+static long scalar(DatabaseManager& db, const char* sql) {
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db.get(), sql, -1, &stmt, nullptr);
+    long v = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return v;
+}
+
+TEST(ReportServiceTest, AggregatesFollowIssuesAndReturns) {
+    const time_t day = 24 * 60 * 60;
+    auto clock = std::make_shared<ManualClock>(1'700'000'000 / day * day);   // midnight UTC
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    auto assets = std::make_shared<AssetRepository>(db);
+    auto users  = std::make_shared<UserRepository>(db);
+    LoanService loans(assets, users, clock);
+    ReportService reports(db, clock);
+
+    assets->add({"B1", AssetType::Book, "Dune", "Herbert", 2, 2});
+    assets->add({"B2", AssetType::Book, "Emma", "Austen"});
+    assets->add({"L1", AssetType::Laptop, "XPS", "Dell"});
+    users->add({"U1", "Alice", Role::User, "x"});
+    users->add({"U2", "Bob", Role::User, "x"});
+
+    ASSERT_TRUE(loans.issueAsset("B1", "U1"));
+    ASSERT_TRUE(loans.issueAsset("B1", "U2"));
+    ASSERT_TRUE(loans.issueAsset("L1", "U1"));
+    clock->advanceDays(3);
+    ASSERT_TRUE(loans.returnAsset("B1", "U1"));
+    ASSERT_TRUE(loans.issueAsset("B2", "U1"));
+    clock->advanceDays(1);
+    ASSERT_TRUE(loans.returnAsset("B1", "U2"));
+    ASSERT_TRUE(loans.issueAsset("B1", "U2"));
+    assets->addCopies("L1", 1);
+
+    auto r = reports.report(2, 5);
+    ASSERT_EQ(r.types.size(), 2u);
+    auto& books = r.types[0];
+    EXPECT_EQ(books.type, AssetType::Book);
+    EXPECT_EQ(books.copies, 3);
+    EXPECT_EQ(books.onLoan, 2);
+    EXPECT_EQ(books.borrows, 4);
+    EXPECT_EQ(books.returns, 2);
+    EXPECT_DOUBLE_EQ(books.avgDaysOut(), 3.5);
+    EXPECT_EQ(r.types[1].copies, 2);
+    EXPECT_DOUBLE_EQ(r.types[1].utilization(), 0.5);
+
+    ASSERT_EQ(r.topTitles.size(), 2u);
+    EXPECT_EQ(r.topTitles[0].assetId, "B1");
+    EXPECT_EQ(r.topTitles[0].borrows, 3);
+    EXPECT_DOUBLE_EQ(r.topTitles[0].daysOut(), 7.0);
+
+    ASSERT_EQ(r.days.size(), 5u);
+    EXPECT_EQ(r.days[0].issued, 3);     // four days ago
+    EXPECT_EQ(r.days[3].issued, 1);
+    EXPECT_EQ(r.days[3].returned, 1);
+    EXPECT_EQ(r.days[4].issued, 1);
+    EXPECT_EQ(r.days[4].returned, 1);
+    EXPECT_EQ(r.days[1].issued + r.days[2].issued, 0);
+
+    auto alice = reports.history("U1");
+    ASSERT_EQ(alice.size(), 1u);
+    EXPECT_EQ(alice[0].assetId, "B1");
+    EXPECT_EQ(alice[0].returnDate - alice[0].issueDate, 3 * day);
+
+    // The running totals agree with re-aggregating the history.
+    EXPECT_EQ(scalar(*db, "SELECT sum(seconds_out) FROM asset_stats;"),
+              scalar(*db, "SELECT sum(return_date - issue_date) FROM loan_history;"));
+    EXPECT_EQ(scalar(*db, "SELECT sum(borrows) FROM type_stats;"),
+              scalar(*db, "SELECT (SELECT count(*) FROM loan_history) + (SELECT count(*) FROM loans);"));
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "../services/ShardedCatalog.h"
+#include "../util/Clock.h"
+#include "../util/KWayMerge.h"
+#include "../util/Security.h"
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// Temporary branch files, removed on scope exit.
+struct BranchFiles {
+    std::vector<std::string> paths;
+    explicit BranchFiles(int n) {
+        for (int i = 0; i < n; ++i) {
+            auto p = fs::temp_directory_path() / ("lm_branch_" + std::to_string(i) + ".db");
+            fs::remove(p);
+            paths.push_back(p.string());
+        }
+    }
+    ~BranchFiles() {
+        for (auto& p : paths) fs::remove(p);
+    }
+};
+
+TEST(KWayMergeTest, MergesInOrderAndStopsEarly) {
+    std::vector<VectorSource<int>> sources;
+    sources.emplace_back(std::vector<int>{1, 4, 7});
+    sources.emplace_back(std::vector<int>{});
+    sources.emplace_back(std::vector<int>{2, 3, 8, 9});
+    std::vector<int> out;
+    kWayMerge(sources, std::less<int>(), [&](int v, std::size_t) { out.push_back(v); return out.size() < 6; });
+    EXPECT_EQ(out, (std::vector<int>{1, 2, 3, 4, 7, 8}));
+}
+
+TEST(ShardedCatalogTest, RoutesAndFansOut) {
+    ASSERT_TRUE(initCrypto());
+    BranchFiles files(3);
+    auto clock = std::make_shared<ManualClock>(1'700'000'000);
+    {
+        ShardedCatalog catalog(files.paths, DurabilityProfile::Default, clock);
+
+        for (int i = 0; i < 60; ++i) {
+            auto id = "A" + std::to_string(100 + i);
+            catalog.addAsset({id, AssetType::Book, i % 3 == 0 ? "Dune part " + id : "Other " + id, "Author"});
+        }
+        catalog.addUser({"U1", "Alice", Role::User, hashPassword("pw")});
+
+        // Every asset lives only on the branch its id hashes to.
+        std::set<std::size_t> used;
+        for (int i = 0; i < 60; ++i) {
+            auto id = "A" + std::to_string(100 + i);
+            std::size_t s = catalog.shardFor(id);
+            used.insert(s);
+            EXPECT_TRUE(catalog.shard(s).assets->find(id).has_value());
+            EXPECT_FALSE(catalog.shard((s + 1) % 3).assets->find(id).has_value());
+        }
+        EXPECT_EQ(used.size(), 3u);
+        EXPECT_EQ(catalog.findUser("U1")->name(), "Alice");
+
+        // Streaming listing is globally sorted and complete.
+        std::vector<std::string> ids;
+        catalog.forEachAsset([&](const Asset& a) { ids.emplace_back(a.id()); return true; }, 7);
+        ASSERT_EQ(ids.size(), 60u);
+        EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+
+        auto hits = catalog.search("dune", 50);
+        EXPECT_EQ(hits.size(), 20u);
+        for (std::size_t i = 1; i < hits.size(); ++i) EXPECT_LE(hits[i - 1].rank, hits[i].rank);
+        EXPECT_EQ(catalog.search("dune", 5, 18).size(), 2u);
+
+        // Loans live on the asset's branch; users are on every branch.
+        for (const char* id : {"A100", "A101", "A102"}) {
+            ASSERT_TRUE(catalog.issueAsset(id, "U1"));
+            clock->advanceDays(1);
+        }
+        clock->advanceDays(13);   // loans are now 16, 15 and 14 days old
+        EXPECT_EQ(catalog.countOverdue(), 2);
+        auto overdue = catalog.overdueLoans();
+        ASSERT_EQ(overdue.size(), 2u);
+        EXPECT_EQ(overdue[0].assetId, "A100");
+        EXPECT_EQ(overdue[1].assetId, "A101");
+    }
+}
+
+TEST(ShardedCatalogTest, LendsToUsersWhoseIdHashesToAnotherBranch) {
+    BranchFiles files(3);
+    ShardedCatalog catalog(files.paths);
+    catalog.addUser({"U1", "Alice", Role::User, "h"});
+    std::string id;
+    for (int i = 0; id.empty(); ++i)
+        if (catalog.shardFor("A" + std::to_string(i)) != catalog.shardFor("U1")) id = "A" + std::to_string(i);
+    catalog.addAsset({id, AssetType::Book, "Dune", "Herbert"});
+
+    ASSERT_TRUE(catalog.issueAsset(id, "U1"));
+    auto loans = catalog.branchFor(id).loans->loansFor(id);
+    ASSERT_EQ(loans.size(), 1u);
+    EXPECT_EQ(loans[0].userId, "U1");
+    EXPECT_FALSE(catalog.issueAsset(id, "nobody"));
+    EXPECT_TRUE(catalog.returnAsset(id, "U1"));
+    EXPECT_EQ(catalog.findAsset(id)->onLoan(), 0);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/UserRepository.h"
+#include "../util/Trace.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+std::size_t count(const std::string& haystack, const std::string& needle) {
+    std::size_t n = 0;
+    for (auto pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1)) ++n;
+    return n;
+}
+
+}  // namespace
+
+TEST(TraceTest, DisabledSpansRecordNothing) {
+    Tracer::stop();
+    Tracer::clear();
+    {
+        TraceSpan outer("outer", "test");
+        TraceSpan inner("inner", "test", "detail");
+    }
+    EXPECT_EQ(Tracer::eventCount(), 0u);
+}
+
+TEST(TraceTest, ExportsSpansFromEveryThreadAndSqlite) {
+    Tracer::clear();
+    Tracer::start();
+    {
+        TraceSpan span("test::outer", "test", "say \"hi\"");
+        TraceSpan inner("test::inner", "test");
+    }
+    std::thread([] {
+        Tracer::nameThread("worker");
+        TraceSpan span("test::worker", "test");
+    }).join();
+    {
+        // Opened while tracing, so its statements are traced too.
+        auto db = std::make_shared<DatabaseManager>(":memory:");
+        db->initializeSchema();
+        UserRepository users(db);
+        users.add({"U1", "Ann", Role::User, "x"});
+        EXPECT_TRUE(users.find("U1"));
+    }
+    Tracer::stop();
+
+    auto path = (std::filesystem::temp_directory_path() / "trace_test.json").string();
+    ASSERT_TRUE(Tracer::writeChromeJson(path));
+    auto json = readFile(path);
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(count(json, "\"name\":\"test::outer\""), 1u);
+    EXPECT_NE(json.find("\"args\":{\"detail\":\"say \\\"hi\\\"\"}"), std::string::npos);
+    EXPECT_EQ(count(json, "\"name\":\"test::inner\""), 1u);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"worker\"}"), std::string::npos);
+    EXPECT_EQ(count(json, "\"name\":\"UserRepository::add\""), 1u);
+    EXPECT_GE(count(json, "\"name\":\"DatabaseManager::write\""), 1u);
+    EXPECT_GE(count(json, "\"cat\":\"sqlite\""), 3u);   // schema, insert, lookup
+    EXPECT_NE(json.find("\"name\":\"COMMIT;\""), std::string::npos);
+    EXPECT_NE(json.find("\"droppedSpans\":0"), std::string::npos);
+
+    // Once stopped, nothing more is recorded.
+    auto before = Tracer::eventCount();
+    { TraceSpan late("late", "test"); }
+    EXPECT_EQ(Tracer::eventCount(), before);
+    Tracer::clear();
+}
@@ -3,6 +3,9 @@
 #include "../persistence/UserRepository.h"
 #include "../models/User.h"
 #include "../util/Security.h"
+#include "../util/TrigramIndex.h"
+
+#include <stdexcept>
 
 TEST(UserRepositoryTest, AddFind) {
     ASSERT_TRUE(initCrypto());
@@ -19,5 +22,49 @@ TEST(UserRepositoryTest, AddFind) {
     EXPECT_EQ(opt->id(), "u1");
     EXPECT_EQ(opt->name(), "Alice");
     EXPECT_EQ(opt->role(), Role::User);
-    EXPECT_TRUE(verifyPassword(opt->passwordHash(), "password"));
-}
\ No newline at end of file
+    EXPECT_TRUE(verifyPassword(std::string(opt->passwordHash()), "password"));
+}
+TEST(UserRepositoryTest, SearchByNameToleratesTypos) {
+    auto db = std::make_shared<DatabaseManager>(":memory:");
+    db->initializeSchema();
+    UserRepository repo(db);
+
+    repo.add({"u1", "John Smith", Role::User, "h"});
+    repo.add({"u2", "Joan Smithers", Role::User, "h"});
+    auto first = repo.searchByName("jon smith");   // builds the index
+    ASSERT_FALSE(first.empty());
+    EXPECT_EQ(first[0].key, "u1");
+
+    // Users added after the index exists are found too.
+    repo.add({"u3", "Margaret Atwood", Role::Staff, "h"});
+    auto typo = repo.searchByName("Atwod");
+    ASSERT_EQ(typo.size(), 1u);
+    EXPECT_EQ(typo[0].key, "u3");
+    EXPECT_EQ(typo[0].distance, 1);
+
+    // Adjacent swaps count as a single edit.
+    auto swapped = repo.searchByName("smtih");
+    ASSERT_GE(swapped.size(), 1u);
+    EXPECT_EQ(swapped[0].key, "u1");
+
+    EXPECT_TRUE(repo.searchByName("zzzzzz").empty());
+
+    // A user whose insert is rolled back with its enclosing write is not.
+    EXPECT_THROW(db->write([&] {
+        repo.add({"u4", "Alice Munro", Role::User, "h"});
+        throw std::runtime_error("abort");
+    }), std::runtime_error);
+    EXPECT_FALSE(repo.find("u4").has_value());
+    EXPECT_TRUE(repo.searchByName("Alice Munro").empty());
+}
+
+TEST(UserRepositoryTest, EditDistanceStopsAtTheLimit) {
+    EXPECT_EQ(editDistance("smith", "smith"), 0);
+    EXPECT_EQ(editDistance("smith", "smtih"), 1);     // adjacent swap
+    EXPECT_EQ(editDistance("smith", "smithers"), 3);
+    EXPECT_EQ(editDistance("kitten", "sitting"), 3);
+    EXPECT_EQ(editDistance("kitten", "sitting", 2), 3);   // limit + 1
+    EXPECT_EQ(editDistance("abcdef", "badcfe", 3), 3);
+    EXPECT_EQ(editDistance("abcdef", "badcfe", 2), 3);
+    EXPECT_EQ(editDistance("", "abc", 1), 2);
+}
@@ -0,0 +1,89 @@
+// Checks that loans, holds, shelf counters and type totals agree, and with
+// --repair fixes what doesn't. Exits 0 when the database is (or was made)
+// consistent, 1 when issues remain, 2 on bad usage.
+//
+// usage: checkdb [--db PATH] [--threads N] [--show N] [--repair]
+#include "../persistence/ConsistencyChecker.h"
+#include "../persistence/DatabaseManager.h"
+
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+static void print(const ConsistencyReport& report, std::size_t show) {
+    std::cout << report.assets << " assets, " << report.loans << " loans, " << report.holds << " holds, "
+              << report.users << " users checked in " << std::fixed << std::setprecision(1) << report.elapsedMs
+              << " ms\n";
+    std::map<ConsistencyIssue::Kind, std::size_t> counts;
+    for (auto& issue : report.issues) ++counts[issue.kind];
+    for (auto& [kind, n] : counts)
+        std::cout << std::left << std::setw(20) << consistencyIssueName(kind) << std::right << std::setw(10) << n
+                  << "\n";
+    if (report.dropped) std::cout << std::left << std::setw(20) << "not listed" << std::right << std::setw(10)
+                                  << report.dropped << "\n";
+    for (std::size_t i = 0; i < std::min(show, report.issues.size()); ++i) {
+        auto& issue = report.issues[i];
+        std::cout << "  " << consistencyIssueName(issue.kind) << " " << issue.id;
+        switch (issue.kind) {
+            case ConsistencyIssue::Kind::ShelfCount:
+            case ConsistencyIssue::Kind::TypeCopies:
+            case ConsistencyIssue::Kind::TypeOnLoan:
+                std::cout << ": recorded " << issue.recorded << ", expected " << issue.expected;
+                break;
+            default:
+                std::cout << ": asset " << issue.assetId << ", user " << issue.userId;
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string dbPath = "library.db";
+    CheckOptions options;
+    std::size_t show = 20;
+    bool repair = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        try {
+            if (a == "--db") dbPath = value();
+            else if (a == "--threads") options.threads = std::stoul(value());
+            else if (a == "--show") show = std::stoul(value());
+            else if (a == "--repair") repair = true;
+            else {
+                std::cerr << "unknown argument " << a << "\n";
+                return 2;
+            }
+        } catch (const std::logic_error&) {
+            std::cerr << a << " takes a number\n";
+            return 2;
+        }
+    }
+
+    if (!std::filesystem::exists(dbPath)) {
+        std::cerr << dbPath << ": no such database\n";
+        return 1;
+    }
+    try {
+        auto db = std::make_shared<DatabaseManager>(dbPath);
+        ConsistencyChecker checker(db, options);
+        auto report = checker.check();
+        print(report, show);
+        if (report.clean() || !repair) return report.clean() ? 0 : 1;
+
+        std::cout << "repaired " << checker.repair(report) << " rows\n";
+        // What was past maxIssues is fixed on a later pass.
+        report = checker.check();
+        print(report, show);
+        return report.clean() ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,61 @@
+// Exports tables for reporting instead of ad-hoc sqlite3 shell dumps. All
+// tables named are read from one snapshot; see Exporter for the formats.
+//
+// usage: dump [--db PATH] [--out DIR] [--format csv|jsonl|columnar] [--gzip]
+//             [assets|users|loans|active ...]   (default: all four)
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/Exporter.h"
+
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::string dbPath = "library.db", outDir = "export";
+    ExportOptions options;
+    std::vector<ExportTable> tables;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) { std::cerr << "missing value for " << a << "\n"; std::exit(2); }
+            return argv[++i];
+        };
+        if (a == "--db") dbPath = value();
+        else if (a == "--out") outDir = value();
+        else if (a == "--gzip") options.gzip = true;
+        else if (a == "--format") {
+            auto f = parseExportFormat(value());
+            if (!f) { std::cerr << "format must be csv, jsonl or columnar\n"; return 2; }
+            options.format = *f;
+        } else if (auto t = parseExportTable(a)) {
+            tables.push_back(*t);
+        } else {
+            std::cerr << "unknown argument " << a << "\n";
+            return 2;
+        }
+    }
+    if (tables.empty()) tables = {ExportTable::Assets, ExportTable::Users, ExportTable::Loans, ExportTable::Active};
+    if (options.gzip && !Exporter::gzipAvailable()) {
+        std::cerr << "built without zlib; --gzip is unavailable\n";
+        return 2;
+    }
+
+    if (!std::filesystem::exists(dbPath)) {
+        std::cerr << dbPath << ": no such database\n";
+        return 1;
+    }
+    try {
+        auto db = std::make_shared<DatabaseManager>(dbPath);
+        Exporter exporter(db, options);
+        for (auto& s : exporter.run(tables, outDir))
+            std::cout << std::left << std::setw(28) << s.path << std::right << std::setw(10) << s.rows << " rows "
+                      << std::setw(12) << s.bytes << " bytes " << std::fixed << std::setprecision(1)
+                      << std::setw(9) << s.elapsedMs << " ms\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
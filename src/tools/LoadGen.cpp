@@ -0,0 +1,393 @@
+// Load generator: synthesizes a catalog with skewed (Zipf) popularity and
+// replays a weighted operation mix against the core library from many
+// threads, then reports throughput, latency percentiles and database growth.
+//
+// usage: loadgen [--db PATH] [--profile default|durable|balanced|fast]
+//                [--assets N] [--users N] [--loans N]
+//                [--threads N] [--connections N] [--ops N]
+//                [--mix issue=40,return=35,search=20,list=0,overdue=5]
+//                [--zipf S] [--group-commit MS] [--seed N] [--keep]
+//                [--replica PATH]
+#include "../persistence/DatabaseManager.h"
+#include "../persistence/Replicator.h"
+#include "../persistence/AssetRepository.h"
+#include "../persistence/UserRepository.h"
+#include "../services/LoanService.h"
+#include "../services/NotificationService.h"
+#include "../models/Asset.h"
+#include "../models/User.h"
+#include "../util/Arena.h"
+#include "../util/Security.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using SteadyClock = std::chrono::steady_clock;
+
+enum Op { Issue, Return, Search, List, Overdue, OpCount };
+static const char* opNames[OpCount] = {"issue", "return", "search", "list", "overdue"};
+
+struct Options {
+    std::string       dbPath      = "loadgen.db";
+    DurabilityProfile profile     = DurabilityProfile::Balanced;
+    long              assets      = 100000;
+    long              users       = 10000;
+    long              loans       = 20000;
+    int               threads     = 8;
+    int               connections = 1;
+    long              ops         = 200000;
+    std::array<int, OpCount> mix  = {40, 35, 20, 0, 5};
+    double            zipf        = 1.1;
+    int               groupCommitMs = 0;
+    unsigned          seed        = 42;
+    bool              keep        = false;
+    std::string       replicaPath;
+};
+
+// A connection and the services bound to it, like one desk terminal.
+struct Session {
+    std::shared_ptr<DatabaseManager>     db;
+    std::shared_ptr<AssetRepository>     assets;
+    std::shared_ptr<UserRepository>      users;
+    std::unique_ptr<LoanService>         loans;
+    std::unique_ptr<NotificationService> notifier;
+};
+
+static Session openSession(const Options& o) {
+    Session s;
+    s.db       = std::make_shared<DatabaseManager>(o.dbPath, o.profile);
+    s.db->initializeSchema();
+    s.assets   = std::make_shared<AssetRepository>(s.db);
+    s.users    = std::make_shared<UserRepository>(s.db);
+    s.loans    = std::make_unique<LoanService>(s.assets, s.users);
+    s.notifier = std::make_unique<NotificationService>(s.assets, s.users,
+                     std::vector<std::shared_ptr<NotificationStrategy>>{});
+    if (o.groupCommitMs > 0)
+        s.db->enableGroupCommit(std::chrono::milliseconds(o.groupCommitMs));
+    return s;
+}
+
+// Samples ranks 0..n-1 with P(r) ~ 1/(r+1)^s.
+class ZipfSampler {
+public:
+    ZipfSampler(long n, double s) : _cdf(static_cast<size_t>(n)) {
+        double sum = 0;
+        for (long r = 0; r < n; ++r) {
+            sum += 1.0 / std::pow(static_cast<double>(r + 1), s);
+            _cdf[r] = sum;
+        }
+        for (auto& c : _cdf) c /= sum;
+    }
+    template <class Rng>
+    long operator()(Rng& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return std::lower_bound(_cdf.begin(), _cdf.end(), u) - _cdf.begin();
+    }
+private:
+    std::vector<double> _cdf;
+};
+
+// Spreads popular ranks over the ID space so hot assets aren't all adjacent.
+static long scatter(long rank, long n) {
+    return static_cast<long>((static_cast<unsigned long long>(rank) * 2654435761ULL) % n);
+}
+static std::string assetId(long i) { return "A" + std::to_string(i); }
+static std::string userId(long i)  { return "U" + std::to_string(i); }
+
+static const char* titleWords[] = {
+    "Silent", "River", "Empire", "Garden", "Shadow", "Winter", "Machine", "Ocean", "Secret",
+    "Night", "Stone", "Glass", "Fire", "Iron", "Summer", "Lost", "City", "Star", "Memory", "Code"};
+static const char* surnames[] = {
+    "Herbert", "Orwell", "Austen", "Le Guin", "Tolkien", "Morrison", "Atwood", "Ishiguro",
+    "Murakami", "Adichie", "Borges", "Calvino", "Woolf", "Achebe", "Okri", "Rushdie"};
+
+static std::string makeTitle(std::mt19937_64& rng) {
+    std::uniform_int_distribution<size_t> w(0, std::size(titleWords) - 1);
+    return std::string("The ") + titleWords[w(rng)] + " " + titleWords[w(rng)];
+}
+
+static sqlite3_int64 dbBytes(const std::string& path) {
+    sqlite3_int64 total = 0;
+    for (auto suffix : {"", "-wal"}) {
+        std::error_code ec;
+        auto sz = fs::file_size(path + suffix, ec);
+        if (!ec) total += static_cast<sqlite3_int64>(sz);
+    }
+    return total;
+}
+
+static void synthesize(const Options& o, Session& s) {
+    std::mt19937_64 rng(o.seed);
+    std::uniform_int_distribution<size_t> sn(0, std::size(surnames) - 1);
+    const long chunk = 10000;
+
+    std::cerr << "synthesizing " << o.assets << " assets, " << o.users << " users, "
+              << o.loans << " loans...\n";
+    for (long base = 0; base < o.assets; base += chunk) {
+        s.db->write([&] {
+            for (long i = base; i < std::min(base + chunk, o.assets); ++i) {
+                bool laptop = i % 10 == 0;
+                s.assets->add({assetId(i), laptop ? AssetType::Laptop : AssetType::Book,
+                               laptop ? "Laptop " + std::to_string(i) : makeTitle(rng),
+                               laptop ? "IT Desk" : surnames[sn(rng)]});
+            }
+        });
+    }
+
+    // Hashing is deliberately slow; every synthetic user shares one hash.
+    const std::string hash = hashPassword("loadgen");
+    for (long base = 0; base < o.users; base += chunk) {
+        s.db->write([&] {
+            for (long i = base; i < std::min(base + chunk, o.users); ++i)
+                s.users->add({userId(i), "Patron " + std::to_string(i), Role::User, hash});
+        });
+    }
+
+    ZipfSampler popularity(o.assets, o.zipf);
+    std::uniform_int_distribution<long> anyUser(0, o.users - 1);
+    for (long base = 0; base < o.loans; base += chunk) {
+        s.db->write([&] {
+            for (long i = base; i < std::min(base + chunk, o.loans); ++i)
+                s.loans->issueAsset(assetId(scatter(popularity(rng), o.assets)), userId(anyUser(rng)));
+        });
+    }
+}
+
+static Op pickOp(const std::array<int, OpCount>& mix, int total, std::mt19937_64& rng) {
+    int x = std::uniform_int_distribution<int>(0, total - 1)(rng);
+    for (int i = 0; i < OpCount; ++i) {
+        if (x < mix[i]) return static_cast<Op>(i);
+        x -= mix[i];
+    }
+    return Issue;
+}
+
+struct ThreadStats {
+    std::array<std::vector<std::int64_t>, OpCount> latencyNs;
+    std::array<long, OpCount> failed{};
+};
+
+static void worker(const Options& o, Session& s, const ZipfSampler& popularity,
+                   long ops, unsigned seed, ThreadStats& out) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<long> anyUser(0, o.users - 1);
+    int total = 0;
+    for (int w : o.mix) total += w;
+    std::vector<std::string> mine; // assets this thread issued, returned later
+
+    for (long n = 0; n < ops; ++n) {
+        Op op = pickOp(o.mix, total, rng);
+        bool ok = true;
+        auto start = SteadyClock::now();
+        std::optional<CommandArena> arena(std::in_place);   // one per request, as the CLI has one per command
+        switch (op) {
+            case Issue: {
+                auto aid = assetId(scatter(popularity(rng), o.assets));
+                ok = s.loans->issueAsset(aid, userId(anyUser(rng)));
+                if (ok) mine.push_back(aid);
+                break;
+            }
+            case Return: {
+                std::string aid;
+                if (!mine.empty()) {
+                    size_t i = std::uniform_int_distribution<size_t>(0, mine.size() - 1)(rng);
+                    aid = mine[i];
+                    mine[i] = mine.back();
+                    mine.pop_back();
+                } else {
+                    aid = assetId(scatter(popularity(rng), o.assets));
+                }
+                ok = s.loans->returnAsset(aid);
+                break;
+            }
+            case Search: {
+                std::uniform_int_distribution<size_t> w(0, std::size(titleWords) - 1);
+                std::string word = titleWords[w(rng)];
+                ok = !s.assets->search(word.substr(0, 4), 20).empty();
+                break;
+            }
+            case List:
+                ok = !s.assets->getAll().empty();
+                break;
+            case Overdue:
+                s.notifier->countOverdue();
+                break;
+            default:
+                break;
+        }
+        arena.reset();   // releasing it is part of the request
+        out.latencyNs[op].push_back((SteadyClock::now() - start).count());
+        if (!ok) ++out.failed[op];
+    }
+}
+
+struct NullBuffer : std::streambuf {
+    int overflow(int c) override { return c; }
+};
+
+static bool parseArgs(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error("missing value for " + a);
+            return argv[++i];
+        };
+        if      (a == "--db")           o.dbPath = next();
+        else if (a == "--profile")      o.profile = stringToDurabilityProfile(next());
+        else if (a == "--assets")       o.assets = std::stol(next());
+        else if (a == "--users")        o.users = std::stol(next());
+        else if (a == "--loans")        o.loans = std::stol(next());
+        else if (a == "--threads")      o.threads = std::stoi(next());
+        else if (a == "--connections")  o.connections = std::stoi(next());
+        else if (a == "--ops")          o.ops = std::stol(next());
+        else if (a == "--zipf")         o.zipf = std::stod(next());
+        else if (a == "--group-commit") o.groupCommitMs = std::stoi(next());
+        else if (a == "--seed")         o.seed = static_cast<unsigned>(std::stoul(next()));
+        else if (a == "--keep")         o.keep = true;
+        else if (a == "--replica")      o.replicaPath = next();
+        else if (a == "--mix") {
+            o.mix.fill(0);
+            std::stringstream ss(next());
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                auto eq = item.find('=');
+                auto name = item.substr(0, eq);
+                auto it = std::find(std::begin(opNames), std::end(opNames), name);
+                if (eq == std::string::npos || it == std::end(opNames))
+                    throw std::runtime_error("bad --mix entry: " + item);
+                o.mix[it - std::begin(opNames)] = std::stoi(item.substr(eq + 1));
+            }
+        } else {
+            std::cerr << "unknown option " << a << "\n";
+            return false;
+        }
+    }
+    if (o.assets <= 0 || o.users <= 0 || o.threads <= 0 || o.connections <= 0)
+        throw std::runtime_error("counts must be positive");
+    int weight = 0;
+    for (int w : o.mix) weight += w;
+    if (weight <= 0) throw std::runtime_error("--mix needs at least one positive weight");
+    return true;
+}
+
+static std::int64_t percentile(const std::vector<std::int64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[idx];
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    try {
+        if (!parseArgs(argc, argv, o)) return 2;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 2;
+    }
+    if (!initCrypto()) throw std::runtime_error("crypto init failed");
+
+    // Services report to stdout; keep it quiet while generating load.
+    NullBuffer sink;
+    auto* coutBuf = std::cout.rdbuf(&sink);
+
+    if (!o.keep && o.dbPath != ":memory:") {
+        for (auto suffix : {"", "-wal", "-shm", "-journal"}) fs::remove(o.dbPath + suffix);
+    }
+    std::vector<Session> sessions;
+    for (int c = 0; c < (o.dbPath == ":memory:" ? 1 : o.connections); ++c)
+        sessions.push_back(openSession(o));
+
+    sqlite3_int64 sizeEmpty = dbBytes(o.dbPath);
+    auto synthStart = SteadyClock::now();
+    if (sessions[0].assets->find(assetId(0)).has_value()) {
+        std::cerr << "reusing existing catalog in " << o.dbPath << "\n";
+    } else {
+        synthesize(o, sessions[0]);
+    }
+    double synthSecs = std::chrono::duration<double>(SteadyClock::now() - synthStart).count();
+    sqlite3_int64 sizeLoaded = dbBytes(o.dbPath);
+    if (!o.replicaPath.empty()) {
+        // Changesets are captured per connection; one keeps them in commit order.
+        if (sessions.size() > 1) throw std::runtime_error("--replica needs --connections 1");
+        sessions[0].db->enableReplication(o.replicaPath);
+    }
+
+    std::cerr << "replaying " << o.ops << " operations on " << o.threads << " threads...\n";
+    ZipfSampler popularity(o.assets, o.zipf);
+    std::vector<ThreadStats> stats(o.threads);
+    std::vector<std::thread> workers;
+    auto runStart = SteadyClock::now();
+    for (int t = 0; t < o.threads; ++t) {
+        long share = o.ops / o.threads + (t < o.ops % o.threads ? 1 : 0);
+        Session& s = sessions[t % sessions.size()];
+        workers.emplace_back(worker, std::cref(o), std::ref(s), std::cref(popularity),
+                             share, o.seed + 1 + t, std::ref(stats[t]));
+    }
+    for (auto& w : workers) w.join();
+    double runSecs = std::chrono::duration<double>(SteadyClock::now() - runStart).count();
+    for (auto& s : sessions) s.db->disableGroupCommit();
+    sqlite3_int64 sizeAfter = dbBytes(o.dbPath);
+
+    double catchUpMs = 0;
+    ReplicationStats repl;
+    if (auto r = sessions[0].db->replicator()) {
+        auto flushStart = SteadyClock::now();
+        r->flush();
+        catchUpMs = std::chrono::duration<double, std::milli>(SteadyClock::now() - flushStart).count();
+        repl = r->stats();
+    }
+
+    std::cout.rdbuf(coutBuf);
+
+    std::cout << "\nprofile=" << durabilityProfileToString(o.profile)
+              << " threads=" << o.threads << " connections=" << sessions.size()
+              << " group-commit=" << o.groupCommitMs << "ms zipf=" << o.zipf << "\n"
+              << "synthesis: " << std::fixed << std::setprecision(2) << synthSecs << " s\n"
+              << "replay:    " << runSecs << " s, "
+              << std::setprecision(0) << o.ops / runSecs << " ops/s\n\n"
+              << "op       |    count |  failed |    ops/s |  p50 us |  p95 us |  p99 us |  max us\n"
+              << "----------------------------------------------------------------------------------\n";
+    for (int op = 0; op < OpCount; ++op) {
+        std::vector<std::int64_t> all;
+        long failed = 0;
+        for (auto& st : stats) {
+            all.insert(all.end(), st.latencyNs[op].begin(), st.latencyNs[op].end());
+            failed += st.failed[op];
+        }
+        if (all.empty()) continue;
+        std::sort(all.begin(), all.end());
+        auto us = [](std::int64_t ns) { return ns / 1000; };
+        std::cout << std::left << std::setw(8) << opNames[op] << " | " << std::right
+                  << std::setw(8) << all.size() << " | "
+                  << std::setw(7) << failed << " | "
+                  << std::setw(8) << all.size() / runSecs << " | "
+                  << std::setw(7) << us(percentile(all, 0.50)) << " | "
+                  << std::setw(7) << us(percentile(all, 0.95)) << " | "
+                  << std::setw(7) << us(percentile(all, 0.99)) << " | "
+                  << std::setw(7) << us(all.back()) << "\n";
+    }
+    auto mib = [](sqlite3_int64 b) { return static_cast<double>(b) / (1024 * 1024); };
+    std::cout << std::setprecision(1)
+              << "\ndatabase size: empty " << mib(sizeEmpty) << " MiB, after synthesis "
+              << mib(sizeLoaded) << " MiB, after replay " << mib(sizeAfter) << " MiB\n";
+    if (!o.replicaPath.empty()) {
+        std::cout << "replication: " << repl.applied << "/" << repl.captured << " changesets applied, "
+                  << mib(static_cast<sqlite3_int64>(repl.bytesShipped)) << " MiB shipped, lag last "
+                  << repl.lastLagMs << " ms max " << repl.maxLagMs << " ms, catch-up after replay "
+                  << catchUpMs << " ms, conflicts " << repl.conflicts << "\n";
+    }
+    return 0;
+}
@@ -2,13 +2,21 @@
 #include "Context.h"
 #include "../persistence/DatabaseManager.h"
 #include "../persistence/AssetRepository.h"
+#include "../persistence/ArchiveManager.h"
+#include "../persistence/ChangeWatcher.h"
 #include "../persistence/UserRepository.h"
+#include "../services/HoldService.h"
 #include "../services/LoanService.h"
 #include "../services/NotificationService.h"
+#include "../services/ReportService.h"
+#include "../services/FinesJob.h"
+#include "../services/RecommendationEngine.h"
 #include "../services/EmailNotifier.h"
 #include "../models/Asset.h"
 #include "../models/User.h"
+#include "../util/Arena.h"
 #include "../util/Security.h"
+#include "../util/Trace.h"
 
 #include <filesystem>
 #include <iostream>
@@ -16,52 +24,105 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <charconv>
+#include <ctime>
 
 // Globals for our repos & services
 static std::shared_ptr<AssetRepository>     assetRepoPtr;
 static std::shared_ptr<UserRepository>      userRepoPtr;
+static std::shared_ptr<HoldService>         holdServicePtr;
 static std::unique_ptr<LoanService>         loanServicePtr;
 static std::unique_ptr<NotificationService> notifierPtr;
+static std::unique_ptr<ReportService>       reportServicePtr;
+static std::unique_ptr<FinesJob>            finesJobPtr;
+static std::shared_ptr<RecommendationEngine> recommenderPtr;
+static std::unique_ptr<ArchiveManager>      archivePtr;
+static std::unique_ptr<ChangeWatcher>       changeWatcherPtr;
 static Context                              context;
+static CliOptions                           options;
+static std::string                          recPath;
 
-// Pretty-print helpers
-static void printAssetHeader() {
-    std::cout
-      << "ID    | Type   | Title                  | Author/Owner         | Status    | Borrowed Info\n"
-      << "---------------------------------------------------------------------------------------------\n";
+const char* const cliUsage =
+    "usage: app [--format table|csv|json] [--page-size N] [--trace out.json] [assets|users]\n"
+    "  --format     output of every listing (default table)\n"
+    "  --page-size  table rows shown before asking for more (default: no pager)\n"
+    "  --trace      record spans and write them as Chrome trace JSON on exit\n"
+    "  assets|users print that listing and exit instead of starting the menus\n";
+
+std::optional<CliOptions> parseCliOptions(int argc, char** argv) {
+    CliOptions o;
+    for (int i=1;i<argc;++i) {
+        std::string_view a=argv[i], value;
+        auto flag=[&](std::string_view name){
+            if (a==name && i+1<argc) { value=argv[++i]; return true; }
+            if (a.starts_with(name) && a.size()>name.size() && a[name.size()]=='=') {
+                value=a.substr(name.size()+1); return true;
+            }
+            return false;
+        };
+        if (flag("--format")) {
+            auto f=parseOutputFormat(value);
+            if (!f) return std::nullopt;
+            o.format=*f;
+        } else if (flag("--page-size")) {
+            auto [end,ec]=std::from_chars(value.data(),value.data()+value.size(),o.pageSize);
+            if (ec!=std::errc{} || end!=value.data()+value.size()) return std::nullopt;
+        } else if (flag("--trace")) {
+            if (value.empty()) return std::nullopt;
+            o.tracePath=value;
+        } else if ((a=="assets"||a=="users") && o.command.empty()) {
+            o.command=a;
+        } else return std::nullopt;
+    }
+    return o;
 }
-static void printAssetRow(const std::string& id,
-                          const std::string& type,
-                          const std::string& title,
-                          const std::string& authOwner,
-                          const std::string& status,
-                          const std::string& extra)
-{
-    auto pad = [&](const std::string& s, size_t w){
-        return s.size() >= w ? s.substr(0,w) : s + std::string(w-s.size(),' ');
-    };
-    std::cout
-      << pad(id,5)         << " | "
-      << pad(type,6)       << " | "
-      << pad(title,22)     << " | "
-      << pad(authOwner,20) << " | "
-      << pad(status,9)     << " | "
-      << extra             << "\n";
+
+CLI::CLI(CliOptions o) { options=std::move(o); }
+
+// Listing columns; the last one takes whatever width its value needs.
+static const std::vector<Renderer::Column> assetColumns = {
+    {"ID","id",5}, {"Type","type",6}, {"Title","title",22}, {"Author/Owner","author",20},
+    {"Status","status",9}, {"Borrowed Info","info",0}};
+static const std::vector<Renderer::Column> userColumns = {{"ID","id",5}, {"Name","name",0}};
+
+static bool tableOutput() { return options.format==OutputFormat::Table; }
+
+// "Issued"/"Available" for single items, "<on shelf> of <copies>" for titles.
+static std::string availability(const Asset& a) {
+    if (a.copies()==1) return a.isIssued()?"Issued":"Available";
+    return std::to_string(a.available())+" of "+std::to_string(a.copies());
 }
 
-// User list helpers
-static void printUserHeader() {
-    std::cout
-      << "ID    | Name\n"
-      << "--------------\n";
+static void printReport(const LoanReport& r) {
+    std::cout<<"Type   | Copies | Out  | Util | Borrows | Avg days out\n"
+             <<"-------------------------------------------------------\n";
+    for (auto &t:r.types) {
+        char line[96];
+        std::snprintf(line,sizeof line,"%-6s | %6d | %4d | %3.0f%% | %7ld | %6.1f\n",
+                      assetTypeToString(t.type).c_str(),t.copies,t.onLoan,t.utilization()*100,
+                      t.borrows,t.avgDaysOut());
+        std::cout<<line;
+    }
+    std::cout<<"\nMost borrowed:\n";
+    for (auto &t:r.topTitles)
+        std::cout<<"  "<<t.assetId<<" | "<<t.title<<" | "<<t.borrows<<" loans, "
+                 <<int(t.daysOut())<<" days out\n";
+    std::cout<<"\nDay        | Issued | Returned\n";
+    for (auto &d:r.days) {
+        char day[16]; std::tm tm{}; gmtime_r(&d.day,&tm);
+        std::strftime(day,sizeof day,"%Y-%m-%d",&tm);
+        char line[64];
+        std::snprintf(line,sizeof line,"%s | %6d | %8d\n",day,d.issued,d.returned);
+        std::cout<<line;
+    }
 }
-static void printUserRow(const std::string& id, const std::string& name) {
-    auto pad = [&](const std::string& s, size_t w){
-        return s.size() >= w ? s.substr(0,w) : s + std::string(w - s.size(),' ');
-    };
-    std::cout
-      << pad(id,5) << " | "
-      << name << "\n";
+
+static std::string money(std::int64_t cents) {
+    char s[32]; std::snprintf(s,sizeof s,"$%lld.%02lld",(long long)(cents/100),(long long)(cents%100));
+    return s;
 }
 
 // Helpers
@@ -78,37 +139,169 @@ static std::string readLine() {
     return l.substr(b,e-b+1);
 }
 
+static bool askMore() {
+    std::cout<<"More? (y/n): ";
+    auto yn=readLine();
+    return yn=="y"||yn=="Y";
+}
+
+// A listing in the chosen format, paged by --page-size (or `defaultPage`).
+static Renderer listing(std::vector<Renderer::Column> columns, std::size_t defaultPage=0) {
+    return Renderer(std::cout,options.format,std::move(columns),
+                    options.pageSize?options.pageSize:defaultPage,askMore);
+}
+
+static bool assetRow(Renderer& r, const Asset& a, const std::string& status, const std::string& extra) {
+    return r.row({a.id(),assetTypeToString(a.type()),a.title(),a.authorOrOwner(),status,extra});
+}
+
+// Every asset with who has it (staff), or only what is on the shelf. Walks
+// the catalogue in id order a batch at a time so a large listing never
+// holds it all in memory.
+static void listAssets(bool availableOnly) {
+    auto r=listing(assetColumns);
+    const int batchSize=1000;
+    for (auto batch=assetRepoPtr->page("",batchSize); !batch.empty();
+         batch=assetRepoPtr->page(batch.back().id(),batchSize)) {
+        for (auto &a:batch) {
+            if (availableOnly && a.available()==0) continue;
+            std::string extra;
+            if (!availableOnly && a.onLoan()>0) {
+                if (auto lo=loanServicePtr->loanInfo(a.id()); lo) {
+                    int d=int((loanServicePtr->clock()->now()-lo->issueDate)/86400);
+                    if (a.onLoan()==1) {
+                        auto bo=userRepoPtr->find(lo->userId);
+                        extra="borrowed "+std::to_string(d)+"d by "+std::string(bo?bo->name():lo->userId);
+                    } else {
+                        extra=std::to_string(a.onLoan())+" on loan, oldest "+std::to_string(d)+"d";
+                    }
+                }
+            }
+            if (!assetRow(r,a,availability(a),extra)) return;
+        }
+        if (static_cast<int>(batch.size())<batchSize) break;
+    }
+    r.finish();
+    if (r.rows()==0 && tableOutput()) std::cout<<(availableOnly?"Nothing available.\n":"No assets.\n");
+}
+
+static void listUsers() {
+    auto r=listing(userColumns);
+    for (auto &u:userRepoPtr->getAll())
+        if (!r.row({u.id(),u.name()})) return;
+    r.finish();
+    if (r.rows()==0 && tableOutput()) std::cout<<"No users.\n";
+}
+
+static void printRecommendations(const std::string& assetId) {
+    auto rs=recommenderPtr->recommend(assetId,5);
+    if (rs.empty() && tableOutput()) { std::cout<<"No recommendations yet.\n"; return; }
+    if (tableOutput()) std::cout<<"Readers who borrowed this also borrowed:\n";
+    auto out=listing({{"ID","id",10}, {"Title","title",30}, {"Readers","readers",0}});
+    for (auto &r:rs) {
+        auto ao=assetRepoPtr->find(r.assetId);
+        if (!ao) continue;   // archived since
+        out.row({r.assetId,ao->title(),std::to_string(r.count)});
+    }
+}
+
+// Exact ID match first, otherwise ranked title/author matches a page at a time,
+// retired titles too when includeArchived. Returns true when the query was an asset ID.
+static bool searchAssets(const std::string& query, bool includeArchived=false) {
+    const int pageSize=20;
+    auto r=listing(assetColumns,pageSize);
+    if (auto ao=assetRepoPtr->find(query)) {
+        std::string details;
+        for (auto &[name,value]:assetRepoPtr->attributes(ao->id()))
+            details+=(details.empty()?"":", ")+name+": "+value;
+        assetRow(r,*ao,availability(*ao),details);
+        return true;
+    }
+    for (int offset=0;;offset+=pageSize) {
+        auto hits=assetRepoPtr->searchRanked(query,pageSize,offset,includeArchived);
+        for (auto &h:hits)
+            if (!assetRow(r,h.asset,h.archived?"Archived":availability(h.asset),"")) return false;
+        if (static_cast<int>(hits.size())<pageSize) break;
+    }
+    r.finish();
+    if (r.rows()==0 && tableOutput()) std::cout<<"Not found.\n";
+    return false;
+}
+
 void CLI::printHelp() {
     std::cout << "\nCommands / shortcuts:\n"
-              << "  a / 1  : Add Asset (Book/Laptop)\n"
+              << "  a / 1  : Add Asset (book, laptop, ...)\n"
               << "  u / 2  : Add User\n"
               << "  i / 3  : Issue Asset\n"
               << "  r / 4  : Return Asset\n"
               << "  l / 5  : List Assets\n"
               << "  o / 6  : Show Overdues\n"
-              << "  sa/7   : Search Asset\n"
-              << "  su/8   : Search User\n"
+              << "  sa/7   : Search Asset (ID, title or author)\n"
+              << "  su/8   : Search User (ID or name, typos ok)\n"
               << "  lu/9   : List Users\n"
+              << "  hd     : Place Hold for a user\n"
+              << "  hq     : Show Hold Queue\n"
+              << "  hc     : Cancel Hold\n"
+              << "  rp     : Loan Report\n"
+              << "  fn     : Accrue Fines for today\n"
+              << "  fb     : Show a user's Fines\n"
+              << "  rc     : Recommendations for an asset\n"
+              << "  rt     : Retire Asset (moved to the archive)\n"
+              << "  ar     : Archive retired assets and old loan history now\n"
+              << "  sr     : Search Asset including the archive\n"
               << "  h      : Help\n"
               << "  q      : Quit\n";
 }
 
-void CLI::run() {
-    if (!initCrypto()) throw std::runtime_error("crypto init failed");
-    const std::string ctxFile = "context.txt";
+// Opens library.db in the working directory and wires up the services.
+// The recommender starts empty; run() fills it.
+static void openServices() {
     auto dbPath = std::filesystem::current_path() / "library.db";
-    std::cout << "Welcome! Using database: " << dbPath.string() << "\n";
-    context = loadContext(ctxFile);
-
     auto db = std::make_shared<DatabaseManager>(dbPath.string());
     db->initializeSchema();
-    assetRepoPtr   = std::make_shared<AssetRepository>(db);
-    userRepoPtr    = std::make_shared<UserRepository>(db);
-    loanServicePtr = std::make_unique<LoanService>(assetRepoPtr, userRepoPtr);
+    recPath = (std::filesystem::current_path() / "recommendations.bin").string();
+    recommenderPtr = std::make_shared<RecommendationEngine>();
+    auto events = std::make_shared<EventBus>();
+    assetRepoPtr   = std::make_shared<AssetRepository>(db, events);
+    userRepoPtr    = std::make_shared<UserRepository>(db, events);
 
     std::vector<std::shared_ptr<NotificationStrategy>> strategies;
     strategies.emplace_back(std::make_shared<EmailNotifier>("noreply@library.local"));
-    notifierPtr = std::make_unique<NotificationService>(assetRepoPtr, userRepoPtr, strategies);
+    holdServicePtr = std::make_shared<HoldService>(assetRepoPtr, userRepoPtr, strategies);
+    loanServicePtr = std::make_unique<LoanService>(assetRepoPtr, userRepoPtr, systemClock(), holdServicePtr,
+                                                   recommenderPtr);
+    notifierPtr = std::make_unique<NotificationService>(assetRepoPtr, userRepoPtr, strategies,
+                                                        loanServicePtr->clock());
+    reportServicePtr = std::make_unique<ReportService>(db, loanServicePtr->clock());
+    finesJobPtr = std::make_unique<FinesJob>(db);
+    ArchiveOptions archive;
+    archive.path = (std::filesystem::current_path() / "archive.db").string();
+    archivePtr = std::make_unique<ArchiveManager>(db, archive);
+    changeWatcherPtr = std::make_unique<ChangeWatcher>(db, events);
+}
+
+int CLI::runCommand(const std::string& command) {
+    if (command!="assets" && command!="users") { std::cerr<<cliUsage; return 2; }
+    TraceSpan span("command","cli",command);
+    openServices();
+    CommandArena arena;
+    if (command=="assets") listAssets(false);
+    else                   listUsers();
+    return 0;
+}
+
+void CLI::run() {
+    if (!initCrypto()) throw std::runtime_error("crypto init failed");
+    const std::string ctxFile = "context.txt";
+    std::cout << "Welcome! Using database: " << (std::filesystem::current_path() / "library.db").string() << "\n";
+    context = loadContext(ctxFile);
+
+    openServices();
+    // Other desks and the nightly job write to the same file.
+    changeWatcherPtr->start();
+    auto db = assetRepoPtr->getDb();
+    if (recommenderPtr->load(recPath)) recommenderPtr->catchUp(*db);
+    else                               recommenderPtr->rebuild(*db);
 
     // Bootstrap initial staff
     if (userRepoPtr->getAll().empty()) {
@@ -153,7 +346,7 @@ void CLI::run() {
         if (uid=="q"||uid=="exit") return;
         std::cout<<"Password: "; auto pw=readLine();
         if (auto o=userRepoPtr->find(uid); o) {
-            if (!verifyPassword(o->passwordHash(),pw)) {
+            if (!verifyPassword(std::string(o->passwordHash()),pw)) {
                 std::cout<<"Invalid password.\n"; continue;
             }
             current=*o;
@@ -176,6 +369,7 @@ void CLI::run() {
     }
 
     saveContext(ctxFile,context);
+    recommenderPtr->save(recPath);
 }
 
 void CLI::runStaffMenu(const User& u) {
@@ -188,151 +382,257 @@ void CLI::runStaffMenu(const User& u) {
         std::cout<<"\n[Staff] (h=help) > ";
         std::string cmd; std::cin>>cmd; std::cin.ignore();
         cmd=normalize(cmd);
-        if (cmd=="h"||cmd=="help")          { printHelp(); continue; }
-        if (cmd=="1"||cmd=="a"||cmd=="add_asset") {
-            int t; std::cout<<"Type 1)Book 2)Laptop: "; std::cin>>t; std::cin.ignore();
-            std::string id; std::cout<<"Asset ID: "; std::cin>>id; std::cin.ignore();
-            if (assetRepoPtr->find(id)) { std::cout<<"Exists.\n"; continue; }
-            std::string title,owner;
-            if (t==1) {
-                std::cout<<"Title: "; std::getline(std::cin,title);
-                std::cout<<"Author: "; std::getline(std::cin,owner);
-                assetRepoPtr->add({id,AssetType::Book,title,owner});
-                std::cout<<"Added book.\n";
-            } else {
-                std::cout<<"Model: "; std::getline(std::cin,title);
-                std::cout<<"Info: ";  std::getline(std::cin,owner);
-                assetRepoPtr->add({id,AssetType::Laptop,title,owner});
-                std::cout<<"Added laptop.\n";
+        TraceSpan span("command","cli",cmd);
+        CommandArena arena;   // what the command reads is freed here, in one go
+        // A failed command (a busy database, say) is reported; the session goes on.
+        try {
+            if (cmd=="h"||cmd=="help")          { printHelp(); continue; }
+            if (cmd=="1"||cmd=="a"||cmd=="add_asset") {
+                std::cout<<"Type";
+                for (auto &t:assetTypes)
+                    if (t.type!=AssetType::Unknown) std::cout<<" "<<assetTypeToCode(t.type)<<")"<<t.label;
+                std::cout<<": ";
+                auto t=normalize(readLine());
+                auto type=std::isdigit(static_cast<unsigned char>(t[0]))?codeToAssetType(std::atoi(t.c_str()))
+                                                                       :stringToAssetType(t);
+                if (type==AssetType::Unknown) { std::cout<<"Unknown type.\n"; continue; }
+                auto &info=assetTypeInfo(type);
+                std::string id; std::cout<<"Asset ID: "; std::cin>>id; std::cin.ignore();
+                if (assetRepoPtr->find(id)) { std::cout<<"Exists.\n"; continue; }
+                std::string title,owner;
+                std::cout<<info.titleLabel<<": "; std::getline(std::cin,title);
+                std::cout<<info.ownerLabel<<": "; std::getline(std::cin,owner);
+                int copies=1;
+                if (info.copies) {
+                    std::cout<<"Copies [1]: "; auto n=readLine();
+                    copies=n.empty()?1:std::max(1,std::atoi(n.c_str()));
+                }
+                AssetAttributes attrs;
+                for (auto name:info.attributes) {
+                    if (name.empty()) break;
+                    std::cout<<name<<": "; auto v=readLine();
+                    if (!v.empty()) attrs.emplace_back(name,v);
+                }
+                assetRepoPtr->add({id,type,title,owner,copies,copies},attrs);
+                std::cout<<"Added "<<info.name<<".\n";
+                context.lastAsset=id;
             }
-            context.lastAsset=id;
-        }
-        else if (cmd=="2"||cmd=="u"||cmd=="add_user") {
-            std::string id,name,pw;
-            std::cout<<"User ID: "; std::cin>>id; std::cin.ignore();
-            if (userRepoPtr->find(id)) { std::cout<<"Exists.\n"; continue; }
-            std::cout<<"Name: "; std::getline(std::cin,name);
-            std::cout<<"Password: "; std::cin>>pw;
-            userRepoPtr->add({id,name,Role::User,hashPassword(pw)});
-            std::cout<<"Added user.\n";
-            context.lastUser=id;
-        }
-        else if (cmd=="3"||cmd=="i"||cmd=="issue") {
-            std::string aid,uid;
-            std::cout<<"Asset ID: "; std::cin>>aid;
-            std::cout<<"User ID: "; std::cin>>uid;
-            if (loanServicePtr->issueAsset(aid,uid)) {
-                std::cout<<"Issued.\n";
-                context.lastAsset=aid;
+            else if (cmd=="2"||cmd=="u"||cmd=="add_user") {
+                std::string id,name,pw;
+                std::cout<<"User ID: "; std::cin>>id; std::cin.ignore();
+                if (userRepoPtr->find(id)) { std::cout<<"Exists.\n"; continue; }
+                std::cout<<"Name: "; std::getline(std::cin,name);
+                std::cout<<"Password: "; std::cin>>pw;
+                userRepoPtr->add({id,name,Role::User,hashPassword(pw)});
+                std::cout<<"Added user.\n";
+                context.lastUser=id;
             }
-        }
-        else if (cmd=="4"||cmd=="r"||cmd=="return") {
-            std::string aid; char c;
-            std::cout<<"Asset ID: "; std::cin>>aid;
-            std::cout<<"Confirm? (y/n): "; std::cin>>c;
-            if (c=='y'||c=='Y') { loanServicePtr->returnAsset(aid); std::cout<<"Returned.\n"; }
-        }
-        else if (cmd=="5"||cmd=="l"||cmd=="list") {
-            auto all=assetRepoPtr->getAll();
-            if (all.empty()) { std::cout<<"No assets.\n"; continue; }
-            printAssetHeader();
-            for (auto &a:all) {
-                std::string st=a.isIssued()?"Issued":"Available", extra;
-                if (a.isIssued()) {
-                    if (auto lo=loanServicePtr->loanInfo(a.id()); lo) {
-                        int d=int((std::time(nullptr)-lo->issueDate)/86400);
-                        extra="borrowed "+std::to_string(d)+"d by "+userRepoPtr->find(lo->userId)->name();
+            else if (cmd=="3"||cmd=="i"||cmd=="issue") {
+                std::string aid,uid;
+                std::cout<<"Asset ID: "; std::cin>>aid;
+                std::cout<<"User ID: "; std::cin>>uid;
+                if (loanServicePtr->issueAsset(aid,uid)) {
+                    std::cout<<"Issued.\n";
+                    context.lastAsset=aid;
+                }
+            }
+            else if (cmd=="4"||cmd=="r"||cmd=="return") {
+                std::string aid; char c;
+                std::cout<<"Asset ID: "; std::cin>>aid; std::cin.ignore();
+                std::cout<<"User ID (Enter if one borrower): "; auto uid=readLine();
+                std::cout<<"Confirm? (y/n): "; std::cin>>c;
+                if ((c=='y'||c=='Y') && loanServicePtr->returnAsset(aid,uid)) std::cout<<"Returned.\n";
+            }
+            else if (cmd=="5"||cmd=="l"||cmd=="list") {
+                listAssets(false);
+            }
+            else if (cmd=="6"||cmd=="o"||cmd=="overdue") {
+                notifierPtr->checkAndNotifyOverdue();
+            }
+            else if (cmd=="7"||cmd=="sa"||cmd=="search_asset") {
+                std::cout<<"Asset ID or title/author: ";
+                auto q=readLine();
+                if (searchAssets(q)) context.lastAsset=q;
+            }
+            else if (cmd=="8"||cmd=="su"||cmd=="search_user") {
+                std::cout<<"User ID or name: ";
+                auto q=readLine();
+                if (auto uo=userRepoPtr->find(q)) {
+                    listing(userColumns).row({uo->id(),uo->name()});
+                    context.lastUser=q;
+                } else if (auto ms=userRepoPtr->searchByName(q); !ms.empty()) {
+                    auto r=listing(userColumns);
+                    for (auto &m:ms) r.row({m.key,m.text});
+                } else std::cout<<"Not found.\n";
+            }
+            else if (cmd=="9"||cmd=="lu"||cmd=="list_users") {
+                listUsers();
+            }
+            else if (cmd=="hd"||cmd=="hold") {
+                std::string aid,uid; int prio=0;
+                std::cout<<"Asset ID: "; std::cin>>aid;
+                std::cout<<"User ID: "; std::cin>>uid; std::cin.ignore();
+                std::cout<<"Priority [0]: "; auto p=readLine();
+                if (!p.empty()) prio=std::atoi(p.c_str());
+                if (holdServicePtr->placeHold(aid,uid,prio)) std::cout<<"Hold placed.\n";
+            }
+            else if (cmd=="hq"||cmd=="holds") {
+                std::string aid; std::cout<<"Asset ID: "; std::cin>>aid; std::cin.ignore();
+                auto hs=holdServicePtr->holdsFor(aid);
+                if (hs.empty() && tableOutput()) { std::cout<<"No holds.\n"; continue; }
+                auto r=listing({{"Position","position",8}, {"User","user",12}, {"Priority","priority",0}});
+                int pos=0;
+                for (auto &h:hs)
+                    if (!r.row({h.readyAt?"ready":"#"+std::to_string(++pos),h.userId,std::to_string(h.priority)}))
+                        break;
+            }
+            else if (cmd=="hc"||cmd=="cancel_hold") {
+                std::string aid,uid;
+                std::cout<<"Asset ID: "; std::cin>>aid;
+                std::cout<<"User ID: "; std::cin>>uid;
+                std::cout<<(holdServicePtr->cancelHold(aid,uid)?"Hold cancelled.\n":"No such hold.\n");
+            }
+            else if (cmd=="rp"||cmd=="report") {
+                printReport(reportServicePtr->report());
+            }
+            else if (cmd=="fn"||cmd=="fines") {
+                try {
+                    auto r=finesJobPtr->run(loanServicePtr->clock()->now());
+                    if (r.alreadyRun) std::cout<<"Fines already accrued today.\n";
+                    std::cout<<r.accruals<<" of "<<r.loans<<" loans charged, "<<money(r.totalCents)
+                             <<" ("<<int(r.elapsedMs)<<" ms)\n";
+                } catch (const std::exception& e) {
+                    std::cout<<"Fines run failed: "<<e.what()<<"\n";
+                }
+            }
+            else if (cmd=="fb"||cmd=="fine_balance") {
+                std::string uid; std::cout<<"User ID: "; std::cin>>uid; std::cin.ignore();
+                {
+                    auto r=listing({{"Day","day",10}, {"Asset","asset",10}, {"Overdue","days_overdue",7},
+                                    {"Fine","fine",0}});
+                    for (auto &f:finesJobPtr->ledger(uid)) {
+                        time_t day=f.day*86400; char date[16]; std::tm tm{}; gmtime_r(&day,&tm);
+                        std::strftime(date,sizeof date,"%Y-%m-%d",&tm);
+                        if (!r.row({date,f.assetId,std::to_string(f.daysOverdue)+"d",money(f.cents)})) break;
                     }
                 }
-                printAssetRow(a.id(),assetTypeToString(a.type()),a.title(),a.authorOrOwner(),st,extra);
+                if (tableOutput()) std::cout<<"Balance: "<<money(finesJobPtr->balance(uid))<<"\n";
             }
-        }
-        else if (cmd=="6"||cmd=="o"||cmd=="overdue") {
-            notifierPtr->checkAndNotifyOverdue();
-        }
-        else if (cmd=="7"||cmd=="sa"||cmd=="search_asset") {
-            std::string aid; std::cout<<"Asset ID: "; std::cin>>aid;
-            if (auto ao=assetRepoPtr->find(aid)) {
-                auto &a=*ao;
-                std::cout<<a.id()<<" | "<<assetTypeToString(a.type())
-                         <<" | "<<a.title()<<" | "<<a.authorOrOwner()
-                         <<" | "<<(a.isIssued()?"Issued":"Available")<<"\n";
-                context.lastAsset=aid;
-            } else std::cout<<"Not found.\n";
-        }
-        else if (cmd=="8"||cmd=="su"||cmd=="search_user") {
-            std::string uid; std::cout<<"User ID: "; std::cin>>uid;
-            if (auto uo=userRepoPtr->find(uid)) {
-                std::cout<<uo->id()<<" | "<<uo->name()<<"\n";
-                context.lastUser=uid;
-            } else std::cout<<"Not found.\n";
-        }
-        else if (cmd=="9"||cmd=="lu"||cmd=="list_users") {
-            auto us=userRepoPtr->getAll();
-            if (us.empty()) { std::cout<<"No users.\n"; continue; }
-            printUserHeader();
-            for (auto &u:us) printUserRow(u.id(),u.name());
-        }
-        else if (cmd=="q"||cmd=="exit") {
-            std::cout<<"Goodbye, "<<u.name()<<"!\n";
-            break;
-        }
-        else {
-            std::cout<<"Unknown. 'h' for help.\n";
+            else if (cmd=="rc"||cmd=="recommend") {
+                std::string aid; std::cout<<"Asset ID: "; std::cin>>aid; std::cin.ignore();
+                printRecommendations(aid);
+            }
+            else if (cmd=="rt"||cmd=="retire") {
+                std::string aid; std::cout<<"Asset ID: "; std::cin>>aid; std::cin.ignore();
+                std::cout<<"Retire "<<aid<<"? (y/n): "; auto yn=readLine();
+                if (yn!="y" && yn!="Y") continue;
+                if (!archivePtr->retire(aid)) {
+                    std::cout<<"Not retired: unknown, already retired, on loan or on hold.\n"; continue;
+                }
+                archivePtr->archiveNow();   // moves it in the background
+                std::cout<<"Retired; moving to the archive.\n";
+            }
+            else if (cmd=="ar"||cmd=="archive") {
+                try {
+                    auto s=archivePtr->archiveNow().get();
+                    std::cout<<s.assets<<" assets and "<<s.loanRecords<<" loan records archived ("
+                             <<int(s.elapsedMs)<<" ms)\n";
+                } catch (const std::exception& e) {
+                    std::cout<<"Archiving failed: "<<e.what()<<"\n";
+                }
+            }
+            else if (cmd=="sr"||cmd=="search_archive") {
+                std::cout<<"Title/author: ";
+                searchAssets(readLine(),true);
+            }
+            else if (cmd=="q"||cmd=="exit") {
+                std::cout<<"Goodbye, "<<u.name()<<"!\n";
+                break;
+            }
+            else {
+                std::cout<<"Unknown. 'h' for help.\n";
+            }
+        } catch (const std::exception& e) {
+            std::cout<<"Command failed: "<<e.what()<<"\n";
         }
     }
 }
 
 void CLI::runUserMenu(const User& u) {
+    const std::string uid(u.id());
     std::cout<<"\n[User] Welcome, "<<u.name()<<"!\n";
     while (true) {
-        std::cout<<"\n1) List Avail 2) Search 3) Issue 4) My Loans 5) Return 6) Exit\n> ";
+        std::cout<<"\n1) List Avail 2) Search 3) Issue 4) My Loans 5) Return 6) Exit 7) Cancel Hold 8) Also Borrowed\n> ";
         int c; if (!(std::cin>>c)) return;
-        switch(c) {
-            case 1: {
-                printAssetHeader();
-                for (auto &a:assetRepoPtr->getAll())
-                    if (!a.isIssued())
-                        printAssetRow(a.id(),assetTypeToString(a.type()),a.title(),a.authorOrOwner(),"Available","");
-                break;
-            }
-            case 2: {
-                std::string aid; std::cout<<"Asset ID: "; std::cin>>aid;
-                if (auto ao=assetRepoPtr->find(aid)) {
-                    auto &a=*ao;
-                    std::cout<<a.id()<<" | "<<assetTypeToString(a.type())
-                             <<" | "<<a.title()<<" | "<<a.authorOrOwner()
-                             <<" | "<<(a.isIssued()?"Issued":"Available")<<"\n";
-                } else std::cout<<"Not found.\n";
-                break;
-            }
-            case 3: {
-                std::string aid; std::cout<<"Asset ID: "; std::cin>>aid;
-                if (loanServicePtr->issueAsset(aid,u.id()))
-                    std::cout<<"✅ Borrowed "<<aid<<"\n";
-                break;
-            }
-            case 4: {
-                printAssetHeader();
-                for (auto &a:assetRepoPtr->getAll())
-                    if (a.isIssued() && loanServicePtr->loanInfo(a.id())->userId==u.id()) {
-                        int d=int((std::time(nullptr)-loanServicePtr->loanInfo(a.id())->issueDate)/86400);
-                        printAssetRow(a.id(),assetTypeToString(a.type()),a.title(),a.authorOrOwner(),"Issued",std::to_string(d)+"d ago");
+        TraceSpan span("command","cli",std::to_string(c));
+        CommandArena arena;
+        try {
+            switch(c) {
+                case 1: {
+                    std::cin.ignore();
+                    listAssets(true);
+                    break;
+                }
+                case 2: {
+                    std::cin.ignore();
+                    std::cout<<"Asset ID or title/author: ";
+                    searchAssets(readLine());
+                    break;
+                }
+                case 3: {
+                    std::string aid; std::cout<<"Asset ID: "; std::cin>>aid;
+                    if (loanServicePtr->issueAsset(aid,uid)) {
+                        std::cout<<"✅ Borrowed "<<aid<<"\n";
+                    } else if (auto ao=assetRepoPtr->find(aid); ao && ao->available()==0) {
+                        char yn; std::cout<<"Place a hold? (y/n): "; std::cin>>yn;
+                        if ((yn=='y'||yn=='Y') && holdServicePtr->placeHold(aid,uid))
+                            std::cout<<"Hold placed; "<<holdServicePtr->queueLength(std::string(ao->id()))
+                                     <<" waiting.\n";
                     }
-                break;
-            }
-            case 5: {
-                std::string aid; char yn;
-                std::cout<<"Asset ID: "; std::cin>>aid;
-                std::cout<<"Confirm return? (y/n): "; std::cin>>yn;
-                if (yn=='y'||yn=='Y') { loanServicePtr->returnAsset(aid); std::cout<<"Returned.\n"; }
-                break;
+                    break;
+                }
+                case 4: {
+                    std::cin.ignore();
+                    {
+                        auto r=listing(assetColumns);
+                        for (auto &a:assetRepoPtr->getAll()) {
+                            if (a.onLoan()==0) continue;
+                            for (auto &lo:loanServicePtr->loansFor(a.id()))
+                                if (lo.userId==u.id()) {
+                                    int d=int((loanServicePtr->clock()->now()-lo.issueDate)/86400);
+                                    assetRow(r,a,"Issued",std::to_string(d)+"d ago");
+                                }
+                        }
+                    }
+                    if (auto owed=finesJobPtr->balance(uid); owed>0 && tableOutput())
+                        std::cout<<"Fines owed: "<<money(owed)<<"\n";
+                    break;
+                }
+                case 5: {
+                    std::string aid; char yn;
+                    std::cout<<"Asset ID: "; std::cin>>aid;
+                    std::cout<<"Confirm return? (y/n): "; std::cin>>yn;
+                    if ((yn=='y'||yn=='Y') && loanServicePtr->returnAsset(aid,uid)) std::cout<<"Returned.\n";
+                    break;
+                }
+                case 6:
+                    std::cout<<"Goodbye, "<<u.name()<<"!\n";
+                    return;
+                case 7: {
+                    std::string aid; std::cout<<"Asset ID: "; std::cin>>aid;
+                    std::cout<<(holdServicePtr->cancelHold(aid,uid)?"Hold cancelled.\n":"No such hold.\n");
+                    break;
+                }
+                case 8: {
+                    std::string aid; std::cout<<"Asset ID: "; std::cin>>aid; std::cin.ignore();
+                    printRecommendations(aid);
+                    break;
+                }
+                default:
+                    std::cout<<"Invalid.\n";
             }
-            case 6:
-                std::cout<<"Goodbye, "<<u.name()<<"!\n";
-                return;
-            default:
-                std::cout<<"Invalid.\n";
+        } catch (const std::exception& e) {
+            std::cout<<"Command failed: "<<e.what()<<"\n";
         }
     }
 }
\ No newline at end of file
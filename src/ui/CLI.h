@@ -1,13 +1,32 @@
 #pragma once
 
 #include "../models/User.h"
+#include "Renderer.h"
+#include <cstddef>
+#include <optional>
+#include <string>
+
+struct CliOptions {
+    OutputFormat format = OutputFormat::Table;
+    std::size_t  pageSize = 0;   // table rows per page; 0 = no pager
+    std::string  command;        // "assets" or "users": print it and exit
+    std::string  tracePath;      // Chrome trace JSON written on exit
+};
+
+extern const char* const cliUsage;
+
+// nullopt on unknown flags or values.
+std::optional<CliOptions> parseCliOptions(int argc, char** argv);
 
 class CLI {
 public:
+    explicit CLI(CliOptions options = {});
     void run();
+    // Non-interactive listing for scripts and pipes; returns the exit code.
+    int runCommand(const std::string& command);
 
 private:
     void runStaffMenu(const User& u);
     void runUserMenu(const User& u);
     void printHelp();
-};
\ No newline at end of file
+};
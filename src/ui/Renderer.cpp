@@ -0,0 +1,219 @@
+#include "Renderer.h"
+#include "../util/Escape.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+std::optional<OutputFormat> parseOutputFormat(std::string_view name) {
+    if (name == "table") return OutputFormat::Table;
+    if (name == "csv")   return OutputFormat::Csv;
+    if (name == "json")  return OutputFormat::Json;
+    return std::nullopt;
+}
+
+// Code point starting at s[i]; advances i past it. A byte that doesn't
+// start a well-formed sequence is consumed on its own as U+FFFD.
+static char32_t decode(std::string_view s, std::size_t& i) {
+    auto c = static_cast<unsigned char>(s[i]);
+    std::size_t len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    if (len == 1 || i + len > s.size()) { ++i; return 0xFFFD; }
+    char32_t cp = c & (0x7F >> len);
+    for (std::size_t k = 1; k < len; ++k) {
+        auto cc = static_cast<unsigned char>(s[i + k]);
+        if ((cc & 0xC0) != 0x80) { ++i; return 0xFFFD; }
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    i += len;
+    return cp;
+}
+
+// The common cases of wcwidth() without depending on the C locale.
+static std::size_t columns(char32_t cp) {
+    if ((cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x1AB0 && cp <= 0x1AFF) || (cp >= 0x200B && cp <= 0x200F) ||
+        (cp >= 0x20D0 && cp <= 0x20FF) || (cp >= 0xFE00 && cp <= 0xFE0F))
+        return 0;
+    if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF && cp != 0x303F) ||
+        (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE30 && cp <= 0xFE4F) ||
+        (cp >= 0xFF00 && cp <= 0xFF60) || (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1F64F) ||
+        (cp >= 0x1F900 && cp <= 0x1F9FF) || (cp >= 0x20000 && cp <= 0x3FFFD))
+        return 2;
+    return 1;
+}
+
+std::size_t displayWidth(std::string_view s) {
+    std::size_t width = 0;
+    for (std::size_t i = 0; i < s.size();) {
+        if (static_cast<unsigned char>(s[i]) < 0x80) { ++width; ++i; continue; }
+        width += columns(decode(s, i));
+    }
+    return width;
+}
+
+Renderer::Renderer(std::ostream& out, OutputFormat format, std::vector<Column> columns, std::size_t pageSize,
+                   MorePrompt more)
+    : _out(out), _format(format), _columns(std::move(columns)), _pageSize(pageSize), _more(std::move(more)) {
+    reserve(flushAt);
+    for (std::size_t c = 0; c < _columns.size(); ++c) {
+        if (_format == OutputFormat::Json) {
+            reserve(6 * _columns[c].key.size() + 4);
+            if (c) put(',');
+            jsonString(_columns[c].key);
+            put(':');
+            _jsonKeys.emplace_back(_buf.get(), _size);
+            _size = 0;
+        }
+        _rowSlack += _columns[c].width + (_jsonKeys.empty() ? 0 : _jsonKeys.back().size()) + 8;
+    }
+}
+
+Renderer::~Renderer() {
+    try { finish(); } catch (...) {}
+}
+
+void Renderer::reserve(std::size_t n) {
+    if (_size + n <= _capacity) return;
+    auto capacity = std::max(2 * _capacity, _size + n);
+    auto buf = std::make_unique<char[]>(capacity);
+    std::memcpy(buf.get(), _buf.get(), _size);
+    _buf = std::move(buf);
+    _capacity = capacity;
+}
+
+void Renderer::flush() {
+    _out.write(_buf.get(), static_cast<std::streamsize>(_size));
+    _size = 0;
+}
+
+void Renderer::header() {
+    std::size_t need = _rowSlack + 16;
+    for (auto& c : _columns) need += 6 * c.title.size() + c.width + 3;
+    reserve(need);
+    switch (_format) {
+    case OutputFormat::Table: {
+        std::size_t width = 0;
+        for (std::size_t c = 0; c < _columns.size(); ++c) {
+            if (c) put(" | ");
+            bool last = c + 1 == _columns.size();
+            tableCell(_columns[c].title, last ? 0 : _columns[c].width);
+            width += (c ? 3 : 0) + (last ? displayWidth(_columns[c].title) : _columns[c].width);
+        }
+        put('\n');
+        reserve(width + 1);
+        std::memset(_buf.get() + _size, '-', width);
+        _size += width;
+        put('\n');
+        break;
+    }
+    case OutputFormat::Csv:
+        for (std::size_t c = 0; c < _columns.size(); ++c) {
+            if (c) put(',');
+            csvCell(_columns[c].title);
+        }
+        put('\n');
+        break;
+    case OutputFormat::Json:
+        put('[');
+        break;
+    }
+}
+
+bool Renderer::row(std::initializer_list<std::string_view> cells) {
+    if (_stopped || _finished) return false;
+    if (_rows == 0) {
+        header();
+    } else if (_pageSize && _format == OutputFormat::Table && _more && _rows % _pageSize == 0) {
+        flush();
+        _out.flush();
+        if (!_more()) { _stopped = true; return false; }
+    }
+
+    // Room for the worst case (every byte escaped in JSON), so the cell
+    // writers below never check capacity.
+    std::size_t need = _rowSlack + 8;
+    for (auto cell : cells) need += 6 * cell.size();
+    reserve(need);
+
+    std::size_t c = 0;
+    switch (_format) {
+    case OutputFormat::Table:
+        for (auto cell : cells) {
+            if (c == _columns.size()) break;
+            if (c) put(" | ");
+            tableCell(cell, c + 1 == _columns.size() ? 0 : _columns[c].width);
+            ++c;
+        }
+        put('\n');
+        break;
+    case OutputFormat::Csv:
+        for (auto cell : cells) {
+            if (c == _columns.size()) break;
+            if (c++) put(',');
+            csvCell(cell);
+        }
+        put('\n');
+        break;
+    case OutputFormat::Json:
+        put(_rows ? ",\n{" : "\n{");
+        for (auto cell : cells) {
+            if (c == _columns.size()) break;
+            put(_jsonKeys[c++]);
+            jsonString(cell);
+        }
+        put('}');
+        break;
+    }
+    ++_rows;
+    if (_size >= flushAt) flush();
+    return true;
+}
+
+void Renderer::finish() {
+    if (_finished) return;
+    _finished = true;
+    if (_rows == 0 && _format != OutputFormat::Table) header();
+    if (_format == OutputFormat::Json) {
+        reserve(4);
+        put(_rows ? "\n]\n" : "]\n");
+    }
+    flush();
+    _out.flush();
+}
+
+void Renderer::tableCell(std::string_view s, std::size_t width) {
+    std::size_t used = 0;
+    for (std::size_t i = 0; i < s.size();) {
+        // Copy a run of printable ASCII (usually the whole cell) in one go.
+        std::size_t end = width ? std::min(s.size(), i + (width - used)) : s.size();
+        std::size_t plain = escape::plainPrefix<escape::tableSpecial>(s.data() + i, end - i);
+        put(s.substr(i, plain));
+        used += plain;
+        i += plain;
+        if (i == s.size() || (width && used == width)) break;
+
+        if (static_cast<unsigned char>(s[i]) < 0x80) {   // control character
+            put(' ');
+            ++used;
+            ++i;
+            continue;
+        }
+        auto start = i;
+        auto w = columns(decode(s, i));
+        if (width && used + w > width) break;
+        put(s.substr(start, i - start));
+        used += w;
+    }
+    if (used < width) {
+        std::memset(_buf.get() + _size, ' ', width - used);
+        _size += width - used;
+    }
+}
+
+void Renderer::csvCell(std::string_view s) {
+    _size = putCsvField(_buf.get() + _size, s) - _buf.get();
+}
+
+void Renderer::jsonString(std::string_view s) {
+    _size = putJsonString(_buf.get() + _size, s) - _buf.get();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class OutputFormat { Table, Csv, Json };
+
+// "table", "csv" or "json"; nullopt for anything else.
+std::optional<OutputFormat> parseOutputFormat(std::string_view name);
+
+// Terminal columns a UTF-8 string takes: combining marks take none, East
+// Asian wide characters and emoji take two. Invalid bytes count one each.
+std::size_t displayWidth(std::string_view s);
+
+// Writes a listing one row at a time as an aligned table, CSV (RFC 4180
+// quoting) or a JSON array of objects with string values. Rows are
+// formatted into a buffer that is reused and handed to the stream in large
+// writes, so the cost per row is a few appends rather than a stream
+// insertion per field.
+//
+// Table cells are padded or cut to the column's display width, never in
+// the middle of a character; control characters become spaces so a stray
+// newline can't break the layout. With a page size, a table stops after
+// each page and asks `more` whether to go on (CSV and JSON are meant for
+// pipes and are never paged).
+class Renderer {
+public:
+    struct Column {
+        std::string_view title;   // table and CSV header
+        std::string_view key;     // JSON member name
+        std::size_t      width;   // table width; 0 = as wide as the value
+    };
+    using MorePrompt = std::function<bool()>;
+
+    Renderer(std::ostream& out, OutputFormat format, std::vector<Column> columns, std::size_t pageSize = 0,
+             MorePrompt more = {});
+    ~Renderer();   // finish()
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // One cell per column. False once the reader declined the next page;
+    // the row is not written and later rows are ignored.
+    bool row(std::initializer_list<std::string_view> cells);
+    // Closes the listing (the JSON array; a CSV header if there were no
+    // rows) and writes out the buffer. Further calls do nothing.
+    void finish();
+
+    std::size_t rows() const { return _rows; }
+    bool stopped() const { return _stopped; }
+
+private:
+    static constexpr std::size_t flushAt = 64 * 1024;
+
+    std::ostream&       _out;
+    OutputFormat        _format;
+    std::vector<Column> _columns;
+    std::size_t         _pageSize;
+    MorePrompt          _more;
+    std::vector<std::string> _jsonKeys;   // `"key":` per column, comma included
+    std::size_t         _rowSlack = 0;    // bytes a row needs beyond 6 per input byte
+    std::size_t         _rows = 0;
+    bool                _stopped = false;
+    bool                _finished = false;
+
+    // Output not yet written to _out. row() reserves its worst case up
+    // front, so put() is a bare copy.
+    std::unique_ptr<char[]> _buf;
+    std::size_t         _size = 0;
+    std::size_t         _capacity = 0;
+
+    void reserve(std::size_t n);
+    void put(std::string_view s) { std::memcpy(_buf.get() + _size, s.data(), s.size()); _size += s.size(); }
+    void put(char c) { _buf[_size++] = c; }
+
+    void header();
+    void flush();
+    void tableCell(std::string_view s, std::size_t width);
+    void csvCell(std::string_view s);
+    void jsonString(std::string_view s);
+};
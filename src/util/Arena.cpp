@@ -0,0 +1,16 @@
+#include "Arena.h"
+
+namespace {
+thread_local std::pmr::memory_resource* innermost = nullptr;
+}
+
+CommandArena::CommandArena(std::pmr::memory_resource* upstream)
+    : _memory(_initial, sizeof _initial, upstream), _previous(innermost) {
+    innermost = &_memory;
+}
+
+CommandArena::~CommandArena() { innermost = _previous; }
+
+std::pmr::memory_resource* CommandArena::current() {
+    return innermost ? innermost : std::pmr::get_default_resource();
+}
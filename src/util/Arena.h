@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+// Memory for one CLI command or server request. A listing or lookup makes
+// many small strings and a few growing vectors that all die together at the
+// end of the command; inside a CommandArena they are carved out of one
+// monotonic buffer instead, and released in one step when the scope ends.
+//
+// While an arena is alive it is current() for its thread, and repository
+// reads default to current() for their results (see AssetRepository), so
+// the command code itself does not change. Arenas nest; the innermost wins.
+// Without one, current() is the default resource and nothing changes.
+//
+// Anything built in the arena must not outlive it. Copies of the models
+// and of pmr containers are made with the default resource, so copying a
+// result out is safe; moving it into longer-lived storage is not.
+class CommandArena {
+public:
+    // The first `initialBytes` come from a buffer inside the arena object
+    // (on the stack, for a local); the rest from the upstream resource, in
+    // chunks that grow geometrically.
+    static constexpr std::size_t initialBytes = 16 * 1024;
+
+    explicit CommandArena(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    ~CommandArena();
+
+    CommandArena(const CommandArena&) = delete;
+    CommandArena& operator=(const CommandArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &_memory; }
+
+    // The innermost arena on the calling thread, or the default resource.
+    static std::pmr::memory_resource* current();
+
+private:
+    alignas(std::max_align_t) std::byte _initial[initialBytes];
+    std::pmr::monotonic_buffer_resource _memory;
+    std::pmr::memory_resource*          _previous;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <ctime>
+#include <memory>
+
+// Source of "now" for anything that reasons about loan age.
+class Clock {
+public:
+    virtual ~Clock() = default;
+    virtual std::time_t now() const = 0;
+};
+
+class SystemClock : public Clock {
+public:
+    std::time_t now() const override { return std::time(nullptr); }
+};
+
+// Virtual time for tests and simulations; only moves when told to.
+class ManualClock : public Clock {
+public:
+    explicit ManualClock(std::time_t start = std::time(nullptr)) : _now(start) {}
+
+    std::time_t now() const override { return _now.load(); }
+    void set(std::time_t t)          { _now = t; }
+    void advance(std::time_t seconds) { _now += seconds; }
+    void advanceDays(int days)        { advance(static_cast<std::time_t>(days) * 24 * 60 * 60); }
+
+private:
+    std::atomic<std::time_t> _now;
+};
+
+inline std::shared_ptr<Clock> systemClock() {
+    static auto clock = std::make_shared<SystemClock>();
+    return clock;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Escaping for text output (Renderer, Exporter). Writers reserve the worst
+// case up front and hand in a raw pointer, so the escapers never check
+// capacity.
+
+namespace escape {
+
+// What each byte needs per format. Cells are scanned for the first byte
+// that needs attention and copied up to it in one append.
+enum : std::uint8_t { tableSpecial = 1, csvSpecial = 2, jsonSpecial = 4 };
+inline constexpr auto byteClass = [] {
+    std::array<std::uint8_t, 256> t{};
+    for (int c = 0; c < 256; ++c) {
+        if (c < 0x20 || c >= 0x7F) t[c] |= tableSpecial;
+        if (c < 0x20 || c == '"' || c == '\\') t[c] |= jsonSpecial;
+    }
+    for (int c : {',', '"', '\n', '\r'}) t[c] |= csvSpecial;
+    return t;
+}();
+
+inline bool is(char c, std::uint8_t cls) { return byteClass[static_cast<unsigned char>(c)] & cls; }
+
+// Eight bytes at a time: the high bit of each byte of x that is in the
+// class (the usual has-zero-byte / has-byte-less-than tricks). Bytes above
+// a flagged one may be flagged falsely, never bytes below it, so the lowest
+// set bit is exact on little-endian machines.
+inline constexpr std::uint64_t ones = 0x0101010101010101ull, highs = 0x8080808080808080ull;
+inline std::uint64_t zeroByte(std::uint64_t x) { return (x - ones) & ~x & highs; }
+inline std::uint64_t byteBelow(std::uint64_t x, std::uint8_t n) { return (x - ones * n) & ~x & highs; }
+
+template <std::uint8_t cls>
+std::uint64_t flagged(std::uint64_t x) {
+    if constexpr (cls == tableSpecial)
+        return (x & highs) | byteBelow(x, 0x20) | zeroByte(x ^ (ones * 0x7F));
+    else if constexpr (cls == csvSpecial)
+        return zeroByte(x ^ (ones * ',')) | zeroByte(x ^ (ones * '"')) | zeroByte(x ^ (ones * '\n')) |
+               zeroByte(x ^ (ones * '\r'));
+    else
+        return byteBelow(x, 0x20) | zeroByte(x ^ (ones * '"')) | zeroByte(x ^ (ones * '\\'));
+}
+
+// 1 to 7 bytes as the low bytes of a word, the rest filled with 'A' (which
+// no class cares about), without a loop: overlapping loads repeat bytes in
+// the same positions, so OR-ing them is harmless.
+inline std::uint64_t loadShort(const char* p, std::size_t n) {
+    auto byte = [&](std::size_t i) { return std::uint64_t{static_cast<unsigned char>(p[i])} << (8 * i); };
+    std::uint64_t x;
+    if (n >= 4) {
+        std::uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + n - 4, 4);
+        x = lo | (std::uint64_t{hi} << (8 * (n - 4)));
+    } else {
+        x = byte(0) | byte(n / 2) | byte(n - 1);
+    }
+    return x | (ones * 'A' & ~(~std::uint64_t{0} >> (64 - 8 * n)));
+}
+
+// Length of the prefix of p[0, n) with no byte in the class. The last word
+// overlaps bytes already checked rather than reading past the end.
+template <std::uint8_t cls>
+std::size_t plainPrefix(const char* p, std::size_t n) {
+    if constexpr (std::endian::native == std::endian::little) {
+        auto first = [](std::uint64_t m) { return static_cast<std::size_t>(std::countr_zero(m)) / 8; };
+        if (n == 0) return 0;
+        if (n < 8) {
+            auto m = flagged<cls>(loadShort(p, n));
+            return m ? first(m) : n;
+        }
+        std::uint64_t x;
+        for (std::size_t i = 0; i + 8 <= n; i += 8) {
+            std::memcpy(&x, p + i, 8);
+            if (auto m = flagged<cls>(x)) return i + first(m);
+        }
+        std::memcpy(&x, p + n - 8, 8);
+        if (auto m = flagged<cls>(x)) return n - 8 + first(m);
+        return n;
+    } else {
+        std::size_t i = 0;
+        while (i < n && !is(p[i], cls)) ++i;
+        return i;
+    }
+}
+
+}  // namespace escape
+
+// s as a CSV field at out, quoted (RFC 4180) only if it holds a comma,
+// quote, CR or LF. Needs room for 2 * s.size() + 2 bytes; returns the end.
+inline char* putCsvField(char* out, std::string_view s) {
+    if (escape::plainPrefix<escape::csvSpecial>(s.data(), s.size()) == s.size()) {
+        std::memcpy(out, s.data(), s.size());
+        return out + s.size();
+    }
+    *out++ = '"';
+    for (std::size_t i = 0, q; i < s.size(); i = q + 1) {   // double every quote
+        q = std::min(s.find('"', i), s.size());
+        std::memcpy(out, s.data() + i, q - i);
+        out += q - i;
+        if (q < s.size()) { *out++ = '"'; *out++ = '"'; }
+    }
+    *out++ = '"';
+    return out;
+}
+
+// s as a JSON string literal at out. Needs room for 6 * s.size() + 2
+// bytes; returns the end.
+inline char* putJsonString(char* out, std::string_view s) {
+    static constexpr char hex[] = "0123456789abcdef";
+    auto put = [&](std::string_view t) { std::memcpy(out, t.data(), t.size()); out += t.size(); };
+    *out++ = '"';
+    for (std::size_t i = 0;; ++i) {
+        auto plain = escape::plainPrefix<escape::jsonSpecial>(s.data() + i, s.size() - i);
+        put(s.substr(i, plain));
+        i += plain;
+        if (i == s.size()) break;
+        auto c = static_cast<unsigned char>(s[i]);
+        switch (c) {
+        case '"':  put("\\\""); break;
+        case '\\': put("\\\\"); break;
+        case '\n': put("\\n");  break;
+        case '\r': put("\\r");  break;
+        case '\t': put("\\t");  break;
+        default: {
+            char u[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            put(std::string_view(u, sizeof u));
+        }
+        }
+    }
+    *out++ = '"';
+    return out;
+}
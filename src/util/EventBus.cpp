@@ -0,0 +1,120 @@
+#include "EventBus.h"
+#include "Trace.h"
+#include <algorithm>
+#include <stdexcept>
+
+EventBus::Subscription& EventBus::Subscription::operator=(Subscription&& o) noexcept {
+    if (this != &o) {
+        reset();
+        _bus = std::exchange(o._bus, nullptr);
+        _slot = o._slot;
+    }
+    return *this;
+}
+
+void EventBus::Subscription::reset() {
+    if (auto bus = std::exchange(_bus, nullptr)) bus->stop(*bus->_subscribers[_slot]);
+}
+
+EventBus::EventBus(std::size_t ringCapacity) : _ringCapacity(ringCapacity) {}
+
+EventBus::~EventBus() {
+    auto n = _count.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; ++i) stop(*_subscribers[i]);
+}
+
+EventBus::Subscription EventBus::subscribe(std::string name, Handler handler, std::size_t maxBatch) {
+    std::lock_guard<std::mutex> lock(_subscribeMutex);
+    auto slot = _count.load(std::memory_order_relaxed);
+    if (slot == maxSubscribers) throw std::runtime_error("Too many event subscribers");
+    auto s = std::make_unique<Subscriber>(std::move(name), std::move(handler), _ringCapacity,
+                                          std::max<std::size_t>(maxBatch, 1));
+    s->thread = std::thread([this, sub = s.get()] { run(*sub); });
+    _subscribers[slot] = std::move(s);
+    _count.store(slot + 1, std::memory_order_release);
+    return Subscription(this, slot);
+}
+
+void EventBus::wake(Subscriber& s) {
+    s.signal.fetch_add(1);
+    s.signal.notify_one();
+}
+
+// Only the first producer to see the consumer asleep pays for the wake;
+// until it runs again the others see the flag cleared.
+void EventBus::wakeIfSleeping(Subscriber& s) {
+    if (s.sleeping.load() && s.sleeping.exchange(false)) wake(s);
+}
+
+void EventBus::publish(const DomainEvent& event) {
+    auto n = _count.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto& s = *_subscribers[i];
+        if (!s.active.load(std::memory_order_relaxed)) continue;
+        while (!s.ring.tryPush(event)) {
+            if (!s.active.load(std::memory_order_relaxed)) break;
+            wakeIfSleeping(s);
+            std::this_thread::yield();
+        }
+        wakeIfSleeping(s);
+    }
+}
+
+void EventBus::run(Subscriber& s) {
+    if (Tracer::enabled()) Tracer::nameThread("events: " + s.name);
+    std::vector<DomainEvent> batch;
+    batch.reserve(s.maxBatch);
+    while (true) {
+        s.ring.drain([&](DomainEvent&& e) { batch.push_back(std::move(e)); }, s.maxBatch);
+        if (!batch.empty()) {
+            TraceSpan span("EventBus::deliver", "events");
+            try {
+                s.handler(batch);
+            } catch (...) {
+                s.errors.fetch_add(1, std::memory_order_relaxed);
+            }
+            s.batches.fetch_add(1, std::memory_order_relaxed);
+            s.handled.fetch_add(batch.size());
+            s.handled.notify_all();
+            batch.clear();
+            continue;
+        }
+        if (!s.ring.drained()) {   // a push is being written
+            std::this_thread::yield();
+            continue;
+        }
+        if (!s.active.load()) return;
+
+        auto seen = s.signal.load();
+        s.sleeping.store(true);
+        if (s.ring.drained() && s.active.load()) s.signal.wait(seen);
+        s.sleeping.store(false);
+    }
+}
+
+void EventBus::stop(Subscriber& s) {
+    s.active.store(false);
+    wake(s);
+    if (s.thread.joinable()) s.thread.join();
+}
+
+void EventBus::flush() {
+    auto n = _count.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto& s = *_subscribers[i];
+        if (!s.active.load()) continue;
+        auto target = s.ring.pushed();
+        for (auto done = s.handled.load(); done < target && s.active.load(); done = s.handled.load())
+            s.handled.wait(done);
+    }
+}
+
+std::vector<EventBus::Stats> EventBus::stats() const {
+    std::vector<Stats> out;
+    auto n = _count.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto& s = *_subscribers[i];
+        out.push_back({s.name, s.handled.load(), s.batches.load(), s.errors.load()});
+    }
+    return out;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "../models/DomainEvents.h"
+#include "MpscRing.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// In-process fan-out of DomainEvents. Every subscriber has its own
+// lock-free ring and thread; publish() copies the event into each ring
+// (no lock, no allocation for short IDs) and wakes a consumer only if it
+// is asleep. Consumers hand events to their handler in batches, in
+// publish order per publishing thread. A full ring makes publish() wait
+// for that consumer rather than drop the event.
+//
+// Repositories and LoanService publish after their transaction commits
+// (DatabaseManager::afterCommit), so handlers never see a change that was
+// rolled back. Handler exceptions are counted and dropped.
+class EventBus {
+public:
+    using Handler = std::function<void(std::span<const DomainEvent>)>;
+
+    // Unsubscribes (after handling what was already queued) when destroyed.
+    class Subscription {
+    public:
+        Subscription() = default;
+        Subscription(EventBus* bus, std::size_t slot) : _bus(bus), _slot(slot) {}
+        Subscription(Subscription&& o) noexcept : _bus(std::exchange(o._bus, nullptr)), _slot(o._slot) {}
+        Subscription& operator=(Subscription&& o) noexcept;
+        Subscription(const Subscription&) = delete;
+        Subscription& operator=(const Subscription&) = delete;
+        ~Subscription() { reset(); }
+
+        void reset();
+        explicit operator bool() const { return _bus != nullptr; }
+
+    private:
+        EventBus*   _bus = nullptr;
+        std::size_t _slot = 0;
+    };
+
+    struct Stats {
+        std::string   name;
+        std::uint64_t delivered;
+        std::uint64_t batches;
+        std::uint64_t errors;
+    };
+
+    static constexpr std::size_t maxSubscribers = 16;
+
+    explicit EventBus(std::size_t ringCapacity = 4096);
+    ~EventBus();   // delivers what is queued, then stops the threads
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    // Events published before this call are not delivered to it.
+    [[nodiscard]] Subscription subscribe(std::string name, Handler handler, std::size_t maxBatch = 256);
+
+    void publish(const DomainEvent& event);
+    // Returns once every event published so far has been handled.
+    void flush();
+
+    std::vector<Stats> stats() const;
+
+private:
+    struct Subscriber {
+        Subscriber(std::string name, Handler handler, std::size_t capacity, std::size_t maxBatch)
+            : name(std::move(name)), handler(std::move(handler)), ring(capacity), maxBatch(maxBatch) {}
+
+        std::string              name;
+        Handler                  handler;
+        MpscRing<DomainEvent>    ring;
+        std::size_t              maxBatch;
+        std::atomic<bool>        active{true};
+        std::atomic<bool>        sleeping{false};
+        std::atomic<std::uint32_t> signal{0};
+        std::atomic<std::uint64_t> handled{0};
+        std::atomic<std::uint64_t> batches{0};
+        std::atomic<std::uint64_t> errors{0};
+        std::thread              thread;
+    };
+
+    std::size_t _ringCapacity;
+    std::array<std::unique_ptr<Subscriber>, maxSubscribers> _subscribers;
+    std::atomic<std::size_t>   _count{0};
+    std::mutex                 _subscribeMutex;
+
+    void run(Subscriber& s);
+    void stop(Subscriber& s);
+    static void wake(Subscriber& s);
+    static void wakeIfSleeping(Subscriber& s);
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Waiting list for one title: highest priority first, then first come
+// (lowest hold id). Push, erase by user and pop are O(log n); a user is
+// queued at most once. Not thread-safe.
+class HoldQueue {
+public:
+    struct Entry {
+        std::int64_t holdId;
+        std::string  userId;
+        int          priority;
+    };
+
+    // Returns false if the user is already queued.
+    bool push(Entry e) {
+        if (_byUser.count(e.userId)) return false;
+        auto it = _queue.insert(std::move(e)).first;
+        _byUser.emplace(it->userId, it);
+        return true;
+    }
+
+    bool erase(const std::string& userId) {
+        auto found = _byUser.find(userId);
+        if (found == _byUser.end()) return false;
+        _queue.erase(found->second);
+        _byUser.erase(found);
+        return true;
+    }
+
+    std::optional<Entry> front() const {
+        if (_queue.empty()) return std::nullopt;
+        return *_queue.begin();
+    }
+
+    std::optional<Entry> pop() {
+        auto e = front();
+        if (e) erase(e->userId);
+        return e;
+    }
+
+    bool contains(const std::string& userId) const { return _byUser.count(userId) > 0; }
+    std::size_t size() const { return _queue.size(); }
+    bool empty() const { return _queue.empty(); }
+
+    // Queue order, front first.
+    std::vector<Entry> entries() const { return {_queue.begin(), _queue.end()}; }
+
+private:
+    struct Order {
+        bool operator()(const Entry& a, const Entry& b) const {
+            if (a.priority != b.priority) return a.priority > b.priority;
+            return a.holdId < b.holdId;
+        }
+    };
+
+    std::set<Entry, Order> _queue;
+    std::unordered_map<std::string, std::set<Entry, Order>::iterator> _byUser;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Merges already-sorted sources into one ordered stream. A source exposes
+//   const T* peek();   // current item, or nullptr once exhausted
+//   void pop();        // advance
+// and is only pulled as far as the consumer reads, so sources can page
+// lazily. emit(const T&, std::size_t source) returns false to stop early.
+// Ties are broken by source index, keeping the merge stable.
+template <typename Source, typename Less, typename Emit>
+void kWayMerge(std::vector<Source>& sources, Less less, Emit emit) {
+    auto item = [&](std::size_t i) { return sources[i].peek(); };
+    // Heap of source indices ordered by their current item.
+    auto after = [&](std::size_t a, std::size_t b) {
+        if (less(*item(b), *item(a))) return true;
+        if (less(*item(a), *item(b))) return false;
+        return a > b;
+    };
+    std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(after)> heads(after);
+    for (std::size_t i = 0; i < sources.size(); ++i)
+        if (item(i)) heads.push(i);
+
+    while (!heads.empty()) {
+        std::size_t i = heads.top();
+        heads.pop();
+        if (!emit(*item(i), i)) return;
+        sources[i].pop();
+        if (item(i)) heads.push(i);
+    }
+}
+
+// Source over a sorted vector.
+template <typename T, typename Alloc = std::allocator<T>>
+class VectorSource {
+public:
+    explicit VectorSource(std::vector<T, Alloc> items) : _items(std::move(items)) {}
+    const T* peek() const { return _pos < _items.size() ? &_items[_pos] : nullptr; }
+    void pop() { ++_pos; }
+
+private:
+    std::vector<T, Alloc> _items;
+    std::size_t           _pos = 0;
+};
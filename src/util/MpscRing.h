@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free queue for many producers and one consumer. Each cell
+// carries a sequence number saying whether it is free for the producer at
+// that position or full for the consumer (Vyukov's bounded queue), so a
+// push is one CAS on the tail plus a release store, and the consumer never
+// writes to a cache line producers contend on. Capacity is rounded up to
+// a power of two.
+template <typename T>
+class MpscRing {
+public:
+    explicit MpscRing(std::size_t capacity) {
+        std::size_t n = 2;
+        while (n < capacity) n *= 2;
+        _mask = n - 1;
+        _cells = std::make_unique<Cell[]>(n);
+        for (std::size_t i = 0; i < n; ++i) _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Any thread. False when the ring is full.
+    template <typename U>
+    bool tryPush(U&& value) {
+        std::size_t pos = _tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &_cells[pos & _mask];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                // seq_cst so a consumer going to sleep sees the claim (see drained()).
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::forward<U>(value);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only: hands up to `max` values to f in order; returns how many.
+    template <typename F>
+    std::size_t drain(F&& f, std::size_t max) {
+        std::size_t n = 0;
+        for (; n < max; ++n) {
+            Cell& cell = _cells[_head & _mask];
+            if (cell.seq.load(std::memory_order_acquire) != _head + 1) break;
+            f(std::move(cell.value));
+            cell.seq.store(_head + _mask + 1, std::memory_order_release);
+            ++_head;
+        }
+        return n;
+    }
+
+    // Consumer only.
+    bool empty() const { return _cells[_head & _mask].seq.load(std::memory_order_acquire) != _head + 1; }
+    // Consumer only: nothing claimed beyond what was consumed, including
+    // pushes still being written. Ordered (seq_cst) against the producers'
+    // claims, so a consumer that announces it is sleeping and then finds
+    // the ring drained can't miss a producer that missed the announcement.
+    bool drained() const { return _tail.load(std::memory_order_seq_cst) == _head; }
+
+    // Positions claimed by producers so far, including pushes in flight.
+    std::uint64_t pushed() const { return _tail.load(std::memory_order_acquire); }
+    std::size_t capacity() const { return _mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T                        value{};
+    };
+
+    static constexpr std::size_t line = 64;
+
+    std::unique_ptr<Cell[]>               _cells;
+    std::size_t                           _mask = 0;
+    alignas(line) std::atomic<std::size_t> _tail{0};
+    alignas(line) std::size_t              _head = 0;
+};
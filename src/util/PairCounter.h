@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Counts for unordered pairs of 32-bit IDs, each pair stored once, in a
+// single open-addressing table (linear probing, power-of-two capacity, at
+// most 70% full): no allocation per pair and 12 bytes a slot. Counts only
+// grow; there is no erase. Not thread-safe.
+class PairCounter {
+public:
+    std::uint32_t increment(std::uint32_t a, std::uint32_t b) { return ++_counts[claim(key(a, b))]; }
+
+    std::uint32_t get(std::uint32_t a, std::uint32_t b) const {
+        return _keys.empty() ? 0 : _counts[find(key(a, b))];
+    }
+
+    // For restoring saved counts; count must be non-zero.
+    void set(std::uint32_t a, std::uint32_t b, std::uint32_t count) { _counts[claim(key(a, b))] = count; }
+
+    void reserve(std::size_t pairs) {
+        while (pairs * 10 > _keys.size() * 7) grow();
+    }
+
+    std::size_t size() const { return _size; }
+
+    void clear() {
+        _keys.clear();
+        _counts.clear();
+        _size = 0;
+    }
+
+    // f(low, high, count) for every pair, in no particular order.
+    template <typename F>
+    void forEach(F&& f) const {
+        for (std::size_t i = 0; i < _keys.size(); ++i)
+            if (_counts[i])
+                f(static_cast<std::uint32_t>(_keys[i] >> 32), static_cast<std::uint32_t>(_keys[i]), _counts[i]);
+    }
+
+private:
+    std::vector<std::uint64_t> _keys;
+    std::vector<std::uint32_t> _counts;   // 0 marks an empty slot
+    std::size_t                _size = 0;
+
+    static std::uint64_t key(std::uint32_t a, std::uint32_t b) {
+        if (a > b) std::swap(a, b);
+        return static_cast<std::uint64_t>(a) << 32 | b;
+    }
+
+    std::size_t find(std::uint64_t k) const {
+        std::size_t mask = _keys.size() - 1;
+        std::size_t i = (k * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+        while (_counts[i] && _keys[i] != k) i = (i + 1) & mask;
+        return i;
+    }
+
+    // Slot holding k, taking a free one (and growing first) if k is new.
+    std::size_t claim(std::uint64_t k) {
+        if ((_size + 1) * 10 > _keys.size() * 7) grow();
+        auto slot = find(k);
+        if (_counts[slot] == 0) {
+            _keys[slot] = k;
+            ++_size;
+        }
+        return slot;
+    }
+
+    void grow() {
+        std::vector<std::uint64_t> keys(_keys.empty() ? 64 : _keys.size() * 2);
+        std::vector<std::uint32_t> counts(keys.size());
+        std::swap(keys, _keys);
+        std::swap(counts, _counts);
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            if (!counts[i]) continue;
+            auto slot = find(keys[i]);
+            _keys[slot] = keys[i];
+            _counts[slot] = counts[i];
+        }
+    }
+};
@@ -1,4 +1,5 @@
 #include "Security.h"
+#include "Trace.h"
 #include <sodium.h>
 #include <stdexcept>
 
@@ -7,6 +8,7 @@ bool initCrypto() {
 }
 
 std::string hashPassword(const std::string& pwd) {
+    TraceSpan span("hashPassword", "security");
     char hash[crypto_pwhash_STRBYTES];
     if (crypto_pwhash_str(
             hash, pwd.c_str(), pwd.size(),
@@ -19,6 +21,7 @@ std::string hashPassword(const std::string& pwd) {
 }
 
 bool verifyPassword(const std::string& hash, const std::string& pwd) {
+    TraceSpan span("verifyPassword", "security");
     return crypto_pwhash_str_verify(
         hash.c_str(), pwd.c_str(), pwd.size()
     ) == 0;
@@ -0,0 +1,173 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char*  name;
+    const char*  category;
+    const char*  detail;
+    std::int64_t start;
+    std::int64_t duration;
+};
+
+// One per thread that ever recorded. The owning thread is the only
+// writer; the mutex is there for writeChromeJson()/clear(), so it is never
+// contended while a trace is running.
+struct ThreadBuffer {
+    std::mutex                      mutex;
+    int                             tid = 0;
+    std::string                     name;
+    std::vector<Event>              events;
+    std::unordered_set<std::string> strings;
+    std::uint64_t                   dropped = 0;
+};
+
+std::mutex                                 registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;   // never shrinks; threads keep raw pointers
+std::atomic<std::int64_t>                  origin{0};
+thread_local ThreadBuffer*                 local = nullptr;
+
+ThreadBuffer& buffer() {
+    if (!local) {
+        auto b = std::make_unique<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        b->tid = static_cast<int>(registry.size()) + 1;
+        local = b.get();
+        registry.push_back(std::move(b));
+    }
+    return *local;
+}
+
+void appendJsonString(std::string& out, const char* s) {
+    out += '"';
+    for (; *s; ++s) {
+        auto c = static_cast<unsigned char>(*s);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char esc[8];
+            std::snprintf(esc, sizeof esc, "\\u%04x", c);
+            out += esc;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+
+void appendMicros(std::string& out, std::int64_t ns) {
+    char num[32];
+    std::snprintf(num, sizeof num, "%.3f", static_cast<double>(ns) / 1000.0);
+    out += num;
+}
+
+}  // namespace
+
+void Tracer::start() {
+    std::int64_t zero = 0;
+    origin.compare_exchange_strong(zero, nowNs());
+    _enabled.store(true);
+}
+
+void Tracer::stop() {
+    _enabled.store(false);
+}
+
+std::int64_t Tracer::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Tracer::record(const char* name, const char* category, std::int64_t startNs, std::int64_t durationNs,
+                    const char* detail) {
+    auto& b = buffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    if (b.events.size() >= maxEventsPerThread) {
+        ++b.dropped;
+        return;
+    }
+    b.events.push_back({name, category, detail, startNs, durationNs});
+}
+
+const char* Tracer::intern(std::string_view s) {
+    auto& b = buffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    return b.strings.emplace(s).first->c_str();
+}
+
+void Tracer::nameThread(std::string_view name) {
+    auto& b = buffer();
+    std::lock_guard<std::mutex> lock(b.mutex);
+    b.name = name;
+}
+
+std::size_t Tracer::eventCount() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::size_t n = 0;
+    for (auto& b : registry) {
+        std::lock_guard<std::mutex> l(b->mutex);
+        n += b->events.size();
+    }
+    return n;
+}
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& b : registry) {
+        std::lock_guard<std::mutex> l(b->mutex);
+        b->events.clear();
+        b->strings.clear();
+        b->dropped = 0;
+    }
+}
+
+bool Tracer::writeChromeJson(const std::string& path) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"library\"}}";
+    std::uint64_t dropped = 0;
+    auto zero = origin.load();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& b : registry) {
+        std::lock_guard<std::mutex> l(b->mutex);
+        dropped += b->dropped;
+        auto tid = std::to_string(b->tid);
+        out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid + ",\"args\":{\"name\":";
+        appendJsonString(out, b->name.empty() ? ("thread " + tid).c_str() : b->name.c_str());
+        out += "}}";
+        for (auto& e : b->events) {
+            out += ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" + tid + ",\"name\":";
+            appendJsonString(out, e.name);
+            out += ",\"cat\":";
+            appendJsonString(out, e.category);
+            out += ",\"ts\":";
+            appendMicros(out, e.start - zero);
+            out += ",\"dur\":";
+            appendMicros(out, e.duration);
+            if (e.detail) {
+                out += ",\"args\":{\"detail\":";
+                appendJsonString(out, e.detail);
+                out += '}';
+            }
+            out += '}';
+            if (out.size() > (1 << 20)) {
+                file.write(out.data(), static_cast<std::streamsize>(out.size()));
+                out.clear();
+            }
+        }
+    }
+    out += "\n],\"otherData\":{\"droppedSpans\":" + std::to_string(dropped) + "}}\n";
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file.flush());
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Timeline tracing for finding out where one slow operation spent its
+// time. Code marks scopes with TraceSpan; each finished span is appended
+// to a buffer owned by the thread that ran it, so recording threads never
+// contend. Tracing is off until start(): a span then costs one relaxed
+// load and a branch. writeChromeJson() exports the Chrome trace-event
+// format, which chrome://tracing and ui.perfetto.dev open as a timeline.
+class Tracer {
+public:
+    static void start();
+    static void stop();
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    // Monotonic nanoseconds; the clock spans are measured with.
+    static std::int64_t nowNs();
+
+    // A finished span. Name, category and detail must outlive the trace:
+    // literals, or strings from intern().
+    static void record(const char* name, const char* category, std::int64_t startNs, std::int64_t durationNs,
+                       const char* detail = nullptr);
+    // Copy of s that lives until clear(), for names that aren't literals.
+    static const char* intern(std::string_view s);
+    // Label for the calling thread's row on the timeline.
+    static void nameThread(std::string_view name);
+
+    // Everything recorded so far, from every thread. False if the file
+    // can't be written.
+    static bool writeChromeJson(const std::string& path);
+    static std::size_t eventCount();
+    // Drops recorded spans and interned strings.
+    static void clear();
+
+    // Per thread; spans past this are counted and dropped.
+    static constexpr std::size_t maxEventsPerThread = 1 << 20;
+
+private:
+    static inline std::atomic<bool> _enabled{false};
+};
+
+// Records the enclosing scope as a span if tracing was on when it began.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, const char* category = "app") noexcept
+        : _name(name), _category(category), _start(Tracer::enabled() ? Tracer::nowNs() : -1) {}
+    // With a detail string (a command, a key) shown in the span's args.
+    TraceSpan(const char* name, const char* category, std::string_view detail) : TraceSpan(name, category) {
+        if (_start >= 0) _detail = Tracer::intern(detail);
+    }
+    ~TraceSpan() {
+        if (_start >= 0) Tracer::record(_name, _category, _start, Tracer::nowNs() - _start, _detail);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char*  _name;
+    const char*  _category;
+    const char*  _detail = nullptr;
+    std::int64_t _start;
+};
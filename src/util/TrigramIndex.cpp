@@ -0,0 +1,318 @@
+#include "TrigramIndex.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <mutex>
+
+static std::vector<std::string> words(std::string_view s) {
+    std::vector<std::string> out;
+    std::string w;
+    for (unsigned char c : s) {
+        if (std::isspace(c)) {
+            if (!w.empty()) out.push_back(std::move(w));
+            w.clear();
+        } else {
+            w += static_cast<char>(std::tolower(c));
+        }
+    }
+    if (!w.empty()) out.push_back(std::move(w));
+    return out;
+}
+
+// Trigrams of a word padded as "  w" ... "d ", so its start and end count.
+static std::vector<std::uint32_t> trigrams(const std::string& word) {
+    std::string padded = "  " + word + " ";
+    std::vector<std::uint32_t> out;
+    for (std::size_t i = 0; i + 2 < padded.size(); ++i) {
+        auto b = [&](std::size_t k) { return static_cast<std::uint32_t>(static_cast<unsigned char>(padded[k])); };
+        out.push_back(b(i) << 16 | b(i + 1) << 8 | b(i + 2));
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+// Typos tolerated per word: none for very short words, then one, then two.
+static int editBudget(std::size_t length) {
+    return length < 3 ? 0 : length < 8 ? 1 : TrigramIndex::maxBudget;
+}
+
+int editDistance(std::string_view a, std::string_view b, int limit) {
+    const std::size_t n = a.size(), m = b.size();
+    if (static_cast<int>(n > m ? n - m : m - n) > limit) return limit + 1;
+    // Only cells within `limit` of the diagonal can stay within the limit;
+    // the ones just outside the band are pinned at limit + 1.
+    const std::size_t band = static_cast<std::size_t>(std::min<long long>(limit, static_cast<long long>(n + m)));
+    thread_local std::vector<int> rows;
+    if (rows.size() < 3 * (m + 1)) rows.resize(3 * (m + 1));
+    int* prev2 = rows.data();
+    int* prev  = prev2 + (m + 1);
+    int* cur   = prev + (m + 1);
+    for (std::size_t j = 0; j <= m; ++j) prev[j] = static_cast<int>(std::min(j, band + 1));
+    for (std::size_t i = 1; i <= n; ++i) {
+        std::size_t lo = i > band ? i - band : 1, hi = std::min(m, i + band);
+        cur[lo - 1] = lo == 1 ? static_cast<int>(i) : limit + 1;
+        if (hi < m) cur[hi + 1] = limit + 1;
+        int rowMin = lo == 1 ? cur[0] : limit + 1;
+        for (std::size_t j = lo; j <= hi; ++j) {
+            int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1, prev[j - 1] + cost});
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+                cur[j] = std::min(cur[j], prev2[j - 2] + 1);
+            rowMin = std::min(rowMin, cur[j]);
+        }
+        if (rowMin > limit) return limit + 1;
+        std::swap(prev2, prev);
+        std::swap(prev, cur);
+    }
+    return std::min(prev[m], limit + 1);
+}
+
+bool TrigramIndex::add(const std::string& key, const std::string& text) {
+    std::unique_lock lock(_mutex);
+    if (_docIds.contains(key)) return false;
+    insert(key, text);
+    return true;
+}
+
+void TrigramIndex::replace(const std::string& key, const std::string& text) {
+    std::unique_lock lock(_mutex);
+    if (auto it = _docIds.find(key); it != _docIds.end()) {
+        if (_texts[it->second] == text) return;
+        erase(key);
+    }
+    insert(key, text);
+}
+
+bool TrigramIndex::remove(const std::string& key) {
+    std::unique_lock lock(_mutex);
+    return erase(key);
+}
+
+void TrigramIndex::clear() {
+    std::unique_lock lock(_mutex);
+    _docIds.clear();
+    _keys.clear();
+    _texts.clear();
+    _docWordStart.assign(1, 0);
+    _docWordIds.clear();
+    _wordIds.clear();
+    _words.clear();
+    _wordDocs.clear();
+    _gramWords.clear();
+}
+
+void TrigramIndex::insert(const std::string& key, const std::string& text) {
+    auto ws = words(text);
+    std::sort(ws.begin(), ws.end());
+    ws.erase(std::unique(ws.begin(), ws.end()), ws.end());
+
+    auto doc = static_cast<std::uint32_t>(_keys.size());
+    _docIds.emplace(key, doc);
+    _keys.push_back(key);
+    _texts.push_back(text);
+
+    for (auto& w : ws) {
+        auto [it, isNew] = _wordIds.emplace(w, static_cast<std::uint32_t>(_words.size()));
+        if (isNew) {
+            for (auto g : trigrams(w)) _gramWords[g].push_back(it->second);
+            _words.push_back(w);
+            _wordDocs.emplace_back();
+        }
+        _wordDocs[it->second].push_back(doc);
+        _docWordIds.push_back(it->second);
+    }
+    _docWordStart.push_back(static_cast<std::uint32_t>(_docWordIds.size()));
+}
+
+// The doc id is retired rather than reused, so posting lists stay in id
+// order; its words stay in the vocabulary.
+bool TrigramIndex::erase(const std::string& key) {
+    auto it = _docIds.find(key);
+    if (it == _docIds.end()) return false;
+    auto doc = it->second;
+    _docIds.erase(it);
+    for (auto i = _docWordStart[doc]; i < _docWordStart[doc + 1]; ++i) {
+        auto& docs = _wordDocs[_docWordIds[i]];
+        docs.erase(std::lower_bound(docs.begin(), docs.end(), doc));
+    }
+    std::string().swap(_keys[doc]);
+    std::string().swap(_texts[doc]);
+    return true;
+}
+
+std::size_t TrigramIndex::size() const {
+    std::shared_lock lock(_mutex);
+    return _docIds.size();
+}
+
+std::vector<TrigramIndex::WordHit> TrigramIndex::matchWord(const std::string& word) const {
+    std::vector<WordHit> hits;
+    int budget = editBudget(word.size());
+    if (budget == 0) {
+        if (auto it = _wordIds.find(word); it != _wordIds.end())
+            hits.push_back({it->second, 0});
+        return hits;
+    }
+
+    // Per-thread trigram hit counters, reset only where touched.
+    thread_local std::vector<std::uint8_t> counts;
+    thread_local std::vector<std::uint32_t> touched;
+    if (counts.size() < _words.size()) counts.resize(_words.size(), 0);
+    touched.clear();
+
+    auto grams = trigrams(word);
+    for (auto g : grams) {
+        auto it = _gramWords.find(g);
+        if (it == _gramWords.end()) continue;
+        for (auto w : it->second) {
+            if (counts[w] == 0) touched.push_back(w);
+            if (counts[w] < 255) ++counts[w];
+        }
+    }
+
+    // One edit (an adjacent swap, at worst) destroys up to four trigrams,
+    // and changes the length by at most one.
+    int needed = std::max(1, static_cast<int>(grams.size()) - 4 * budget);
+    std::array<std::uint32_t, 256> byCount{};
+    std::size_t candidates = 0;
+    for (auto& w : touched) {
+        auto length = _words[w].size();
+        if (counts[w] >= needed && length + budget >= word.size() && length <= word.size() + budget) {
+            ++byCount[counts[w]];
+            touched[candidates++] = w;
+        } else {
+            counts[w] = 0;
+        }
+    }
+    touched.resize(candidates);
+
+    // Words sharing the most trigrams are verified first, and at most
+    // verifyLimit of them: a common short word can leave thousands of
+    // candidates that share only a trigram or two.
+    int cutoff = 255;
+    std::size_t taken = 0;
+    while (cutoff > needed && taken + byCount[cutoff] <= verifyLimit) taken += byCount[cutoff--];
+    std::size_t atCutoff = verifyLimit - taken;
+    for (auto w : touched) {
+        if (counts[w] > cutoff || (counts[w] == cutoff && atCutoff > 0 && atCutoff--)) {
+            int d = editDistance(word, _words[w], budget);
+            if (d <= budget) hits.push_back({w, d});
+        }
+        counts[w] = 0;
+    }
+    std::sort(hits.begin(), hits.end(), [](const WordHit& a, const WordHit& b) { return a.distance < b.distance; });
+    return hits;
+}
+
+std::vector<TrigramIndex::Match> TrigramIndex::search(const std::string& query, std::size_t limit) const {
+    std::vector<Match> out;
+    auto qwords = words(query);
+    if (qwords.empty() || limit == 0) return out;
+
+    std::shared_lock lock(_mutex);
+
+    // Every query word must match some word of the name.
+    const std::size_t n = qwords.size();
+    std::vector<std::vector<WordHit>> hits;
+    for (auto& w : qwords) {
+        hits.push_back(matchWord(w));
+        if (hits.back().empty()) return out;
+    }
+
+    // Per query word, the distance of each matching vocabulary word (or
+    // noMatch), so a candidate name is checked with one load per word.
+    constexpr std::uint8_t noMatch = 0xFF;
+    thread_local std::vector<std::vector<std::uint8_t>> distances;
+    if (distances.size() < n) distances.resize(n);
+    // Names reached through each (query word, distance), to pick drivers.
+    std::vector<std::array<std::size_t, maxBudget + 1>> postings(n);
+    for (std::size_t q = 0; q < n; ++q) {
+        if (distances[q].size() < _words.size()) distances[q].resize(_words.size(), noMatch);
+        for (auto& h : hits[q]) {
+            distances[q][h.word] = static_cast<std::uint8_t>(h.distance);
+            postings[q][h.distance] += _wordDocs[h.word].size();
+        }
+        // Rarer words first, so a capped scan favours specific matches.
+        std::stable_sort(hits[q].begin(), hits[q].end(), [&](const WordHit& a, const WordHit& b) {
+            return a.distance != b.distance ? a.distance < b.distance
+                                            : _wordDocs[a.word].size() < _wordDocs[b.word].size();
+        });
+    }
+
+    // A name's distance for query word q.
+    auto closest = [&](std::size_t q, std::uint32_t doc) {
+        int best = noMatch;
+        for (auto i = _docWordStart[doc]; i < _docWordStart[doc + 1]; ++i)
+            best = std::min<int>(best, distances[q][_docWordIds[i]]);
+        return best;
+    };
+    // Names already scored, so one reached again through another of its
+    // words is skipped; cleared before returning.
+    thread_local std::vector<bool> seen;
+    if (seen.size() < _keys.size()) seen.resize(_keys.size());
+
+    // Names are visited in tiers of summed distance, so the first time a
+    // name matches is at its own distance. Within a tier, each split of the
+    // distance over the query words is driven by its rarest part. A
+    // finished tier with `limit` names ends the search: later tiers rank
+    // lower. Ties in a crowded tier stop after scanLimit names.
+    struct Scored { std::uint32_t doc; int distance; };
+    std::vector<Scored> scored;
+    std::size_t scanned = 0;
+    std::vector<int> split(n, 0);
+    int maxTotal = 0;
+    for (auto& hs : hits) maxTotal += hs.back().distance;
+    for (int total = 0; total <= maxTotal && scored.size() < limit && scanned < scanLimit; ++total) {
+        // Every split of `total` as split[0] + ... + split[n-1], each part
+        // within the distances its query word actually matched.
+        std::fill(split.begin(), split.end(), 0);
+        while (true) {
+            int sum = 0;
+            for (int d : split) sum += d;
+            if (sum == total) {
+                std::size_t driver = n;
+                for (std::size_t q = 0; q < n; ++q) {
+                    if (postings[q][split[q]] == 0) { driver = n; break; }
+                    if (driver == n || postings[q][split[q]] < postings[driver][split[driver]]) driver = q;
+                }
+                for (std::size_t i = 0; driver < n && i < hits[driver].size(); ++i) {
+                    auto& h = hits[driver][i];
+                    if (h.distance != split[driver]) continue;
+                    for (auto doc : _wordDocs[h.word]) {
+                        if (scanned == scanLimit) break;
+                        ++scanned;
+                        if (seen[doc]) continue;
+                        bool match = true;
+                        for (std::size_t q = 0; q < n && match; ++q)
+                            match = q == driver || closest(q, doc) == split[q];
+                        if (!match) continue;
+                        seen[doc] = true;
+                        scored.push_back({doc, total});
+                    }
+                }
+            }
+            std::size_t q = 0;
+            while (q < n && split[q] == hits[q].back().distance) split[q++] = 0;
+            if (q == n) break;
+            ++split[q];
+        }
+    }
+
+    for (std::size_t q = 0; q < n; ++q)
+        for (auto& h : hits[q]) distances[q][h.word] = noMatch;
+    for (auto& s : scored) seen[s.doc] = false;
+
+    auto better = [&](const Scored& a, const Scored& b) {
+        if (a.distance != b.distance) return a.distance < b.distance;
+        auto la = _texts[a.doc].size(), lb = _texts[b.doc].size();
+        if (la != lb) return la < lb;
+        return a.doc < b.doc;
+    };
+    std::size_t k = std::min(limit, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + k, scored.end(), better);
+    for (std::size_t i = 0; i < k; ++i)
+        out.push_back({_keys[scored[i].doc], _texts[scored[i].doc], scored[i].distance});
+    return out;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// In-memory fuzzy lookup over short multi-word texts (names).
+//
+// Each distinct word is indexed once by its character trigrams. A query
+// word is expanded to the vocabulary words within its edit budget, and the
+// names containing a match for every query word are ranked by the summed
+// edit distance. Working on the (small) vocabulary instead of every name
+// keeps lookups fast even when some trigrams occur in most names.
+//
+// Work per lookup is bounded so the slowest lookups stay under a
+// millisecond at a million names: a query word verifies at most
+// verifyLimit vocabulary words (those sharing the most trigrams), and at
+// most scanLimit names are scanned. Only very ambiguous queries reach
+// either limit; they may then miss some equally close names.
+//
+// Thread-safe: lookups run concurrently, changes take an exclusive lock.
+class TrigramIndex {
+public:
+    struct Match {
+        std::string key;
+        std::string text;
+        int distance;  // summed edits between query words and name words
+    };
+
+    static constexpr int         maxBudget   = 2;      // edits tolerated per word
+    static constexpr std::size_t scanLimit   = 2048;   // names scanned per search
+    static constexpr std::size_t verifyLimit = 1024;   // words edit-checked per query word
+
+    // Returns false if the key is already indexed.
+    bool add(const std::string& key, const std::string& text);
+    // Indexes key with text, in place of any text it had.
+    void replace(const std::string& key, const std::string& text);
+    // Returns false if the key is not indexed.
+    bool remove(const std::string& key);
+    void clear();
+    std::vector<Match> search(const std::string& query, std::size_t limit = 10) const;
+    std::size_t size() const;
+
+private:
+    struct WordHit {
+        std::uint32_t word;
+        int distance;
+    };
+
+    mutable std::shared_mutex _mutex;
+
+    std::unordered_map<std::string, std::uint32_t> _docIds;
+    std::vector<std::string> _keys;
+    std::vector<std::string> _texts;
+    // Word ids of doc d are _docWordIds[_docWordStart[d] .. _docWordStart[d + 1]),
+    // one allocation for all names so a candidate costs few cache misses.
+    std::vector<std::uint32_t> _docWordStart{0};
+    std::vector<std::uint32_t> _docWordIds;
+
+    std::unordered_map<std::string, std::uint32_t> _wordIds;
+    std::vector<std::string> _words;
+    std::vector<std::vector<std::uint32_t>> _wordDocs;  // ascending doc ids
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> _gramWords;
+
+    std::vector<WordHit> matchWord(const std::string& word) const;
+    // Callers hold the exclusive lock.
+    void insert(const std::string& key, const std::string& text);
+    bool erase(const std::string& key);
+};
+
+// Optimal string alignment distance (Levenshtein plus adjacent swaps),
+// giving up with limit + 1 as soon as the distance must exceed limit.
+int editDistance(std::string_view a, std::string_view b, int limit = 1 << 20);